@@ -0,0 +1,132 @@
+/*
+** File Name: barrier_benchmark.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Compares the topology-aware tree barrier against a centralized
+** sense-reversing barrier and `pthread_barrier_t`. The C++ standard used by
+** this project predates `std::barrier`; glibc implements `pthread_barrier_t`
+** as the same kind of flat barrier.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/barrier.hpp>
+#include <ctop/system_query.hpp>
+
+#include <pthread.h>
+
+static constexpr auto episodes = 100000u;
+
+/*
+** A barrier whose arrival counter and sense flag are shared by all threads.
+*/
+class central_barrier final
+{
+	alignas(64) std::atomic<uint32_t> m_count;
+	alignas(64) std::atomic<uint32_t> m_sense{0};
+	uint32_t m_threads;
+public:
+	explicit central_barrier(uint32_t threads)
+	: m_count{threads}, m_threads{threads} {}
+
+	void arrive_and_wait(uint32_t& local_sense)
+	{
+		local_sense ^= 1;
+		if (m_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			m_count.store(m_threads, std::memory_order_relaxed);
+			m_sense.store(local_sense, std::memory_order_release);
+			return;
+		}
+		while (m_sense.load(std::memory_order_acquire) != local_sense) {
+			ctop::cpu_relax();
+		}
+	}
+};
+
+template <class Function>
+double run(const std::vector<uint32_t>& cpus, Function f)
+{
+	auto threads = std::vector<std::thread>{};
+	std::atomic<uint32_t> ready{0};
+	auto start = std::chrono::steady_clock::time_point{};
+
+	for (auto i = size_t{}; i != cpus.size(); ++i) {
+		threads.emplace_back([&, i] {
+			ctop::pin_current_thread(cpus[i]);
+			if (ready.fetch_add(1) + 1 == cpus.size()) {
+				start = std::chrono::steady_clock::now();
+			}
+			while (ready.load() != cpus.size()) {
+				ctop::cpu_relax();
+			}
+			f(i);
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	auto ns = std::chrono::duration<double, std::nano>(end - start).count();
+	return ns / episodes;
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	auto cpus = std::vector<uint32_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		cpus.push_back(t.os_id());
+	}
+
+	cc::println("Participants: $.", cpus.size());
+
+	auto tree = ctop::tree_barrier{info, cpus};
+	cc::println("Tree depth: $.", tree.depth());
+	auto t1 = run(cpus, [&](size_t i) {
+		for (auto j = 0u; j != episodes; ++j) {
+			tree.arrive_and_wait(i);
+		}
+	});
+	cc::println("Tree barrier: $ ns per episode.", t1);
+
+	central_barrier central{uint32_t(cpus.size())};
+	auto t2 = run(cpus, [&](size_t) {
+		auto sense = uint32_t{};
+		for (auto j = 0u; j != episodes; ++j) {
+			central.arrive_and_wait(sense);
+		}
+	});
+	cc::println("Centralized barrier: $ ns per episode.", t2);
+
+	auto pbarrier = ::pthread_barrier_t{};
+	::pthread_barrier_init(&pbarrier, nullptr, cpus.size());
+	auto t3 = run(cpus, [&](size_t) {
+		for (auto j = 0u; j != episodes; ++j) {
+			::pthread_barrier_wait(&pbarrier);
+		}
+	});
+	::pthread_barrier_destroy(&pbarrier);
+	cc::println("pthread barrier: $ ns per episode.", t3);
+
+	std::atomic<uint32_t> errors{0};
+	auto t4 = run(cpus, [&](size_t i) {
+		for (auto j = 0u; j != episodes; ++j) {
+			auto r = tree.all_reduce(i, uint64_t{i + j},
+				[](uint64_t a, uint64_t b) { return a + b; });
+			auto n = uint64_t(cpus.size());
+			if (r != n * (n - 1) / 2 + n * j) {
+				++errors;
+			}
+		}
+	});
+	cc::println("Tree all-reduce: $ ns per episode ($ errors).", t4,
+		errors.load());
+}
@@ -0,0 +1,47 @@
+/*
+** File Name: cache_benchmark.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Sweeps the working-set size from the L1 cache out to main memory, and
+** compares the levels found in the sweep with the caches reported by CPUID.
+*/
+
+#include <ccbase/format.hpp>
+#include <ctop/cache_measurement.hpp>
+#include <ctop/system_query.hpp>
+
+int main()
+{
+	auto info = *ctop::system_query();
+	auto r = ctop::measure_caches(info);
+
+	cc::println("$ $ $ $", "Working set", "Latency (ns)", "Read (GB/s)",
+		"Write (GB/s)");
+	for (const auto& s : r.samples) {
+		cc::println("${data} $ $ $", s.bytes, s.latency,
+			s.read_bandwidth / 1e9, s.write_bandwidth / 1e9);
+	}
+	cc::println("");
+
+	for (const auto& c : info.cpu_info().caches()) {
+		if (c.type() == ctop::cache_type::instruction) {
+			continue;
+		}
+		if (c.measured_size() == 0) {
+			cc::println("$: no matching level found in the sweep.", c);
+			continue;
+		}
+		cc::println("$: measured ${data}, $ ns, read $ GB/s, write $ GB/s$",
+			c, c.measured_size(), c.measured_latency(),
+			c.measured_read_bandwidth() / 1e9,
+			c.measured_write_bandwidth() / 1e9,
+			c.has_size_mismatch() ? " (size differs from CPUID)" : "");
+	}
+	if (r.memory) {
+		cc::println("Memory: $ ns, read $ GB/s, write $ GB/s.",
+			r.memory->latency, r.memory->read_bandwidth / 1e9,
+			r.memory->write_bandwidth / 1e9);
+	}
+}
@@ -0,0 +1,68 @@
+/*
+** File Name: counter_benchmark.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Compares a shared `std::atomic` counter with the per-CPU counter, with one
+** thread pinned to each available CPU thread.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/per_cpu.hpp>
+#include <ctop/system_query.hpp>
+
+static constexpr auto increments = 10000000u;
+
+template <class Function>
+double run(const std::vector<uint32_t>& cpus, Function f)
+{
+	auto threads = std::vector<std::thread>{};
+	auto start = std::chrono::steady_clock::now();
+
+	for (auto cpu : cpus) {
+		threads.emplace_back([&, cpu] {
+			ctop::pin_current_thread(cpu);
+			for (auto j = 0u; j != increments; ++j) {
+				f();
+			}
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	auto ns = std::chrono::duration<double, std::nano>(end - start).count();
+	return ns / increments;
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	auto cpus = std::vector<uint32_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		cpus.push_back(t.os_id());
+	}
+
+	std::atomic<int64_t> shared{0};
+	auto t1 = run(cpus, [&] {
+		shared.fetch_add(1, std::memory_order_relaxed);
+	});
+	cc::println("std::atomic: $ ns per increment per thread.", t1);
+
+	auto counter = ctop::per_cpu_counter{info};
+	auto t2 = run(cpus, [&] { counter.increment(); });
+	cc::println("Per-CPU counter (rseq: ${bool}): $ ns per increment per "
+		"thread.", counter.uses_rseq(), t2);
+
+	for (const auto& p : counter.sum_by(ctop::topology_domain::package)) {
+		cc::println("Package $: $ increments.", p.first, p.second);
+	}
+}
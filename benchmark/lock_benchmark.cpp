@@ -0,0 +1,109 @@
+/*
+** File Name: lock_benchmark.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Measures lock throughput under contention for `std::mutex`, a plain MCS lock,
+** and the cohort lock, sweeping over thread counts and placements. The
+** critical section updates a few cache lines of shared data, so that handing
+** the lock to another socket also moves the data it protects.
+*/
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/cohort_lock.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/system_query.hpp>
+
+static constexpr auto acquisitions = 1000000u;
+
+struct alignas(64) shared_line
+{
+	uint64_t value;
+};
+
+static std::array<shared_line, 4> shared_data;
+
+void critical_section()
+{
+	for (auto& l : shared_data) {
+		++l.value;
+	}
+}
+
+/*
+** Returns the number of acquisitions per second.
+*/
+template <class Function>
+double run(const std::vector<uint32_t>& cpus, Function f)
+{
+	auto threads = std::vector<std::thread>{};
+	std::atomic<uint32_t> ready{0};
+	auto per_thread = acquisitions / cpus.size();
+
+	for (auto i = size_t{}; i != cpus.size(); ++i) {
+		threads.emplace_back([&, i] {
+			ctop::pin_current_thread(cpus[i]);
+			ready.fetch_add(1);
+			while (ready.load() != cpus.size()) {
+				ctop::cpu_relax();
+			}
+			for (auto j = size_t{}; j != per_thread; ++j) {
+				f();
+			}
+		});
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (auto& t : threads) {
+		t.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	auto s = std::chrono::duration<double>(end - start).count();
+	return per_thread * cpus.size() / s;
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	auto max_threads = size_t(info.available_cpu_threads().size());
+
+	std::mutex mutex{};
+	ctop::mcs_lock mcs{};
+	ctop::cohort_lock cohort{info};
+
+	cc::println("Cohorts: $. Throughput in acquisitions per second.",
+		cohort.cohorts());
+	cc::println("threads, placement, std::mutex, MCS, cohort");
+
+	for (auto p : {ctop::placement_policy::compact, ctop::placement_policy::scatter}) {
+		for (auto n = size_t{1}; n <= max_threads; n *= 2) {
+			auto cpus = ctop::place_threads(info, p, n);
+
+			auto t1 = run(cpus, [&] {
+				std::lock_guard<std::mutex> g{mutex};
+				critical_section();
+			});
+			auto t2 = run(cpus, [&] {
+				ctop::mcs_lock::node node;
+				mcs.lock(node);
+				critical_section();
+				mcs.unlock(node);
+			});
+			auto t3 = run(cpus, [&] {
+				ctop::cohort_lock::guard g{cohort};
+				critical_section();
+			});
+
+			cc::println("$, $, $, $, $", n, p, t1, t2, t3);
+		}
+	}
+}
@@ -0,0 +1,93 @@
+/*
+** File Name: parallel_benchmark.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Measures the bandwidth of a memory-bound sum over a large array in three
+** ways: sequentially, with threads that are started for each call and split
+** the range evenly over an array that was initialized by one thread, and with
+** the worker set over a `partitioned_array`. On a multi-socket host, the
+** first two read most of the array from a remote node.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/parallel.hpp>
+#include <ctop/system_query.hpp>
+
+static constexpr auto elements = size_t{1} << 27;
+static constexpr auto trials = 10u;
+
+/*
+** Returns the bandwidth in GB/s of the fastest of several calls.
+*/
+template <class Function>
+double measure(const Function& f)
+{
+	auto best = 0.0;
+	for (auto i = 0u; i != trials; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		auto s = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+		best = std::max(best, elements * sizeof(uint64_t) / s / 1e9);
+	}
+	return best;
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	ctop::worker_set w{info};
+	auto n = w.size();
+	cc::println("Workers: $. Bandwidth in GB/s.", n);
+
+	auto checksum = uint64_t{};
+	auto plain = std::vector<uint64_t>(elements, 1);
+	auto seq = measure([&] {
+		checksum += std::accumulate(plain.begin(), plain.end(),
+			uint64_t{});
+	});
+
+	auto oblivious = measure([&] {
+		auto partials = std::vector<uint64_t>(8 * n);
+		auto threads = std::vector<std::thread>{};
+		for (auto i = size_t{}; i != n; ++i) {
+			threads.emplace_back([&, i] {
+				auto b = elements / n * i;
+				auto e = i + 1 == n ? elements : b + elements / n;
+				partials[8 * i] = std::accumulate(plain.begin() + b,
+					plain.begin() + e, uint64_t{});
+			});
+		}
+		for (auto& t : threads) {
+			t.join();
+		}
+		for (auto i = size_t{}; i != n; ++i) {
+			checksum += partials[8 * i];
+		}
+	});
+
+	auto a = ctop::partitioned_array<uint64_t>{w, elements};
+	ctop::parallel_for_each(w, a.map(), a.begin(), [](uint64_t& x) {
+		x = 1;
+	});
+	auto partitioned = measure([&] {
+		checksum += ctop::parallel_reduce(w, a.map(), a.begin(),
+			uint64_t{}, std::plus<>{});
+	});
+
+	cc::println("sequential, node-oblivious, partitioned");
+	cc::println("$, $, $", seq, oblivious, partitioned);
+	if (checksum != 3 * uint64_t{trials} * elements) {
+		cc::println("Checksum mismatch.");
+		return 1;
+	}
+}
@@ -0,0 +1,368 @@
+/*
+** File Name: adaptive_wait.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Waiting for another thread in three phases: spinning with `pause`, then
+** waiting in the light C0.1 state with UMONITOR/UMWAIT where WAITPKG is
+** available, and finally parking on a futex. Spinning hands over in well under
+** a microsecond, but takes execution resources from the SMT sibling; parking
+** frees the core, but the wakeup costs tens of microseconds. UMWAIT lies in
+** between: the core stops issuing instructions for this thread, and resumes
+** when the monitored cache line is written. The length of each phase is
+** calibrated from the measured latency of `pause` and the SMT layout.
+**
+** MONITOR/MWAIT, which leaf 5 describes, can only be executed in ring 0 on
+** Linux, so user space relies on WAITPKG. Leaf 5 is still read for the size
+** of the monitored line, which bounds the data that can cause false wakeups.
+*/
+
+#ifndef Z4C034A9F_DADF_41FF_8B11_A67653E0E66D
+#define Z4C034A9F_DADF_41FF_8B11_A67653E0E66D
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <tuple>
+
+#include <ccbase/format.hpp>
+#include <ccbase/utility.hpp>
+#include <ctop/barrier.hpp>
+#include <ctop/cpuid.hpp>
+#include <ctop/cpuid_leaf.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+/*
+** The features of leaves 1, 5, and 7 that concern waiting.
+*/
+struct wait_features
+{
+	// MONITOR/MWAIT, which only the kernel can use on Linux.
+	bool monitor_mwait{};
+	// The smallest and largest monitor line sizes, in bytes.
+	uint16_t min_monitor_line{};
+	uint16_t max_monitor_line{};
+	// UMONITOR, UMWAIT, and TPAUSE, which user space can use.
+	bool waitpkg{};
+};
+
+std::ostream& operator<<(std::ostream& os, const wait_features& f)
+{
+	cc::write(os, "wait features: {MONITOR/MWAIT: ${bool}, monitor line: "
+		"$-$ bytes, WAITPKG: ${bool}}", f.monitor_mwait,
+		f.min_monitor_line, f.max_monitor_line, f.waitpkg);
+	return os;
+}
+
+/*
+** Decodes the features from the output of `cpuid_fn(leaf)`, which must return
+** EAX, EBX, ECX, and EDX like `cpuid` with ECX set to zero.
+*/
+template <class CpuidFn>
+wait_features detect_wait_features(const CpuidFn& cpuid_fn)
+{
+	auto r = wait_features{};
+	uint32_t max_leaf, eax, ebx, ecx;
+	std::tie(max_leaf, std::ignore, std::ignore, std::ignore) =
+		cpuid_fn(cpuid_leaf::basic_info);
+
+	std::tie(std::ignore, std::ignore, ecx, std::ignore) =
+		cpuid_fn(cpuid_leaf::version_info);
+	r.monitor_mwait = (ecx >> 3) & 1;
+
+	if (r.monitor_mwait &&
+		max_leaf >= cpuid_leaf::monitor_mwait_info)
+	{
+		std::tie(eax, ebx, std::ignore, std::ignore) =
+			cpuid_fn(cpuid_leaf::monitor_mwait_info);
+		r.min_monitor_line = eax & 0xFFFF;
+		r.max_monitor_line = ebx & 0xFFFF;
+	}
+	if (max_leaf >= cpuid_leaf::enumerable_feature_info) {
+		std::tie(std::ignore, std::ignore, ecx, std::ignore) =
+			cpuid_fn(cpuid_leaf::enumerable_feature_info);
+		r.waitpkg = (ecx >> 5) & 1;
+	}
+	return r;
+}
+
+wait_features detect_wait_features()
+{
+	return detect_wait_features([](uint32_t leaf) {
+		return cpuid(leaf, 0);
+	});
+}
+
+#if PLATFORM_COMPILER == PLATFORM_COMPILER_GCC   || \
+    PLATFORM_COMPILER == PLATFORM_COMPILER_CLANG || \
+    PLATFORM_COMPILER == PLATFORM_COMPILER_ICC
+
+CC_ALWAYS_INLINE uint64_t read_tsc() noexcept
+{
+	return __builtin_ia32_rdtsc();
+}
+
+/*
+** The WAITPKG instructions are emitted as bytes, so that neither `-mwaitpkg`
+** nor a recent assembler is needed. They must only be executed if
+** `wait_features::waitpkg` is set.
+*/
+CC_ALWAYS_INLINE void umonitor(const volatile void* p) noexcept
+{
+	// umonitor %rax
+	asm volatile(".byte 0xF3, 0x0F, 0xAE, 0xF0" : : "a" (p) : "memory");
+}
+
+/*
+** Waits in C0.1 until the monitored line is written, the TSC reaches
+** `deadline`, or an interrupt arrives. Returns true if the wait was cut short
+** by the limit that the OS imposes.
+*/
+CC_ALWAYS_INLINE bool umwait(uint64_t deadline) noexcept
+{
+	uint8_t cf;
+	// umwait %ecx, with ECX = 1 to select C0.1.
+	asm volatile(".byte 0xF2, 0x0F, 0xAE, 0xF1\n\tsetc %0"
+		: "=q" (cf)
+		: "c" (1), "a" (uint32_t(deadline)),
+		  "d" (uint32_t(deadline >> 32))
+		: "memory", "cc");
+	return cf;
+}
+
+#else
+	#error "Unsupported compiler."
+#endif
+
+/*
+** Returns the longest UMWAIT that the kernel allows, in TSC cycles, or zero if
+** the kernel does not report a limit.
+*/
+uint64_t umwait_max_time(const std::string& sysfs_root = default_sysfs_root)
+{
+	auto t = try_read_integer(sysfs_root +
+		"/devices/system/cpu/umwait_control/max_time");
+	return t ? *t : 0;
+}
+
+/*
+** The length of each phase of `wait_word::wait`.
+*/
+class wait_policy final
+{
+	double m_pause_ns{};
+	double m_tsc_per_ns{};
+	uint32_t m_spin_iterations{};
+	// The total time to spend in UMWAIT, and the length of each UMWAIT,
+	// in TSC cycles. Zero if WAITPKG is not used.
+	uint64_t m_monitor_cycles{};
+	uint64_t m_umwait_cycles{};
+public:
+	explicit wait_policy() noexcept {}
+
+	bool uses_monitor() const noexcept
+	{ return m_monitor_cycles != 0; }
+
+	DEFINE_COPY_GETTER_SETTER(wait_policy, pause_latency, m_pause_ns)
+	DEFINE_COPY_GETTER_SETTER(wait_policy, tsc_per_ns, m_tsc_per_ns)
+	DEFINE_COPY_GETTER_SETTER(wait_policy, spin_iterations, m_spin_iterations)
+	DEFINE_COPY_GETTER_SETTER(wait_policy, monitor_cycles, m_monitor_cycles)
+	DEFINE_COPY_GETTER_SETTER(wait_policy, umwait_cycles, m_umwait_cycles)
+};
+
+std::ostream& operator<<(std::ostream& os, const wait_policy& p)
+{
+	cc::write(os, "wait policy: {pause: $ ns, spin: $ iterations, "
+		"monitor: $ cycles}", p.pause_latency(), p.spin_iterations(),
+		p.monitor_cycles());
+	return os;
+}
+
+/*
+** Measures the latency of `pause` and the TSC frequency, and returns a policy
+** that spins for about `spin_ns` and then waits with UMWAIT for about
+** `monitor_ns`, if WAITPKG is available, before parking. The latency of
+** `pause` ranges from a few cycles to well over a hundred, depending on the
+** microarchitecture, so a fixed iteration count would be far off on one or
+** the other.
+**
+** If the CPU threads of `info` use SMT, a spinning thread slows down its
+** sibling, so the spinning phase is divided by the number of threads per
+** core; with WAITPKG, the time saved is spent in UMWAIT instead, which
+** leaves the core to the sibling.
+*/
+wait_policy calibrate_wait(
+	const system_info& info,
+	const wait_features& f,
+	double spin_ns = 4000,
+	double monitor_ns = 50000,
+	const std::string& sysfs_root = default_sysfs_root
+)
+{
+	using clock = std::chrono::steady_clock;
+	static constexpr auto rounds = 8;
+	static constexpr auto pauses = 1000;
+
+	// The minimum over several rounds excludes preemption.
+	auto pause_ns = 1e9;
+	auto tsc_per_ns = 0.0;
+	for (auto i = 0; i != rounds; ++i) {
+		auto t0 = clock::now();
+		auto c0 = read_tsc();
+		for (auto j = 0; j != pauses; ++j) {
+			cpu_relax();
+		}
+		auto c1 = read_tsc();
+		auto t1 = clock::now();
+		auto ns = std::chrono::duration<double, std::nano>(t1 - t0).
+			count();
+		if (ns > 0 && ns / pauses < pause_ns) {
+			pause_ns = ns / pauses;
+			tsc_per_ns = (c1 - c0) / ns;
+		}
+	}
+
+	auto smt = std::any_of(info.available_numa_nodes().begin(),
+		info.available_numa_nodes().end(),
+		[](const numa_node_info& n) { return n.cpu_info().uses_smt(); });
+	auto siblings = smt ? std::max(info.cpu_info().threads_per_core(), 1u) :
+		1u;
+	auto spin = spin_ns / siblings;
+
+	auto r = wait_policy{};
+	r.pause_latency(pause_ns).tsc_per_ns(tsc_per_ns).
+		spin_iterations(uint32_t(spin / pause_ns));
+	if (f.waitpkg && tsc_per_ns > 0) {
+		auto max = umwait_max_time(sysfs_root);
+		auto total = uint64_t((monitor_ns + spin_ns - spin) * tsc_per_ns);
+		r.monitor_cycles(total).umwait_cycles(max == 0 ? total :
+			std::min(max, total));
+	}
+	return r;
+}
+
+/*
+** Which phase of `wait_word::wait` saw the value change.
+*/
+enum class wait_phase : uint8_t
+{
+	spin,
+	monitor,
+	park,
+};
+
+std::ostream& operator<<(std::ostream& os, const wait_phase& p)
+{
+	switch (p) {
+	case wait_phase::spin:
+		cc::write(os, "spin");
+		return os;
+	case wait_phase::monitor:
+		cc::write(os, "monitor");
+		return os;
+	case wait_phase::park:
+		cc::write(os, "park");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** A 32-bit word on which threads wait for a change of value, like a futex.
+** The value and the count of parked threads share a cache line of their own,
+** so that the monitored line is only written when the value changes or a
+** thread parks. `notify` only makes a system call if a thread is parked.
+*/
+class alignas(64) wait_word final
+{
+	std::atomic<uint32_t> m_value;
+	std::atomic<uint32_t> m_parked{0};
+public:
+	explicit wait_word(uint32_t value = 0) noexcept : m_value{value} {}
+
+	wait_word(const wait_word&) = delete;
+	wait_word& operator=(const wait_word&) = delete;
+
+	uint32_t load(std::memory_order o = std::memory_order_acquire)
+	const noexcept { return m_value.load(o); }
+
+	/*
+	** Stores `value` and wakes the parked threads. Threads that have yet to
+	** park see the new value and return without parking.
+	*/
+	void notify(uint32_t value) noexcept
+	{
+		m_value.store(value, std::memory_order_seq_cst);
+		if (m_parked.load(std::memory_order_seq_cst) != 0) {
+			futex(FUTEX_WAKE_PRIVATE, INT32_MAX);
+		}
+	}
+
+	/*
+	** Waits until the value differs from `old`, and returns the phase in
+	** which the change was seen. Spurious wakeups are handled internally.
+	*/
+	wait_phase wait(uint32_t old, const wait_policy& p) noexcept
+	{
+		for (auto i = uint32_t{}; i != p.spin_iterations(); ++i) {
+			if (load() != old) {
+				return wait_phase::spin;
+			}
+			cpu_relax();
+		}
+		if (load() != old) {
+			return wait_phase::spin;
+		}
+
+		if (p.uses_monitor()) {
+			auto end = read_tsc() + p.monitor_cycles();
+			for (auto now = read_tsc(); now < end; now = read_tsc()) {
+				umonitor(&m_value);
+				if (load() != old) {
+					return wait_phase::monitor;
+				}
+				umwait(std::min(end, now + p.umwait_cycles()));
+				if (load() != old) {
+					return wait_phase::monitor;
+				}
+			}
+		}
+
+		m_parked.fetch_add(1, std::memory_order_seq_cst);
+		while (m_value.load(std::memory_order_seq_cst) == old) {
+			// Returns immediately if the value has already changed.
+			futex(FUTEX_WAIT_PRIVATE, old);
+		}
+		m_parked.fetch_sub(1, std::memory_order_relaxed);
+		return wait_phase::park;
+	}
+private:
+	void futex(int op, uint32_t value) noexcept
+	{
+		::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_value), op,
+			value, nullptr, nullptr, 0);
+	}
+};
+
+}
+
+#endif
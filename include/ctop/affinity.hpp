@@ -0,0 +1,313 @@
+/*
+** File Name: affinity.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z4EFE946A_179C_4EFE_8495_3C7E22E1B4EE
+#define Z4EFE946A_179C_4EFE_8495_3C7E22E1B4EE
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/numa_error.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#ifndef _GNU_SOURCE
+		#define _GNU_SOURCE
+	#endif
+
+	// For `sched_setaffinity`.
+	#include <sched.h>
+	#include <numa.h>
+	#include <numaif.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+enum class memory_policy : uint8_t
+{
+	// Leave the memory policy of the thread as it is.
+	unchanged,
+	// Allocate only from the given nodes.
+	bind,
+	// Allocate from the first given node when it has free memory.
+	preferred,
+	// Interleave pages across the given nodes.
+	interleave,
+};
+
+namespace detail {
+
+/*
+** A CPU mask sized for the kernel, which may support more CPU threads than
+** fit in a `cpu_set_t`.
+*/
+class dynamic_cpu_set final
+{
+	std::vector<unsigned long> m_bits{};
+public:
+	explicit dynamic_cpu_set() noexcept {}
+
+	::cpu_set_t* data() noexcept
+	{ return reinterpret_cast<::cpu_set_t*>(m_bits.data()); }
+
+	const ::cpu_set_t* data() const noexcept
+	{ return reinterpret_cast<const ::cpu_set_t*>(m_bits.data()); }
+
+	size_t size() const noexcept
+	{ return m_bits.size() * sizeof(unsigned long); }
+
+	/*
+	** Reads the affinity of the calling thread, growing the mask until the
+	** kernel accepts its size.
+	*/
+	void get()
+	{
+		m_bits.resize(sizeof(::cpu_set_t) / sizeof(unsigned long));
+		while (::sched_getaffinity(0, size(), data()) == -1) {
+			if (errno != EINVAL || size() >= (1u << 20)) {
+				throw numa_error{cc::format("failed to get thread "
+					"affinity: $", std::strerror(errno))};
+			}
+			m_bits.resize(2 * m_bits.size());
+		}
+	}
+
+	/*
+	** Sets the affinity of the calling thread, and returns false on
+	** failure.
+	*/
+	bool set() const noexcept
+	{ return ::sched_setaffinity(0, size(), data()) == 0; }
+
+	/*
+	** Replaces the mask with `s`, growing it if needed.
+	*/
+	void assign(const cpu_set& s)
+	{
+		auto words = s.empty() ? size_t{} :
+			s.back() / (8 * sizeof(unsigned long)) + 1;
+		m_bits.assign(std::max(words, m_bits.size()), 0);
+		s.to_cpu_mask(data(), size());
+	}
+
+	cpu_set members() const
+	{ return cpu_set::from_cpu_mask(data(), size()); }
+};
+
+/*
+** The memory policy of a thread, as set by `set_mempolicy`.
+*/
+class thread_mempolicy final
+{
+	struct bitmask* m_nodes{};
+	int m_mode{};
+public:
+	explicit thread_mempolicy()
+	{
+		m_nodes = ::numa_allocate_nodemask();
+		if (m_nodes == nullptr) {
+			throw numa_error{"failed to allocate node mask"};
+		}
+	}
+
+	~thread_mempolicy()
+	{ ::numa_bitmask_free(m_nodes); }
+
+	thread_mempolicy(const thread_mempolicy&) = delete;
+	thread_mempolicy& operator=(const thread_mempolicy&) = delete;
+
+	int mode() const noexcept
+	{ return m_mode; }
+
+	bool has_node(uint32_t node) const noexcept
+	{ return ::numa_bitmask_isbitset(m_nodes, node); }
+
+	void get()
+	{
+		// libnuma passes one more than the size of the mask, and so must
+		// we.
+		if (::get_mempolicy(&m_mode, m_nodes->maskp, m_nodes->size + 1,
+			nullptr, 0) == -1)
+		{
+			throw numa_error{cc::format("failed to get memory "
+				"policy: $", std::strerror(errno))};
+		}
+	}
+
+	bool set() const noexcept
+	{
+		// The default and local policies take no nodes.
+		if (m_mode == MPOL_DEFAULT || m_mode == MPOL_LOCAL) {
+			return ::set_mempolicy(m_mode, nullptr, 0) == 0;
+		}
+		return ::set_mempolicy(m_mode, m_nodes->maskp,
+			m_nodes->size + 1) == 0;
+	}
+
+	void assign(memory_policy p, const std::vector<uint32_t>& nodes)
+	{
+		switch (p) {
+		case memory_policy::bind:       m_mode = MPOL_BIND; break;
+		case memory_policy::preferred:  m_mode = MPOL_PREFERRED; break;
+		case memory_policy::interleave: m_mode = MPOL_INTERLEAVE; break;
+		default: throw std::invalid_argument{"unknown memory policy"};
+		}
+		if (nodes.empty()) {
+			throw std::invalid_argument{"memory policy requires nodes"};
+		}
+
+		::numa_bitmask_clearall(m_nodes);
+		for (auto n : nodes) {
+			if (n >= m_nodes->size) {
+				throw numa_error{n, "node out of range"};
+			}
+			::numa_bitmask_setbit(m_nodes, n);
+		}
+	}
+};
+
+}
+
+/*
+** Restricts the calling thread to the CPU threads with the given OS IDs. The
+** mask is sized for the largest ID, so IDs beyond the 1024 that fit in a
+** `cpu_set_t` are not dropped.
+*/
+void pin_current_thread(const std::vector<uint32_t>& os_ids)
+{
+	auto set = detail::dynamic_cpu_set{};
+	set.assign(cpu_set::from_range(os_ids));
+	if (!set.set()) {
+		auto msg = cc::format("failed to schedule thread on $ CPUs: $",
+			os_ids.size(), std::strerror(errno));
+		throw numa_error{msg};
+	}
+}
+
+/*
+** Restricts the calling thread to the CPU thread with the given OS ID.
+*/
+void pin_current_thread(uint32_t os_id)
+{
+	auto set = detail::dynamic_cpu_set{};
+	set.assign(cpu_set{os_id});
+	if (!set.set()) {
+		auto msg = cc::format("failed to schedule thread on CPU $: $",
+			os_id, std::strerror(errno));
+		throw numa_error{msg};
+	}
+}
+
+/*
+** Saves the CPU affinity and memory policy of the calling thread, and restores
+** both on destruction. Must be destroyed on the thread that created it.
+*/
+class thread_state_guard final
+{
+	detail::dynamic_cpu_set m_cpus{};
+	detail::thread_mempolicy m_policy{};
+public:
+	explicit thread_state_guard()
+	{
+		m_cpus.get();
+		m_policy.get();
+	}
+
+	~thread_state_guard()
+	{
+		m_cpus.set();
+		m_policy.set();
+	}
+
+	thread_state_guard(const thread_state_guard&) = delete;
+	thread_state_guard& operator=(const thread_state_guard&) = delete;
+};
+
+/*
+** Restricts the calling thread to the given CPU threads and, unless the policy
+** is `memory_policy::unchanged`, sets its memory policy over the given nodes.
+** Both settings are read back after they are applied, and `numa_error` is
+** thrown if the kernel did not apply them as requested, e.g. because a cpuset
+** excludes some of the CPU threads or nodes. The previous settings are
+** restored on destruction, or if the constructor throws.
+**
+** Memory that the thread already touched stays where it is.
+*/
+class scoped_binding final
+{
+	thread_state_guard m_saved{};
+public:
+	explicit scoped_binding(
+		const std::vector<uint32_t>& cpus,
+		memory_policy p = memory_policy::unchanged,
+		const std::vector<uint32_t>& nodes = {}
+	)
+	{
+		if (cpus.empty()) {
+			throw std::invalid_argument{"no CPU threads given"};
+		}
+
+		auto set = cpu_set::from_range(cpus);
+		auto want = detail::dynamic_cpu_set{};
+		want.get();
+		want.assign(set);
+		if (!want.set()) {
+			throw numa_error{cc::format("failed to schedule thread on "
+				"$ CPUs: $", cpus.size(), std::strerror(errno))};
+		}
+		auto got = detail::dynamic_cpu_set{};
+		got.get();
+		if (got.members() != set) {
+			throw numa_error{"thread affinity differs from the "
+				"requested CPU threads"};
+		}
+
+		if (p == memory_policy::unchanged) {
+			return;
+		}
+		detail::thread_mempolicy policy{};
+		policy.assign(p, nodes);
+		if (!policy.set()) {
+			throw numa_error{cc::format("failed to set memory policy: "
+				"$", std::strerror(errno))};
+		}
+		detail::thread_mempolicy check{};
+		check.get();
+		if (check.mode() != policy.mode()) {
+			throw numa_error{"memory policy differs from the requested "
+				"policy"};
+		}
+		// The preferred policy only keeps the first node.
+		auto n = p == memory_policy::preferred ? size_t{1} : nodes.size();
+		for (auto i = size_t{}; i != n; ++i) {
+			if (!check.has_node(nodes[i])) {
+				throw numa_error{nodes[i], "node missing from memory "
+					"policy"};
+			}
+		}
+	}
+
+	explicit scoped_binding(
+		uint32_t cpu,
+		memory_policy p = memory_policy::unchanged,
+		const std::vector<uint32_t>& nodes = {}
+	) : scoped_binding{std::vector<uint32_t>{cpu}, p, nodes} {}
+
+	scoped_binding(const scoped_binding&) = delete;
+	scoped_binding& operator=(const scoped_binding&) = delete;
+};
+
+}
+
+#endif
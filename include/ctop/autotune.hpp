@@ -0,0 +1,485 @@
+/*
+** File Name: autotune.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Chooses a placement for a kernel by running it under each placement policy
+** and thread count, and remembers the choice for the host. Which policy wins
+** depends on whether the kernel is bound by a shared cache, by memory
+** bandwidth, or by the execution units of each core, and that changes from one
+** CPU model to the next.
+*/
+
+#ifndef Z8F8B54D4_B0F5_4DEB_98C9_A88A943BD51A
+#define Z8F8B54D4_B0F5_4DEB_98C9_A88A943BD51A
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/scope_exit.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/barrier.hpp>
+#include <ctop/parse_error.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <fcntl.h>
+	#include <stdlib.h>
+	#include <sys/file.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+/*
+** The throughput of the kernel under one policy and thread count.
+*/
+struct placement_sample
+{
+	placement_policy policy;
+	size_t threads;
+	std::vector<uint32_t> cpus;
+	// The mean and standard deviation over the repetitions, in operations
+	// per second.
+	double mean;
+	double stddev;
+};
+
+std::ostream& operator<<(std::ostream& os, const placement_sample& s)
+{
+	cc::write(os, "$ threads, $: $ ops/s (stddev $)", s.threads, s.policy,
+		s.mean, s.stddev);
+	return os;
+}
+
+struct placement_tuning_options
+{
+	std::vector<placement_policy> policies = {
+		placement_policy::compact,
+		placement_policy::scatter,
+		placement_policy::one_per_core,
+		placement_policy::smt_pairs,
+	};
+	// Empty means the powers of two below the number of available CPU
+	// threads, followed by that number.
+	std::vector<size_t> thread_counts = {};
+	size_t repetitions = 5;
+	// How long each repetition runs.
+	std::chrono::nanoseconds duration = std::chrono::milliseconds{100};
+};
+
+class placement_tuning final
+{
+	std::vector<placement_sample> m_samples{};
+public:
+	explicit placement_tuning(std::vector<placement_sample> samples)
+	noexcept : m_samples(std::move(samples)) {}
+
+	const std::vector<placement_sample>& samples() const noexcept
+	{ return m_samples; }
+
+	/*
+	** Returns the samples of the policy in increasing order of thread count.
+	*/
+	std::vector<placement_sample> scaling_curve(placement_policy p) const
+	{
+		auto r = std::vector<placement_sample>{};
+		std::copy_if(m_samples.begin(), m_samples.end(),
+			std::back_inserter(r),
+			[&](const placement_sample& s) { return s.policy == p; });
+		std::sort(r.begin(), r.end(),
+			[](const placement_sample& lhs, const placement_sample& rhs) {
+				return lhs.threads < rhs.threads;
+			});
+		return r;
+	}
+
+	/*
+	** Returns the sample with the highest mean throughput.
+	*/
+	const placement_sample& best() const
+	{
+		if (m_samples.empty()) {
+			throw std::logic_error{"no placements were measured"};
+		}
+		return *std::max_element(m_samples.begin(), m_samples.end(),
+			[](const placement_sample& lhs, const placement_sample& rhs) {
+				return lhs.mean < rhs.mean;
+			});
+	}
+};
+
+namespace detail {
+
+/*
+** Runs `kernel(i, cpus.size())` in a loop on one thread pinned to each of the
+** CPU threads for the given duration, and returns the number of operations
+** completed per second. An exception thrown by the kernel is rethrown here.
+*/
+template <class Kernel>
+double run_placement(
+	const std::vector<uint32_t>& cpus,
+	std::chrono::nanoseconds duration,
+	Kernel& kernel
+)
+{
+	using clock = std::chrono::steady_clock;
+
+	auto n = cpus.size();
+	auto ops = std::vector<uint64_t>(n);
+	auto errors = std::vector<std::exception_ptr>(n);
+	std::atomic<size_t> ready{0};
+	std::atomic<bool> go{false};
+	std::atomic<bool> stop{false};
+	auto threads = std::vector<std::thread>{};
+
+	for (auto i = size_t{}; i != n; ++i) {
+		threads.emplace_back([&, i] {
+			try {
+				pin_current_thread(cpus[i]);
+				++ready;
+				while (!go.load(std::memory_order_acquire)) {
+					cpu_relax();
+				}
+				auto count = uint64_t{};
+				while (!stop.load(std::memory_order_relaxed)) {
+					count += kernel(i, n);
+				}
+				ops[i] = count;
+			}
+			catch (...) {
+				errors[i] = std::current_exception();
+				++ready;
+			}
+		});
+	}
+
+	while (ready.load() != n) {
+		cpu_relax();
+	}
+	auto start = clock::now();
+	go.store(true, std::memory_order_release);
+	std::this_thread::sleep_for(duration);
+	stop.store(true, std::memory_order_relaxed);
+	for (auto& t : threads) {
+		t.join();
+	}
+	auto secs = std::chrono::duration<double>(clock::now() - start).count();
+
+	for (const auto& e : errors) {
+		if (e) {
+			std::rethrow_exception(e);
+		}
+	}
+	auto total = uint64_t{};
+	for (auto c : ops) {
+		total += c;
+	}
+	return total / secs;
+}
+
+/*
+** The name of the policy in the placement cache.
+*/
+const char* placement_policy_key(placement_policy p)
+{
+	switch (p) {
+	case placement_policy::compact:
+		return "compact";
+	case placement_policy::scatter:
+		return "scatter";
+	case placement_policy::one_per_core:
+		return "one_per_core";
+	case placement_policy::smt_pairs:
+		return "smt_pairs";
+	default:
+		throw std::invalid_argument{"unknown placement policy"};
+	}
+}
+
+std::vector<size_t> default_thread_counts(size_t max)
+{
+	auto r = std::vector<size_t>{};
+	for (auto n = size_t{1}; n < max; n *= 2) {
+		r.push_back(n);
+	}
+	r.push_back(max);
+	return r;
+}
+
+placement_policy parse_placement_policy(boost::string_ref s, size_t offset)
+{
+	for (auto p : {placement_policy::compact, placement_policy::scatter,
+		placement_policy::one_per_core, placement_policy::smt_pairs})
+	{
+		if (s == placement_policy_key(p)) {
+			return p;
+		}
+	}
+	throw parse_error{offset, "unknown placement policy"};
+}
+
+}
+
+/*
+** Runs the kernel under every combination of policy and thread count in the
+** options. The kernel is called as `kernel(i, n)` by the `i`th of `n`
+** threads, repeatedly until the repetition ends, and returns the number of
+** operations that it completed. Combinations that a policy cannot place, such
+** as more threads than cores under `one_per_core`, are skipped.
+*/
+template <class Kernel>
+placement_tuning tune_placement(
+	const system_info& info,
+	Kernel kernel,
+	const placement_tuning_options& opts = {}
+)
+{
+	auto counts = opts.thread_counts;
+	if (counts.empty()) {
+		counts = detail::default_thread_counts(
+			info.available_cpu_threads().size());
+	}
+
+	auto r = std::vector<placement_sample>{};
+	for (auto p : opts.policies) {
+		for (auto n : counts) {
+			auto s = placement_sample{p, n, {}, 0, 0};
+			try {
+				s.cpus = place_threads(info, p, n);
+			}
+			catch (const std::invalid_argument&) {
+				continue;
+			}
+
+			auto x = std::vector<double>{};
+			for (auto i = size_t{}; i != opts.repetitions; ++i) {
+				x.push_back(detail::run_placement(s.cpus,
+					opts.duration, kernel));
+			}
+			for (auto v : x) {
+				s.mean += v / x.size();
+			}
+			for (auto v : x) {
+				s.stddev += (v - s.mean) * (v - s.mean);
+			}
+			s.stddev = x.size() > 1 ?
+				std::sqrt(s.stddev / (x.size() - 1)) : 0;
+			r.push_back(std::move(s));
+		}
+	}
+	return placement_tuning{std::move(r)};
+}
+
+/*
+** Identifies the host for the placement cache. Hosts with the same CPU model
+** and the same numbers of cores, threads, and NUMA nodes share tuned
+** placements.
+*/
+std::string cpu_signature(const system_info& info)
+{
+	const auto& cpu = info.cpu_info();
+	const auto& v = cpu.version();
+	return cc::format("$:$:$:$:$c:$t:$n", v.vendor(), unsigned(v.family()),
+		unsigned(v.model()), unsigned(v.stepping()),
+		unsigned(cpu.total_cores()), unsigned(cpu.total_threads()),
+		info.available_numa_nodes().size());
+}
+
+/*
+** `$XDG_CACHE_HOME/ctop/placements`, or `$HOME/.cache/ctop/placements`.
+*/
+std::string default_placement_cache_path()
+{
+	if (auto p = std::getenv("XDG_CACHE_HOME")) {
+		return std::string{p} + "/ctop/placements";
+	}
+	if (auto p = std::getenv("HOME")) {
+		return std::string{p} + "/.cache/ctop/placements";
+	}
+	throw std::runtime_error{"neither XDG_CACHE_HOME nor HOME is set"};
+}
+
+/*
+** The configuration stored for one kernel on one kind of host.
+*/
+struct tuned_placement
+{
+	placement_policy policy;
+	size_t threads;
+	// The mean throughput measured when the placement was tuned.
+	double throughput;
+
+	std::vector<uint32_t> cpus(const system_info& info) const
+	{ return place_threads(info, policy, threads); }
+};
+
+namespace detail {
+
+/*
+** Reads the placement cache as lines of the form
+** `<signature> <kernel> <policy> <threads> <throughput>`. A missing file is
+** an empty cache.
+*/
+std::vector<std::pair<std::string, std::string>>
+read_placement_cache(const std::string& path)
+{
+	auto r = std::vector<std::pair<std::string, std::string>>{};
+	auto is = std::ifstream{path};
+	auto line = std::string{};
+	while (std::getline(is, line)) {
+		auto i = line.find(' ');
+		auto j = i == std::string::npos ? i : line.find(' ', i + 1);
+		if (j == std::string::npos) {
+			continue;
+		}
+		r.emplace_back(line.substr(0, j), line);
+	}
+	return r;
+}
+
+void make_parent_directories(const std::string& path)
+{
+	for (auto i = path.find('/', 1); i != std::string::npos;
+		i = path.find('/', i + 1))
+	{
+		auto dir = path.substr(0, i);
+		if (::mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to create " + dir};
+		}
+	}
+}
+
+}
+
+/*
+** Stores the placement for the kernel named `kernel` on hosts like this one,
+** replacing any earlier entry. The file is replaced atomically, so that a
+** service starting at the same time never reads a partial file. Processes
+** storing placements concurrently are serialized by an exclusive lock on
+** `<path>.lock`, so that none of their entries are lost.
+*/
+void store_tuned_placement(
+	const system_info& info,
+	boost::string_ref kernel,
+	const tuned_placement& t,
+	const std::string& path = default_placement_cache_path()
+)
+{
+	if (kernel.empty() || kernel.find(' ') != boost::string_ref::npos ||
+		kernel.find('\n') != boost::string_ref::npos)
+	{
+		throw std::invalid_argument{"kernel name must be a non-empty "
+			"word"};
+	}
+
+	detail::make_parent_directories(path);
+	auto lock = path + ".lock";
+	auto lock_fd = ::open(lock.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (lock_fd == -1) {
+		throw std::system_error{errno, std::system_category(),
+			"failed to open " + lock};
+	}
+	BOOST_SCOPE_EXIT_ALL(&) {
+		::close(lock_fd);
+	};
+	while (::flock(lock_fd, LOCK_EX) == -1) {
+		if (errno != EINTR) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to lock " + lock};
+		}
+	}
+
+	auto key = cpu_signature(info) + " " + kernel.to_string();
+	auto entries = detail::read_placement_cache(path);
+	entries.erase(std::remove_if(entries.begin(), entries.end(),
+		[&](const std::pair<std::string, std::string>& e) {
+			return e.first == key;
+		}), entries.end());
+	entries.emplace_back(key, cc::format("$ $ $ $", key,
+		detail::placement_policy_key(t.policy), t.threads, t.throughput));
+
+	auto tmp = path + ".XXXXXX";
+	auto tmp_fd = ::mkstemp(&tmp[0]);
+	if (tmp_fd == -1) {
+		throw std::system_error{errno, std::system_category(),
+			"failed to create " + tmp};
+	}
+	::fchmod(tmp_fd, 0644);
+	::close(tmp_fd);
+
+	auto os = std::ofstream{tmp};
+	for (const auto& e : entries) {
+		os << e.second << '\n';
+	}
+	os.close();
+	if (!os) {
+		std::remove(tmp.c_str());
+		throw std::runtime_error{"failed to write " + tmp};
+	}
+	if (std::rename(tmp.c_str(), path.c_str()) == -1) {
+		auto e = errno;
+		std::remove(tmp.c_str());
+		throw std::system_error{e, std::system_category(),
+			"failed to rename " + tmp};
+	}
+}
+
+/*
+** Returns the placement stored for the kernel on hosts like this one, or
+** `boost::none` if it has not been tuned here.
+*/
+boost::optional<tuned_placement> load_tuned_placement(
+	const system_info& info,
+	boost::string_ref kernel,
+	const std::string& path = default_placement_cache_path()
+)
+{
+	auto key = cpu_signature(info) + " " + kernel.to_string();
+	for (const auto& e : detail::read_placement_cache(path)) {
+		if (e.first != key) {
+			continue;
+		}
+
+		auto is = std::istringstream{e.second.substr(key.size())};
+		auto policy = std::string{};
+		auto t = tuned_placement{};
+		if (!(is >> policy >> t.threads >> t.throughput)) {
+			throw parse_error{key.size(), "malformed placement cache "
+				"entry"};
+		}
+		t.policy = detail::parse_placement_policy(policy, key.size());
+		return t;
+	}
+	return boost::none;
+}
+
+}
+
+#endif
@@ -0,0 +1,389 @@
+/*
+** File Name: barrier.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z1D662641_22E8_4E7E_9BE6_868922298A87
+#define Z1D662641_22E8_4E7E_9BE6_868922298A87
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <ccbase/utility.hpp>
+#include <ctop/node_memory.hpp>
+#include <ctop/numa_error.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+#if PLATFORM_COMPILER == PLATFORM_COMPILER_GCC   || \
+    PLATFORM_COMPILER == PLATFORM_COMPILER_CLANG || \
+    PLATFORM_COMPILER == PLATFORM_COMPILER_ICC
+
+CC_ALWAYS_INLINE void cpu_relax() noexcept
+{
+	__builtin_ia32_pause();
+}
+
+#else
+	#error "Unsupported compiler."
+#endif
+
+/*
+** Returns one key for each level of the hierarchy below the root, ordered from
+** the outermost level to the innermost one: NUMA node, package, the domains of
+** the shared caches from the last level inwards, and finally the core. Two
+** threads that agree on the first `n` keys belong to the same group at depth
+** `n`.
+*/
+std::vector<uint32_t>
+hierarchy_keys(uint32_t os_id, const system_info& info)
+{
+	auto node = find_numa_node(os_id, info);
+	auto thread = find_cpu_thread(os_id, info);
+	if (node == nullptr || thread == nullptr) {
+		throw numa_error{cc::format("CPU thread $ is not available",
+			os_id)};
+	}
+
+	const auto& cpu = info.cpu_info();
+	auto keys = std::vector<uint32_t>{node->id(), package_id(*thread, cpu)};
+
+	auto caches = std::vector<cpu_cache>{};
+	for (const auto& c : cpu.caches()) {
+		if (c.level() >= 2 && c.type() != cache_type::instruction) {
+			caches.push_back(c);
+		}
+	}
+	std::sort(caches.begin(), caches.end(),
+		[](const cpu_cache& lhs, const cpu_cache& rhs) {
+			return lhs.level() > rhs.level();
+		});
+
+	for (const auto& c : caches) {
+		keys.push_back(cache_instance_id(*thread, c));
+	}
+	keys.push_back(core_id(*thread, cpu));
+	return keys;
+}
+
+/*
+** A combining tree barrier whose shape follows the system topology. SMT
+** siblings arrive at a common leaf; the last thread to arrive at a node
+** continues to the node's parent, which groups cores that share a cache, then
+** packages, then NUMA nodes. Levels that do not split the participants are
+** skipped, and nodes with more than `max_fan_in` children are split further.
+**
+** Each tree node occupies its own cache lines in memory local to the NUMA node
+** of its participants, so that threads only contend with their neighbors.
+** Waiting threads spin on the sense flag of the node at which they stopped,
+** and are released top-down.
+**
+** Participant `i` is expected to call `arrive_and_wait(i)` or `all_reduce(i,
+** ...)` from the CPU thread whose OS ID is `cpus[i]`.
+*/
+class tree_barrier final
+{
+	struct node
+	{
+		std::atomic<uint32_t> count;
+		std::atomic<uint32_t> sense;
+		uint32_t fan_in;
+		uint32_t parent_slot;
+		node* parent;
+	};
+
+	struct participant
+	{
+		node* leaf;
+		uint32_t slot;
+		uint32_t sense;
+	};
+
+	struct child
+	{
+		bool is_participant;
+		uint32_t index;
+	};
+
+	struct node_spec
+	{
+		uint32_t numa_node;
+		uint32_t fan_in;
+		uint32_t parent;
+		uint32_t parent_slot;
+	};
+
+	static constexpr auto npos = std::numeric_limits<uint32_t>::max();
+	static constexpr auto header_size = round_up(sizeof(node), 16);
+
+	std::vector<node_buffer> m_buffers{};
+	std::vector<participant*> m_participants{};
+	std::vector<node_spec> m_specs{};
+	std::vector<std::pair<uint32_t, uint32_t>> m_leaf_slots{};
+	std::vector<uint32_t> m_numa_nodes{};
+	size_t m_value_size;
+	uint32_t m_max_fan_in;
+	uint32_t m_depth{};
+public:
+	explicit tree_barrier(
+		const system_info& info,
+		const std::vector<uint32_t>& cpus,
+		size_t value_size = sizeof(uint64_t),
+		uint32_t max_fan_in = 8
+	) : m_value_size{round_up(std::max(value_size, size_t{1}), 16)},
+	m_max_fan_in{max_fan_in}
+	{
+		if (cpus.empty()) {
+			throw std::invalid_argument{"barrier has no participants"};
+		}
+		if (max_fan_in < 2) {
+			throw std::invalid_argument{"maximum fan-in must be at "
+				"least two"};
+		}
+
+		auto keys = std::vector<std::vector<uint32_t>>{};
+		auto members = std::vector<uint32_t>{};
+		for (auto i = size_t{}; i != cpus.size(); ++i) {
+			keys.push_back(hierarchy_keys(cpus[i], info));
+			m_numa_nodes.push_back(keys.back()[0]);
+			members.push_back(i);
+		}
+
+		m_leaf_slots.resize(cpus.size());
+		build(members, 0, keys);
+		place(info);
+
+		// These are only needed during construction.
+		m_specs.clear();
+		m_leaf_slots.clear();
+	}
+
+	tree_barrier(tree_barrier&&) = default;
+	tree_barrier(const tree_barrier&) = delete;
+	tree_barrier& operator=(const tree_barrier&) = delete;
+
+	size_t participants() const noexcept
+	{ return m_participants.size(); }
+
+	/*
+	** The largest number of tree nodes between a leaf and the root,
+	** inclusive.
+	*/
+	DEFINE_COPY_GETTER(tree_barrier, depth, m_depth)
+
+	void arrive_and_wait(size_t i)
+	{
+		auto token = char{};
+		auto p = m_participants[i];
+		p->sense ^= 1;
+		arrive(p->leaf, p->slot, p->sense, token,
+			[](char lhs, char) { return lhs; });
+	}
+
+	/*
+	** Combines the values contributed by all participants using `op`, and
+	** returns the result to each of them. The values are combined in the
+	** same order in every episode, so `op` only needs to be associative.
+	*/
+	template <class T, class BinaryOp>
+	T all_reduce(size_t i, const T& value, BinaryOp op)
+	{
+		static_assert(std::is_trivially_copyable<T>::value,
+			"Reduced type must be trivially copyable.");
+		if (sizeof(T) > m_value_size) {
+			throw std::invalid_argument{"reduced type is larger "
+				"than the value size of the barrier"};
+		}
+
+		auto r = value;
+		auto p = m_participants[i];
+		p->sense ^= 1;
+		arrive(p->leaf, p->slot, p->sense, r, op);
+		return r;
+	}
+private:
+	char* value_slot(node* n, uint32_t slot) const noexcept
+	{ return reinterpret_cast<char*>(n) + header_size + slot * m_value_size; }
+
+	template <class T, class BinaryOp>
+	void arrive(node* n, uint32_t slot, uint32_t sense, T& value, BinaryOp op)
+	{
+		std::memcpy(value_slot(n, slot), &value, sizeof(T));
+
+		if (n->count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			while (n->sense.load(std::memory_order_acquire) != sense) {
+				cpu_relax();
+			}
+			std::memcpy(&value, value_slot(n, n->fan_in), sizeof(T));
+			return;
+		}
+
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type buf;
+		std::memcpy(&value, value_slot(n, 0), sizeof(T));
+		for (auto i = 1u; i != n->fan_in; ++i) {
+			std::memcpy(&buf, value_slot(n, i), sizeof(T));
+			value = op(value, *reinterpret_cast<const T*>(&buf));
+		}
+
+		if (n->parent != nullptr) {
+			arrive(n->parent, n->parent_slot, sense, value, op);
+		}
+
+		std::memcpy(value_slot(n, n->fan_in), &value, sizeof(T));
+		n->count.store(n->fan_in, std::memory_order_relaxed);
+		n->sense.store(sense, std::memory_order_release);
+	}
+
+	/*
+	** Builds the subtree for the given participants, skipping levels of the
+	** hierarchy at which all of them agree. Returns the index of the root
+	** of the subtree.
+	*/
+	uint32_t build(
+		const std::vector<uint32_t>& members,
+		size_t depth,
+		const std::vector<std::vector<uint32_t>>& keys
+	)
+	{
+		auto levels = keys[members[0]].size();
+		auto numa_node = m_numa_nodes[members[0]];
+
+		for (; depth != levels; ++depth) {
+			auto k = keys[members[0]][depth];
+			auto split = std::any_of(members.begin(), members.end(),
+				[&](uint32_t m) { return keys[m][depth] != k; });
+			if (split) {
+				break;
+			}
+		}
+
+		auto children = std::vector<child>{};
+		if (depth == levels) {
+			for (auto m : members) {
+				children.push_back({true, m});
+			}
+			return make_node(std::move(children), numa_node);
+		}
+
+		auto groups = std::map<uint32_t, std::vector<uint32_t>>{};
+		for (auto m : members) {
+			groups[keys[m][depth]].push_back(m);
+		}
+		for (const auto& g : groups) {
+			children.push_back({false, build(g.second, depth + 1, keys)});
+		}
+		return make_node(std::move(children), numa_node);
+	}
+
+	uint32_t make_node(std::vector<child> children, uint32_t numa_node)
+	{
+		while (children.size() > m_max_fan_in) {
+			auto grouped = std::vector<child>{};
+			for (auto i = size_t{}; i < children.size(); i += m_max_fan_in) {
+				auto end = std::min(i + m_max_fan_in, children.size());
+				auto part = std::vector<child>(children.begin() + i,
+					children.begin() + end);
+				grouped.push_back({false, attach(part, numa_node)});
+			}
+			children = std::move(grouped);
+		}
+		return attach(children, numa_node);
+	}
+
+	uint32_t attach(const std::vector<child>& children, uint32_t numa_node)
+	{
+		auto index = uint32_t(m_specs.size());
+		m_specs.push_back({numa_node, uint32_t(children.size()), npos, 0});
+
+		for (auto i = uint32_t{}; i != children.size(); ++i) {
+			const auto& c = children[i];
+			if (c.is_participant) {
+				m_leaf_slots[c.index] = {index, i};
+			}
+			else {
+				m_specs[c.index].parent = index;
+				m_specs[c.index].parent_slot = i;
+			}
+		}
+		return index;
+	}
+
+	/*
+	** Allocates the tree nodes and participant records in memory local to
+	** the NUMA nodes on which they are used, padding each one to a multiple
+	** of the cache line size.
+	*/
+	void place(const system_info& info)
+	{
+		auto line = cache_line_size(info.cpu_info());
+		auto node_size = [&](const node_spec& s) {
+			return round_up(header_size + (s.fan_in + 1) * m_value_size,
+				line);
+		};
+		auto part_size = round_up(sizeof(participant), line);
+
+		auto sizes = std::map<uint32_t, size_t>{};
+		for (const auto& s : m_specs) {
+			sizes[s.numa_node] += node_size(s);
+		}
+		for (auto n : m_numa_nodes) {
+			sizes[n] += part_size;
+		}
+
+		auto offsets = std::map<uint32_t, char*>{};
+		for (const auto& s : sizes) {
+			m_buffers.emplace_back(s.second, s.first);
+			offsets[s.first] = static_cast<char*>(m_buffers.back().data());
+		}
+
+		auto nodes = std::vector<node*>{};
+		for (const auto& s : m_specs) {
+			auto& off = offsets[s.numa_node];
+			auto n = new (off) node;
+			n->count.store(s.fan_in, std::memory_order_relaxed);
+			n->sense.store(0, std::memory_order_relaxed);
+			n->fan_in = s.fan_in;
+			n->parent_slot = s.parent_slot;
+			n->parent = nullptr;
+			nodes.push_back(n);
+			off += node_size(s);
+		}
+		for (auto i = size_t{}; i != m_specs.size(); ++i) {
+			if (m_specs[i].parent != npos) {
+				nodes[i]->parent = nodes[m_specs[i].parent];
+			}
+		}
+
+		for (auto i = size_t{}; i != m_leaf_slots.size(); ++i) {
+			auto& off = offsets[m_numa_nodes[i]];
+			auto p = new (off) participant;
+			p->leaf = nodes[m_leaf_slots[i].first];
+			p->slot = m_leaf_slots[i].second;
+			p->sense = 0;
+			m_participants.push_back(p);
+			off += part_size;
+		}
+
+		for (auto p : m_participants) {
+			auto depth = uint32_t{1};
+			for (auto n = p->leaf; n->parent != nullptr; n = n->parent) {
+				++depth;
+			}
+			m_depth = std::max(m_depth, depth);
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,228 @@
+/*
+** File Name: cache_domain.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Enumerates the instances of each cache, i.e. the exact sets of CPU threads
+** that share one copy of it. The scope of a cache only says whether it belongs
+** to a core or a package, but an L2 shared by a module or an L3 split by die
+** sits in between, and only the sharing mask from leaf 4 says which threads
+** share it.
+*/
+
+#ifndef ZDC2DC92E_EBEA_48B5_9886_84C649DC401F
+#define ZDC2DC92E_EBEA_48B5_9886_84C649DC401F
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+/*
+** One instance of a cache, and the instances of smaller caches that it
+** contains.
+*/
+class cache_domain final
+{
+	friend class cache_domains;
+
+	const cpu_cache* m_cache{};
+	uint32_t m_id{};
+	// The OS IDs of the available CPU threads that share the instance, in
+	// increasing order.
+	std::vector<uint32_t> m_threads{};
+	const cache_domain* m_parent{};
+	std::vector<const cache_domain*> m_children{};
+public:
+	explicit cache_domain() noexcept {}
+
+	const cpu_cache& cache() const noexcept
+	{ return *m_cache; }
+
+	/*
+	** The instance ID, as returned by `cache_instance_id` for each of the
+	** threads.
+	*/
+	uint32_t id() const noexcept
+	{ return m_id; }
+
+	const std::vector<uint32_t>& threads() const noexcept
+	{ return m_threads; }
+
+	/*
+	** The instance of the next larger data or unified cache that contains
+	** this one, or `nullptr` for the last level.
+	*/
+	const cache_domain* parent() const noexcept
+	{ return m_parent; }
+
+	const std::vector<const cache_domain*>& children() const noexcept
+	{ return m_children; }
+
+	/*
+	** The capacity of the instance divided evenly among the available
+	** threads that share it.
+	*/
+	uint32_t bytes_per_thread() const noexcept
+	{ return m_cache->size() / std::max<size_t>(m_threads.size(), 1); }
+};
+
+std::ostream& operator<<(std::ostream& os, const cache_domain& d)
+{
+	cc::write(os, "L$ $ cache instance $: {threads: $, size: ${data}}",
+		d.cache().level(), d.cache().type(), d.id(), d.threads().size(),
+		d.cache().size());
+	return os;
+}
+
+/*
+** The instances of every cache of the system, arranged in a tree by level.
+** The roots are the instances of the last-level cache. Instruction caches are
+** leaves whose parent is the instance of the next level that contains them.
+*/
+class cache_domains final
+{
+	std::vector<cpu_cache> m_caches{};
+	// Sorted by cache level, then type, then instance ID.
+	std::vector<cache_domain> m_domains{};
+public:
+	explicit cache_domains(const system_info& info)
+	{
+		const auto& cpu = info.cpu_info();
+		m_caches.assign(cpu.caches().begin(), cpu.caches().end());
+		std::sort(m_caches.begin(), m_caches.end(),
+			[](const cpu_cache& lhs, const cpu_cache& rhs) {
+				return std::make_tuple(lhs.level(), lhs.type()) <
+					std::make_tuple(rhs.level(), rhs.type());
+			});
+
+		for (const auto& c : m_caches) {
+			auto ids = std::map<uint32_t, std::vector<uint32_t>>{};
+			for (const auto& t : info.available_cpu_threads()) {
+				ids[cache_instance_id(t, c)].push_back(t.os_id());
+			}
+			for (auto& p : ids) {
+				auto d = cache_domain{};
+				d.m_cache = &c;
+				d.m_id = p.first;
+				d.m_threads = std::move(p.second);
+				std::sort(d.m_threads.begin(), d.m_threads.end());
+				m_domains.push_back(std::move(d));
+			}
+		}
+
+		for (auto& d : m_domains) {
+			auto p = next_level(d);
+			if (p == nullptr) {
+				continue;
+			}
+			d.m_parent = p;
+			const_cast<cache_domain*>(p)->m_children.push_back(&d);
+		}
+	}
+
+	/*
+	** The domains hold pointers to one another and to `m_caches`, which stay
+	** valid when the vectors are moved but not when they are copied.
+	*/
+	cache_domains(cache_domains&&) = default;
+	cache_domains(const cache_domains&) = delete;
+	cache_domains& operator=(const cache_domains&) = delete;
+
+	const std::vector<cache_domain>& all() const noexcept
+	{ return m_domains; }
+
+	/*
+	** The instances of the last-level cache.
+	*/
+	std::vector<const cache_domain*> roots() const
+	{
+		auto r = std::vector<const cache_domain*>{};
+		for (const auto& d : m_domains) {
+			if (d.parent() == nullptr) {
+				r.push_back(&d);
+			}
+		}
+		return r;
+	}
+
+	/*
+	** The instances of the data or unified cache at the given level.
+	*/
+	std::vector<const cache_domain*> at_level(uint8_t level) const
+	{
+		auto r = std::vector<const cache_domain*>{};
+		for (const auto& d : m_domains) {
+			if (d.cache().level() == level &&
+				d.cache().type() != cache_type::instruction)
+			{
+				r.push_back(&d);
+			}
+		}
+		return r;
+	}
+
+	/*
+	** Returns the instance of the data or unified cache at the given level
+	** used by the CPU thread, or `nullptr` if there is none.
+	*/
+	const cache_domain* find(uint32_t os_id, uint8_t level) const noexcept
+	{
+		for (const auto& d : m_domains) {
+			if (d.cache().level() == level &&
+				d.cache().type() != cache_type::instruction &&
+				std::binary_search(d.threads().begin(),
+					d.threads().end(), os_id))
+			{
+				return &d;
+			}
+		}
+		return nullptr;
+	}
+
+	/*
+	** Returns the instance of the last-level cache used by the CPU thread,
+	** or `nullptr` if the thread is not available.
+	*/
+	const cache_domain* last_level(uint32_t os_id) const noexcept
+	{
+		for (const auto& d : m_domains) {
+			if (d.parent() == nullptr && std::binary_search(
+				d.threads().begin(), d.threads().end(), os_id))
+			{
+				return &d;
+			}
+		}
+		return nullptr;
+	}
+private:
+	/*
+	** Returns the instance of the smallest data or unified cache above the
+	** level of `d` that contains the threads of `d`.
+	*/
+	const cache_domain* next_level(const cache_domain& d) const noexcept
+	{
+		auto level = d.cache().level();
+		for (const auto& c : m_caches) {
+			if (c.level() <= level || c.type() == cache_type::instruction) {
+				continue;
+			}
+			// The caches are sorted by level, so the first match is the
+			// next level.
+			return find(d.threads().front(), c.level());
+		}
+		return nullptr;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,492 @@
+/*
+** File Name: cache_measurement.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Measures the latency and bandwidth of each level of the memory hierarchy by
+** sweeping the working-set size from the L1 cache out to main memory. CPUID
+** describes the structure of the caches but not how they perform, and it is
+** not always right about their size: cache allocation technology can give a
+** thread only part of the LLC, and a hypervisor can report made-up leaves.
+*/
+
+#ifndef Z28EE5D10_2795_45C6_8EC7_7D66AA9C89A7
+#define Z28EE5D10_2795_45C6_8EC7_7D66AA9C89A7
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <sys/mman.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+/*
+** The latency and bandwidth measured for one working-set size.
+*/
+struct cache_sample
+{
+	size_t bytes;
+	// Nanoseconds per dependent load.
+	double latency;
+	// Bytes per second.
+	double read_bandwidth;
+	double write_bandwidth;
+};
+
+/*
+** A range of working-set sizes over which the latency stays roughly constant,
+** i.e. one level of the memory hierarchy.
+*/
+struct cache_plateau
+{
+	// The largest working set in the range. The capacity of the level lies
+	// between this and the next size in the sweep.
+	size_t bytes;
+	// The medians over the range.
+	double latency;
+	double read_bandwidth;
+	double write_bandwidth;
+};
+
+struct cache_measurement_options
+{
+	size_t min_bytes = 4096;
+	// Zero means four times the size of the largest cache, but at least 64
+	// MiB.
+	size_t max_bytes = 0;
+	unsigned steps_per_octave = 4;
+	// Each measurement is repeated until it has run for at least this long.
+	std::chrono::nanoseconds min_time = std::chrono::milliseconds{5};
+	// A range ends when the latency grows by more than `step_ratio` from one
+	// size to the next, or by more than `level_ratio` from the start of the
+	// range.
+	double step_ratio = 1.15;
+	double level_ratio = 1.5;
+	// A cache whose measured size is off from the size given by CPUID by
+	// more than this factor is flagged.
+	double size_tolerance = 2;
+};
+
+struct cache_report
+{
+	std::vector<cache_sample> samples;
+	std::vector<cache_plateau> plateaus;
+	// The last range, if the sweep went past the last-level cache.
+	boost::optional<cache_plateau> memory;
+};
+
+namespace detail {
+
+/*
+** An anonymous mapping backed by transparent huge pages where possible, so
+** that TLB misses add as little as possible to the latency of the caches.
+*/
+class probe_buffer final
+{
+	void* m_data{};
+	size_t m_size{};
+public:
+	explicit probe_buffer(size_t size) :
+	m_size{(size + (size_t{1} << 21) - 1) & ~((size_t{1} << 21) - 1)}
+	{
+		m_data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (m_data == MAP_FAILED) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to map probe buffer"};
+		}
+		// Not every kernel supports THP, and the measurement is still
+		// meaningful without it.
+		::madvise(m_data, m_size, MADV_HUGEPAGE);
+		std::memset(m_data, 0, m_size);
+	}
+
+	~probe_buffer()
+	{ ::munmap(m_data, m_size); }
+
+	probe_buffer(const probe_buffer&) = delete;
+	probe_buffer& operator=(const probe_buffer&) = delete;
+
+	char* data() const noexcept
+	{ return static_cast<char*>(m_data); }
+};
+
+/*
+** Finds the smallest `n` for which `f(n)` takes at least `min_time`, and
+** returns the least time in nanoseconds divided by `n` over three runs.
+** Interference only ever adds time, so the least is the best estimate.
+*/
+template <class Function>
+double time_per_iteration(std::chrono::nanoseconds min_time, Function f)
+{
+	using clock = std::chrono::steady_clock;
+
+	auto run = [&](size_t n) {
+		auto start = clock::now();
+		f(n);
+		return clock::now() - start;
+	};
+
+	// Warm up the caches and the TLB.
+	f(size_t{1});
+	auto n = size_t{1};
+	auto best = run(n);
+	while (best < min_time) {
+		n *= 2;
+		best = run(n);
+	}
+	for (auto i = 0; i != 2; ++i) {
+		best = std::min(best, run(n));
+	}
+	return std::chrono::duration<double, std::nano>(best).count() / n;
+}
+
+/*
+** Links the lines of the first `bytes` of `buf` into a single cycle in random
+** order, so that neither the prefetchers nor the memory-level parallelism of
+** the core can hide the latency of each load.
+*/
+void* make_chase(char* buf, size_t bytes, size_t stride)
+{
+	auto slots = std::max<size_t>(bytes / stride, 1);
+	auto order = std::vector<size_t>(slots);
+	for (auto i = size_t{}; i != slots; ++i) {
+		order[i] = i;
+	}
+
+	// Sattolo's algorithm, which yields a single cycle.
+	auto gen = std::mt19937_64{slots};
+	for (auto i = slots - 1; i > 0; --i) {
+		auto j = std::uniform_int_distribution<size_t>{0, i - 1}(gen);
+		std::swap(order[i], order[j]);
+	}
+	for (auto i = size_t{}; i != slots; ++i) {
+		*reinterpret_cast<void**>(buf + i * stride) =
+			buf + order[i] * stride;
+	}
+	return buf;
+}
+
+double measure_latency(
+	char* buf,
+	size_t bytes,
+	size_t stride,
+	std::chrono::nanoseconds min_time
+)
+{
+	auto start = make_chase(buf, bytes, stride);
+	auto loads = std::max<size_t>(bytes / stride, 1024);
+	void* volatile sink;
+
+	return time_per_iteration(min_time, [&](size_t n) {
+		auto p = start;
+		for (auto i = n * loads; i != 0; --i) {
+			p = *static_cast<void**>(p);
+		}
+		sink = p;
+	}) / loads;
+}
+
+double measure_read_bandwidth(
+	char* buf,
+	size_t bytes,
+	std::chrono::nanoseconds min_time
+)
+{
+	auto p = reinterpret_cast<const uint64_t*>(buf);
+	auto words = bytes / sizeof(uint64_t);
+	volatile uint64_t sink;
+
+	auto ns = time_per_iteration(min_time, [&](size_t n) {
+		// Independent sums, so that the loop is not bound by the latency
+		// of the additions.
+		uint64_t s[4] = {};
+		for (auto j = n; j != 0; --j) {
+			for (auto i = size_t{}; i + 4 <= words; i += 4) {
+				s[0] += p[i];
+				s[1] += p[i + 1];
+				s[2] += p[i + 2];
+				s[3] += p[i + 3];
+			}
+			asm volatile("" : : "r"(p) : "memory");
+		}
+		sink = s[0] + s[1] + s[2] + s[3];
+	});
+	return bytes / ns * 1e9;
+}
+
+double measure_write_bandwidth(
+	char* buf,
+	size_t bytes,
+	std::chrono::nanoseconds min_time
+)
+{
+	auto p = reinterpret_cast<uint64_t*>(buf);
+	auto words = bytes / sizeof(uint64_t);
+
+	auto ns = time_per_iteration(min_time, [&](size_t n) {
+		for (auto j = n; j != 0; --j) {
+			// The stored value depends on the pass, so that the loop is
+			// not turned into a call to `memset`, which uses
+			// non-temporal stores for large buffers.
+			for (auto i = size_t{}; i != words; ++i) {
+				p[i] = i ^ j;
+			}
+			asm volatile("" : : "r"(p) : "memory");
+		}
+	});
+	return bytes / ns * 1e9;
+}
+
+double median(std::vector<double> v)
+{
+	std::sort(v.begin(), v.end());
+	auto n = v.size();
+	return n % 2 == 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+}
+
+/*
+** Returns the working-set sizes from `min_bytes` to `max_bytes`, spaced evenly
+** on a logarithmic scale and rounded to multiples of `stride`.
+*/
+std::vector<size_t> working_set_sizes(
+	size_t min_bytes,
+	size_t max_bytes,
+	unsigned steps_per_octave,
+	size_t stride
+)
+{
+	auto r = std::vector<size_t>{};
+	for (auto k = 0u;; ++k) {
+		auto b = size_t(min_bytes * std::exp2(double(k) / steps_per_octave));
+		b = std::max(b / stride * stride, stride);
+		if (b > max_bytes) {
+			return r;
+		}
+		if (r.empty() || b != r.back()) {
+			r.push_back(b);
+		}
+	}
+}
+
+/*
+** Measures the latency and the bandwidths for each of the working-set sizes.
+** The calling thread should be pinned, and the machine otherwise idle.
+*/
+std::vector<cache_sample>
+sweep_working_sets(
+	const std::vector<size_t>& sizes,
+	size_t stride,
+	std::chrono::nanoseconds min_time = std::chrono::milliseconds{5}
+)
+{
+	auto r = std::vector<cache_sample>{};
+	if (sizes.empty()) {
+		return r;
+	}
+
+	detail::probe_buffer buf{*std::max_element(sizes.begin(), sizes.end())};
+	for (auto b : sizes) {
+		auto s = cache_sample{};
+		s.bytes = b;
+		s.read_bandwidth = detail::measure_read_bandwidth(buf.data(), b,
+			min_time);
+		s.write_bandwidth = detail::measure_write_bandwidth(buf.data(), b,
+			min_time);
+		// Last, since it overwrites the buffer with the pointer chain.
+		s.latency = detail::measure_latency(buf.data(), b, stride,
+			min_time);
+		r.push_back(s);
+	}
+	return r;
+}
+
+/*
+** Splits the samples into ranges over which the latency stays roughly
+** constant. The latencies are first passed through a median filter of width
+** three, so that a single noisy sample does not split a range. Samples in the
+** transition from one level to the next form ranges of their own, and are
+** dropped. Neighboring ranges whose latencies are within `level_ratio` of one
+** another are merged, since there is no level between them.
+*/
+std::vector<cache_plateau> detect_plateaus(
+	const std::vector<cache_sample>& samples,
+	double step_ratio = 1.15,
+	double level_ratio = 1.5
+)
+{
+	auto n = samples.size();
+	auto lat = std::vector<double>(n);
+	for (auto i = size_t{}; i != n; ++i) {
+		lat[i] = detail::median({samples[i == 0 ? i : i - 1].latency,
+			samples[i].latency, samples[i + 1 == n ? i : i + 1].latency});
+	}
+
+	// Half-open ranges of sample indices.
+	auto ranges = std::vector<std::pair<size_t, size_t>>{};
+	auto begin = size_t{};
+	while (begin != n) {
+		auto end = begin + 1;
+		while (end != n && lat[end] <= step_ratio * lat[end - 1] &&
+			lat[end] <= level_ratio * lat[begin])
+		{
+			++end;
+		}
+		if (end - begin >= 2) {
+			if (!ranges.empty() && lat[begin] <= level_ratio *
+				lat[ranges.back().first])
+			{
+				ranges.back().second = end;
+			}
+			else {
+				ranges.emplace_back(begin, end);
+			}
+		}
+		begin = end;
+	}
+
+	auto r = std::vector<cache_plateau>{};
+	for (const auto& p : ranges) {
+		auto l = std::vector<double>{};
+		auto rd = std::vector<double>{};
+		auto wr = std::vector<double>{};
+		for (auto i = p.first; i != p.second; ++i) {
+			l.push_back(samples[i].latency);
+			rd.push_back(samples[i].read_bandwidth);
+			wr.push_back(samples[i].write_bandwidth);
+		}
+		r.push_back({samples[p.second - 1].bytes, detail::median(l),
+			detail::median(rd), detail::median(wr)});
+	}
+	return r;
+}
+
+/*
+** Matches the ranges to the data and unified caches of `info`, and records the
+** measurements in each cache. A cache is flagged if no range matches it, or
+** if the size of its range differs from its size by more than `tolerance`.
+** The last range is taken to be main memory if it extends past `tolerance`
+** times the size of the largest cache.
+*/
+boost::optional<cache_plateau> attach_measurements(
+	system_info& info,
+	const std::vector<cache_plateau>& plateaus,
+	double tolerance = 2
+)
+{
+	auto caches = std::vector<cpu_cache*>{};
+	for (auto& c : info.cpu_info().caches()) {
+		if (c.type() != cache_type::instruction) {
+			caches.push_back(&c);
+		}
+	}
+	std::sort(caches.begin(), caches.end(),
+		[](const cpu_cache* lhs, const cpu_cache* rhs) {
+			return lhs->level() < rhs->level();
+		});
+
+	auto largest = size_t{};
+	for (auto c : caches) {
+		largest = std::max<size_t>(largest, c->size());
+	}
+
+	auto memory = boost::optional<cache_plateau>{};
+	auto last = plateaus.size();
+	if (!plateaus.empty() && plateaus.back().bytes > tolerance * largest) {
+		memory = plateaus.back();
+		--last;
+	}
+
+	// Each cache gets the range whose size is closest to its own, on a
+	// logarithmic scale, among those after the range of the previous level.
+	auto next = size_t{};
+	for (auto c : caches) {
+		c->measured_latency(0).measured_read_bandwidth(0).
+			measured_write_bandwidth(0).measured_size(0).
+			has_size_mismatch(true);
+
+		auto best = last;
+		auto best_dist = 0.0;
+		for (auto i = next; i != last; ++i) {
+			auto d = std::abs(std::log2(double(plateaus[i].bytes) /
+				c->size()));
+			if (best == last || d < best_dist) {
+				best = i;
+				best_dist = d;
+			}
+		}
+		if (best == last) {
+			continue;
+		}
+
+		const auto& p = plateaus[best];
+		c->measured_latency(p.latency).
+			measured_read_bandwidth(p.read_bandwidth).
+			measured_write_bandwidth(p.write_bandwidth).
+			measured_size(p.bytes).
+			has_size_mismatch(best_dist > std::log2(tolerance));
+		next = best + 1;
+	}
+	return memory;
+}
+
+/*
+** Runs the sweep on the first available CPU thread of the first available
+** NUMA node, with memory bound to that node, and records the results in the
+** caches of `info`. Takes up to a minute with the default options.
+*/
+cache_report measure_caches(
+	system_info& info,
+	const cache_measurement_options& opts = {}
+)
+{
+	auto stride = size_t{64};
+	auto largest = size_t{};
+	for (const auto& c : info.cpu_info().caches()) {
+		if (c.type() == cache_type::instruction) {
+			continue;
+		}
+		if (c.level() == 1) {
+			stride = c.line_size();
+		}
+		largest = std::max<size_t>(largest, c.size());
+	}
+
+	auto max_bytes = opts.max_bytes != 0 ? opts.max_bytes :
+		std::max(4 * largest, size_t{64} << 20);
+	const auto& node = info.available_numa_nodes()[0];
+	scoped_binding b{node.cpu_info().available_threads()[0].os_id(),
+		memory_policy::bind, {node.id()}};
+
+	auto r = cache_report{};
+	r.samples = sweep_working_sets(working_set_sizes(opts.min_bytes,
+		max_bytes, opts.steps_per_octave, stride), stride, opts.min_time);
+	r.plateaus = detect_plateaus(r.samples, opts.step_ratio,
+		opts.level_ratio);
+	r.memory = attach_measurements(info, r.plateaus, opts.size_tolerance);
+	return r;
+}
+
+}
+
+#endif
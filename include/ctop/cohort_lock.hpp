@@ -0,0 +1,319 @@
+/*
+** File Name: cohort_lock.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z791FBAD1_2398_46A2_8603_E0A81C84245B
+#define Z791FBAD1_2398_46A2_8603_E0A81C84245B
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ccbase/utility.hpp>
+#include <ctop/barrier.hpp>
+#include <ctop/node_memory.hpp>
+#include <ctop/numa_error.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#ifndef _GNU_SOURCE
+		#define _GNU_SOURCE
+	#endif
+
+	// For `sched_getcpu`.
+	#include <sched.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+/*
+** An MCS queue lock. Each acquisition uses a queue node supplied by the caller,
+** typically on the stack, and each waiter spins on its own node.
+*/
+class mcs_lock final
+{
+public:
+	struct alignas(64) node
+	{
+		std::atomic<node*> next;
+		std::atomic<uint32_t> status;
+	};
+private:
+	alignas(64) std::atomic<node*> m_tail{nullptr};
+public:
+	explicit mcs_lock() noexcept {}
+
+	mcs_lock(const mcs_lock&) = delete;
+	mcs_lock& operator=(const mcs_lock&) = delete;
+
+	/*
+	** Returns true if the lock was acquired without waiting for another
+	** thread to hand it over.
+	*/
+	bool lock(node& n) noexcept
+	{
+		n.next.store(nullptr, std::memory_order_relaxed);
+		n.status.store(0, std::memory_order_relaxed);
+
+		auto pred = m_tail.exchange(&n, std::memory_order_acq_rel);
+		if (pred == nullptr) {
+			return true;
+		}
+
+		pred->next.store(&n, std::memory_order_release);
+		while (n.status.load(std::memory_order_acquire) == 0) {
+			cpu_relax();
+		}
+		return false;
+	}
+
+	/*
+	** Returns the status that the predecessor passed along with the lock;
+	** only meaningful if `lock` returned false.
+	*/
+	static uint32_t status(const node& n) noexcept
+	{ return n.status.load(std::memory_order_relaxed); }
+
+	/*
+	** Returns true if another thread is known to be waiting for the lock.
+	*/
+	bool has_waiters(const node& n) const noexcept
+	{
+		return n.next.load(std::memory_order_acquire) != nullptr ||
+			m_tail.load(std::memory_order_relaxed) != &n;
+	}
+
+	/*
+	** Releases the lock, passing `status` to the successor if there is one.
+	** The status must be nonzero.
+	*/
+	void unlock(node& n, uint32_t status = 1) noexcept
+	{
+		auto succ = n.next.load(std::memory_order_acquire);
+		if (succ == nullptr) {
+			auto expected = &n;
+			if (m_tail.compare_exchange_strong(expected, nullptr,
+				std::memory_order_release, std::memory_order_relaxed))
+			{
+				return;
+			}
+			while ((succ = n.next.load(std::memory_order_acquire)) == nullptr) {
+				cpu_relax();
+			}
+		}
+		succ->status.store(status, std::memory_order_release);
+	}
+};
+
+/*
+** A ticket lock. Unlike the MCS lock, it can be released by a thread other than
+** the one that acquired it, which is what the cohort lock needs for its global
+** lock.
+*/
+class ticket_lock final
+{
+	alignas(64) std::atomic<uint32_t> m_next{0};
+	alignas(64) std::atomic<uint32_t> m_serving{0};
+public:
+	explicit ticket_lock() noexcept {}
+
+	ticket_lock(const ticket_lock&) = delete;
+	ticket_lock& operator=(const ticket_lock&) = delete;
+
+	void lock() noexcept
+	{
+		auto t = m_next.fetch_add(1, std::memory_order_relaxed);
+		while (m_serving.load(std::memory_order_acquire) != t) {
+			cpu_relax();
+		}
+	}
+
+	void unlock() noexcept
+	{
+		auto t = m_serving.load(std::memory_order_relaxed);
+		m_serving.store(t + 1, std::memory_order_release);
+	}
+};
+
+enum class cohort_level : uint8_t
+{
+	numa_node,
+	package,
+};
+
+std::ostream& operator<<(std::ostream& os, const cohort_level& l)
+{
+	switch (l) {
+	case cohort_level::numa_node:
+		cc::write(os, "NUMA node");
+		return os;
+	case cohort_level::package:
+		cc::write(os, "package");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** A cohort lock built from a global ticket lock and one MCS lock per cohort,
+** where a cohort is the set of CPU threads on one NUMA node or package. A
+** thread first acquires the MCS lock of its cohort. If the previous owner was
+** in the same cohort, it inherits the global lock along with the local one;
+** otherwise it acquires the global lock itself. On release, the owner passes
+** both locks to a waiting thread in its cohort, unless `max_handoffs`
+** consecutive handoffs have already happened in this cohort. That bound keeps
+** the other cohorts from starving; setting it to zero degrades the lock to a
+** fair lock with one extra level of indirection.
+**
+** The cohort of a thread is determined by the CPU it is running on when it
+** calls `lock`. The state of each cohort lives in memory local to the cohort's
+** first NUMA node.
+*/
+class cohort_lock final
+{
+	static constexpr auto acquire_global = uint32_t{1};
+	static constexpr auto global_passed  = uint32_t{2};
+
+	struct cohort
+	{
+		mcs_lock local;
+		uint32_t handoffs;
+	};
+
+	std::vector<node_buffer> m_buffers{};
+	std::vector<cohort*> m_cohorts{};
+	std::vector<uint32_t> m_cpu_cohorts{};
+	ticket_lock m_global{};
+	uint32_t m_max_handoffs;
+	cohort_level m_level;
+public:
+	/*
+	** The queue node for one acquisition. The same node must be passed to
+	** `lock` and `unlock`.
+	*/
+	class node final
+	{
+		friend class cohort_lock;
+		mcs_lock::node m_node;
+		cohort* m_cohort;
+	public:
+		explicit node() noexcept {}
+	};
+
+	explicit cohort_lock(
+		const system_info& info,
+		cohort_level level = cohort_level::numa_node,
+		uint32_t max_handoffs = 64
+	) : m_max_handoffs{max_handoffs}, m_level{level}
+	{
+		auto max_cpu = uint32_t{};
+		for (const auto& t : info.available_cpu_threads()) {
+			max_cpu = std::max(max_cpu, t.os_id());
+		}
+		m_cpu_cohorts.resize(max_cpu + 1);
+
+		// Maps each cohort key to the cohort's index and NUMA node.
+		auto keys = std::map<uint32_t, std::pair<uint32_t, uint32_t>>{};
+		for (const auto& n : info.available_numa_nodes()) {
+			for (const auto& t : n.cpu_info().available_threads()) {
+				auto key = level == cohort_level::numa_node ?
+					n.id() : package_id(t, info.cpu_info());
+				auto it = keys.find(key);
+				if (it == keys.end()) {
+					auto index = uint32_t(keys.size());
+					it = keys.emplace(key, std::make_pair(index, n.id())).first;
+				}
+				m_cpu_cohorts[t.os_id()] = it->second.first;
+			}
+		}
+
+		auto size = round_up(sizeof(cohort), cache_line_size(info.cpu_info()));
+		m_cohorts.resize(keys.size());
+		for (const auto& k : keys) {
+			m_buffers.emplace_back(size, k.second.second);
+			auto c = new (m_buffers.back().data()) cohort;
+			c->handoffs = 0;
+			m_cohorts[k.second.first] = c;
+		}
+	}
+
+	cohort_lock(const cohort_lock&) = delete;
+	cohort_lock& operator=(const cohort_lock&) = delete;
+
+	~cohort_lock()
+	{
+		for (auto c : m_cohorts) {
+			c->~cohort();
+		}
+	}
+
+	size_t cohorts() const noexcept
+	{ return m_cohorts.size(); }
+
+	DEFINE_COPY_GETTER(cohort_lock, level, m_level)
+	DEFINE_COPY_GETTER(cohort_lock, max_handoffs, m_max_handoffs)
+
+	void lock(node& n)
+	{
+		auto cpu = ::sched_getcpu();
+		if (cpu < 0 || size_t(cpu) >= m_cpu_cohorts.size()) {
+			throw numa_error{cc::format("CPU thread $ is not "
+				"available", cpu)};
+		}
+
+		n.m_cohort = m_cohorts[m_cpu_cohorts[cpu]];
+		auto& local = n.m_cohort->local;
+		if (local.lock(n.m_node) ||
+			mcs_lock::status(n.m_node) == acquire_global)
+		{
+			m_global.lock();
+			n.m_cohort->handoffs = 0;
+		}
+	}
+
+	void unlock(node& n) noexcept
+	{
+		auto c = n.m_cohort;
+		if (c->local.has_waiters(n.m_node) && c->handoffs < m_max_handoffs) {
+			++c->handoffs;
+			c->local.unlock(n.m_node, global_passed);
+			return;
+		}
+
+		m_global.unlock();
+		c->local.unlock(n.m_node, acquire_global);
+	}
+
+	/*
+	** Holds the lock for the lifetime of the guard.
+	*/
+	class guard final
+	{
+		cohort_lock& m_lock;
+		node m_node{};
+	public:
+		explicit guard(cohort_lock& l) : m_lock{l}
+		{ m_lock.lock(m_node); }
+
+		guard(const guard&) = delete;
+		guard& operator=(const guard&) = delete;
+
+		~guard() { m_lock.unlock(m_node); }
+	};
+};
+
+}
+
+#endif
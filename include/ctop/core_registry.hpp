@@ -0,0 +1,506 @@
+/*
+** File Name: core_registry.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** A registry of claimed CPU threads shared by every process on the host.
+** Processes that each place their threads from their own `system_info` end up
+** on the same cores unless they agree on who owns what. The registry is a
+** POSIX shared memory object with one owner word per CPU thread, so that a
+** claim is a single compare-and-swap and no process ever holds a lock.
+**
+** A claim lasts as long as the process that made it. The owner word records
+** the PID and the start time of the process, and a claim whose process has
+** exited, or whose PID now belongs to a different process, is free to be
+** taken. This requires that the processes share a PID namespace, e.g. that
+** containers that open the same registry share the PID namespace of the host.
+** The registry records the PID namespace of the process that created it, and
+** processes in other namespaces cannot open it.
+**
+** Each `core_registry` object only releases the claims that it made itself,
+** so that several objects in one process do not release each other's claims.
+** A child created by `fork` must open its own registry.
+*/
+
+#ifndef ZBEA049D8_D5F0_4F5C_A1A0_77913BDBF5BB
+#define ZBEA049D8_D5F0_4F5C_A1A0_77913BDBF5BB
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+static constexpr auto default_registry_name = "/ctop_core_registry";
+
+/*
+** The unit in which CPU threads are claimed.
+*/
+enum class claim_scope : uint8_t
+{
+	// Single CPU threads.
+	thread,
+	// Every CPU thread of a core, so that no other process runs on an SMT
+	// sibling.
+	core,
+	// Every CPU thread of a NUMA node.
+	numa_node,
+};
+
+std::ostream& operator<<(std::ostream& os, const claim_scope& s)
+{
+	switch (s) {
+	case claim_scope::thread:
+		cc::write(os, "thread");
+		return os;
+	case claim_scope::core:
+		cc::write(os, "core");
+		return os;
+	case claim_scope::numa_node:
+		cc::write(os, "NUMA node");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+namespace detail {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The registry requires lock-free "
+	"64-bit atomics.");
+
+/*
+** The contents of the shared memory object. A new object is filled with
+** zeros, which is a valid registry in which nothing is claimed.
+*/
+struct registry_layout
+{
+	static constexpr auto magic = uint32_t{0x31525443}; // "CTR1"
+	static constexpr auto capacity = size_t{8192};
+
+	std::atomic<uint32_t> magic_word;
+	// The inode of the PID namespace of the creator.
+	std::atomic<uint64_t> pid_namespace;
+	// Zero if the CPU thread is free. Otherwise, the PID of the owner in
+	// the high 22 bits, and the low 42 bits of its start time, in clock
+	// ticks since boot, in the rest. PIDs never exceed 2^22 on Linux.
+	std::atomic<uint64_t> owners[capacity];
+};
+
+/*
+** Returns the start time of the process in clock ticks since boot, or
+** `boost::none` if the process does not exist.
+*/
+boost::optional<uint64_t>
+process_start_time(pid_t pid, const std::string& procfs_root)
+{
+	auto path = cc::format("$/$/stat", procfs_root, pid);
+	auto s = try_read_file(path);
+	if (!s) {
+		return boost::none;
+	}
+
+	// The command name may contain spaces and parentheses, so the fields
+	// are counted from the last closing parenthesis. The start time is the
+	// 22nd field, and the state after the parenthesis is the third.
+	auto stat = boost::string_ref{*s};
+	auto i = stat.rfind(')');
+	if (i == boost::string_ref::npos) {
+		throw sysfs_error{path, "malformed stat"};
+	}
+	stat.remove_prefix(i + 1);
+	for (auto field = 2; field != 22; ++field) {
+		auto j = stat.find(' ');
+		if (j == boost::string_ref::npos) {
+			throw sysfs_error{path, "malformed stat"};
+		}
+		stat.remove_prefix(j + 1);
+	}
+	return parse_integer(stat.substr(0, stat.find(' ')), path);
+}
+
+uint64_t make_owner(pid_t pid, uint64_t start_time) noexcept
+{
+	return uint64_t(pid) << 42 | (start_time & ((uint64_t{1} << 42) - 1));
+}
+
+pid_t owner_pid(uint64_t owner) noexcept
+{ return pid_t(owner >> 42); }
+
+/*
+** Returns the inode that identifies the PID namespace of this process.
+*/
+uint64_t pid_namespace(const std::string& procfs_root)
+{
+	auto path = procfs_root + "/self/ns/pid";
+	struct stat st{};
+	if (::stat(path.c_str(), &st) == -1) {
+		throw sysfs_error{path, std::strerror(errno)};
+	}
+	return st.st_ino;
+}
+
+}
+
+class core_registry final
+{
+	using layout = detail::registry_layout;
+
+	std::string m_procfs_root;
+	layout* m_layout{};
+	uint64_t m_owner{};
+	pid_t m_pid{};
+	// The CPU threads claimed through this object.
+	cpu_set m_claims{};
+public:
+	/*
+	** Opens the registry with the given name, creating it if it does not
+	** exist. The registry is shared by every process that opens the same
+	** name. Throws `std::runtime_error` if the registry was created in
+	** another PID namespace, in which the PIDs of the owners mean nothing.
+	*/
+	explicit core_registry(
+		const std::string& name = default_registry_name,
+		const std::string& procfs_root = default_procfs_root
+	) : m_procfs_root{procfs_root}
+	{
+		auto pid = m_pid = ::getpid();
+		auto start = detail::process_start_time(pid, procfs_root);
+		if (!start) {
+			throw sysfs_error{procfs_root, "own stat file missing"};
+		}
+		m_owner = detail::make_owner(pid, *start);
+		auto ns = detail::pid_namespace(procfs_root);
+
+		auto fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT, 0666);
+		if (fd == -1) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to open registry " + name};
+		}
+		// Services may run as different users. Only the creator can
+		// change the mode, and the umask may have removed bits.
+		::fchmod(fd, 0666);
+
+		struct stat st{};
+		if (::fstat(fd, &st) == -1 || (size_t(st.st_size) <
+			sizeof(layout) && ::ftruncate(fd, sizeof(layout)) == -1))
+		{
+			auto e = errno;
+			::close(fd);
+			throw std::system_error{e, std::system_category(),
+				"failed to size registry " + name};
+		}
+
+		auto p = ::mmap(nullptr, sizeof(layout), PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+		auto e = errno;
+		::close(fd);
+		if (p == MAP_FAILED) {
+			throw std::system_error{e, std::system_category(),
+				"failed to map registry " + name};
+		}
+		m_layout = static_cast<layout*>(p);
+
+		auto m = uint32_t{};
+		if (!m_layout->magic_word.compare_exchange_strong(m,
+			layout::magic) && m != layout::magic)
+		{
+			::munmap(m_layout, sizeof(layout));
+			throw std::runtime_error{"registry " + name + " has an "
+				"unsupported format"};
+		}
+
+		auto n = uint64_t{};
+		if (!m_layout->pid_namespace.compare_exchange_strong(n, ns) &&
+			n != ns)
+		{
+			::munmap(m_layout, sizeof(layout));
+			throw std::runtime_error{"registry " + name + " belongs to "
+				"another PID namespace"};
+		}
+	}
+
+	/*
+	** Releases the claims made through this object. In a child created by
+	** `fork`, the claims belong to the parent and are left alone.
+	*/
+	~core_registry()
+	{
+		if (::getpid() == m_pid) {
+			release_all();
+		}
+		::munmap(m_layout, sizeof(layout));
+	}
+
+	core_registry(const core_registry&) = delete;
+	core_registry& operator=(const core_registry&) = delete;
+
+	/*
+	** Claims the CPU thread for this process. Returns false if a live
+	** process other than this one owns it. A CPU thread that another object
+	** in this process claimed stays that object's to release.
+	*/
+	bool try_claim(uint32_t cpu)
+	{
+		if (::getpid() != m_pid) {
+			throw std::logic_error{"registry used after fork"};
+		}
+
+		auto& o = slot(cpu);
+		auto cur = o.load(std::memory_order_acquire);
+		for (;;) {
+			if (cur == m_owner) {
+				return true;
+			}
+			if (cur != 0 && is_live(cur)) {
+				return false;
+			}
+			if (o.compare_exchange_weak(cur, m_owner,
+				std::memory_order_acq_rel))
+			{
+				m_claims.insert(cpu);
+				return true;
+			}
+		}
+	}
+
+	/*
+	** Claims `count` units of the given scope whose CPU threads are all
+	** free or already owned by this process, in the order given by the
+	** placement policy, and returns the CPU threads. If there are not
+	** enough such units, nothing new is claimed, and `std::runtime_error`
+	** is thrown.
+	*/
+	std::vector<uint32_t> claim(
+		const system_info& info,
+		size_t count,
+		claim_scope s = claim_scope::core,
+		placement_policy p = placement_policy::compact
+	)
+	{
+		auto r = std::vector<uint32_t>{};
+		auto claimed = size_t{};
+		auto added = std::vector<uint32_t>{};
+
+		for (const auto& g : claim_units(info, s, p)) {
+			if (claimed == count) {
+				break;
+			}
+
+			auto ok = true;
+			auto group_added = std::vector<uint32_t>{};
+			for (auto cpu : g) {
+				auto owned = slot(cpu).load() == m_owner;
+				if (!try_claim(cpu)) {
+					ok = false;
+					break;
+				}
+				if (!owned) {
+					group_added.push_back(cpu);
+				}
+			}
+			if (!ok) {
+				release(group_added);
+				continue;
+			}
+
+			++claimed;
+			r.insert(r.end(), g.begin(), g.end());
+			added.insert(added.end(), group_added.begin(),
+				group_added.end());
+		}
+
+		if (claimed != count) {
+			release(added);
+			throw std::runtime_error{cc::format("fewer than $ "
+				"unclaimed units of scope $", count, s)};
+		}
+		return r;
+	}
+
+	/*
+	** Releases the CPU thread if it was claimed through this object.
+	*/
+	void release(uint32_t cpu)
+	{
+		if (!m_claims.contains(cpu)) {
+			return;
+		}
+		auto cur = m_owner;
+		slot(cpu).compare_exchange_strong(cur, 0,
+			std::memory_order_release);
+		m_claims.erase(cpu);
+	}
+
+	void release(const std::vector<uint32_t>& cpus)
+	{
+		for (auto cpu : cpus) {
+			release(cpu);
+		}
+	}
+
+	void release_all()
+	{
+		for (auto cpu : m_claims.to_vector()) {
+			release(cpu);
+		}
+	}
+
+	/*
+	** Returns the PID of the live process that owns the CPU thread, or
+	** `boost::none` if the CPU thread is free.
+	*/
+	boost::optional<pid_t> owner(uint32_t cpu) const
+	{
+		auto cur = slot(cpu).load(std::memory_order_acquire);
+		if (cur == 0 || !is_live(cur)) {
+			return boost::none;
+		}
+		return detail::owner_pid(cur);
+	}
+
+	/*
+	** Returns the CPU threads claimed through this object, in increasing
+	** order.
+	*/
+	std::vector<uint32_t> claimed() const
+	{ return m_claims.to_vector(); }
+
+	/*
+	** Returns the available CPU threads that are free or owned by this
+	** process, in increasing order. These can be passed to `place_threads`
+	** to keep clear of the CPU threads of other processes.
+	*/
+	cpu_set unclaimed_cpus(const system_info& info) const
+	{
+		auto r = cpu_set{};
+		for (const auto& t : info.available_cpu_threads()) {
+			auto cur = slot(t.os_id()).load(std::memory_order_acquire);
+			if (cur == 0 || cur == m_owner || !is_live(cur)) {
+				r.insert(t.os_id());
+			}
+		}
+		return r;
+	}
+
+	/*
+	** Frees the claims of processes that have exited, and returns how many
+	** were freed. Claims are also taken over lazily by `try_claim`, so this
+	** only serves to keep the registry tidy.
+	*/
+	size_t reap()
+	{
+		auto r = size_t{};
+		for (auto cpu = uint32_t{}; cpu != layout::capacity; ++cpu) {
+			auto& o = slot(cpu);
+			auto cur = o.load(std::memory_order_acquire);
+			if (cur != 0 && !is_live(cur) &&
+				o.compare_exchange_strong(cur, 0,
+				std::memory_order_acq_rel))
+			{
+				++r;
+			}
+		}
+		return r;
+	}
+private:
+	std::atomic<uint64_t>& slot(uint32_t cpu) const
+	{
+		if (cpu >= layout::capacity) {
+			throw std::out_of_range{"CPU thread beyond the capacity of "
+				"the registry"};
+		}
+		return m_layout->owners[cpu];
+	}
+
+	bool is_live(uint64_t owner) const
+	{
+		if (owner == m_owner) {
+			return true;
+		}
+		auto start = detail::process_start_time(
+			detail::owner_pid(owner), m_procfs_root);
+		return start && detail::make_owner(detail::owner_pid(owner),
+			*start) == owner;
+	}
+
+	/*
+	** Returns the units of the scope, each as a list of CPU threads, in the
+	** order in which the policy visits their first CPU threads.
+	*/
+	static std::vector<std::vector<uint32_t>> claim_units(
+		const system_info& info,
+		claim_scope s,
+		placement_policy p
+	)
+	{
+		// The index of the unit of each CPU thread.
+		auto unit = std::map<uint32_t, size_t>{};
+		auto units = std::vector<std::vector<uint32_t>>{};
+		for (const auto& n : info.available_numa_nodes()) {
+			if (s == claim_scope::numa_node) {
+				units.emplace_back();
+				for (const auto& t : n.cpu_info().available_threads()) {
+					unit[t.os_id()] = units.size() - 1;
+					units.back().push_back(t.os_id());
+				}
+				continue;
+			}
+			for (const auto& c : core_groups(n, info.cpu_info())) {
+				if (s == claim_scope::core) {
+					units.push_back(c);
+					for (auto cpu : c) {
+						unit[cpu] = units.size() - 1;
+					}
+					continue;
+				}
+				for (auto cpu : c) {
+					units.push_back({cpu});
+					unit[cpu] = units.size() - 1;
+				}
+			}
+		}
+
+		auto r = std::vector<std::vector<uint32_t>>{};
+		auto seen = std::vector<bool>(units.size());
+		for (auto cpu : place_threads(info, p, placement_capacity(info, p))) {
+			auto i = unit.at(cpu);
+			if (!seen[i]) {
+				seen[i] = true;
+				r.push_back(units[i]);
+			}
+		}
+		return r;
+	}
+};
+
+}
+
+#endif
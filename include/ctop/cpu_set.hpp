@@ -0,0 +1,526 @@
+/*
+** File Name: cpu_set.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** A set of CPU thread IDs stored as a bitset. Membership tests, counts, and
+** set operations work a 64-bit word at a time, so that they stay cheap on
+** hosts with thousands of CPU threads.
+**
+** The loops over the words are kept free of branches so that the compiler can
+** vectorize them, e.g. to 256-bit operations when AVX2 is enabled, and the
+** counts use `popcnt` when it is enabled. Sets of up to 256 CPU threads are
+** stored inline, without allocating.
+*/
+
+#ifndef Z29F3938C_33A2_480A_83CF_D5B331D25FAC
+#define Z29F3938C_33A2_480A_83CF_D5B331D25FAC
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include <ccbase/format.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#ifndef _GNU_SOURCE
+		#define _GNU_SOURCE
+	#endif
+
+	// For `cpu_set_t`.
+	#include <sched.h>
+	#include <numa.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+class cpu_set final
+{
+	static constexpr auto word_bits = size_t{64};
+	static constexpr auto inline_words = size_t{4};
+
+	static_assert(sizeof(unsigned long) == sizeof(uint64_t),
+		"Expected 64-bit words in kernel and libnuma masks.");
+
+	// The words are in `m_heap` once the set outgrows `m_inline`. Bits past
+	// `m_size` words are zero. The set may end in zero words, so `m_size` is
+	// not part of the value of the set.
+	std::array<uint64_t, inline_words> m_inline{};
+	std::unique_ptr<uint64_t[]> m_heap{};
+	uint32_t m_size{};
+	uint32_t m_capacity{inline_words};
+public:
+	/*
+	** Visits the members in increasing order.
+	*/
+	class const_iterator final
+	{
+		const cpu_set* m_set{};
+		size_t m_pos{};
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = uint32_t;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const uint32_t*;
+		using reference         = uint32_t;
+
+		explicit const_iterator() noexcept {}
+
+		explicit const_iterator(const cpu_set* s, size_t pos) noexcept
+		: m_set{s}, m_pos{s->next(pos)} {}
+
+		uint32_t operator*() const noexcept
+		{ return m_pos; }
+
+		const_iterator& operator++() noexcept
+		{
+			m_pos = m_set->next(m_pos + 1);
+			return *this;
+		}
+
+		const_iterator operator++(int) noexcept
+		{
+			auto r = *this;
+			++*this;
+			return r;
+		}
+
+		bool operator==(const const_iterator& rhs) const noexcept
+		{ return m_pos == rhs.m_pos; }
+
+		bool operator!=(const const_iterator& rhs) const noexcept
+		{ return m_pos != rhs.m_pos; }
+	};
+
+	explicit cpu_set() noexcept {}
+
+	cpu_set(std::initializer_list<uint32_t> ids)
+	{
+		for (auto i : ids) {
+			insert(i);
+		}
+	}
+
+	cpu_set(const cpu_set& rhs)
+	{
+		resize(rhs.m_size);
+		std::copy_n(rhs.data(), m_size, data());
+	}
+
+	cpu_set(cpu_set&& rhs) noexcept
+	{ *this = std::move(rhs); }
+
+	cpu_set& operator=(const cpu_set& rhs)
+	{
+		if (this != &rhs) {
+			m_size = 0;
+			resize(rhs.m_size);
+			std::copy_n(rhs.data(), m_size, data());
+		}
+		return *this;
+	}
+
+	cpu_set& operator=(cpu_set&& rhs) noexcept
+	{
+		if (this == &rhs) {
+			return *this;
+		}
+		if (rhs.m_heap) {
+			m_heap = std::move(rhs.m_heap);
+			m_capacity = rhs.m_capacity;
+		}
+		else {
+			m_heap.reset();
+			m_capacity = inline_words;
+			m_inline = rhs.m_inline;
+		}
+		m_size = rhs.m_size;
+		rhs.m_size = 0;
+		rhs.m_capacity = inline_words;
+		rhs.m_inline.fill(0);
+		return *this;
+	}
+
+	template <class Range>
+	static cpu_set from_range(const Range& ids)
+	{
+		auto r = cpu_set{};
+		for (auto i : ids) {
+			r.insert(i);
+		}
+		return r;
+	}
+
+	/*
+	** Copies the set bits of a libnuma mask, a word at a time.
+	*/
+	static cpu_set from_bitmask(const struct bitmask* m)
+	{
+		auto r = cpu_set{};
+		r.assign_words(m->maskp, m->size);
+		return r;
+	}
+
+	/*
+	** Copies a mask in the format of `sched_getaffinity`, which may be
+	** larger than a `cpu_set_t` when allocated with `CPU_ALLOC`.
+	*/
+	static cpu_set
+	from_cpu_mask(const ::cpu_set_t* m, size_t bytes = sizeof(::cpu_set_t))
+	{
+		auto r = cpu_set{};
+		r.assign_words(reinterpret_cast<const unsigned long*>(m),
+			8 * bytes);
+		return r;
+	}
+
+	/*
+	** Writes the set to a libnuma mask, and throws `std::out_of_range` if a
+	** member does not fit.
+	*/
+	void to_bitmask(struct bitmask* m) const
+	{ copy_words(m->maskp, m->size); }
+
+	/*
+	** Writes the set to a mask for `sched_setaffinity`, and throws
+	** `std::out_of_range` if a member does not fit.
+	*/
+	void to_cpu_mask(::cpu_set_t* m, size_t bytes = sizeof(::cpu_set_t))
+	const
+	{ copy_words(reinterpret_cast<unsigned long*>(m), 8 * bytes); }
+
+	const_iterator begin() const noexcept
+	{ return const_iterator{this, 0}; }
+
+	const_iterator end() const noexcept
+	{ return const_iterator{this, end_pos()}; }
+
+	bool contains(uint32_t i) const noexcept
+	{
+		auto w = i / word_bits;
+		return w < m_size && (data()[w] >> i % word_bits & 1);
+	}
+
+	cpu_set& insert(uint32_t i)
+	{
+		auto w = i / word_bits;
+		if (w >= m_size) {
+			resize(w + 1);
+		}
+		data()[w] |= uint64_t{1} << i % word_bits;
+		return *this;
+	}
+
+	/*
+	** Inserts every ID from `first` through `last`, a word at a time.
+	*/
+	cpu_set& insert(uint32_t first, uint32_t last)
+	{
+		if (first > last) {
+			return *this;
+		}
+		auto fw = first / word_bits;
+		auto lw = last / word_bits;
+		if (lw >= m_size) {
+			resize(lw + 1);
+		}
+		auto head = ~uint64_t{} << first % word_bits;
+		auto tail = ~uint64_t{} >> (word_bits - 1 - last % word_bits);
+		auto w = data();
+		if (fw == lw) {
+			w[fw] |= head & tail;
+			return *this;
+		}
+		w[fw] |= head;
+		std::fill(w + fw + 1, w + lw, ~uint64_t{});
+		w[lw] |= tail;
+		return *this;
+	}
+
+	cpu_set& erase(uint32_t i) noexcept
+	{
+		auto w = i / word_bits;
+		if (w < m_size) {
+			data()[w] &= ~(uint64_t{1} << i % word_bits);
+		}
+		return *this;
+	}
+
+	void clear() noexcept
+	{
+		std::fill_n(data(), m_size, 0);
+		m_size = 0;
+	}
+
+	size_t count() const noexcept
+	{
+		auto w = data();
+		auto r = size_t{};
+		for (auto i = size_t{}; i != m_size; ++i) {
+			r += __builtin_popcountll(w[i]);
+		}
+		return r;
+	}
+
+	bool empty() const noexcept
+	{
+		auto w = data();
+		auto r = uint64_t{};
+		for (auto i = size_t{}; i != m_size; ++i) {
+			r |= w[i];
+		}
+		return r == 0;
+	}
+
+	/*
+	** The smallest member, or `end_pos()` if the set is empty.
+	*/
+	uint32_t front() const noexcept
+	{ return next(0); }
+
+	/*
+	** The largest member, or `end_pos()` if the set is empty.
+	*/
+	size_t back() const noexcept
+	{
+		auto p = data();
+		for (auto w = size_t{m_size}; w != 0; --w) {
+			if (p[w - 1] != 0) {
+				return (w - 1) * word_bits + word_bits - 1 -
+					__builtin_clzll(p[w - 1]);
+			}
+		}
+		return end_pos();
+	}
+
+	/*
+	** One past the largest ID that the storage can hold. Every member is
+	** less than this.
+	*/
+	size_t end_pos() const noexcept
+	{ return m_size * word_bits; }
+
+	/*
+	** Returns the smallest member that is at least `i`, or `end_pos()`.
+	*/
+	size_t next(size_t i) const noexcept
+	{
+		auto w = i / word_bits;
+		if (w >= m_size) {
+			return end_pos();
+		}
+		auto p = data();
+		auto bits = p[w] & (~uint64_t{} << i % word_bits);
+		while (bits == 0) {
+			if (++w == m_size) {
+				return end_pos();
+			}
+			bits = p[w];
+		}
+		return w * word_bits + __builtin_ctzll(bits);
+	}
+
+	bool is_subset_of(const cpu_set& rhs) const noexcept
+	{
+		auto a = data();
+		auto b = rhs.data();
+		auto n = std::min(m_size, rhs.m_size);
+		auto r = uint64_t{};
+		for (auto i = size_t{}; i != n; ++i) {
+			r |= a[i] & ~b[i];
+		}
+		for (auto i = size_t{n}; i < m_size; ++i) {
+			r |= a[i];
+		}
+		return r == 0;
+	}
+
+	bool intersects(const cpu_set& rhs) const noexcept
+	{
+		auto a = data();
+		auto b = rhs.data();
+		auto n = std::min(m_size, rhs.m_size);
+		auto r = uint64_t{};
+		for (auto i = size_t{}; i != n; ++i) {
+			r |= a[i] & b[i];
+		}
+		return r != 0;
+	}
+
+	cpu_set& operator|=(const cpu_set& rhs)
+	{
+		if (rhs.m_size > m_size) {
+			resize(rhs.m_size);
+		}
+		auto a = data();
+		auto b = rhs.data();
+		for (auto i = size_t{}; i != rhs.m_size; ++i) {
+			a[i] |= b[i];
+		}
+		return *this;
+	}
+
+	cpu_set& operator&=(const cpu_set& rhs) noexcept
+	{
+		auto a = data();
+		auto b = rhs.data();
+		auto n = std::min(m_size, rhs.m_size);
+		for (auto i = size_t{}; i != n; ++i) {
+			a[i] &= b[i];
+		}
+		std::fill(a + n, a + m_size, 0);
+		return *this;
+	}
+
+	/*
+	** Removes the members of `rhs`.
+	*/
+	cpu_set& operator-=(const cpu_set& rhs) noexcept
+	{
+		auto a = data();
+		auto b = rhs.data();
+		auto n = std::min(m_size, rhs.m_size);
+		for (auto i = size_t{}; i != n; ++i) {
+			a[i] &= ~b[i];
+		}
+		return *this;
+	}
+
+	cpu_set& operator^=(const cpu_set& rhs)
+	{
+		if (rhs.m_size > m_size) {
+			resize(rhs.m_size);
+		}
+		auto a = data();
+		auto b = rhs.data();
+		for (auto i = size_t{}; i != rhs.m_size; ++i) {
+			a[i] ^= b[i];
+		}
+		return *this;
+	}
+
+	bool operator==(const cpu_set& rhs) const noexcept
+	{
+		auto a = data();
+		auto b = rhs.data();
+		auto n = std::min(m_size, rhs.m_size);
+		auto r = uint64_t{};
+		for (auto i = size_t{}; i != n; ++i) {
+			r |= a[i] ^ b[i];
+		}
+		for (auto i = size_t{n}; i < m_size; ++i) {
+			r |= a[i];
+		}
+		for (auto i = size_t{n}; i < rhs.m_size; ++i) {
+			r |= b[i];
+		}
+		return r == 0;
+	}
+
+	bool operator!=(const cpu_set& rhs) const noexcept
+	{ return !(*this == rhs); }
+
+	std::vector<uint32_t> to_vector() const
+	{ return {begin(), end()}; }
+private:
+	uint64_t* data() noexcept
+	{ return m_heap ? m_heap.get() : m_inline.data(); }
+
+	const uint64_t* data() const noexcept
+	{ return m_heap ? m_heap.get() : m_inline.data(); }
+
+	/*
+	** Sets the number of words in use. New words are zero.
+	*/
+	void resize(size_t n)
+	{
+		if (n > m_capacity) {
+			auto cap = std::max(n, size_t{2} * m_capacity);
+			auto p = std::unique_ptr<uint64_t[]>{new uint64_t[cap]()};
+			std::copy_n(data(), m_size, p.get());
+			m_heap = std::move(p);
+			m_capacity = uint32_t(cap);
+		}
+		if (n > m_size) {
+			std::fill(data() + m_size, data() + n, 0);
+		}
+		m_size = uint32_t(n);
+	}
+
+	void assign_words(const unsigned long* src, size_t bits)
+	{
+		m_size = 0;
+		resize((bits + word_bits - 1) / word_bits);
+		std::memcpy(data(), src, m_size * sizeof(uint64_t));
+		// The last word may have bits past the size of the mask.
+		if (bits % word_bits != 0) {
+			data()[m_size - 1] &= (uint64_t{1} << bits % word_bits) - 1;
+		}
+	}
+
+	void copy_words(unsigned long* dst, size_t bits) const
+	{
+		auto words = (bits + word_bits - 1) / word_bits;
+		auto last = back();
+		if (last != end_pos() && last >= bits) {
+			throw std::out_of_range{cc::format("CPU thread $ does not "
+				"fit in a mask of $ bits", last, bits)};
+		}
+		auto n = std::min(size_t{m_size}, words);
+		std::memcpy(dst, data(), n * sizeof(uint64_t));
+		std::fill(dst + n, dst + words, 0);
+	}
+};
+
+cpu_set operator|(cpu_set lhs, const cpu_set& rhs)
+{ return lhs |= rhs; }
+
+cpu_set operator&(cpu_set lhs, const cpu_set& rhs)
+{ return lhs &= rhs; }
+
+cpu_set operator-(cpu_set lhs, const cpu_set& rhs)
+{ return lhs -= rhs; }
+
+cpu_set operator^(cpu_set lhs, const cpu_set& rhs)
+{ return lhs ^= rhs; }
+
+/*
+** Writes the set as a list of ranges, e.g. "0-3,8,10-11", which is the format
+** of the CPU lists in sysfs. See `parse_cpu_set` to read one.
+*/
+std::ostream& operator<<(std::ostream& os, const cpu_set& s)
+{
+	auto first = true;
+	for (auto i = s.next(0); i != s.end_pos();) {
+		auto j = i;
+		while (j + 1 != s.end_pos() && s.contains(j + 1)) {
+			++j;
+		}
+		if (!first) {
+			os.put(',');
+		}
+		first = false;
+		if (i == j) {
+			cc::write(os, "$", i);
+		}
+		else {
+			cc::write(os, "$-$", i, j);
+		}
+		i = s.next(j + 1);
+	}
+	return os;
+}
+
+}
+
+#endif
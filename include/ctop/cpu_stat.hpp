@@ -0,0 +1,310 @@
+/*
+** File Name: cpu_stat.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Samples the per-CPU time counters in `/proc/stat` and aggregates utilization
+** by topology domain. The sampler keeps the file open and rereads it with
+** `pread` into a buffer allocated up front, and the parser works on that
+** buffer in place, so that taking a sample costs one system call and no
+** allocations.
+*/
+
+#ifndef ZA82A4F80_47B8_4F1D_BA73_40CA7C12E18B
+#define ZA82A4F80_47B8_4F1D_BA73_40CA7C12E18B
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/domain_stats.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+/*
+** The columns of a "cpuN" line in `/proc/stat`, in order. Older kernels omit
+** the trailing columns, which are then reported as zero.
+*/
+enum class cpu_time : uint8_t
+{
+	user,
+	nice,
+	system,
+	idle,
+	iowait,
+	irq,
+	softirq,
+	steal,
+	guest,
+	guest_nice,
+};
+
+static constexpr auto cpu_time_count = 10u;
+
+class cpu_times final
+{
+	std::array<uint64_t, cpu_time_count> m_ticks{};
+public:
+	explicit cpu_times() noexcept {}
+
+	uint64_t& operator[](cpu_time t) noexcept
+	{ return m_ticks[size_t(t)]; }
+
+	uint64_t operator[](cpu_time t) const noexcept
+	{ return m_ticks[size_t(t)]; }
+
+	/*
+	** Guest time is already included in user time, so it is not counted
+	** again.
+	*/
+	uint64_t total() const noexcept
+	{
+		auto r = uint64_t{};
+		for (auto i = 0u; i != size_t(cpu_time::guest); ++i) {
+			r += m_ticks[i];
+		}
+		return r;
+	}
+
+	uint64_t idle() const noexcept
+	{ return m_ticks[size_t(cpu_time::idle)] + m_ticks[size_t(cpu_time::iowait)]; }
+
+	uint64_t busy() const noexcept
+	{ return total() - idle(); }
+};
+
+/*
+** Returns the change in each counter from `prev` to `cur`. Counters that went
+** backwards, as the idle and iowait counters can on NOHZ kernels, contribute
+** zero rather than wrapping around.
+*/
+cpu_times cpu_times_delta(const cpu_times& cur, const cpu_times& prev) noexcept
+{
+	auto r = cpu_times{};
+	for (auto i = 0u; i != cpu_time_count; ++i) {
+		auto t = cpu_time(i);
+		r[t] = cur[t] > prev[t] ? cur[t] - prev[t] : 0;
+	}
+	return r;
+}
+
+namespace detail {
+
+/*
+** Parses the run of up to eight decimal digits at `p` with SWAR arithmetic,
+** and advances `p` past it. At least eight bytes must be readable from `p`.
+*/
+CC_ALWAYS_INLINE uint32_t
+parse_digits(const char*& p, unsigned& len) noexcept
+{
+	auto x = uint64_t{};
+	std::memcpy(&x, p, sizeof(x));
+
+	// A byte is a digit iff both it and the byte plus six have 3 as the
+	// high nibble.
+	auto hi = (x & 0xF0F0F0F0F0F0F0F0) ^ 0x3030303030303030;
+	auto hi6 = ((x + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) ^
+		0x3030303030303030;
+	auto nondigit = hi | hi6;
+	len = nondigit == 0 ? 8 : __builtin_ctzll(nondigit) / 8;
+	if (len == 0) {
+		return 0;
+	}
+	p += len;
+
+	// Move the digits to the high bytes, so that the bytes shifted in act as
+	// leading zeros, and combine pairs of digits, then pairs of pairs, and
+	// so on.
+	x = (x << (8 * (8 - len))) & 0x0F0F0F0F0F0F0F0F;
+	x = (x * 2561) >> 8;
+	x = ((x & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+	return ((x & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
+}
+
+CC_ALWAYS_INLINE uint64_t
+parse_integer(const char*& p) noexcept
+{
+	auto r = uint64_t{};
+	auto len = 0u;
+	do {
+		auto d = parse_digits(p, len);
+		static constexpr uint32_t pow10[] =
+			{1, 10, 100, 1000, 10000, 100000, 1000000, 10000000,
+			100000000};
+		r = r * pow10[len] + d;
+	}
+	while (len == 8);
+	return r;
+}
+
+}
+
+/*
+** Reads `/proc/stat` through a persistent file descriptor.
+*/
+class cpu_stat_sampler final
+{
+	pread_file m_file;
+public:
+	explicit cpu_stat_sampler(const std::string& root = default_procfs_root)
+	: m_file{root + "/stat"} {}
+
+	/*
+	** Stores the counters of each CPU thread listed in the file at the
+	** index given by its OS ID, and returns the number of CPU threads read.
+	** Threads with IDs beyond the end of `out` are ignored; the entries of
+	** threads that are missing from the file, e.g. because they are
+	** offline, are left unchanged.
+	*/
+	size_t sample(std::vector<cpu_times>& out)
+	{
+		auto s = m_file.read();
+		return parse(s.begin(), s.end(), out);
+	}
+
+	/*
+	** Parses the contents of `/proc/stat` in `[beg, end)`. At least eight
+	** zero bytes must follow `end`.
+	*/
+	static size_t parse(const char* beg, const char* end,
+		std::vector<cpu_times>& out) noexcept
+	{
+		auto count = size_t{};
+		auto p = beg;
+
+		while (end - p > 3 && std::memcmp(p, "cpu", 3) == 0) {
+			p += 3;
+			auto line_end = (const char*)std::memchr(p, '\n', end - p);
+			if (line_end == nullptr) {
+				line_end = end;
+			}
+
+			// Skip the aggregate line, which has no CPU ID.
+			if (*p >= '0' && *p <= '9') {
+				auto id = detail::parse_integer(p);
+				if (id < out.size()) {
+					auto& t = out[id];
+					for (auto i = 0u; i != cpu_time_count; ++i) {
+						while (*p == ' ') {
+							++p;
+						}
+						if (p >= line_end) {
+							break;
+						}
+						t[cpu_time(i)] = detail::parse_integer(p);
+					}
+				}
+				++count;
+			}
+			p = line_end + 1;
+		}
+		return count;
+	}
+};
+
+/*
+** Holds the two most recent samples of `/proc/stat`, for the monitors that
+** report the change in the counters over an interval. A CPU thread that is
+** missing from a sample, e.g. because it went offline, keeps its previous
+** counters, so its change over that interval is zero.
+*/
+class cpu_stat_interval final
+{
+	cpu_stat_sampler m_sampler;
+	std::vector<cpu_times> m_prev;
+	std::vector<cpu_times> m_cur;
+public:
+	/*
+	** Takes the first sample for the CPU threads with OS IDs below `size`.
+	*/
+	explicit cpu_stat_interval(size_t size, const std::string& root)
+	: m_sampler{root}, m_prev(size), m_cur(size)
+	{ m_sampler.sample(m_cur); }
+
+	/*
+	** Takes a new sample. The interval now ends at it.
+	*/
+	void update()
+	{
+		std::copy(m_cur.begin(), m_cur.end(), m_prev.begin());
+		m_sampler.sample(m_cur);
+	}
+
+	/*
+	** Returns the counters from the most recent sample.
+	*/
+	const cpu_times& times(uint32_t cpu) const noexcept
+	{ return m_cur[cpu]; }
+
+	cpu_times delta(uint32_t cpu) const noexcept
+	{ return cpu_times_delta(m_cur[cpu], m_prev[cpu]); }
+};
+
+/*
+** Tracks the utilization of each available CPU thread between successive
+** calls to `update`, as a fraction in [0, 1], and aggregates it by topology
+** domain. All storage is allocated by the constructor.
+*/
+class utilization_monitor final
+{
+	domain_means m_means;
+	cpu_stat_interval m_stat;
+	std::vector<double> m_util;
+public:
+	explicit utilization_monitor(
+		const system_info& info,
+		const std::string& root = default_procfs_root
+	) : m_means{info}, m_stat{slots(), root}, m_util(slots()) {}
+
+	/*
+	** Takes a new sample, and recomputes the utilization over the interval
+	** since the previous one.
+	*/
+	void update()
+	{
+		m_stat.update();
+		m_means.clear();
+
+		for (auto cpu : cpus()) {
+			auto d = m_stat.delta(cpu);
+			auto total = d.total();
+			m_util[cpu] = total == 0 ? 0 : double(d.busy()) / total;
+			m_means.add(cpu, m_util[cpu]);
+		}
+	}
+
+	const std::vector<uint32_t>& cpus() const noexcept
+	{ return m_means.cpus(); }
+
+	double utilization(uint32_t cpu) const noexcept
+	{ return m_util[cpu]; }
+
+	/*
+	** Returns the counters from the most recent sample.
+	*/
+	const cpu_times& times(uint32_t cpu) const noexcept
+	{ return m_stat.times(cpu); }
+
+	const std::vector<domain_mean>& by(topology_domain d) const noexcept
+	{ return m_means.by(d); }
+
+	const domain_mean& domain(uint32_t cpu, topology_domain d) const noexcept
+	{ return m_means.domain(cpu, d); }
+private:
+	/*
+	** The number of entries needed to index the CPU threads by OS ID.
+	*/
+	size_t slots() const noexcept
+	{ return cpus().empty() ? 0 : cpus().back() + 1; }
+};
+
+}
+
+#endif
@@ -10,6 +10,7 @@
 
 #include <ostream>
 #include <stdexcept>
+#include <ccbase/format.hpp>
 
 namespace ctop {
 
@@ -30,6 +31,9 @@ struct cpuid_leaf
 	static constexpr auto enumerable_qos_monitoring_info  = uint32_t{0xF};
 	static constexpr auto enumerable_qos_enforcement_info = uint32_t{0x10};
 	static constexpr auto enumerable_trace_info           = uint32_t{0x14};
+	static constexpr auto frequency_info                  = uint32_t{0x16};
+	static constexpr auto enumerable_tlb_info             = uint32_t{0x18};
+	static constexpr auto hypervisor_info                 = uint32_t{0x40000000};
 	static constexpr auto max_extended_leaf               = uint32_t{0x80000000};
 	static constexpr auto extended_feature_info           = uint32_t{0x80000001};
 	static constexpr auto brand_string_part_1             = uint32_t{0x80000002};
@@ -56,6 +60,9 @@ struct cpuid_leaf
 		case enumerable_qos_monitoring_info:  return "enumerable_qos_monitoring_info";
 		case enumerable_qos_enforcement_info: return "enumerable_qos_enforcement_info";
 		case enumerable_trace_info:           return "enumerable_trace_info";
+		case frequency_info:                  return "frequency_info";
+		case enumerable_tlb_info:             return "enumerable_tlb_info";
+		case hypervisor_info:                 return "hypervisor_info";
 		case max_extended_leaf:               return "max_extended_leaf";
 		case extended_feature_info:           return "extended_feature_info";
 		case brand_string_part_1:             return "brand_string_part_1";
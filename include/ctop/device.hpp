@@ -0,0 +1,153 @@
+/*
+** File Name: device.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Locality of PCI devices and interrupts. A device attached to the root
+** complex of one package is slower to reach from the other packages, so
+** threads that drive it, and the interrupts that it raises, belong on its own
+** NUMA node.
+*/
+
+#ifndef ZA08A32CA_A60A_4105_A563_CB6D6EF01106
+#define ZA08A32CA_A60A_4105_A563_CB6D6EF01106
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ccbase/utility.hpp>
+
+namespace ctop {
+
+/*
+** The base classes of the PCI class codes that we distinguish.
+*/
+enum class pci_device_class : uint8_t
+{
+	storage = 0x01,
+	network = 0x02,
+	display = 0x03,
+	other   = 0xFF,
+};
+
+std::ostream& operator<<(std::ostream& os, const pci_device_class& c)
+{
+	switch (c) {
+	case pci_device_class::storage:
+		cc::write(os, "storage");
+		return os;
+	case pci_device_class::network:
+		cc::write(os, "network");
+		return os;
+	case pci_device_class::display:
+		cc::write(os, "display");
+		return os;
+	default:
+		cc::write(os, "other");
+		return os;
+	}
+}
+
+class pci_device_info final
+{
+	// The bus address, e.g. "0000:3b:00.0".
+	std::string m_address{};
+	uint32_t m_class_code{};
+	uint16_t m_vendor_id{};
+	uint16_t m_device_id{};
+	// The node to which the device is attached, or -1 if the platform does
+	// not report one.
+	int32_t m_numa_node{-1};
+	// The OS IDs of the CPU threads that are local to the device.
+	std::vector<uint32_t> m_local_cpus{};
+	// The names of the kernel interfaces bound to the device, e.g. "eth0"
+	// or "nvme0".
+	std::vector<std::string> m_interfaces{};
+	// The IRQs that the device can raise, in increasing order. For a
+	// multiqueue device, there is usually one per queue.
+	std::vector<uint32_t> m_irqs{};
+public:
+	explicit pci_device_info() noexcept {}
+
+	pci_device_class device_class() const noexcept
+	{
+		switch (m_class_code >> 16) {
+		case 0x01: return pci_device_class::storage;
+		case 0x02: return pci_device_class::network;
+		case 0x03: return pci_device_class::display;
+		default:   return pci_device_class::other;
+		}
+	}
+
+	DEFINE_REF_GETTER_SETTER(pci_device_info, address, m_address)
+	DEFINE_COPY_GETTER_SETTER(pci_device_info, class_code, m_class_code)
+	DEFINE_COPY_GETTER_SETTER(pci_device_info, vendor_id, m_vendor_id)
+	DEFINE_COPY_GETTER_SETTER(pci_device_info, device_id, m_device_id)
+	DEFINE_COPY_GETTER_SETTER(pci_device_info, numa_node, m_numa_node)
+	DEFINE_REF_GETTER_SETTER(pci_device_info, local_cpus, m_local_cpus)
+	DEFINE_REF_GETTER_SETTER(pci_device_info, interfaces, m_interfaces)
+	DEFINE_REF_GETTER_SETTER(pci_device_info, irqs, m_irqs)
+};
+
+std::ostream& operator<<(std::ostream& os, const pci_device_info& d)
+{
+	cc::write(os, "PCI device: {address: $, class: $, NUMA node: $, "
+		"IRQs: $}", d.address(), d.device_class(), d.numa_node(),
+		d.irqs().size());
+	return os;
+}
+
+class irq_info final
+{
+	uint32_t m_irq{};
+	// The text after the counts in `/proc/interrupts`, e.g. "IR-PCI-MSI
+	// 524288-edge eth0-TxRx-0". The last word names the handlers.
+	std::string m_description{};
+	// The CPU threads on which the interrupt may be delivered.
+	std::vector<uint32_t> m_affinity{};
+	// The number of times that the interrupt was handled by each CPU
+	// thread, indexed by OS ID, when the system was queried.
+	std::vector<uint64_t> m_counts{};
+public:
+	explicit irq_info() noexcept {}
+
+	boost::string_ref name() const noexcept
+	{
+		auto s = boost::string_ref{m_description};
+		auto i = s.find_last_of(' ');
+		return i == boost::string_ref::npos ? s : s.substr(i + 1);
+	}
+
+	uint64_t count(uint32_t cpu) const noexcept
+	{ return cpu < m_counts.size() ? m_counts[cpu] : 0; }
+
+	uint64_t total_count() const noexcept
+	{
+		auto r = uint64_t{};
+		for (auto n : m_counts) {
+			r += n;
+		}
+		return r;
+	}
+
+	DEFINE_COPY_GETTER_SETTER(irq_info, irq, m_irq)
+	DEFINE_REF_GETTER_SETTER(irq_info, description, m_description)
+	DEFINE_REF_GETTER_SETTER(irq_info, affinity, m_affinity)
+	DEFINE_REF_GETTER_SETTER(irq_info, counts, m_counts)
+};
+
+std::ostream& operator<<(std::ostream& os, const irq_info& i)
+{
+	cc::write(os, "IRQ $: {name: $, count: $}", i.irq(), i.name(),
+		i.total_count());
+	return os;
+}
+
+}
+
+#endif
@@ -0,0 +1,296 @@
+/*
+** File Name: device_query.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z3E90A38A_5E32_4D0D_892E_4BB826A74D03
+#define Z3E90A38A_5E32_4D0D_892E_4BB826A74D03
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+/*
+** Parses a hexadecimal sysfs attribute such as "0x020000".
+*/
+uint32_t parse_hex(boost::string_ref s, const std::string& path)
+{
+	while (!s.empty() && std::isspace(s.back())) {
+		s.remove_suffix(1);
+	}
+	if (s.starts_with("0x")) {
+		s.remove_prefix(2);
+	}
+	if (s.empty()) {
+		throw sysfs_error{path, "expected hexadecimal integer"};
+	}
+
+	auto r = uint32_t{};
+	for (auto c : s) {
+		auto d = 0u;
+		if (c >= '0' && c <= '9') {
+			d = c - '0';
+		}
+		else if (c >= 'a' && c <= 'f') {
+			d = c - 'a' + 10;
+		}
+		else if (c >= 'A' && c <= 'F') {
+			d = c - 'A' + 10;
+		}
+		else {
+			throw sysfs_error{path, "expected hexadecimal integer"};
+		}
+		r = 16 * r + d;
+	}
+	return r;
+}
+
+/*
+** Returns the names of the network and NVMe interfaces bound to the device at
+** `dir`. Virtio devices expose these one level further down, under the virtio
+** device.
+*/
+std::vector<std::string> get_device_interfaces(const std::string& dir)
+{
+	auto r = std::vector<std::string>{};
+	auto add = [&](const std::string& d) {
+		for (const auto& s : {"/net", "/nvme", "/block"}) {
+			for (auto& n : list_directory(d + s)) {
+				r.push_back(std::move(n));
+			}
+		}
+	};
+
+	add(dir);
+	for (const auto& e : list_directory(dir)) {
+		if (boost::string_ref{e}.starts_with("virtio")) {
+			add(dir + "/" + e);
+		}
+	}
+	return r;
+}
+
+void get_pci_device_info(system_info& info,
+	const std::string& sysfs_root = default_sysfs_root)
+{
+	auto base = sysfs_root + "/bus/pci/devices";
+	info.pci_devices().clear();
+
+	for (const auto& addr : list_directory(base)) {
+		auto dir = base + "/" + addr;
+		auto d = pci_device_info{};
+		d.address(addr);
+
+		auto path = dir + "/class";
+		d.class_code(parse_hex(read_file(path), path));
+		path = dir + "/vendor";
+		d.vendor_id(parse_hex(read_file(path), path));
+		path = dir + "/device";
+		d.device_id(parse_hex(read_file(path), path));
+
+		// The kernel reports -1 when the firmware does not assign the
+		// device to a node.
+		path = dir + "/numa_node";
+		if (auto s = try_read_file(path)) {
+			if (!s->empty() && s->front() != '-') {
+				d.numa_node(parse_integer(*s, path));
+			}
+		}
+
+		path = dir + "/local_cpulist";
+		if (auto s = try_read_file(path)) {
+			d.local_cpus() = parse_cpu_list(*s, path);
+		}
+
+		d.interfaces() = get_device_interfaces(dir);
+
+		// Devices using MSI or MSI-X list one entry per vector. Otherwise,
+		// the legacy IRQ is used, and zero means none.
+		for (const auto& s : list_directory(dir + "/msi_irqs")) {
+			d.irqs().push_back(parse_integer(s, dir + "/msi_irqs"));
+		}
+		if (d.irqs().empty()) {
+			path = dir + "/irq";
+			auto irq = try_read_integer(path);
+			if (irq && *irq != 0) {
+				d.irqs().push_back(*irq);
+			}
+		}
+		std::sort(d.irqs().begin(), d.irqs().end());
+
+		info.pci_devices().push_back(std::move(d));
+	}
+}
+
+/*
+** Reads the numbered rows of `/proc/interrupts`, and the affinity of each IRQ
+** from `/proc/irq/N`. The rows for IPIs and other architectural interrupts have
+** no IRQ number, and are skipped.
+*/
+void get_irq_info(system_info& info,
+	const std::string& procfs_root = default_procfs_root)
+{
+	auto path = procfs_root + "/interrupts";
+	auto text = read_file(path);
+	auto s = boost::string_ref{text};
+	info.irqs().clear();
+
+	auto next_line = [&]() {
+		auto i = s.find('\n');
+		auto r = s.substr(0, i);
+		s = i == boost::string_ref::npos ? boost::string_ref{} :
+			s.substr(i + 1);
+		return r;
+	};
+	auto next_word = [](boost::string_ref& l) {
+		while (!l.empty() && l.front() == ' ') {
+			l.remove_prefix(1);
+		}
+		auto i = std::min(l.find(' '), l.size());
+		auto r = l.substr(0, i);
+		l.remove_prefix(i);
+		return r;
+	};
+
+	// The header names the column of each online CPU thread.
+	auto columns = std::vector<uint32_t>{};
+	auto max_cpu = uint32_t{};
+	auto header = next_line();
+	for (auto w = next_word(header); !w.empty(); w = next_word(header)) {
+		if (!w.starts_with("CPU")) {
+			throw sysfs_error{path, "expected CPU column"};
+		}
+		columns.push_back(parse_integer(w.substr(3), path));
+		max_cpu = std::max(max_cpu, columns.back());
+	}
+
+	while (!s.empty()) {
+		auto l = next_line();
+		auto w = next_word(l);
+		if (w.size() < 2 || w.back() != ':' ||
+			!std::isdigit(w.front()))
+		{
+			continue;
+		}
+
+		auto irq = irq_info{};
+		irq.irq(parse_integer(w.substr(0, w.size() - 1), path));
+		irq.counts().resize(columns.empty() ? 0 : max_cpu + 1);
+		for (auto c : columns) {
+			auto rest = l;
+			auto n = next_word(l);
+			if (n.empty() || !std::isdigit(n.front())) {
+				l = rest;
+				break;
+			}
+			irq.counts()[c] = parse_integer(n, path);
+		}
+
+		// Collapse the padding between the columns of the description.
+		for (auto w = next_word(l); !w.empty(); w = next_word(l)) {
+			if (!irq.description().empty()) {
+				irq.description() += ' ';
+			}
+			irq.description().append(w.begin(), w.end());
+		}
+
+		auto dir = cc::format("$/irq/$", procfs_root, irq.irq());
+		auto a = try_read_file(dir + "/effective_affinity_list");
+		if (!a || a->empty()) {
+			a = try_read_file(dir + "/smp_affinity_list");
+		}
+		if (a) {
+			irq.affinity() = parse_cpu_list(*a, dir);
+		}
+		info.irqs().push_back(std::move(irq));
+	}
+}
+
+/*
+** Fills in the PCI devices and IRQs of `info`. The roots can be pointed at a
+** fake tree for testing.
+*/
+void get_device_info(
+	system_info& info,
+	const std::string& sysfs_root = default_sysfs_root,
+	const std::string& procfs_root = default_procfs_root
+)
+{
+	get_pci_device_info(info, sysfs_root);
+	get_irq_info(info, procfs_root);
+}
+
+/*
+** Like `get_device_info`, but treats the devices and IRQs as optional data:
+** containers and sandboxes often hide `/proc/interrupts` or parts of the PCI
+** tree. Each list is left empty if its part of the tree is missing or
+** malformed, and false is returned if either one was.
+*/
+bool try_get_device_info(
+	system_info& info,
+	const std::string& sysfs_root = default_sysfs_root,
+	const std::string& procfs_root = default_procfs_root
+)
+{
+	auto ok = true;
+	try {
+		get_pci_device_info(info, sysfs_root);
+	}
+	catch (const sysfs_error&) {
+		info.pci_devices().clear();
+		ok = false;
+	}
+	try {
+		get_irq_info(info, procfs_root);
+	}
+	catch (const sysfs_error&) {
+		info.irqs().clear();
+		ok = false;
+	}
+	return ok;
+}
+
+/*
+** Returns the device with the given bus address or interface name, or
+** `nullptr`.
+*/
+const pci_device_info*
+find_pci_device(boost::string_ref name, const system_info& info) noexcept
+{
+	for (const auto& d : info.pci_devices()) {
+		if (d.address() == name) {
+			return &d;
+		}
+		for (const auto& i : d.interfaces()) {
+			if (i == name) {
+				return &d;
+			}
+		}
+	}
+	return nullptr;
+}
+
+const irq_info* find_irq(uint32_t irq, const system_info& info) noexcept
+{
+	for (const auto& i : info.irqs()) {
+		if (i.irq() == irq) {
+			return &i;
+		}
+	}
+	return nullptr;
+}
+
+}
+
+#endif
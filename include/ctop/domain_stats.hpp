@@ -0,0 +1,128 @@
+/*
+** File Name: domain_stats.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Aggregation of per-CPU-thread measurements by topology domain, for the
+** samplers that report utilization, frequency, and so on.
+*/
+
+#ifndef ZB3B892F7_EE7C_490E_93ED_2135DA84CCD0
+#define ZB3B892F7_EE7C_490E_93ED_2135DA84CCD0
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+/*
+** Returns the OS IDs of the available CPU threads in increasing order.
+*/
+std::vector<uint32_t> available_cpus(const system_info& info)
+{
+	auto r = std::vector<uint32_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		r.push_back(t.os_id());
+	}
+	std::sort(r.begin(), r.end());
+	return r;
+}
+
+/*
+** The mean of a measurement over the CPU threads of one topology domain.
+*/
+struct domain_mean
+{
+	uint32_t id;
+	uint32_t cpu_threads;
+	double value;
+};
+
+/*
+** Computes the mean of a per-CPU-thread measurement over each domain at every
+** topology level. The mapping from CPU threads to domains is computed by the
+** constructor, so `clear` and `add` neither allocate nor search.
+*/
+class domain_means final
+{
+	static constexpr auto domain_count = 4u;
+
+	std::vector<uint32_t> m_cpus;
+	// For each level, the index into `m_domains` of each CPU thread.
+	std::array<std::vector<uint32_t>, domain_count> m_index{};
+	std::array<std::vector<domain_mean>, domain_count> m_domains{};
+public:
+	explicit domain_means(const system_info& info)
+	: m_cpus{available_cpus(info)}
+	{
+		auto size = m_cpus.empty() ? 0 : m_cpus.back() + 1;
+
+		for (auto d = 0u; d != domain_count; ++d) {
+			auto& index = m_index[d];
+			auto& domains = m_domains[d];
+			index.resize(size);
+
+			for (auto cpu : m_cpus) {
+				auto t = find_cpu_thread(cpu, info);
+				auto id = domain_id(*t, topology_domain(d), info);
+				auto it = std::find_if(domains.begin(), domains.end(),
+					[&](const auto& x) { return x.id == id; });
+				if (it == domains.end()) {
+					domains.push_back({id, 0, 0});
+					it = domains.end() - 1;
+				}
+				++it->cpu_threads;
+				index[cpu] = it - domains.begin();
+			}
+		}
+	}
+
+	/*
+	** The available CPU threads, in increasing order of OS ID.
+	*/
+	const std::vector<uint32_t>& cpus() const noexcept
+	{ return m_cpus; }
+
+	void clear() noexcept
+	{
+		for (auto& domains : m_domains) {
+			for (auto& x : domains) {
+				x.value = 0;
+			}
+		}
+	}
+
+	/*
+	** Adds the measurement for one CPU thread. After `clear` and one call
+	** for each CPU thread, each domain holds the mean over its threads.
+	*/
+	void add(uint32_t cpu, double x) noexcept
+	{
+		for (auto d = 0u; d != domain_count; ++d) {
+			auto& m = m_domains[d][m_index[d][cpu]];
+			m.value += x / m.cpu_threads;
+		}
+	}
+
+	/*
+	** Returns the domains at the given level, in the order in which they
+	** were first encountered when enumerating CPU threads by OS ID.
+	*/
+	const std::vector<domain_mean>& by(topology_domain d) const noexcept
+	{ return m_domains[size_t(d)]; }
+
+	/*
+	** Returns the domain at the given level that contains the CPU thread.
+	*/
+	const domain_mean& domain(uint32_t cpu, topology_domain d) const noexcept
+	{ return m_domains[size_t(d)][m_index[size_t(d)][cpu]]; }
+};
+
+}
+
+#endif
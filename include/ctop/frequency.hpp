@@ -0,0 +1,258 @@
+/*
+** File Name: frequency.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Measures the effective frequency of each CPU thread. The nominal frequencies
+** in `cpu_version` say nothing about turbo, AVX frequency offsets, or thermal
+** throttling, all of which change the clock from one interval to the next.
+*/
+
+#ifndef ZD45AFFC8_9BC1_42AD_BF31_A0AA17D71831
+#define ZD45AFFC8_9BC1_42AD_BF31_A0AA17D71831
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/domain_stats.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <fcntl.h>
+	#include <unistd.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+enum class frequency_source : uint8_t
+{
+	// The ratio of the APERF and MPERF MSRs, read through the msr driver.
+	// This is the average frequency over the time that the thread was not
+	// halted, and requires read access to `/dev/cpu/N/msr`.
+	aperf_mperf,
+	// The frequency last requested by or reported to cpufreq, which is
+	// only an approximation of the actual clock.
+	cpufreq,
+};
+
+std::ostream& operator<<(std::ostream& os, const frequency_source& s)
+{
+	switch (s) {
+	case frequency_source::aperf_mperf:
+		cc::write(os, "APERF/MPERF");
+		return os;
+	case frequency_source::cpufreq:
+		cc::write(os, "cpufreq");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** Samples the frequency of each available CPU thread between successive calls
+** to `update`, and aggregates it by topology domain. One file descriptor is
+** kept open per CPU thread, and each sample is taken with `pread`.
+*/
+class frequency_sampler final
+{
+	static constexpr auto msr_mperf = uint32_t{0xE7};
+	static constexpr auto msr_aperf = uint32_t{0xE8};
+
+	domain_means m_means;
+	frequency_source m_source;
+	double m_base_mhz{};
+	std::vector<std::string> m_paths{};
+	std::vector<int> m_fds{};
+	std::vector<uint64_t> m_aperf{};
+	std::vector<uint64_t> m_mperf{};
+	std::vector<double> m_mhz{};
+public:
+	/*
+	** Uses APERF/MPERF if the msr driver is readable for every available
+	** CPU thread and the base frequency is known, and cpufreq otherwise.
+	** Throws `sysfs_error` if neither is available, and
+	** `std::invalid_argument` if `info` has no available CPU threads.
+	*/
+	explicit frequency_sampler(
+		const system_info& info,
+		const std::string& dev_root = default_dev_root,
+		const std::string& sysfs_root = default_sysfs_root
+	) : m_means{info}
+	{
+		if (cpus().empty()) {
+			throw std::invalid_argument{"system has no available CPU "
+				"threads"};
+		}
+
+		auto size = cpus().back() + 1;
+		m_paths.resize(size);
+		m_fds.resize(size, -1);
+		m_aperf.resize(size);
+		m_mperf.resize(size);
+		m_mhz.resize(size);
+
+		m_base_mhz = info.cpu_info().version().base_frequency();
+		if (m_base_mhz == 0) {
+			auto f = try_read_integer(cc::format(
+				"$/devices/system/cpu/cpu$/cpufreq/base_frequency",
+				sysfs_root, cpus().front()));
+			m_base_mhz = f ? *f / 1000.0 : 0;
+		}
+
+		if (m_base_mhz != 0 && open_all([&](uint32_t cpu) {
+			return cc::format("$/cpu/$/msr", dev_root, cpu);
+		}) && read_all_msrs())
+		{
+			m_source = frequency_source::aperf_mperf;
+			return;
+		}
+
+		if (!open_all([&](uint32_t cpu) {
+			return cc::format("$/devices/system/cpu/cpu$/cpufreq/"
+				"scaling_cur_freq", sysfs_root, cpu);
+		}))
+		{
+			throw sysfs_error{m_paths[cpus()[0]], "neither the msr driver "
+				"nor cpufreq is available"};
+		}
+		m_source = frequency_source::cpufreq;
+	}
+
+	~frequency_sampler()
+	{ close_all(); }
+
+	frequency_sampler(const frequency_sampler&) = delete;
+	frequency_sampler& operator=(const frequency_sampler&) = delete;
+
+	/*
+	** Recomputes the frequency of each CPU thread. With APERF/MPERF, this is
+	** the average over the interval since the previous call, and zero for
+	** threads that were halted throughout.
+	*/
+	void update()
+	{
+		m_means.clear();
+		for (auto cpu : cpus()) {
+			if (m_source == frequency_source::aperf_mperf) {
+				auto a = m_aperf[cpu];
+				auto m = m_mperf[cpu];
+				read_msrs(cpu);
+				auto da = m_aperf[cpu] - a;
+				auto dm = m_mperf[cpu] - m;
+				m_mhz[cpu] = dm == 0 ? 0 : m_base_mhz * da / dm;
+			}
+			else {
+				m_mhz[cpu] = read_cpufreq(cpu) / 1000.0;
+			}
+			m_means.add(cpu, m_mhz[cpu]);
+		}
+	}
+
+	frequency_source source() const noexcept
+	{ return m_source; }
+
+	const std::vector<uint32_t>& cpus() const noexcept
+	{ return m_means.cpus(); }
+
+	/*
+	** Returns the frequency of the CPU thread in MHz.
+	*/
+	double frequency(uint32_t cpu) const noexcept
+	{ return m_mhz[cpu]; }
+
+	const std::vector<domain_mean>& by(topology_domain d) const noexcept
+	{ return m_means.by(d); }
+
+	const domain_mean& domain(uint32_t cpu, topology_domain d) const noexcept
+	{ return m_means.domain(cpu, d); }
+private:
+	/*
+	** Opens the file for each CPU thread, and returns false after closing
+	** all of them if any could not be opened.
+	*/
+	template <class PathFunction>
+	bool open_all(PathFunction path)
+	{
+		for (auto cpu : cpus()) {
+			m_paths[cpu] = path(cpu);
+			m_fds[cpu] = ::open(m_paths[cpu].c_str(), O_RDONLY | O_CLOEXEC);
+			if (m_fds[cpu] == -1) {
+				close_all();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void close_all() noexcept
+	{
+		for (auto& fd : m_fds) {
+			if (fd != -1) {
+				::close(fd);
+				fd = -1;
+			}
+		}
+	}
+
+	uint64_t read_msr(uint32_t cpu, uint32_t msr)
+	{
+		auto r = uint64_t{};
+		if (::pread(m_fds[cpu], &r, sizeof(r), msr) != sizeof(r)) {
+			throw sysfs_error{m_paths[cpu], std::strerror(errno)};
+		}
+		return r;
+	}
+
+	void read_msrs(uint32_t cpu)
+	{
+		m_mperf[cpu] = read_msr(cpu, msr_mperf);
+		m_aperf[cpu] = read_msr(cpu, msr_aperf);
+	}
+
+	/*
+	** Takes the initial readings. The msr driver can be opened on machines
+	** that do not implement APERF and MPERF, e.g. some virtual machines; the
+	** reads then fail, and this function returns false after closing the
+	** files.
+	*/
+	bool read_all_msrs()
+	{
+		try {
+			for (auto cpu : cpus()) {
+				read_msrs(cpu);
+			}
+			return true;
+		}
+		catch (const sysfs_error&) {
+			close_all();
+			return false;
+		}
+	}
+
+	uint64_t read_cpufreq(uint32_t cpu)
+	{
+		auto buf = std::array<char, 32>{};
+		auto n = ::pread(m_fds[cpu], buf.data(), buf.size(), 0);
+		if (n == -1) {
+			throw sysfs_error{m_paths[cpu], std::strerror(errno)};
+		}
+		return parse_integer({buf.data(), size_t(n)}, m_paths[cpu]);
+	}
+};
+
+}
+
+#endif
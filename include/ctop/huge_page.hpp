@@ -0,0 +1,411 @@
+/*
+** File Name: huge_page.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef ZD52D2C2A_30F4_4FC4_957B_6D2C0EC4CD29
+#define ZD52D2C2A_30F4_4FC4_957B_6D2C0EC4CD29
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <boost/scope_exit.hpp>
+#include <ccbase/format.hpp>
+#include <ccbase/utility.hpp>
+#include <ctop/numa_error.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <numa.h>
+	#include <numaif.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+
+	// Added in Linux 5.14; older headers lack it.
+	#ifndef MADV_POPULATE_WRITE
+		#define MADV_POPULATE_WRITE 23
+	#endif
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+static constexpr auto huge_page_2m = size_t{1} << 21;
+static constexpr auto huge_page_1g = size_t{1} << 30;
+
+/*
+** The state of one hugetlbfs pool on a NUMA node. The counts are a snapshot;
+** they change as pages are allocated and freed.
+*/
+class huge_page_info final
+{
+	size_t m_page_size;
+	uint64_t m_total;
+	uint64_t m_free;
+	uint64_t m_surplus;
+public:
+	explicit huge_page_info() noexcept {}
+
+	DEFINE_COPY_GETTER_SETTER(huge_page_info, page_size, m_page_size)
+	DEFINE_COPY_GETTER_SETTER(huge_page_info, total_pages, m_total)
+	DEFINE_COPY_GETTER_SETTER(huge_page_info, free_pages, m_free)
+	DEFINE_COPY_GETTER_SETTER(huge_page_info, surplus_pages, m_surplus)
+};
+
+std::ostream& operator<<(std::ostream& os, const huge_page_info& i)
+{
+	cc::write(os, "huge pages: {page size: ${data}, total: ${num}, "
+		"free: ${num}}", i.page_size(), i.total_pages(), i.free_pages());
+	return os;
+}
+
+enum class thp_mode : uint8_t
+{
+	always,
+	madvise,
+	never,
+	unsupported,
+};
+
+std::ostream& operator<<(std::ostream& os, const thp_mode& m)
+{
+	switch (m) {
+	case thp_mode::always:
+		cc::write(os, "always");
+		return os;
+	case thp_mode::madvise:
+		cc::write(os, "madvise");
+		return os;
+	case thp_mode::never:
+		cc::write(os, "never");
+		return os;
+	default:
+		cc::write(os, "unsupported");
+		return os;
+	}
+}
+
+/*
+** Returns one entry for each huge page size configured on the given node,
+** sorted by page size. The list is empty if the kernel does not support
+** hugetlbfs.
+*/
+std::vector<huge_page_info>
+get_huge_page_info(uint32_t node, const std::string& root = default_sysfs_root)
+{
+	auto dir = cc::format("$/devices/system/node/node$/hugepages", root, node);
+	auto r = std::vector<huge_page_info>{};
+
+	for (const auto& name : list_directory(dir)) {
+		// Each directory is named "hugepages-<size>kB".
+		auto s = boost::string_ref{name};
+		if (!s.starts_with("hugepages-") || !s.ends_with("kB")) {
+			throw sysfs_error{dir + "/" + name, "unexpected directory "
+				"name"};
+		}
+		s.remove_prefix(10);
+		s.remove_suffix(2);
+
+		auto path = dir + "/" + name;
+		auto i = huge_page_info{};
+		i.page_size(1024 * parse_integer(s, path));
+		i.total_pages(read_integer(path + "/nr_hugepages"));
+		i.free_pages(read_integer(path + "/free_hugepages"));
+		i.surplus_pages(read_integer(path + "/surplus_hugepages"));
+		r.push_back(i);
+	}
+
+	std::sort(r.begin(), r.end(),
+		[](const huge_page_info& lhs, const huge_page_info& rhs) {
+			return lhs.page_size() < rhs.page_size();
+		});
+	return r;
+}
+
+/*
+** The active mode is the bracketed one, e.g. "always [madvise] never".
+*/
+thp_mode get_thp_mode(const std::string& root = default_sysfs_root)
+{
+	auto path = root + std::string{"/kernel/mm/transparent_hugepage/enabled"};
+	auto s = try_read_file(path);
+	if (!s) {
+		return thp_mode::unsupported;
+	}
+
+	auto str = boost::string_ref{*s};
+	auto beg = str.find('[');
+	auto end = str.find(']');
+	if (beg == boost::string_ref::npos || end == boost::string_ref::npos ||
+		end < beg)
+	{
+		throw sysfs_error{path, "failed to find active mode"};
+	}
+
+	auto mode = str.substr(beg + 1, end - beg - 1);
+	if (mode == "always") {
+		return thp_mode::always;
+	}
+	else if (mode == "madvise") {
+		return thp_mode::madvise;
+	}
+	else if (mode == "never") {
+		return thp_mode::never;
+	}
+	throw sysfs_error{path, "unknown mode"};
+}
+
+/*
+** Returns the number of pages of the given size that the TLBs of one core can
+** map at once, or zero if no TLB supports pages of that size.
+*/
+uint32_t tlb_reach(const global_cpu_info& info, size_t page_size)
+{
+	auto r = uint32_t{};
+	for (const auto& t : info.tlbs()) {
+		if (t.type() == cache_type::instruction) {
+			continue;
+		}
+
+		auto match =
+			(page_size == 4096         && t.has_4k_pages()) ||
+			(page_size == huge_page_2m && t.has_2m_pages()) ||
+			(page_size == huge_page_1g && t.has_1g_pages());
+		if (match) {
+			r = std::max(r, t.entries());
+		}
+	}
+	return r;
+}
+
+/*
+** Chooses the page size to use for a working set of the given size on a node.
+** 1 GiB pages are chosen only when the TLBs can hold them and the node has
+** enough free 1 GiB pages; otherwise 2 MiB pages are used. The caller should
+** still be prepared for `huge_page_pool` to fall back to THP.
+*/
+size_t choose_huge_page_size(
+	size_t working_set,
+	const global_cpu_info& info,
+	const std::vector<huge_page_info>& pools
+)
+{
+	if (working_set >= huge_page_1g && tlb_reach(info, huge_page_1g) != 0) {
+		auto needed = (working_set + huge_page_1g - 1) / huge_page_1g;
+		for (const auto& p : pools) {
+			if (p.page_size() == huge_page_1g && p.free_pages() >= needed) {
+				return huge_page_1g;
+			}
+		}
+	}
+	return huge_page_2m;
+}
+
+/*
+** Hands out fixed-size huge pages whose memory is bound to one NUMA node.
+** Pages are taken from hugetlbfs when possible. If the hugetlbfs pool is
+** exhausted or not configured, the pool falls back to regular mappings aligned
+** to the page size and marked with `MADV_HUGEPAGE`, so that the kernel can back
+** them with transparent huge pages. Every page is faulted in when it is
+** mapped, so that the memory is placed on the right node up front. With THP,
+** the kernel may back a page with base pages if no huge page is free at the
+** time of the fault, so every base page is touched instead.
+**
+** The hugetlbfs reservation made by `mmap` is taken from the pool of the whole
+** host, so it can succeed even though the node has no free pages, and the
+** first write would then raise `SIGBUS`. The free count of the node is checked
+** before mapping, and the mapping is faulted in with `MADV_POPULATE_WRITE`,
+** which reports the failure instead, so that the pool can fall back to THP.
+*/
+class huge_page_pool final
+{
+	struct region
+	{
+		void* base;
+		size_t length;
+	};
+
+	std::vector<region> m_regions{};
+	std::vector<void*> m_free{};
+	std::string m_sysfs_root;
+	size_t m_page_size;
+	uint32_t m_node;
+	bool m_uses_thp{};
+public:
+	explicit huge_page_pool(
+		size_t page_size,
+		uint32_t node,
+		size_t pages = 0,
+		const std::string& sysfs_root = default_sysfs_root
+	) : m_sysfs_root{sysfs_root}, m_page_size{page_size}, m_node{node}
+	{
+		if (page_size != huge_page_2m && page_size != huge_page_1g) {
+			throw std::invalid_argument{"unsupported huge page size"};
+		}
+		if (::numa_available() == -1) {
+			throw numa_error{"libnuma unavailable"};
+		}
+		if (pages != 0) {
+			reserve(pages);
+		}
+	}
+
+	huge_page_pool(huge_page_pool&&) = default;
+	huge_page_pool(const huge_page_pool&) = delete;
+	huge_page_pool& operator=(const huge_page_pool&) = delete;
+
+	~huge_page_pool()
+	{
+		for (const auto& r : m_regions) {
+			::munmap(r.base, r.length);
+		}
+	}
+
+	void* allocate()
+	{
+		if (m_free.empty()) {
+			reserve(1);
+		}
+		auto p = m_free.back();
+		m_free.pop_back();
+		return p;
+	}
+
+	void deallocate(void* p) { m_free.push_back(p); }
+
+	/*
+	** Maps the given number of additional pages into the pool.
+	*/
+	void reserve(size_t pages)
+	{
+		auto len = pages * m_page_size;
+		auto base = map_hugetlb(pages);
+		if (base == nullptr) {
+			base = map_thp(len);
+			m_uses_thp = true;
+		}
+
+		for (auto i = size_t{}; i != pages; ++i) {
+			m_free.push_back(static_cast<char*>(base) + i * m_page_size);
+		}
+	}
+
+	size_t free_pages() const noexcept
+	{ return m_free.size(); }
+
+	DEFINE_COPY_GETTER(huge_page_pool, page_size, m_page_size)
+	DEFINE_COPY_GETTER(huge_page_pool, node, m_node)
+	DEFINE_COPY_GETTER(huge_page_pool, uses_transparent_huge_pages, m_uses_thp)
+private:
+	void bind(void* p, size_t len)
+	{
+		auto mask = ::numa_allocate_nodemask();
+		BOOST_SCOPE_EXIT_ALL(&) {
+			::numa_bitmask_free(mask);
+		};
+
+		::numa_bitmask_setbit(mask, m_node);
+		if (::mbind(p, len, MPOL_BIND, mask->maskp, mask->size + 1, 0) == -1) {
+			auto msg = cc::format("failed to bind memory to node: $",
+				std::strerror(errno));
+			throw numa_error{m_node, msg};
+		}
+	}
+
+	/*
+	** Returns the number of free hugetlbfs pages of the pool's size on the
+	** node, or zero if the node has no such pool.
+	*/
+	uint64_t free_node_pages() const
+	{
+		for (const auto& i : get_huge_page_info(m_node, m_sysfs_root)) {
+			if (i.page_size() == m_page_size) {
+				return i.free_pages();
+			}
+		}
+		return 0;
+	}
+
+	/*
+	** Returns `nullptr` if the node cannot supply the pages.
+	*/
+	void* map_hugetlb(size_t pages)
+	{
+		if (free_node_pages() < pages) {
+			return nullptr;
+		}
+
+		auto len = pages * m_page_size;
+		auto shift = m_page_size == huge_page_1g ? 30 : 21;
+		auto flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+			(shift << MAP_HUGE_SHIFT);
+
+		auto p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (p == MAP_FAILED) {
+			return nullptr;
+		}
+
+		m_regions.push_back({p, len});
+		bind(p, len);
+		if (::madvise(p, len, MADV_POPULATE_WRITE) == 0) {
+			return p;
+		}
+
+		// Kernels before 5.14 reject the advice. The free count of the
+		// node was checked above, so touching the pages is the best that
+		// can be done there.
+		if (errno == EINVAL) {
+			for (auto i = size_t{}; i != len; i += m_page_size) {
+				static_cast<volatile char*>(p)[i] = 0;
+			}
+			return p;
+		}
+		::munmap(p, len);
+		m_regions.pop_back();
+		return nullptr;
+	}
+
+	void* map_thp(size_t len)
+	{
+		// Over-allocate so that the returned range can be aligned.
+		auto total = len + m_page_size;
+		auto p = ::mmap(nullptr, total, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to map memory"};
+		}
+
+		auto addr = reinterpret_cast<uintptr_t>(p);
+		auto aligned = (addr + m_page_size - 1) & ~(m_page_size - 1);
+		m_regions.push_back({p, total});
+
+		auto base = reinterpret_cast<void*>(aligned);
+		if (::madvise(base, len, MADV_HUGEPAGE) == -1) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to enable transparent huge pages"};
+		}
+		bind(base, len);
+
+		auto stride = size_t(::sysconf(_SC_PAGESIZE));
+		for (auto i = size_t{}; i != len; i += stride) {
+			static_cast<volatile char*>(base)[i] = 0;
+		}
+		return base;
+	}
+};
+
+}
+
+#endif
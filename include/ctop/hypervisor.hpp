@@ -0,0 +1,170 @@
+/*
+** File Name: hypervisor.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Detects whether the process runs under a hypervisor, and which one. Leaf 1
+** sets ECX bit 31 under every hypervisor that we know of, and leaf 0x40000000
+** returns the signature of the hypervisor in EBX, ECX, and EDX. Both leaves
+** are read through a function argument, so that recorded CPUID output can
+** stand in for the processor during testing.
+*/
+
+#ifndef Z3A8A798C_FB02_4773_8D5B_C990726DC680
+#define Z3A8A798C_FB02_4773_8D5B_C990726DC680
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/cpuid.hpp>
+#include <ctop/cpuid_leaf.hpp>
+
+namespace ctop {
+
+enum class hypervisor_vendor : uint8_t
+{
+	// Bare metal, or a hypervisor that hides itself.
+	none,
+	kvm,
+	hyper_v,
+	vmware,
+	xen,
+	qemu_tcg,
+	virtualbox,
+	bhyve,
+	acrn,
+	parallels,
+	// The hypervisor bit is set, but the signature is not one that we know.
+	unknown,
+};
+
+std::ostream& operator<<(std::ostream& os, const hypervisor_vendor& v)
+{
+	switch (v) {
+	case hypervisor_vendor::none:
+		cc::write(os, "none");
+		return os;
+	case hypervisor_vendor::kvm:
+		cc::write(os, "KVM");
+		return os;
+	case hypervisor_vendor::hyper_v:
+		cc::write(os, "Hyper-V");
+		return os;
+	case hypervisor_vendor::vmware:
+		cc::write(os, "VMware");
+		return os;
+	case hypervisor_vendor::xen:
+		cc::write(os, "Xen");
+		return os;
+	case hypervisor_vendor::qemu_tcg:
+		cc::write(os, "QEMU TCG");
+		return os;
+	case hypervisor_vendor::virtualbox:
+		cc::write(os, "VirtualBox");
+		return os;
+	case hypervisor_vendor::bhyve:
+		cc::write(os, "bhyve");
+		return os;
+	case hypervisor_vendor::acrn:
+		cc::write(os, "ACRN");
+		return os;
+	case hypervisor_vendor::parallels:
+		cc::write(os, "Parallels");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+struct hypervisor_info
+{
+	hypervisor_vendor vendor{hypervisor_vendor::none};
+	// The twelve bytes of the signature, without trailing NULs.
+	std::string signature{};
+	// The largest leaf in the hypervisor range, or zero.
+	uint32_t max_leaf{};
+
+	bool present() const noexcept
+	{ return vendor != hypervisor_vendor::none; }
+};
+
+std::ostream& operator<<(std::ostream& os, const hypervisor_info& h)
+{
+	cc::write(os, "hypervisor: {vendor: $, signature: ${quote}}", h.vendor,
+		h.signature);
+	return os;
+}
+
+namespace detail {
+
+hypervisor_vendor parse_hypervisor_signature(boost::string_ref s) noexcept
+{
+	static constexpr std::pair<const char*, hypervisor_vendor> sigs[] = {
+		{"KVMKVMKVM",    hypervisor_vendor::kvm},
+		{"Linux KVM Hv", hypervisor_vendor::kvm},
+		{"Microsoft Hv", hypervisor_vendor::hyper_v},
+		{"VMwareVMware", hypervisor_vendor::vmware},
+		{"XenVMMXenVMM", hypervisor_vendor::xen},
+		{"TCGTCGTCGTCG", hypervisor_vendor::qemu_tcg},
+		{"VBoxVBoxVBox", hypervisor_vendor::virtualbox},
+		{"bhyve bhyve ", hypervisor_vendor::bhyve},
+		{"ACRNACRNACRN", hypervisor_vendor::acrn},
+		{" lrpepyh  vr", hypervisor_vendor::parallels},
+	};
+	for (const auto& p : sigs) {
+		if (s == p.first) {
+			return p.second;
+		}
+	}
+	return hypervisor_vendor::unknown;
+}
+
+}
+
+/*
+** Identifies the hypervisor from the output of `cpuid_fn(leaf)`, which must
+** return EAX, EBX, ECX, and EDX like `cpuid`.
+*/
+template <class CpuidFn>
+hypervisor_info detect_hypervisor(const CpuidFn& cpuid_fn)
+{
+	static constexpr auto leaf = cpuid_leaf::hypervisor_info;
+
+	auto r = hypervisor_info{};
+	uint32_t ecx;
+	std::tie(std::ignore, std::ignore, ecx, std::ignore) =
+		cpuid_fn(cpuid_leaf::version_info);
+	if ((ecx & (uint32_t{1} << 31)) == 0) {
+		return r;
+	}
+
+	// Without the hypervisor bit, Intel processors answer leaf 0x40000000
+	// with the data of the largest basic leaf, so it is read only now.
+	auto regs = std::array<uint32_t, 3>{};
+	std::tie(r.max_leaf, regs[0], regs[1], regs[2]) = cpuid_fn(leaf);
+	char buf[12];
+	std::memcpy(buf, regs.data(), sizeof(buf));
+	r.signature.assign(buf, sizeof(buf));
+	// KVM pads its signature with NULs.
+	r.signature.erase(r.signature.find_last_not_of('\0') + 1);
+	r.vendor = detail::parse_hypervisor_signature(r.signature);
+	return r;
+}
+
+hypervisor_info detect_hypervisor()
+{
+	return detect_hypervisor([](uint32_t leaf) { return cpuid(leaf); });
+}
+
+}
+
+#endif
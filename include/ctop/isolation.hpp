@@ -0,0 +1,340 @@
+/*
+** File Name: isolation.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** CPU threads that the kernel keeps free of housekeeping work. `isolcpus`
+** removes CPU threads from scheduler load balancing, `nohz_full` stops the
+** scheduler tick while a single task runs, and `rcu_nocbs` moves RCU callbacks
+** elsewhere. A thread that spins on such a CPU thread sees little jitter, but
+** only as long as no other thread is scheduled there.
+*/
+
+#ifndef Z8E4A1BA3_85AF_4E2C_A50E_13F34CD0BD06
+#define Z8E4A1BA3_85AF_4E2C_A50E_13F34CD0BD06
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <sys/syscall.h>
+	#include <sys/types.h>
+	#include <unistd.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+/*
+** Returns the value of the kernel parameter `name` in the given command line,
+** or `boost::none` if it is absent.
+*/
+boost::optional<boost::string_ref>
+find_kernel_parameter(boost::string_ref cmdline, boost::string_ref name)
+{
+	while (!cmdline.empty()) {
+		auto end = std::min(cmdline.find(' '), cmdline.size());
+		auto p = cmdline.substr(0, end);
+		cmdline.remove_prefix(end);
+		while (!cmdline.empty() && cmdline.front() == ' ') {
+			cmdline.remove_prefix(1);
+		}
+
+		if (p.size() > name.size() && p.starts_with(name) &&
+			p[name.size()] == '=')
+		{
+			return p.substr(name.size() + 1);
+		}
+	}
+	return boost::none;
+}
+
+/*
+** Fills in the isolated, nohz_full, and rcu_nocbs CPU threads of `info`. Only
+** the first two are exported by sysfs, so `rcu_nocbs` is read from the kernel
+** command line.
+*/
+void get_isolation_info(
+	system_info& info,
+	const std::string& sysfs_root = default_sysfs_root,
+	const std::string& procfs_root = default_procfs_root
+)
+{
+	auto dir = sysfs_root + "/devices/system/cpu";
+	auto read_list = [&](const std::string& path) {
+		auto s = try_read_file(path);
+		return s ? parse_cpu_list(*s, path) : std::vector<uint32_t>{};
+	};
+
+	info.isolated_cpus() = read_list(dir + "/isolated");
+	info.nohz_full_cpus() = read_list(dir + "/nohz_full");
+	info.rcu_nocb_cpus().clear();
+
+	auto path = procfs_root + "/cmdline";
+	auto cmdline = try_read_file(path);
+	if (!cmdline) {
+		return;
+	}
+	if (auto s = find_kernel_parameter(*cmdline, "rcu_nocbs")) {
+		if (*s == "all") {
+			info.rcu_nocb_cpus() = read_list(dir + "/possible");
+		}
+		else {
+			info.rcu_nocb_cpus() = parse_cpu_list(*s, path);
+		}
+	}
+}
+
+namespace detail {
+
+std::vector<uint32_t> isolated_or_nohz_full(const system_info& info)
+{
+	auto r = std::vector<uint32_t>{};
+	std::set_union(info.isolated_cpus().begin(), info.isolated_cpus().end(),
+		info.nohz_full_cpus().begin(), info.nohz_full_cpus().end(),
+		std::back_inserter(r));
+	return r;
+}
+
+}
+
+/*
+** Returns the online CPU threads that are either isolated or nohz_full, in
+** increasing order. These are the ones reserved for latency-critical threads.
+** The kernel leaves CPU threads isolated by `isolcpus` out of the default
+** affinity of every task, so they are usually missing from the available CPU
+** threads of `info`, and the online ones are read from sysfs instead.
+*/
+std::vector<uint32_t> isolated_cpus(
+	const system_info& info,
+	const std::string& sysfs_root = default_sysfs_root
+)
+{
+	auto online = read_cpu_set(sysfs_root + "/devices/system/cpu/online");
+	auto r = std::vector<uint32_t>{};
+	for (auto cpu : detail::isolated_or_nohz_full(info)) {
+		if (online.contains(cpu)) {
+			r.push_back(cpu);
+		}
+	}
+	return r;
+}
+
+/*
+** Returns the available CPU threads that are not isolated, in increasing
+** order.
+*/
+std::vector<uint32_t> housekeeping_cpus(const system_info& info)
+{
+	auto iso = detail::isolated_or_nohz_full(info);
+	auto r = std::vector<uint32_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		if (!std::binary_search(iso.begin(), iso.end(), t.os_id())) {
+			r.push_back(t.os_id());
+		}
+	}
+	std::sort(r.begin(), r.end());
+	return r;
+}
+
+struct isolation_violation
+{
+	// The ID of the offending thread.
+	pid_t tid;
+	// The isolated CPU threads on which it may run, but should not.
+	std::vector<uint32_t> cpus;
+};
+
+std::ostream& operator<<(std::ostream& os, const isolation_violation& v)
+{
+	cc::write(os, "thread $ may run on $ isolated CPU threads, starting "
+		"with CPU $", v.tid, v.cpus.size(), v.cpus.front());
+	return os;
+}
+
+/*
+** Hands out isolated CPU threads to latency-critical threads, one each, and
+** keeps every other thread on the housekeeping CPU threads.
+*/
+class cpu_reservation final
+{
+	std::vector<uint32_t> m_isolated;
+	std::vector<uint32_t> m_housekeeping;
+	// The housekeeping CPU threads in the order given by
+	// `placement_policy::scatter`.
+	std::vector<uint32_t> m_worker_order{};
+	// The thread to which each isolated CPU thread is reserved, or zero.
+	std::vector<pid_t> m_owners;
+	mutable std::mutex m_mutex{};
+public:
+	explicit cpu_reservation(
+		const system_info& info,
+		const std::string& sysfs_root = default_sysfs_root
+	) :
+	m_isolated{isolated_cpus(info, sysfs_root)},
+	m_housekeeping{housekeeping_cpus(info)},
+	m_owners(m_isolated.size())
+	{
+		auto all = place_threads(info, placement_policy::scatter,
+			info.available_cpu_threads().size());
+		for (auto cpu : all) {
+			if (std::binary_search(m_housekeeping.begin(),
+				m_housekeeping.end(), cpu))
+			{
+				m_worker_order.push_back(cpu);
+			}
+		}
+	}
+
+	const std::vector<uint32_t>& isolated() const noexcept
+	{ return m_isolated; }
+
+	const std::vector<uint32_t>& housekeeping() const noexcept
+	{ return m_housekeeping; }
+
+	/*
+	** Reserves a free isolated CPU thread for the calling thread, and pins
+	** the thread to it. Throws `std::runtime_error` if every isolated CPU
+	** thread is taken.
+	*/
+	uint32_t reserve_current_thread()
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto tid = current_tid();
+		auto it = std::find(m_owners.begin(), m_owners.end(), tid);
+		if (it == m_owners.end()) {
+			it = std::find(m_owners.begin(), m_owners.end(), 0);
+		}
+		if (it == m_owners.end()) {
+			throw std::runtime_error{"no free isolated CPU thread"};
+		}
+
+		auto cpu = m_isolated[it - m_owners.begin()];
+		pin_current_thread(cpu);
+		*it = tid;
+		return cpu;
+	}
+
+	/*
+	** Returns the reservation of the calling thread, if any, and moves the
+	** thread to the housekeeping CPU threads.
+	*/
+	void release_current_thread()
+	{
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			std::replace(m_owners.begin(), m_owners.end(),
+				current_tid(), pid_t{});
+		}
+		confine_current_thread();
+	}
+
+	/*
+	** Restricts the calling thread, e.g. a general-purpose worker, to the
+	** housekeeping CPU threads.
+	*/
+	void confine_current_thread() const
+	{
+		if (m_housekeeping.empty()) {
+			throw std::runtime_error{"no housekeeping CPU threads"};
+		}
+		pin_current_thread(m_housekeeping);
+	}
+
+	/*
+	** Returns CPU threads for `count` general-purpose workers, spread as
+	** by `placement_policy::scatter` but restricted to the housekeeping CPU
+	** threads.
+	*/
+	std::vector<uint32_t> place_workers(size_t count) const
+	{
+		if (count > m_housekeeping.size()) {
+			throw std::invalid_argument{"more workers requested than "
+				"housekeeping CPU threads available"};
+		}
+
+		return {m_worker_order.begin(), m_worker_order.begin() + count};
+	}
+
+	/*
+	** Checks the affinity of every thread in this process. No thread may
+	** run on an isolated CPU thread, except on the one reserved for it.
+	*/
+	std::vector<isolation_violation>
+	violations(const std::string& procfs_root = default_procfs_root) const
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto r = std::vector<isolation_violation>{};
+		auto dir = procfs_root + "/self/task";
+
+		for (const auto& name : list_directory(dir)) {
+			auto tid = pid_t(parse_integer(name, dir));
+			auto allowed = allowed_cpus(dir + "/" + name + "/status");
+			if (!allowed) {
+				// The thread exited.
+				continue;
+			}
+
+			auto v = isolation_violation{tid, {}};
+			for (auto i = size_t{}; i != m_isolated.size(); ++i) {
+				auto cpu = m_isolated[i];
+				if (m_owners[i] != tid && std::binary_search(
+					allowed->begin(), allowed->end(), cpu))
+				{
+					v.cpus.push_back(cpu);
+				}
+			}
+			if (!v.cpus.empty()) {
+				r.push_back(std::move(v));
+			}
+		}
+		return r;
+	}
+private:
+	static pid_t current_tid() noexcept
+	{ return ::syscall(SYS_gettid); }
+
+	static boost::optional<std::vector<uint32_t>>
+	allowed_cpus(const std::string& path)
+	{
+		static constexpr char key[] = "Cpus_allowed_list:";
+
+		auto s = try_read_file(path);
+		if (!s) {
+			return boost::none;
+		}
+
+		auto status = boost::string_ref{*s};
+		auto i = status.find(key);
+		if (i == boost::string_ref::npos) {
+			throw sysfs_error{path, "missing Cpus_allowed_list"};
+		}
+		auto line = status.substr(i + sizeof(key) - 1);
+		line = line.substr(0, line.find('\n'));
+		while (!line.empty() && std::isspace(line.front())) {
+			line.remove_prefix(1);
+		}
+		return parse_cpu_list(line, path);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,163 @@
+/*
+** File Name: lazy_system_query.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** A query whose parts are computed on first use. The CPUID leaves that
+** describe the version, layout, caches, and TLBs take microseconds to read,
+** but the NUMA topology needs the calling thread to visit every CPU thread in
+** turn, and reading devices and IRQs walks sysfs. A caller that only wants the
+** line size should not pay for either.
+*/
+
+#ifndef Z830ABC76_D8C9_478A_AFD5_363B05071E1A
+#define Z830ABC76_D8C9_478A_AFD5_363B05071E1A
+
+#include <future>
+#include <mutex>
+
+#include <ctop/cpuid.hpp>
+#include <ctop/cpuid_error.hpp>
+#include <ctop/device_query.hpp>
+#include <ctop/isolation.hpp>
+#include <ctop/system.hpp>
+#include <ctop/system_query.hpp>
+
+namespace ctop {
+
+/*
+** Computes each part of a `system_info` the first time that it is needed, and
+** keeps it. Every accessor may be called from any thread; concurrent callers
+** of the same part wait for one of them to compute it. If computing a part
+** throws, the exception is passed to the caller, and the next caller tries
+** again.
+**
+** The object may not be moved, since `start_async` hands its address to
+** another thread.
+*/
+class lazy_system_query final
+{
+	system_info m_info{};
+	std::once_flag m_version_once{};
+	std::once_flag m_layout_once{};
+	std::once_flag m_cache_once{};
+	std::once_flag m_tlb_once{};
+	std::once_flag m_topology_once{};
+	std::mutex m_async_mutex{};
+	std::shared_future<void> m_async{};
+public:
+	explicit lazy_system_query() noexcept {}
+
+	/*
+	** Waits for the topology started by `start_async`, if any.
+	*/
+	~lazy_system_query()
+	{
+		if (m_async.valid()) {
+			m_async.wait();
+		}
+	}
+
+	lazy_system_query(const lazy_system_query&) = delete;
+	lazy_system_query& operator=(const lazy_system_query&) = delete;
+
+	/*
+	** The vendor, model, brand string, and nominal frequencies.
+	*/
+	const cpu_version& version()
+	{
+		std::call_once(m_version_once, [&] {
+			auto m = max_cpuid_leaf();
+			if (!m) {
+				throw cpuid_unsupported_error{};
+			}
+			if (m < 11u) {
+				throw cpuid_error{cpuid_leaf::enumerable_topology_info,
+					"unsupported"};
+			}
+			get_basic_cpu_info(m_info.cpu_info());
+		});
+		return m_info.cpu_info().version();
+	}
+
+	/*
+	** The caches of the CPU. Threads that share each cache are given by
+	** the layout, so the layout is read first.
+	*/
+	auto caches()
+	{
+		layout();
+		std::call_once(m_cache_once, [&] {
+			get_cpu_cache_info(m_info.cpu_info());
+		});
+		return static_cast<const global_cpu_info&>(m_info.cpu_info()).
+			caches();
+	}
+
+	auto tlbs()
+	{
+		layout();
+		std::call_once(m_tlb_once, [&] {
+			get_cpu_tlb_info(m_info.cpu_info());
+		});
+		return static_cast<const global_cpu_info&>(m_info.cpu_info()).
+			tlbs();
+	}
+
+	/*
+	** Everything read from CPUID: the version, the widths of the x2APIC ID
+	** fields and the thread and core counts, the caches, and the TLBs.
+	*/
+	const global_cpu_info& cpu_info()
+	{
+		caches();
+		tlbs();
+		return m_info.cpu_info();
+	}
+
+	/*
+	** The complete result of `system_query`, including the NUMA topology,
+	** the devices, and the isolated CPU threads.
+	*/
+	const system_info& info()
+	{
+		cpu_info();
+		std::call_once(m_topology_once, [&] {
+			get_numa_info(m_info);
+			try_get_device_info(m_info);
+			get_isolation_info(m_info);
+		});
+		return m_info;
+	}
+
+	/*
+	** Computes everything on another thread, so that the walk over the CPU
+	** threads overlaps with the rest of startup and leaves the affinity of
+	** the calling thread alone. The returned future becomes ready when
+	** `info` no longer blocks, and holds any exception that it threw. Later
+	** calls return the same future.
+	*/
+	std::shared_future<void> start_async()
+	{
+		std::lock_guard<std::mutex> lock{m_async_mutex};
+		if (!m_async.valid()) {
+			m_async = std::async(std::launch::async, [this] {
+				info();
+			}).share();
+		}
+		return m_async;
+	}
+private:
+	void layout()
+	{
+		version();
+		std::call_once(m_layout_once, [&] {
+			get_cpu_layout_info(m_info.cpu_info());
+		});
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*
+** File Name: native_topology.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Compile-time constants describing the machine on which the library is built.
+** Running `rake native_topology` probes the build machine and writes
+** `ctop/generated/native_topology.hpp`; when that header is absent, the
+** constants below fall back to conservative defaults and
+** `native::is_specialized` is false. Binaries that use the constants should
+** call `verify_native_topology` at startup, in the same way that binaries
+** built with `-march=native` assume that they run on the build machine.
+*/
+
+#ifndef Z71BE77E0_5046_4AFF_93C7_5D04DB32C4C6
+#define Z71BE77E0_5046_4AFF_93C7_5D04DB32C4C6
+
+#include <cstdint>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/system.hpp>
+#include <ctop/topology_mismatch_error.hpp>
+
+#if defined(__has_include)
+	#if __has_include(<ctop/generated/native_topology.hpp>)
+		#include <ctop/generated/native_topology.hpp>
+	#endif
+#endif
+
+namespace ctop {
+
+#ifndef CTOP_NATIVE_TOPOLOGY
+
+namespace native {
+
+static constexpr auto is_specialized    = false;
+static constexpr auto cpu_family        = uint32_t{0};
+static constexpr auto cpu_model         = uint32_t{0};
+static constexpr auto cache_line_size   = uint32_t{64};
+static constexpr auto l1d_cache_size    = uint32_t{32 * 1024};
+static constexpr auto l2_cache_size     = uint32_t{256 * 1024};
+static constexpr auto llc_size          = uint32_t{8 * 1024 * 1024};
+static constexpr auto threads_per_core  = uint32_t{1};
+static constexpr auto cores_per_package = uint32_t{1};
+static constexpr auto numa_nodes        = uint32_t{1};
+
+}
+
+#endif
+
+/*
+** Pads `T` to a multiple of the native cache line size, to avoid false sharing
+** between adjacent objects.
+*/
+template <class T>
+struct alignas(native::cache_line_size) cache_aligned
+{
+	T value;
+};
+
+/*
+** Returns the size of the given level of data or unified cache, or zero if
+** there is no such cache. Level zero denotes the last-level cache.
+*/
+uint32_t data_cache_size(const global_cpu_info& info, uint8_t level) noexcept
+{
+	auto r = uint32_t{};
+	auto max_level = uint8_t{};
+	for (const auto& c : info.caches()) {
+		if (c.type() == cache_type::instruction) {
+			continue;
+		}
+		if (level == 0 ? c.level() >= max_level : c.level() == level) {
+			max_level = c.level();
+			r = c.size();
+		}
+	}
+	return r;
+}
+
+/*
+** Returns a description of each value that differs between the compile-time
+** constants and the given system. The result is empty if the library was not
+** specialized for a particular machine.
+*/
+std::vector<std::string>
+native_topology_mismatches(const system_info& info)
+{
+	auto r = std::vector<std::string>{};
+	if (!native::is_specialized) {
+		return r;
+	}
+
+	const auto& cpu = info.cpu_info();
+	auto check = [&](const char* name, uint32_t expected, uint32_t actual) {
+		if (expected != actual) {
+			r.push_back(cc::format("$: built for $, running on $",
+				name, expected, actual));
+		}
+	};
+
+	check("CPU family", native::cpu_family, cpu.version().family());
+	check("CPU model", native::cpu_model, cpu.version().model());
+	check("cache line size", native::cache_line_size, cache_line_size(cpu));
+	check("L1d cache size", native::l1d_cache_size, data_cache_size(cpu, 1));
+	check("L2 cache size", native::l2_cache_size, data_cache_size(cpu, 2));
+	check("LLC size", native::llc_size, data_cache_size(cpu, 0));
+	check("threads per core", native::threads_per_core, cpu.threads_per_core());
+	check("cores per package", native::cores_per_package, cpu.total_cores());
+	check("NUMA nodes", native::numa_nodes, info.total_numa_nodes());
+	return r;
+}
+
+enum class mismatch_policy : uint8_t
+{
+	// Throw `topology_mismatch_error`.
+	fail,
+	// Print every mismatch to the given stream, and return false so that
+	// the caller can switch to the values from `system_info`.
+	warn,
+};
+
+/*
+** Checks that the binary is running on the kind of machine for which it was
+** built. Returns true if it is, or if the library was not specialized.
+*/
+bool verify_native_topology(
+	const system_info& info,
+	mismatch_policy p = mismatch_policy::fail,
+	std::ostream& os = std::cerr
+)
+{
+	auto m = native_topology_mismatches(info);
+	if (m.empty()) {
+		return true;
+	}
+
+	if (p == mismatch_policy::fail) {
+		throw topology_mismatch_error{std::move(m)};
+	}
+
+	cc::writeln(os, "Warning: this binary was specialized for a different "
+		"machine; falling back to runtime topology information.");
+	for (const auto& s : m) {
+		cc::writeln(os, "  $.", s);
+	}
+	return false;
+}
+
+/*
+** Writes the header read by this file, describing the given system.
+*/
+void write_native_topology(std::ostream& os, const system_info& info)
+{
+	const auto& cpu = info.cpu_info();
+	cc::writeln(os, "/*");
+	cc::writeln(os, "** Generated by `rake native_topology` for $.",
+		cpu.version());
+	cc::writeln(os, "** Do not edit.");
+	cc::writeln(os, "*/");
+	cc::writeln(os, "");
+	cc::writeln(os, "#ifndef CTOP_NATIVE_TOPOLOGY");
+	cc::writeln(os, "#define CTOP_NATIVE_TOPOLOGY");
+	cc::writeln(os, "");
+	cc::writeln(os, "#include <cstdint>");
+	cc::writeln(os, "");
+	cc::writeln(os, "namespace ctop {");
+	cc::writeln(os, "namespace native {");
+	cc::writeln(os, "");
+
+	auto constant = [&](const char* name, uint32_t value) {
+		cc::writeln(os, "static constexpr auto $ = uint32_t{$};", name,
+			value);
+	};
+
+	cc::writeln(os, "static constexpr auto is_specialized = true;");
+	constant("cpu_family", cpu.version().family());
+	constant("cpu_model", cpu.version().model());
+	constant("cache_line_size", cache_line_size(cpu));
+	constant("l1d_cache_size", data_cache_size(cpu, 1));
+	constant("l2_cache_size", data_cache_size(cpu, 2));
+	constant("llc_size", data_cache_size(cpu, 0));
+	constant("threads_per_core", cpu.threads_per_core());
+	constant("cores_per_package", cpu.total_cores());
+	constant("numa_nodes", info.total_numa_nodes());
+
+	cc::writeln(os, "");
+	cc::writeln(os, "}");
+	cc::writeln(os, "}");
+	cc::writeln(os, "");
+	cc::writeln(os, "#endif");
+}
+
+}
+
+#endif
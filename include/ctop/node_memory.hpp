@@ -0,0 +1,86 @@
+/*
+** File Name: node_memory.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef ZA0FFD3ED_810E_4B1D_98B7_237CFCDBB4E5
+#define ZA0FFD3ED_810E_4B1D_98B7_237CFCDBB4E5
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include <ccbase/utility.hpp>
+#include <ctop/numa_error.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <numa.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+CC_CONST CC_ALWAYS_INLINE constexpr size_t
+round_up(size_t n, size_t align)
+{
+	return (n + align - 1) / align * align;
+}
+
+/*
+** Owns a block of memory whose pages are bound to one NUMA node. The memory is
+** zero-filled and page-aligned.
+*/
+class node_buffer final
+{
+	void* m_data{};
+	size_t m_size{};
+	uint32_t m_node{};
+public:
+	explicit node_buffer(size_t size, uint32_t node)
+	: m_size{size}, m_node{node}
+	{
+		if (::numa_available() == -1) {
+			throw numa_error{"libnuma unavailable"};
+		}
+
+		m_data = ::numa_alloc_onnode(size, node);
+		if (m_data == nullptr) {
+			throw numa_error{node, "failed to allocate node-local memory"};
+		}
+	}
+
+	node_buffer(node_buffer&& rhs) noexcept
+	: m_data{rhs.m_data}, m_size{rhs.m_size}, m_node{rhs.m_node}
+	{ rhs.m_data = nullptr; }
+
+	node_buffer& operator=(node_buffer&& rhs) noexcept
+	{
+		std::swap(m_data, rhs.m_data);
+		std::swap(m_size, rhs.m_size);
+		std::swap(m_node, rhs.m_node);
+		return *this;
+	}
+
+	node_buffer(const node_buffer&) = delete;
+	node_buffer& operator=(const node_buffer&) = delete;
+
+	~node_buffer()
+	{
+		if (m_data != nullptr) {
+			::numa_free(m_data, m_size);
+		}
+	}
+
+	void* data() noexcept { return m_data; }
+	const void* data() const noexcept { return m_data; }
+
+	DEFINE_COPY_GETTER(node_buffer, size, m_size)
+	DEFINE_COPY_GETTER(node_buffer, node, m_node)
+};
+
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+** File Name: parse_error.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef ZE15DF3C2_CAF5_4CB2_9FF5_A4F87B8CF6B6
+#define ZE15DF3C2_CAF5_4CB2_9FF5_A4F87B8CF6B6
+
+#include <exception>
+#include <ccbase/format.hpp>
+#include <ccbase/utility.hpp>
+#include <boost/utility/string_ref.hpp>
+
+namespace ctop {
+
+/*
+** Thrown when serialized topology information is truncated, malformed, or was
+** written by a newer version of the library.
+*/
+class parse_error final : public std::exception
+{
+	size_t m_offset;
+	std::string m_msg{};
+public:
+	explicit parse_error(size_t offset, const boost::string_ref& msg)
+	noexcept : m_offset{offset}
+	{
+		m_msg = cc::format("Parse error at offset $: $.", offset, msg);
+	}
+
+	const char* what() const noexcept override
+	{ return m_msg.c_str(); }
+
+	DEFINE_COPY_GETTER(parse_error, offset, m_offset)
+};
+
+}
+
+#endif
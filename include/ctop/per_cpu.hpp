@@ -0,0 +1,526 @@
+/*
+** File Name: per_cpu.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z35256382_8782_4976_AE41_B9C8EC3EE7C6
+#define Z35256382_8782_4976_AE41_B9C8EC3EE7C6
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/barrier.hpp>
+#include <ctop/node_memory.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#ifndef _GNU_SOURCE
+		#define _GNU_SOURCE
+	#endif
+
+	// For `sched_getcpu`.
+	#include <sched.h>
+
+	/*
+	** The registration of restartable sequences by glibc, and the variables
+	** that describe it, were introduced in glibc 2.35.
+	*/
+	#if defined(__x86_64__) && defined(__has_include)
+		#if __has_include(<sys/rseq.h>)
+			#include <sys/rseq.h>
+			#define CTOP_HAS_RSEQ
+		#endif
+	#endif
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+#ifdef CTOP_HAS_RSEQ
+
+CC_ALWAYS_INLINE struct rseq* rseq_area() noexcept
+{
+	auto tp = static_cast<char*>(__builtin_thread_pointer());
+	return reinterpret_cast<struct rseq*>(tp + __rseq_offset);
+}
+
+/*
+** The sequences below follow the conventions of librseq. Each one publishes a
+** descriptor in the `__rseq_cs` section that gives the start, length, and
+** abort handler of the critical section, stores the address of the descriptor
+** in the thread's rseq area, and checks that the thread is still running on
+** the expected CPU. If the thread is preempted, migrated, or signaled before
+** the final store, the kernel diverts it to the abort handler, and the
+** function returns `rseq_aborted`. The abort handler must be preceded by the
+** signature that glibc registered.
+*/
+
+static constexpr auto rseq_committed = 0;
+static constexpr auto rseq_compare_failed = 1;
+static constexpr auto rseq_aborted = -1;
+
+#define CTOP_RSEQ_STR_(x) #x
+#define CTOP_RSEQ_STR(x) CTOP_RSEQ_STR_(x)
+
+#define CTOP_RSEQ_BEGIN                                             \
+	".pushsection __rseq_cs, \"aw\"\n\t"                        \
+	".balign 32\n\t"                                            \
+	"3:\n\t"                                                    \
+	".long 0x0, 0x0\n\t"                                        \
+	".quad 1f, (2f - 1f), 4f\n\t"                               \
+	".popsection\n\t"                                           \
+	"leaq 3b(%%rip), %%rax\n\t"                                 \
+	"movq %%rax, %[rseq_cs]\n\t"                                \
+	"1:\n\t"                                                    \
+	"cmpl %[cpu], %[current_cpu]\n\t"                           \
+	"jnz 4f\n\t"
+
+#define CTOP_RSEQ_END                                               \
+	"2:\n\t"                                                    \
+	".pushsection __rseq_failure, \"ax\"\n\t"                   \
+	".byte 0x0f, 0xb9, 0x3d\n\t"                                \
+	".long " CTOP_RSEQ_STR(RSEQ_SIG) "\n\t"                     \
+	"4:\n\t"                                                    \
+	"jmp %l[abort]\n\t"                                         \
+	".popsection\n\t"
+
+/*
+** Adds `count` to `*v` if the thread is running on `cpu`.
+*/
+CC_ALWAYS_INLINE int
+rseq_add(int64_t* v, int64_t count, uint32_t cpu) noexcept
+{
+	auto area = rseq_area();
+	asm volatile goto (
+		CTOP_RSEQ_BEGIN
+		"addq %[count], %[v]\n\t"
+		CTOP_RSEQ_END
+		:
+		: [cpu]         "r"  (cpu),
+		  [current_cpu] "m"  (area->cpu_id),
+		  [rseq_cs]     "m"  (area->rseq_cs),
+		  [v]           "m"  (*v),
+		  [count]       "er" (count)
+		: "memory", "cc", "rax"
+		: abort
+	);
+	return rseq_committed;
+abort:
+	return rseq_aborted;
+}
+
+/*
+** Stores `desired` to `*v` if the thread is running on `cpu` and `*v` is
+** equal to `expected`.
+*/
+CC_ALWAYS_INLINE int
+rseq_compare_store(void** v, void* expected, void* desired, uint32_t cpu) noexcept
+{
+	auto area = rseq_area();
+	asm volatile goto (
+		CTOP_RSEQ_BEGIN
+		"cmpq %[v], %[expected]\n\t"
+		"jnz %l[compare_failed]\n\t"
+		"movq %[desired], %[v]\n\t"
+		CTOP_RSEQ_END
+		:
+		: [cpu]         "r" (cpu),
+		  [current_cpu] "m" (area->cpu_id),
+		  [rseq_cs]     "m" (area->rseq_cs),
+		  [v]           "m" (*v),
+		  [expected]    "r" (expected),
+		  [desired]     "r" (desired)
+		: "memory", "cc", "rax"
+		: abort, compare_failed
+	);
+	return rseq_committed;
+abort:
+	return rseq_aborted;
+compare_failed:
+	return rseq_compare_failed;
+}
+
+/*
+** If the thread is running on `cpu` and `*v` is not null, stores `*v` to
+** `*old`, and replaces `*v` with the pointer at offset `offset` from `*v`.
+** This pops the head of an intrusive linked list in one step.
+*/
+CC_ALWAYS_INLINE int
+rseq_pop_front(void** v, void** old, ptrdiff_t offset, uint32_t cpu) noexcept
+{
+	auto area = rseq_area();
+	asm volatile goto (
+		CTOP_RSEQ_BEGIN
+		"movq %[v], %%rbx\n\t"
+		"testq %%rbx, %%rbx\n\t"
+		"jz %l[compare_failed]\n\t"
+		"movq %%rbx, %[old]\n\t"
+		"addq %[offset], %%rbx\n\t"
+		"movq (%%rbx), %%rbx\n\t"
+		"movq %%rbx, %[v]\n\t"
+		CTOP_RSEQ_END
+		:
+		: [cpu]         "r"  (cpu),
+		  [current_cpu] "m"  (area->cpu_id),
+		  [rseq_cs]     "m"  (area->rseq_cs),
+		  [v]           "m"  (*v),
+		  [old]         "m"  (*old),
+		  [offset]      "er" (offset)
+		: "memory", "cc", "rax", "rbx"
+		: abort, compare_failed
+	);
+	return rseq_committed;
+abort:
+	return rseq_aborted;
+compare_failed:
+	return rseq_compare_failed;
+}
+
+#undef CTOP_RSEQ_BEGIN
+#undef CTOP_RSEQ_END
+
+#endif
+
+/*
+** Returns true if the calling thread has a registered rseq area.
+*/
+bool rseq_available() noexcept
+{
+#ifdef CTOP_HAS_RSEQ
+	return __rseq_size != 0 && int32_t(rseq_area()->cpu_id) >= 0;
+#else
+	return false;
+#endif
+}
+
+/*
+** Returns the OS ID of the CPU thread on which the caller is running. The
+** result may be stale as soon as it is returned.
+*/
+uint32_t current_cpu()
+{
+#ifdef CTOP_HAS_RSEQ
+	if (__rseq_size != 0) {
+		auto cpu = int32_t(rseq_area()->cpu_id);
+		if (cpu >= 0) {
+			return cpu;
+		}
+	}
+#endif
+	auto cpu = ::sched_getcpu();
+	if (cpu < 0) {
+		throw std::system_error{errno, std::system_category(),
+			"failed to get current CPU"};
+	}
+	return cpu;
+}
+
+/*
+** One slot of type `T` for each available CPU thread, indexed by OS ID. Each
+** slot is padded to a multiple of the cache line size and lives in memory
+** local to the NUMA node of its CPU thread. The slots are value-initialized.
+*/
+template <class T>
+class per_cpu final
+{
+	std::vector<node_buffer> m_buffers{};
+	std::vector<T*> m_slots{};
+	std::vector<uint32_t> m_cpus{};
+	std::vector<std::array<uint32_t, 4>> m_domains{};
+public:
+	explicit per_cpu(const system_info& info)
+	{
+		auto stride = round_up(sizeof(T), std::max<size_t>(
+			cache_line_size(info.cpu_info()), alignof(T)));
+
+		auto max_cpu = uint32_t{};
+		for (const auto& t : info.available_cpu_threads()) {
+			max_cpu = std::max(max_cpu, t.os_id());
+		}
+		m_slots.resize(max_cpu + 1, nullptr);
+		m_domains.resize(max_cpu + 1);
+
+		for (const auto& n : info.available_numa_nodes()) {
+			auto threads = n.cpu_info().available_threads();
+			if (threads.empty()) {
+				continue;
+			}
+
+			m_buffers.emplace_back(threads.size() * stride, n.id());
+			auto p = static_cast<char*>(m_buffers.back().data());
+			for (const auto& t : threads) {
+				m_slots[t.os_id()] = new (p) T{};
+				m_cpus.push_back(t.os_id());
+				m_domains[t.os_id()] = {{
+					t.os_id(),
+					core_id(t, info.cpu_info()),
+					package_id(t, info.cpu_info()),
+					n.id()
+				}};
+				p += stride;
+			}
+		}
+		std::sort(m_cpus.begin(), m_cpus.end());
+	}
+
+	per_cpu(per_cpu&&) = default;
+	per_cpu(const per_cpu&) = delete;
+	per_cpu& operator=(const per_cpu&) = delete;
+
+	~per_cpu()
+	{
+		for (auto p : m_slots) {
+			if (p != nullptr) {
+				p->~T();
+			}
+		}
+	}
+
+	/*
+	** The OS IDs of the CPU threads that have slots, in increasing order.
+	*/
+	const std::vector<uint32_t>& cpus() const noexcept
+	{ return m_cpus; }
+
+	bool contains(uint32_t cpu) const noexcept
+	{ return cpu < m_slots.size() && m_slots[cpu] != nullptr; }
+
+	T& operator[](uint32_t cpu)
+	{ return *slot(cpu); }
+
+	const T& operator[](uint32_t cpu) const
+	{ return *slot(cpu); }
+
+	/*
+	** Returns the ID of the domain containing the given CPU thread.
+	*/
+	uint32_t domain(uint32_t cpu, topology_domain d) const
+	{
+		slot(cpu);
+		return m_domains[cpu][static_cast<size_t>(d)];
+	}
+private:
+	T* slot(uint32_t cpu) const
+	{
+		if (!contains(cpu)) {
+			throw std::out_of_range{cc::format("no slot for CPU "
+				"thread $", cpu)};
+		}
+		return m_slots[cpu];
+	}
+};
+
+/*
+** A counter that is split into one 64-bit value per CPU thread. When rseq is
+** available, an increment is a plain add to the slot of the current CPU inside
+** a restartable sequence, so it needs no atomic instruction. Otherwise, it is
+** an atomic add to the slot of the CPU reported by `sched_getcpu`.
+**
+** The mode is chosen when the counter is constructed. In rseq mode, every
+** thread that updates the counter must have a registered rseq area, which is
+** the case for all threads created through glibc 2.35 or later unless the
+** registration was disabled with the `glibc.pthread.rseq` tunable.
+*/
+class per_cpu_counter final
+{
+	per_cpu<int64_t> m_slots;
+	bool m_uses_rseq;
+public:
+	explicit per_cpu_counter(const system_info& info)
+	: m_slots{info}, m_uses_rseq{rseq_available()} {}
+
+	DEFINE_COPY_GETTER(per_cpu_counter, uses_rseq, m_uses_rseq)
+
+	void add(int64_t n)
+	{
+#ifdef CTOP_HAS_RSEQ
+		if (m_uses_rseq) {
+			auto area = rseq_area();
+			for (;;) {
+				auto cpu = __atomic_load_n(&area->cpu_id,
+					__ATOMIC_RELAXED);
+				if (!m_slots.contains(cpu)) {
+					throw_unregistered(cpu);
+				}
+				if (rseq_add(&m_slots[cpu], n, cpu) == rseq_committed) {
+					return;
+				}
+			}
+		}
+#endif
+		__atomic_fetch_add(&m_slots[current_cpu()], n, __ATOMIC_RELAXED);
+	}
+
+	void increment() { add(1); }
+
+	/*
+	** The readers below do not stop concurrent updates, so the totals they
+	** return are only consistent with some recent state of the counter.
+	*/
+	int64_t sum() const
+	{
+		auto r = int64_t{};
+		for (auto cpu : m_slots.cpus()) {
+			r += __atomic_load_n(&m_slots[cpu], __ATOMIC_RELAXED);
+		}
+		return r;
+	}
+
+	int64_t value(uint32_t cpu) const
+	{ return __atomic_load_n(&m_slots[cpu], __ATOMIC_RELAXED); }
+
+	/*
+	** Returns the sum of the slots in each domain at the given level, keyed
+	** by domain ID.
+	*/
+	std::map<uint32_t, int64_t> sum_by(topology_domain d) const
+	{
+		auto r = std::map<uint32_t, int64_t>{};
+		for (auto cpu : m_slots.cpus()) {
+			r[m_slots.domain(cpu, d)] += value(cpu);
+		}
+		return r;
+	}
+private:
+	[[noreturn]] static void throw_unregistered(uint32_t cpu)
+	{
+		throw std::logic_error{cc::format("CPU thread $ is not "
+			"available or the calling thread is not registered "
+			"with rseq", int32_t(cpu))};
+	}
+};
+
+/*
+** Base class for the elements of `per_cpu_stack`.
+*/
+struct per_cpu_stack_node
+{
+	per_cpu_stack_node* next;
+};
+
+/*
+** An intrusive LIFO list per CPU thread, e.g. for free lists of objects that
+** are likely to be reused on the same CPU. `push` and `pop` operate on the
+** list of the current CPU. With rseq, both operations are a single
+** restartable sequence; otherwise, each list is protected by a spin lock.
+*/
+template <class T>
+class per_cpu_stack final
+{
+	static_assert(std::is_base_of<per_cpu_stack_node, T>::value,
+		"Element type must derive from per_cpu_stack_node.");
+
+	struct list
+	{
+		per_cpu_stack_node* head;
+		std::atomic<bool> locked;
+	};
+
+	per_cpu<list> m_lists;
+	bool m_uses_rseq;
+public:
+	explicit per_cpu_stack(const system_info& info)
+	: m_lists{info}, m_uses_rseq{rseq_available()} {}
+
+	DEFINE_COPY_GETTER(per_cpu_stack, uses_rseq, m_uses_rseq)
+
+	void push(T* x)
+	{
+		auto n = static_cast<per_cpu_stack_node*>(x);
+#ifdef CTOP_HAS_RSEQ
+		if (m_uses_rseq) {
+			auto area = rseq_area();
+			for (;;) {
+				auto cpu = __atomic_load_n(&area->cpu_id,
+					__ATOMIC_RELAXED);
+				auto& l = checked_list(cpu);
+				auto head = __atomic_load_n(&l.head, __ATOMIC_RELAXED);
+				n->next = head;
+				auto r = rseq_compare_store((void**)&l.head, head,
+					n, cpu);
+				if (r == rseq_committed) {
+					return;
+				}
+			}
+		}
+#endif
+		auto& l = m_lists[current_cpu()];
+		lock(l);
+		n->next = l.head;
+		l.head = n;
+		unlock(l);
+	}
+
+	/*
+	** Returns `nullptr` if the list of the current CPU is empty.
+	*/
+	T* pop()
+	{
+#ifdef CTOP_HAS_RSEQ
+		if (m_uses_rseq) {
+			auto area = rseq_area();
+			for (;;) {
+				auto cpu = __atomic_load_n(&area->cpu_id,
+					__ATOMIC_RELAXED);
+				auto& l = checked_list(cpu);
+				void* old = nullptr;
+				auto r = rseq_pop_front((void**)&l.head, &old,
+					offsetof(per_cpu_stack_node, next), cpu);
+				if (r == rseq_committed) {
+					return static_cast<T*>(
+						static_cast<per_cpu_stack_node*>(old));
+				}
+				else if (r == rseq_compare_failed) {
+					return nullptr;
+				}
+			}
+		}
+#endif
+		auto& l = m_lists[current_cpu()];
+		lock(l);
+		auto n = l.head;
+		if (n != nullptr) {
+			l.head = n->next;
+		}
+		unlock(l);
+		return static_cast<T*>(n);
+	}
+private:
+	list& checked_list(uint32_t cpu)
+	{
+		if (!m_lists.contains(cpu)) {
+			throw std::logic_error{cc::format("CPU thread $ is not "
+				"available or the calling thread is not "
+				"registered with rseq", int32_t(cpu))};
+		}
+		return m_lists[cpu];
+	}
+
+	static void lock(list& l) noexcept
+	{
+		while (l.locked.exchange(true, std::memory_order_acquire)) {
+			cpu_relax();
+		}
+	}
+
+	static void unlock(list& l) noexcept
+	{ l.locked.store(false, std::memory_order_release); }
+};
+
+}
+
+#endif
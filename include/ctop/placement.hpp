@@ -0,0 +1,337 @@
+/*
+** File Name: placement.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z697BD6D8_D971_43A7_8BB2_DF760C9B9EE5
+#define Z697BD6D8_D971_43A7_8BB2_DF760C9B9EE5
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/device_query.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+enum class placement_policy : uint8_t
+{
+	// Fill each NUMA node, core by core, before moving to the next one.
+	compact,
+	// Spread threads across NUMA nodes, and across cores within each node
+	// before using SMT siblings.
+	scatter,
+	// Use only the first CPU thread of each core, filling each NUMA node
+	// before moving to the next one. At most one thread per core can be
+	// placed.
+	one_per_core,
+	// Spread cores across NUMA nodes as `scatter` does, but place threads
+	// on both SMT siblings of a core before moving to the next one, so that
+	// pairs of threads share an L1 and L2 cache.
+	smt_pairs,
+};
+
+std::ostream& operator<<(std::ostream& os, const placement_policy& p)
+{
+	switch (p) {
+	case placement_policy::compact:
+		cc::write(os, "compact");
+		return os;
+	case placement_policy::scatter:
+		cc::write(os, "scatter");
+		return os;
+	case placement_policy::one_per_core:
+		cc::write(os, "one per core");
+		return os;
+	case placement_policy::smt_pairs:
+		cc::write(os, "SMT pairs");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** Returns the threads of the node ordered so that the first thread of each
+** core comes before any SMT sibling. The threads of each node are sorted by
+** x2APIC ID, so siblings are adjacent.
+*/
+std::vector<uint32_t>
+cores_first(const numa_node_info& node, const global_cpu_info& info)
+{
+	auto first = std::vector<uint32_t>{};
+	auto rest = std::vector<uint32_t>{};
+	auto threads = node.cpu_info().available_threads();
+
+	for (auto i = size_t{}; i != size_t(threads.size()); ++i) {
+		if (i != 0 && core_id(threads[i], info) ==
+			core_id(threads[i - 1], info))
+		{
+			rest.push_back(threads[i].os_id());
+		}
+		else {
+			first.push_back(threads[i].os_id());
+		}
+	}
+
+	first.insert(first.end(), rest.begin(), rest.end());
+	return first;
+}
+
+/*
+** Returns the threads of the node grouped by core, in order of x2APIC ID.
+*/
+std::vector<std::vector<uint32_t>>
+core_groups(const numa_node_info& node, const global_cpu_info& info)
+{
+	auto r = std::vector<std::vector<uint32_t>>{};
+	auto threads = node.cpu_info().available_threads();
+
+	for (auto i = size_t{}; i != size_t(threads.size()); ++i) {
+		if (i == 0 || core_id(threads[i], info) !=
+			core_id(threads[i - 1], info))
+		{
+			r.emplace_back();
+		}
+		r.back().push_back(threads[i].os_id());
+	}
+	return r;
+}
+
+/*
+** Returns the OS IDs of the CPU threads on which to run `count` threads under
+** the given policy.
+*/
+std::vector<uint32_t>
+place_threads(const system_info& info, placement_policy p, size_t count)
+{
+	if (count > size_t(info.available_cpu_threads().size())) {
+		throw std::invalid_argument{"more threads requested than CPU "
+			"threads available"};
+	}
+
+	auto r = std::vector<uint32_t>{};
+	switch (p) {
+	case placement_policy::compact:
+		for (const auto& n : info.available_numa_nodes()) {
+			for (const auto& t : n.cpu_info().available_threads()) {
+				r.push_back(t.os_id());
+			}
+		}
+		break;
+	case placement_policy::scatter: {
+		auto nodes = std::vector<std::vector<uint32_t>>{};
+		for (const auto& n : info.available_numa_nodes()) {
+			nodes.push_back(cores_first(n, info.cpu_info()));
+		}
+		for (auto i = size_t{}; r.size() < count; ++i) {
+			for (const auto& n : nodes) {
+				if (i < n.size()) {
+					r.push_back(n[i]);
+				}
+			}
+		}
+		break;
+	}
+	case placement_policy::one_per_core:
+		for (const auto& n : info.available_numa_nodes()) {
+			for (const auto& c : core_groups(n, info.cpu_info())) {
+				r.push_back(c.front());
+			}
+		}
+		if (count > r.size()) {
+			throw std::invalid_argument{"more threads requested than "
+				"cores available"};
+		}
+		break;
+	case placement_policy::smt_pairs: {
+		auto nodes = std::vector<std::vector<std::vector<uint32_t>>>{};
+		for (const auto& n : info.available_numa_nodes()) {
+			nodes.push_back(core_groups(n, info.cpu_info()));
+		}
+		for (auto i = size_t{}; r.size() < count; ++i) {
+			for (const auto& n : nodes) {
+				if (i < n.size()) {
+					r.insert(r.end(), n[i].begin(), n[i].end());
+				}
+			}
+		}
+		break;
+	}
+	default:
+		throw std::invalid_argument{"unknown placement policy"};
+	}
+
+	r.resize(count);
+	return r;
+}
+
+/*
+** Returns the largest number of threads that the policy can place.
+*/
+size_t placement_capacity(const system_info& info, placement_policy p)
+{
+	if (p != placement_policy::one_per_core) {
+		return info.available_cpu_threads().size();
+	}
+
+	auto r = size_t{};
+	for (const auto& n : info.available_numa_nodes()) {
+		r += core_groups(n, info.cpu_info()).size();
+	}
+	return r;
+}
+
+/*
+** Like `place_threads`, but uses only the CPU threads in `allowed`, e.g. the
+** ones that no other process has claimed. The order of the policy is kept.
+*/
+std::vector<uint32_t> place_threads(
+	const system_info& info,
+	placement_policy p,
+	size_t count,
+	const cpu_set& allowed
+)
+{
+	auto r = std::vector<uint32_t>{};
+	for (auto cpu : place_threads(info, p, placement_capacity(info, p))) {
+		if (r.size() == count) {
+			break;
+		}
+		if (allowed.contains(cpu)) {
+			r.push_back(cpu);
+		}
+	}
+	if (r.size() != count) {
+		throw std::invalid_argument{"more threads requested than "
+			"allowed CPU threads available"};
+	}
+	return r;
+}
+
+/*
+** The CPU threads on which to run the threads that drive a device, and the
+** threads that do other work.
+*/
+struct io_placement
+{
+	std::vector<uint32_t> io_threads;
+	std::vector<uint32_t> compute_threads;
+};
+
+/*
+** Returns the number of interrupts handled by the core of each available CPU
+** thread, indexed by OS ID. SMT siblings share the cycles of their core, so
+** the counts of siblings are summed.
+*/
+std::vector<uint64_t> core_irq_load(const system_info& info)
+{
+	auto size = uint32_t{};
+	for (const auto& t : info.available_cpu_threads()) {
+		size = std::max(size, t.os_id() + 1);
+	}
+
+	auto per_core = std::map<uint32_t, uint64_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		auto& n = per_core[core_id(t, info.cpu_info())];
+		for (const auto& i : info.irqs()) {
+			n += i.count(t.os_id());
+		}
+	}
+
+	auto r = std::vector<uint64_t>(size);
+	for (const auto& t : info.available_cpu_threads()) {
+		r[t.os_id()] = per_core[core_id(t, info.cpu_info())];
+	}
+	return r;
+}
+
+/*
+** Places `io_count` threads on the CPU threads local to the device, preferring
+** those that already handle its interrupts, so that the data that the
+** interrupt handlers touch is in a nearby cache. Then places `compute_count`
+** threads on the remaining CPU threads, preferring the cores that handle the
+** fewest interrupts, and spreading them across nodes like
+** `placement_policy::scatter` otherwise.
+**
+** If the platform does not report the locality of the device, every CPU thread
+** is considered local to it.
+*/
+io_placement place_io_threads(
+	const system_info& info,
+	const pci_device_info& dev,
+	size_t io_count,
+	size_t compute_count
+)
+{
+	auto avail = size_t(info.available_cpu_threads().size());
+	if (io_count + compute_count > avail) {
+		throw std::invalid_argument{"more threads requested than CPU "
+			"threads available"};
+	}
+
+	// The scatter order is the default order for both kinds of thread.
+	auto order = place_threads(info, placement_policy::scatter, avail);
+
+	auto is_local = [&](uint32_t cpu) {
+		if (!dev.local_cpus().empty()) {
+			return std::binary_search(dev.local_cpus().begin(),
+				dev.local_cpus().end(), cpu);
+		}
+		if (dev.numa_node() >= 0) {
+			auto n = find_numa_node(cpu, info);
+			return n != nullptr && int32_t(n->id()) == dev.numa_node();
+		}
+		return true;
+	};
+
+	auto dev_irqs = std::vector<uint64_t>(order.empty() ? 0 :
+		*std::max_element(order.begin(), order.end()) + 1);
+	for (auto irq : dev.irqs()) {
+		if (auto i = find_irq(irq, info)) {
+			for (auto cpu : order) {
+				dev_irqs[cpu] += i->count(cpu);
+			}
+		}
+	}
+
+	auto r = io_placement{};
+	auto local = std::vector<uint32_t>{};
+	std::copy_if(order.begin(), order.end(), std::back_inserter(local),
+		is_local);
+	if (io_count > local.size()) {
+		throw std::invalid_argument{"more IO threads requested than CPU "
+			"threads local to the device"};
+	}
+	std::stable_sort(local.begin(), local.end(), [&](auto a, auto b) {
+		return dev_irqs[a] > dev_irqs[b];
+	});
+	r.io_threads.assign(local.begin(), local.begin() + io_count);
+
+	auto load = core_irq_load(info);
+	auto rest = std::vector<uint32_t>{};
+	std::copy_if(order.begin(), order.end(), std::back_inserter(rest),
+		[&](auto cpu) {
+			return std::find(r.io_threads.begin(),
+				r.io_threads.end(), cpu) == r.io_threads.end();
+		});
+	std::stable_sort(rest.begin(), rest.end(), [&](auto a, auto b) {
+		return load[a] < load[b];
+	});
+	r.compute_threads.assign(rest.begin(), rest.begin() + compute_count);
+	return r;
+}
+
+}
+
+#endif
@@ -0,0 +1,489 @@
+/*
+** File Name: power.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Samples the energy counters of RAPL (Running Average Power Limit), which
+** count the energy used by each package, and on most servers by the DRAM
+** attached to it. The counters are read through the powercap driver where
+** it is readable, and through the msr driver otherwise. Both wrap around, the
+** MSRs after as little as a minute at full load, so `update` must be called
+** more often than that.
+*/
+
+#ifndef ZA2F4E67F_D6EB_4F38_B793_40BF4DEF96A8
+#define ZA2F4E67F_D6EB_4F38_B793_40BF4DEF96A8
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <fcntl.h>
+	#include <unistd.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+enum class power_domain : uint8_t
+{
+	// Everything in the package, including the cores and the uncore.
+	package,
+	// The cores of the package.
+	core,
+	// The uncore of the package, e.g. the integrated graphics.
+	uncore,
+	// The DRAM attached to the package.
+	dram,
+};
+
+std::ostream& operator<<(std::ostream& os, const power_domain& d)
+{
+	switch (d) {
+	case power_domain::package:
+		cc::write(os, "package");
+		return os;
+	case power_domain::core:
+		cc::write(os, "core");
+		return os;
+	case power_domain::uncore:
+		cc::write(os, "uncore");
+		return os;
+	case power_domain::dram:
+		cc::write(os, "DRAM");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+enum class power_source : uint8_t
+{
+	// The zones in `/sys/class/powercap`, which the kernel has already
+	// scaled to microjoules.
+	powercap,
+	// The energy status MSRs, read through `/dev/cpu/N/msr`. Only the
+	// package domain is read this way, since the unit of the DRAM counter
+	// differs from the one that the processor reports on some servers.
+	msr,
+};
+
+std::ostream& operator<<(std::ostream& os, const power_source& s)
+{
+	switch (s) {
+	case power_source::powercap:
+		cc::write(os, "powercap");
+		return os;
+	case power_source::msr:
+		cc::write(os, "MSR");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** The energy used by one domain of one package. The package ID is the one
+** given by `package_id`.
+*/
+struct energy_reading
+{
+	uint32_t package;
+	power_domain domain;
+	// Over the interval between the last two calls to `update`.
+	double joules;
+	double watts;
+	// Since the sampler was constructed.
+	double total_joules;
+};
+
+namespace detail {
+
+/*
+** An energy counter that counts up from zero to `range`, and then wraps.
+*/
+struct energy_counter
+{
+	std::string path;
+	int fd{-1};
+	// The offset of the MSR, or zero for a powercap file.
+	uint32_t msr{};
+	double joules_per_count{};
+	uint64_t range{};
+	uint64_t last{};
+};
+
+/*
+** Maps the package numbers used by the kernel to the IDs given by
+** `package_id`. The kernel numbers are read from sysfs; if they are missing,
+** the kernel is assumed to number the packages in order of ID.
+*/
+std::map<uint64_t, uint32_t>
+kernel_package_ids(const system_info& info, const std::string& sysfs_root)
+{
+	auto r = std::map<uint64_t, uint32_t>{};
+	auto ids = std::vector<uint32_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		auto id = package_id(t, info.cpu_info());
+		ids.push_back(id);
+		auto k = try_read_integer(cc::format("$/devices/system/cpu/cpu$/"
+			"topology/physical_package_id", sysfs_root, t.os_id()));
+		if (k) {
+			r[*k] = id;
+		}
+	}
+	if (!r.empty()) {
+		return r;
+	}
+
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	for (auto i = size_t{}; i != ids.size(); ++i) {
+		r[i] = ids[i];
+	}
+	return r;
+}
+
+/*
+** Parses the kernel package number out of a zone name such as "package-1" or
+** "package-1-die-0".
+*/
+boost::optional<uint64_t>
+parse_package_zone(boost::string_ref name, const std::string& path)
+{
+	if (!name.starts_with("package-")) {
+		return boost::none;
+	}
+	name.remove_prefix(std::strlen("package-"));
+	return parse_integer(name.substr(0, name.find('-')), path);
+}
+
+boost::optional<power_domain> parse_subzone(boost::string_ref name) noexcept
+{
+	if (name == "core") {
+		return power_domain::core;
+	}
+	else if (name == "uncore") {
+		return power_domain::uncore;
+	}
+	else if (name == "dram") {
+		return power_domain::dram;
+	}
+	return boost::none;
+}
+
+}
+
+/*
+** Samples the energy of each RAPL domain between successive calls to
+** `update`. One file descriptor is kept open per counter, and each sample is
+** taken with `pread`.
+*/
+class power_sampler final
+{
+	using clock = std::chrono::steady_clock;
+
+	static constexpr auto msr_intel_power_unit = uint32_t{0x606};
+	static constexpr auto msr_intel_pkg_energy = uint32_t{0x611};
+	static constexpr auto msr_amd_power_unit   = uint32_t{0xC0010299};
+	static constexpr auto msr_amd_pkg_energy   = uint32_t{0xC001029B};
+
+	power_source m_source;
+	std::vector<detail::energy_counter> m_counters{};
+	std::vector<energy_reading> m_readings{};
+	clock::time_point m_last{};
+	double m_interval{};
+public:
+	/*
+	** Uses the powercap zones under `sysfs_root` if they can be read, and
+	** the msr driver under `dev_root` otherwise. Throws `sysfs_error` if
+	** neither is available, e.g. because the process is unprivileged.
+	*/
+	explicit power_sampler(
+		const system_info& info,
+		const std::string& sysfs_root = default_sysfs_root,
+		const std::string& dev_root = default_dev_root
+	)
+	{
+		if (open_powercap(info, sysfs_root)) {
+			m_source = power_source::powercap;
+		}
+		else if (open_msrs(info, dev_root)) {
+			m_source = power_source::msr;
+		}
+		else {
+			throw sysfs_error{sysfs_root + "/class/powercap", "neither "
+				"powercap nor the msr driver is readable"};
+		}
+
+		for (auto& c : m_counters) {
+			c.last = read(c);
+		}
+		m_last = clock::now();
+	}
+
+	~power_sampler()
+	{ close_all(); }
+
+	power_sampler(const power_sampler&) = delete;
+	power_sampler& operator=(const power_sampler&) = delete;
+
+	/*
+	** Reads every counter, and computes the energy and average power of
+	** each domain over the interval since the previous call.
+	*/
+	void update()
+	{
+		auto now = clock::now();
+		m_interval = std::chrono::duration<double>(now - m_last).count();
+		m_last = now;
+
+		for (auto i = size_t{}; i != m_counters.size(); ++i) {
+			auto& c = m_counters[i];
+			auto& r = m_readings[i];
+			auto cur = read(c);
+			auto delta = cur >= c.last ? cur - c.last :
+				c.range - c.last + cur;
+			c.last = cur;
+
+			r.joules = delta * c.joules_per_count;
+			r.watts = m_interval == 0 ? 0 : r.joules / m_interval;
+			r.total_joules += r.joules;
+		}
+	}
+
+	power_source source() const noexcept
+	{ return m_source; }
+
+	/*
+	** The length of the last interval in seconds.
+	*/
+	double interval() const noexcept
+	{ return m_interval; }
+
+	/*
+	** One reading per domain of each package, sorted by package ID and then
+	** by domain.
+	*/
+	const std::vector<energy_reading>& readings() const noexcept
+	{ return m_readings; }
+
+	/*
+	** The energy used by the domain over the last interval, summed over all
+	** packages.
+	*/
+	double joules(power_domain d) const noexcept
+	{
+		auto r = 0.0;
+		for (const auto& x : m_readings) {
+			if (x.domain == d) {
+				r += x.joules;
+			}
+		}
+		return r;
+	}
+
+	double watts(power_domain d) const noexcept
+	{ return m_interval == 0 ? 0 : joules(d) / m_interval; }
+
+	/*
+	** Divides the energy used over the last interval by the number of
+	** operations that the caller counted over the same interval, e.g. to
+	** report requests per joule alongside requests per second.
+	*/
+	double energy_per_operation(
+		uint64_t ops,
+		power_domain d = power_domain::package
+	) const noexcept
+	{ return ops == 0 ? 0 : joules(d) / ops; }
+private:
+	void add(detail::energy_counter c, uint32_t package, power_domain d)
+	{
+		m_counters.push_back(std::move(c));
+		m_readings.push_back({package, d, 0, 0, 0});
+	}
+
+	bool open_powercap(const system_info& info, const std::string& root)
+	{
+		auto dir = root + "/class/powercap";
+		auto packages = detail::kernel_package_ids(info, root);
+		// The package of each top-level zone, e.g. "intel-rapl:1".
+		auto zones = std::map<std::string, uint32_t>{};
+
+		// Subzones sort after their parents, so the parents come first.
+		for (const auto& z : list_directory(dir)) {
+			// The MMIO interface duplicates the package zones of the
+			// MSR interface on some client processors.
+			if (!boost::string_ref{z}.starts_with("intel-rapl:")) {
+				continue;
+			}
+			auto path = dir + "/" + z;
+			auto name = try_read_file(path + "/name");
+			if (!name) {
+				continue;
+			}
+
+			auto parent = z.substr(0, z.find(':', z.find(':') + 1));
+			auto d = power_domain::package;
+			auto package = uint32_t{};
+			if (parent == z) {
+				// Platform zones such as "psys" cover more
+				// than one package, so they are skipped.
+				auto k = detail::parse_package_zone(*name, path);
+				if (!k || packages.count(*k) == 0) {
+					continue;
+				}
+				package = zones[z] = packages[*k];
+			}
+			else {
+				auto sub = detail::parse_subzone(*name);
+				if (!sub || zones.count(parent) == 0) {
+					continue;
+				}
+				d = *sub;
+				package = zones[parent];
+			}
+
+			auto range = try_read_integer(path + "/max_energy_range_uj");
+			auto c = detail::energy_counter{};
+			c.path = path + "/energy_uj";
+			c.joules_per_count = 1e-6;
+			c.range = range ? *range : 0;
+			c.fd = ::open(c.path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (!range || c.fd == -1 || !try_read(c)) {
+				if (c.fd != -1) {
+					::close(c.fd);
+				}
+				close_all();
+				return false;
+			}
+			add(std::move(c), package, d);
+		}
+		sort();
+		return !m_counters.empty();
+	}
+
+	/*
+	** Opens the msr driver of the first available CPU thread in each
+	** package, and reads the energy unit from it.
+	*/
+	bool open_msrs(const system_info& info, const std::string& root)
+	{
+		auto amd = info.cpu_info().version().vendor() == cpu_vendor::amd;
+		auto unit_msr = amd ? msr_amd_power_unit : msr_intel_power_unit;
+		auto energy_msr = amd ? msr_amd_pkg_energy : msr_intel_pkg_energy;
+
+		for (const auto& p : domain_cpus(topology_domain::package, info)) {
+			auto c = detail::energy_counter{};
+			c.path = cc::format("$/cpu/$/msr", root, p.second.front());
+			c.fd = ::open(c.path.c_str(), O_RDONLY | O_CLOEXEC);
+			c.msr = unit_msr;
+			if (c.fd == -1 || !try_read(c)) {
+				if (c.fd != -1) {
+					::close(c.fd);
+				}
+				close_all();
+				return false;
+			}
+			// Bits 12:8 give the energy unit as a power of 1/2 J.
+			auto esu = (read(c) >> 8) & 0x1F;
+			c.msr = energy_msr;
+			c.joules_per_count = 1.0 / (uint64_t{1} << esu);
+			c.range = uint64_t{1} << 32;
+			add(std::move(c), p.first, power_domain::package);
+		}
+		return !m_counters.empty();
+	}
+
+	void sort()
+	{
+		auto order = std::vector<size_t>(m_counters.size());
+		for (auto i = size_t{}; i != order.size(); ++i) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			const auto& x = m_readings[a];
+			const auto& y = m_readings[b];
+			return std::make_pair(x.package, x.domain) <
+				std::make_pair(y.package, y.domain);
+		});
+
+		auto counters = std::vector<detail::energy_counter>{};
+		auto readings = std::vector<energy_reading>{};
+		for (auto i : order) {
+			counters.push_back(std::move(m_counters[i]));
+			readings.push_back(m_readings[i]);
+		}
+		m_counters = std::move(counters);
+		m_readings = std::move(readings);
+	}
+
+	void close_all() noexcept
+	{
+		for (auto& c : m_counters) {
+			if (c.fd != -1) {
+				::close(c.fd);
+				c.fd = -1;
+			}
+		}
+		m_counters.clear();
+		m_readings.clear();
+	}
+
+	/*
+	** Returns false if the counter cannot be read, e.g. because the
+	** powercap files are readable only by root.
+	*/
+	bool try_read(const detail::energy_counter& c)
+	{
+		try {
+			read(c);
+			return true;
+		}
+		catch (const sysfs_error&) {
+			return false;
+		}
+	}
+
+	uint64_t read(const detail::energy_counter& c)
+	{
+		if (c.msr != 0) {
+			auto r = uint64_t{};
+			if (::pread(c.fd, &r, sizeof(r), c.msr) != sizeof(r)) {
+				throw sysfs_error{c.path, std::strerror(errno)};
+			}
+			// Only the low 32 bits of the energy status MSRs count.
+			return c.msr == msr_intel_pkg_energy ||
+				c.msr == msr_amd_pkg_energy ? r & 0xFFFFFFFF : r;
+		}
+
+		auto buf = std::array<char, 32>{};
+		auto n = ::pread(c.fd, buf.data(), buf.size(), 0);
+		if (n == -1) {
+			throw sysfs_error{c.path, std::strerror(errno)};
+		}
+		return parse_integer({buf.data(), size_t(n)}, c.path);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+/*
+** File Name: proc_counters.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Per-CPU event counters from procfs, read with the same persistent-descriptor
+** and in-place parsing scheme as `cpu_stat_sampler`.
+*/
+
+#ifndef Z369447EE_B1B5_40EB_8CDD_9035807708D5
+#define Z369447EE_B1B5_40EB_8CDD_9035807708D5
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <ctop/cpu_stat.hpp>
+#include <ctop/sysfs.hpp>
+
+namespace ctop {
+
+namespace detail {
+
+CC_ALWAYS_INLINE bool is_digit(char c) noexcept
+{ return c >= '0' && c <= '9'; }
+
+CC_ALWAYS_INLINE void skip_spaces(const char*& p) noexcept
+{
+	while (*p == ' ') {
+		++p;
+	}
+}
+
+}
+
+/*
+** Counts the interrupts handled by each CPU thread, summed over all sources in
+** `/proc/interrupts`.
+*/
+class interrupt_sampler final
+{
+	pread_file m_file;
+	// The OS ID of the CPU thread for each column, and the values in the
+	// current row.
+	std::vector<uint32_t> m_columns{};
+	std::vector<uint64_t> m_row{};
+public:
+	explicit interrupt_sampler(const std::string& root = default_procfs_root)
+	: m_file{root + "/interrupts", 16384} {}
+
+	/*
+	** Stores the total interrupt count of each online CPU thread at the
+	** index given by its OS ID. Threads with IDs beyond the end of `out` are
+	** ignored, and the entries of offline threads are left unchanged.
+	*/
+	void sample(std::vector<uint64_t>& out)
+	{
+		auto s = m_file.read();
+		auto p = s.begin();
+		auto end = s.end();
+
+		// The header lists the online CPU threads, e.g. "CPU0 CPU2".
+		m_columns.clear();
+		auto line_end = next_line(p, end);
+		for (;;) {
+			detail::skip_spaces(p);
+			if (p >= line_end || std::memcmp(p, "CPU", 3) != 0) {
+				break;
+			}
+			p += 3;
+			m_columns.push_back(detail::parse_integer(p));
+		}
+		m_row.resize(m_columns.size());
+		for (auto cpu : m_columns) {
+			if (cpu < out.size()) {
+				out[cpu] = 0;
+			}
+		}
+
+		for (p = line_end + 1; p < end; p = line_end + 1) {
+			line_end = next_line(p, end);
+
+			// The "ERR" and "MIS" rows are system-wide totals rather
+			// than per-CPU counts.
+			detail::skip_spaces(p);
+			if (line_end - p > 3 && (std::memcmp(p, "ERR:", 4) == 0 ||
+				std::memcmp(p, "MIS:", 4) == 0))
+			{
+				continue;
+			}
+			auto colon = (const char*)std::memchr(p, ':', line_end - p);
+			if (colon == nullptr) {
+				continue;
+			}
+			p = colon + 1;
+
+			// Rows for interrupts that are not per-CPU have fewer
+			// columns, followed by the description.
+			auto n = size_t{};
+			for (; n != m_columns.size(); ++n) {
+				detail::skip_spaces(p);
+				if (!detail::is_digit(*p)) {
+					break;
+				}
+				m_row[n] = detail::parse_integer(p);
+			}
+			if (n != m_columns.size()) {
+				continue;
+			}
+			for (auto i = size_t{}; i != n; ++i) {
+				if (m_columns[i] < out.size()) {
+					out[m_columns[i]] += m_row[i];
+				}
+			}
+		}
+	}
+private:
+	static const char* next_line(const char* p, const char* end) noexcept
+	{
+		auto r = (const char*)std::memchr(p, '\n', end - p);
+		return r == nullptr ? end : r;
+	}
+};
+
+/*
+** Counts the calls to `schedule()` on each CPU thread, from
+** `/proc/schedstat`. This is an upper bound on the number of context
+** switches. The file only exists on kernels built with CONFIG_SCHEDSTATS;
+** the constructor throws `sysfs_error` otherwise.
+*/
+class schedstat_sampler final
+{
+	// The field of a "cpuN" line that counts calls to `schedule()`.
+	static constexpr auto sched_count_field = 2u;
+
+	pread_file m_file;
+public:
+	explicit schedstat_sampler(const std::string& root = default_procfs_root)
+	: m_file{root + "/schedstat", 16384} {}
+
+	void sample(std::vector<uint64_t>& out)
+	{
+		auto s = m_file.read();
+		auto p = s.begin();
+		auto end = s.end();
+
+		while (p < end) {
+			auto line_end = (const char*)std::memchr(p, '\n', end - p);
+			if (line_end == nullptr) {
+				line_end = end;
+			}
+
+			if (end - p > 3 && std::memcmp(p, "cpu", 3) == 0 &&
+				detail::is_digit(p[3]))
+			{
+				p += 3;
+				auto cpu = detail::parse_integer(p);
+				auto x = uint64_t{};
+				for (auto i = 0u; i <= sched_count_field; ++i) {
+					detail::skip_spaces(p);
+					x = detail::parse_integer(p);
+				}
+				if (cpu < out.size()) {
+					out[cpu] = x;
+				}
+			}
+			p = line_end + 1;
+		}
+	}
+};
+
+}
+
+#endif
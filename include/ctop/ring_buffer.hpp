@@ -0,0 +1,111 @@
+/*
+** File Name: ring_buffer.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z2C4B670E_3E0C_4675_B7C8_D51B9CC4EB3D
+#define Z2C4B670E_3E0C_4675_B7C8_D51B9CC4EB3D
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include <ctop/native_topology.hpp>
+
+namespace ctop {
+
+/*
+** A bounded, lock-free queue for one producer thread and one consumer thread.
+** The capacity is a power of two so that indices wrap with a mask. The head
+** and tail counters are on separate cache lines. The producer caches the
+** tail, so that it only reads the consumer's cache line when the queue looks
+** full, and the consumer drains everything available in one batch.
+**
+** When the queue is full, `try_push` drops the new element and counts it,
+** rather than blocking the producer.
+*/
+template <class T, size_t Capacity>
+class spsc_ring final
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+		"Capacity must be a power of two.");
+	static_assert(std::is_trivially_copyable<T>::value,
+		"T must be trivially copyable.");
+
+	static constexpr auto mask = Capacity - 1;
+
+	// Written by the producer.
+	alignas(native::cache_line_size) std::atomic<uint64_t> m_head{0};
+	uint64_t m_cached_tail{0};
+	std::atomic<uint64_t> m_dropped{0};
+
+	// Written by the consumer.
+	alignas(native::cache_line_size) std::atomic<uint64_t> m_tail{0};
+
+	alignas(native::cache_line_size) std::array<T, Capacity> m_data;
+public:
+	explicit spsc_ring() noexcept {}
+
+	spsc_ring(const spsc_ring&) = delete;
+	spsc_ring& operator=(const spsc_ring&) = delete;
+
+	static constexpr size_t capacity() noexcept
+	{ return Capacity; }
+
+	/*
+	** Called by the producer. Returns false if the queue was full.
+	*/
+	bool try_push(const T& x) noexcept
+	{
+		auto h = m_head.load(std::memory_order_relaxed);
+		if (h - m_cached_tail == Capacity) {
+			m_cached_tail = m_tail.load(std::memory_order_acquire);
+			if (h - m_cached_tail == Capacity) {
+				m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1,
+					std::memory_order_relaxed);
+				return false;
+			}
+		}
+		m_data[h & mask] = x;
+		m_head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	** Called by the consumer. Calls `f` with each element that is available,
+	** in FIFO order, and returns the number of elements consumed.
+	*/
+	template <class Function>
+	size_t consume(Function f)
+	{
+		auto t = m_tail.load(std::memory_order_relaxed);
+		auto h = m_head.load(std::memory_order_acquire);
+		for (auto i = t; i != h; ++i) {
+			f(m_data[i & mask]);
+		}
+		m_tail.store(h, std::memory_order_release);
+		return h - t;
+	}
+
+	/*
+	** The number of elements dropped because the queue was full.
+	*/
+	uint64_t dropped() const noexcept
+	{ return m_dropped.load(std::memory_order_relaxed); }
+
+	/*
+	** An estimate of the number of elements in the queue.
+	*/
+	size_t size() const noexcept
+	{
+		return m_head.load(std::memory_order_relaxed) -
+			m_tail.load(std::memory_order_relaxed);
+	}
+};
+
+}
+
+#endif
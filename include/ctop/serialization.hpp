@@ -0,0 +1,972 @@
+/*
+** File Name: serialization.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Binary and JSON encodings of `system_info`, for collecting topology
+** information from many hosts.
+**
+** The binary encoding begins with the magic bytes "CTOP" followed by a 16-bit
+** format version; all integers are little-endian. The JSON encoding is a
+** single object with the keys "format", "version", "total_numa_nodes", "cpu",
+** "threads", and "nodes". Readers reject documents whose version is newer than
+** `serialization_version`, and the JSON reader skips keys that it does not
+** recognize.
+**
+** Both readers parse directly from the input buffer. When they are given an
+** existing `system_info` to fill, they reuse its storage, so that reading a
+** stream of documents does not allocate once the vectors have grown to the
+** size of the largest host.
+*/
+
+#ifndef Z1336B40E_1ED4_4E03_AF23_CDBDA84B200D
+#define Z1336B40E_1ED4_4E03_AF23_CDBDA84B200D
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+#include <ctop/parse_error.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+static constexpr auto serialization_version = uint16_t{1};
+
+namespace detail {
+
+static constexpr char binary_magic[] = {'C', 'T', 'O', 'P'};
+
+static constexpr const char* vendor_names[] = {"intel", "amd", "unknown"};
+static constexpr const char* cache_type_names[] =
+	{"instruction", "data", "unified"};
+static constexpr const char* scope_names[] =
+	{"thread", "core", "processor", "cluster"};
+static constexpr const char* page_size_names[] = {"4K", "2M", "4M", "1G"};
+
+enum cache_flag : uint8_t
+{
+	cache_self_initializing      = 1 << 0,
+	cache_fully_associative      = 1 << 1,
+	cache_invalidate_propagation = 1 << 2,
+	cache_inclusive              = 1 << 3,
+	cache_direct_mapped          = 1 << 4,
+};
+
+enum page_flag : uint8_t
+{
+	page_4k = 1 << 0,
+	page_2m = 1 << 1,
+	page_4m = 1 << 2,
+	page_1g = 1 << 3,
+};
+
+uint8_t cache_flags(const cpu_cache& c) noexcept
+{
+	return (c.is_self_initializing() ? cache_self_initializing : 0) |
+		(c.is_fully_associative() ? cache_fully_associative : 0) |
+		(c.has_invalidate_propagation() ? cache_invalidate_propagation : 0) |
+		(c.is_inclusive() ? cache_inclusive : 0) |
+		(c.is_direct_mapped() ? cache_direct_mapped : 0);
+}
+
+uint8_t page_flags(const cpu_tlb& t) noexcept
+{
+	return (t.has_4k_pages() ? page_4k : 0) |
+		(t.has_2m_pages() ? page_2m : 0) |
+		(t.has_4m_pages() ? page_4m : 0) |
+		(t.has_1g_pages() ? page_1g : 0);
+}
+
+void set_page_flags(cpu_tlb& t, uint8_t f) noexcept
+{
+	t.has_4k_pages(f & page_4k).has_2m_pages(f & page_2m).
+		has_4m_pages(f & page_4m).has_1g_pages(f & page_1g);
+}
+
+/*
+** The brand string is stored in a fixed-size buffer padded with NULs; we only
+** serialize the part before the padding.
+*/
+boost::string_ref brand_string(const cpu_version& v) noexcept
+{
+	auto b = v.brand();
+	auto n = b.find('\0');
+	return n == b.npos ? b : b.substr(0, n);
+}
+
+/*
+** Returns the index of the thread at which the given node's range of threads
+** begins.
+*/
+uint32_t first_thread(const numa_node_info& n, const system_info& info)
+noexcept
+{
+	if (n.cpu_info().available_threads().size() == 0) {
+		return 0;
+	}
+	return &n.cpu_info().available_threads()[0] -
+		&info.available_cpu_threads()[0];
+}
+
+cpu_thread_info* thread_data(system_info& info, uint32_t first) noexcept
+{
+	auto threads = info.available_cpu_threads();
+	return threads.empty() ? nullptr : &threads[0] + first;
+}
+
+class binary_writer final
+{
+	std::string& m_buf;
+public:
+	explicit binary_writer(std::string& buf) noexcept : m_buf(buf) {}
+
+	template <class Integer>
+	void put(Integer x)
+	{
+		for (auto i = 0u; i != sizeof(Integer); ++i) {
+			m_buf.push_back(char(uint64_t(x) >> (8 * i)));
+		}
+	}
+
+	void put(double x)
+	{
+		auto bits = uint64_t{};
+		std::memcpy(&bits, &x, sizeof(x));
+		put(bits);
+	}
+
+	void put(const char* p, size_t n)
+	{ m_buf.append(p, n); }
+};
+
+class binary_reader final
+{
+	boost::string_ref m_buf;
+	size_t m_pos{};
+public:
+	explicit binary_reader(const boost::string_ref& buf) noexcept
+	: m_buf{buf} {}
+
+	size_t offset() const noexcept
+	{ return m_pos; }
+
+	const char* get(size_t n)
+	{
+		if (m_buf.size() - m_pos < n) {
+			throw parse_error{m_pos, "unexpected end of input"};
+		}
+		auto p = m_buf.data() + m_pos;
+		m_pos += n;
+		return p;
+	}
+
+	/*
+	** Reads the number of records that follow, each of which takes at least
+	** `record_size` bytes. The count is checked against the rest of the
+	** input, so that a corrupt count is not used to size a container.
+	*/
+	uint32_t get_record_count(size_t record_size)
+	{
+		auto n = get<uint32_t>();
+		if (uint64_t(n) * record_size > m_buf.size() - m_pos) {
+			throw parse_error{m_pos - 4, "record count exceeds input "
+				"size"};
+		}
+		return n;
+	}
+
+	template <class Integer>
+	Integer get()
+	{
+		auto p = get(sizeof(Integer));
+		auto r = uint64_t{};
+		for (auto i = 0u; i != sizeof(Integer); ++i) {
+			r |= uint64_t(uint8_t(p[i])) << (8 * i);
+		}
+		return Integer(r);
+	}
+
+	double get_double()
+	{
+		auto bits = get<uint64_t>();
+		auto r = double{};
+		std::memcpy(&r, &bits, sizeof(r));
+		return r;
+	}
+
+	/*
+	** Reads a byte that encodes an enum with `count` enumerators.
+	*/
+	template <class Enum>
+	Enum get_enum(uint8_t count)
+	{
+		auto x = get<uint8_t>();
+		if (x >= count) {
+			throw parse_error{m_pos - 1, "enum value out of range"};
+		}
+		return Enum(x);
+	}
+};
+
+}
+
+/*
+** Appends the binary encoding of `info` to `buf`.
+*/
+void write_binary(const system_info& info, std::string& buf)
+{
+	auto w = detail::binary_writer{buf};
+	const auto& cpu = info.cpu_info();
+	const auto& v = cpu.version();
+
+	w.put(detail::binary_magic, sizeof(detail::binary_magic));
+	w.put(serialization_version);
+
+	w.put(v.base_frequency());
+	w.put(v.max_frequency());
+	w.put(v.bus_frequency());
+	w.put(uint8_t(v.vendor()));
+	w.put(uint8_t(v.type()));
+	w.put(v.family());
+	w.put(v.model());
+	w.put(v.stepping());
+	auto brand = detail::brand_string(v);
+	w.put(uint8_t(brand.size()));
+	w.put(brand.data(), brand.size());
+
+	w.put(cpu.thread_ids_per_package());
+	w.put(cpu.core_ids_per_package());
+	w.put(cpu.total_threads());
+	w.put(cpu.total_cores());
+	w.put(cpu.smt_id_bits());
+	w.put(cpu.core_id_bits());
+	w.put(cpu.package_id_bits());
+	w.put(uint32_t(info.total_numa_nodes()));
+
+	w.put(uint16_t(cpu.caches().size()));
+	for (const auto& c : cpu.caches()) {
+		w.put(uint8_t(c.type()));
+		w.put(uint8_t(c.scope()));
+		w.put(c.level());
+		w.put(c.sharing_id_bits());
+		w.put(detail::cache_flags(c));
+		w.put(c.size());
+		w.put(c.sets());
+		w.put(c.line_size());
+		w.put(c.line_partitions());
+		w.put(c.associativity());
+	}
+
+	w.put(uint16_t(cpu.tlbs().size()));
+	for (const auto& t : cpu.tlbs()) {
+		w.put(uint8_t(t.type()));
+		w.put(t.level());
+		w.put(detail::page_flags(t));
+		w.put(t.entries());
+		w.put(t.associativity());
+		w.put(t.sharing_threads());
+	}
+
+	w.put(uint32_t(info.available_cpu_threads().size()));
+	for (const auto& t : info.available_cpu_threads()) {
+		w.put(t.os_id());
+		w.put(t.x2apic_id());
+	}
+
+	w.put(uint32_t(info.available_numa_nodes().size()));
+	for (const auto& n : info.available_numa_nodes()) {
+		w.put(n.id());
+		w.put(detail::first_thread(n, info));
+		w.put(uint32_t(n.cpu_info().available_threads().size()));
+		w.put(uint8_t(n.cpu_info().uses_smt()));
+	}
+}
+
+std::string to_binary(const system_info& info)
+{
+	auto buf = std::string{};
+	write_binary(info, buf);
+	return buf;
+}
+
+/*
+** Replaces the contents of `info` with the system described by `buf`.
+*/
+void read_binary(const boost::string_ref& buf, system_info& info)
+{
+	auto r = detail::binary_reader{buf};
+	auto& cpu = info.cpu_info();
+	auto& v = cpu.version();
+
+	auto magic = r.get(sizeof(detail::binary_magic));
+	if (std::memcmp(magic, detail::binary_magic, sizeof(detail::binary_magic))) {
+		throw parse_error{0, "bad magic"};
+	}
+	if (r.get<uint16_t>() > serialization_version) {
+		throw parse_error{r.offset() - 2, "unsupported version"};
+	}
+
+	v.base_frequency(r.get_double());
+	v.max_frequency(r.get_double());
+	v.bus_frequency(r.get_double());
+	v.vendor(r.get_enum<cpu_vendor>(3));
+	v.type(r.get_enum<cpu_type>(4));
+	v.family(r.get<uint8_t>());
+	v.model(r.get<uint8_t>());
+	v.stepping(r.get<uint8_t>());
+	auto brand_size = r.get<uint8_t>();
+	v.brand({r.get(brand_size), brand_size});
+
+	cpu.thread_ids_per_package(r.get<uint32_t>());
+	cpu.core_ids_per_package(r.get<uint32_t>());
+	cpu.total_threads(r.get<uint32_t>());
+	cpu.total_cores(r.get<uint32_t>());
+	cpu.smt_id_bits(r.get<uint8_t>());
+	cpu.core_id_bits(r.get<uint8_t>());
+	cpu.package_id_bits(r.get<uint8_t>());
+	info.total_numa_nodes(r.get<uint32_t>());
+
+	cpu.clear_caches();
+	for (auto i = r.get<uint16_t>(); i != 0; --i) {
+		auto c = cpu_cache{};
+		c.type(r.get_enum<cache_type>(3));
+		c.scope(r.get_enum<cpu_topology_level>(4));
+		c.level(r.get<uint8_t>());
+		c.sharing_id_bits(r.get<uint8_t>());
+
+		auto f = r.get<uint8_t>();
+		c.is_self_initializing(f & detail::cache_self_initializing).
+			is_fully_associative(f & detail::cache_fully_associative).
+			has_invalidate_propagation(f & detail::cache_invalidate_propagation).
+			is_inclusive(f & detail::cache_inclusive).
+			is_direct_mapped(f & detail::cache_direct_mapped);
+
+		c.size(r.get<uint32_t>());
+		c.sets(r.get<uint32_t>());
+		c.line_size(r.get<uint32_t>());
+		c.line_partitions(r.get<uint32_t>());
+		c.associativity(r.get<uint32_t>());
+		cpu.add(c);
+	}
+
+	cpu.clear_tlbs();
+	for (auto i = r.get<uint16_t>(); i != 0; --i) {
+		auto t = cpu_tlb{};
+		t.type(r.get_enum<cache_type>(3));
+		t.level(r.get<uint8_t>());
+		detail::set_page_flags(t, r.get<uint8_t>());
+		t.entries(r.get<uint32_t>());
+		t.associativity(r.get<uint32_t>());
+		t.sharing_threads(r.get<uint32_t>());
+		cpu.add(t);
+	}
+
+	auto threads = r.get_record_count(8);
+	info.available_cpu_threads(threads);
+	for (auto& t : info.available_cpu_threads()) {
+		t.os_id(r.get<uint32_t>());
+		t.x2apic_id(r.get<uint32_t>());
+	}
+
+	info.available_numa_nodes(r.get_record_count(13));
+	for (auto& n : info.available_numa_nodes()) {
+		n.id(r.get<uint32_t>());
+		auto first = r.get<uint32_t>();
+		auto count = r.get<uint32_t>();
+		if (uint64_t(first) + count > threads) {
+			throw parse_error{r.offset() - 8, "thread range out of "
+				"bounds"};
+		}
+		n.cpu_info().thread_data(detail::thread_data(info, first)).
+			available_threads(count).uses_smt(r.get<uint8_t>());
+	}
+}
+
+system_info from_binary(const boost::string_ref& buf)
+{
+	auto info = system_info{};
+	read_binary(buf, info);
+	return info;
+}
+
+namespace detail {
+
+void write_json_string(std::ostream& os, const boost::string_ref& s)
+{
+	static constexpr auto hex = "0123456789abcdef";
+
+	os.put('"');
+	for (auto c : s) {
+		if (c == '"' || c == '\\') {
+			os.put('\\');
+			os.put(c);
+		}
+		else if (uint8_t(c) < 0x20) {
+			os.write("\\u00", 4);
+			os.put(hex[uint8_t(c) >> 4]);
+			os.put(hex[c & 0xF]);
+		}
+		else {
+			os.put(c);
+		}
+	}
+	os.put('"');
+}
+
+/*
+** Writes the members of a JSON object one at a time, inserting the separators.
+*/
+class json_object_writer final
+{
+	std::ostream& m_os;
+	bool m_first{true};
+public:
+	explicit json_object_writer(std::ostream& os) : m_os(os)
+	{ m_os.put('{'); }
+
+	~json_object_writer()
+	{ m_os.put('}'); }
+
+	std::ostream& key(const char* k)
+	{
+		if (!m_first) {
+			m_os.put(',');
+		}
+		m_first = false;
+		write_json_string(m_os, k);
+		m_os.put(':');
+		return m_os;
+	}
+
+	void member(const char* k, uint64_t x)
+	{ key(k) << x; }
+
+	void member(const char* k, bool x)
+	{ key(k) << (x ? "true" : "false"); }
+
+	void member(const char* k, double x)
+	{
+		char buf[32];
+		auto n = std::snprintf(buf, sizeof(buf), "%.17g", x);
+		key(k).write(buf, n);
+	}
+
+	void member(const char* k, const boost::string_ref& s)
+	{ write_json_string(key(k), s); }
+
+	void member(const char* k, const char* s)
+	{ member(k, boost::string_ref{s}); }
+};
+
+}
+
+/*
+** Writes the JSON encoding of `info` to `os`, without insignificant whitespace.
+*/
+void write_json(std::ostream& os, const system_info& info)
+{
+	using detail::json_object_writer;
+	const auto& cpu = info.cpu_info();
+	const auto& v = cpu.version();
+
+	json_object_writer root{os};
+	root.member("format", "ctop");
+	root.member("version", uint64_t{serialization_version});
+	root.member("total_numa_nodes", uint64_t(info.total_numa_nodes()));
+
+	root.key("cpu");
+	{
+		json_object_writer o{os};
+		o.member("vendor", detail::vendor_names[uint8_t(v.vendor())]);
+		o.member("type", uint64_t(v.type()));
+		o.member("brand", detail::brand_string(v));
+		o.member("family", uint64_t{v.family()});
+		o.member("model", uint64_t{v.model()});
+		o.member("stepping", uint64_t{v.stepping()});
+		o.member("base_frequency_mhz", v.base_frequency());
+		o.member("max_frequency_mhz", v.max_frequency());
+		o.member("bus_frequency_mhz", v.bus_frequency());
+		o.member("thread_ids_per_package", uint64_t{cpu.thread_ids_per_package()});
+		o.member("core_ids_per_package", uint64_t{cpu.core_ids_per_package()});
+		o.member("total_threads", uint64_t{cpu.total_threads()});
+		o.member("total_cores", uint64_t{cpu.total_cores()});
+		o.member("smt_id_bits", uint64_t{cpu.smt_id_bits()});
+		o.member("core_id_bits", uint64_t{cpu.core_id_bits()});
+		o.member("package_id_bits", uint64_t{cpu.package_id_bits()});
+
+		o.key("caches").put('[');
+		for (const auto& c : cpu.caches()) {
+			if (&c != &cpu.caches()[0]) {
+				os.put(',');
+			}
+			json_object_writer co{os};
+			co.member("level", uint64_t{c.level()});
+			co.member("type", detail::cache_type_names[uint8_t(c.type())]);
+			co.member("scope", detail::scope_names[uint8_t(c.scope())]);
+			co.member("sharing_id_bits", uint64_t{c.sharing_id_bits()});
+			co.member("size", uint64_t{c.size()});
+			co.member("sets", uint64_t{c.sets()});
+			co.member("line_size", uint64_t{c.line_size()});
+			co.member("line_partitions", uint64_t{c.line_partitions()});
+			co.member("associativity", uint64_t{c.associativity()});
+			co.member("self_initializing", c.is_self_initializing());
+			co.member("fully_associative", c.is_fully_associative());
+			co.member("invalidate_propagation", c.has_invalidate_propagation());
+			co.member("inclusive", c.is_inclusive());
+			co.member("direct_mapped", c.is_direct_mapped());
+		}
+		os.put(']');
+
+		o.key("tlbs").put('[');
+		for (const auto& t : cpu.tlbs()) {
+			if (&t != &cpu.tlbs()[0]) {
+				os.put(',');
+			}
+			json_object_writer to{os};
+			to.member("level", uint64_t{t.level()});
+			to.member("type", detail::cache_type_names[uint8_t(t.type())]);
+			to.member("entries", uint64_t{t.entries()});
+			to.member("associativity", uint64_t{t.associativity()});
+			to.member("sharing_threads", uint64_t{t.sharing_threads()});
+
+			to.key("page_sizes").put('[');
+			auto f = detail::page_flags(t);
+			auto first = true;
+			for (auto i = 0u; i != 4; ++i) {
+				if (f & (1 << i)) {
+					if (!first) {
+						os.put(',');
+					}
+					first = false;
+					detail::write_json_string(os, detail::page_size_names[i]);
+				}
+			}
+			os.put(']');
+		}
+		os.put(']');
+	}
+
+	root.key("threads").put('[');
+	for (const auto& t : info.available_cpu_threads()) {
+		if (&t != &info.available_cpu_threads()[0]) {
+			os.put(',');
+		}
+		json_object_writer o{os};
+		o.member("os_id", uint64_t{t.os_id()});
+		o.member("x2apic_id", uint64_t{t.x2apic_id()});
+	}
+	os.put(']');
+
+	root.key("nodes").put('[');
+	for (const auto& n : info.available_numa_nodes()) {
+		if (&n != &info.available_numa_nodes()[0]) {
+			os.put(',');
+		}
+		json_object_writer o{os};
+		o.member("id", uint64_t{n.id()});
+		o.member("first_thread", uint64_t{detail::first_thread(n, info)});
+		o.member("threads", uint64_t(n.cpu_info().available_threads().size()));
+		o.member("uses_smt", bool(n.cpu_info().uses_smt()));
+	}
+	os.put(']');
+}
+
+/*
+** A pull parser over a JSON document held in memory. Strings are returned as
+** views into the input with their escape sequences intact, so parsing never
+** allocates.
+*/
+class json_reader final
+{
+	boost::string_ref m_buf;
+	size_t m_pos{};
+public:
+	explicit json_reader(const boost::string_ref& buf) noexcept
+	: m_buf{buf} {}
+
+	size_t offset() const noexcept
+	{ return m_pos; }
+
+	[[noreturn]] void fail(const boost::string_ref& msg) const
+	{ throw parse_error{m_pos, msg}; }
+
+	char peek()
+	{
+		while (m_pos != m_buf.size() && std::strchr(" \t\r\n", m_buf[m_pos]) &&
+			m_buf[m_pos] != '\0')
+		{
+			++m_pos;
+		}
+		if (m_pos == m_buf.size()) {
+			fail("unexpected end of input");
+		}
+		return m_buf[m_pos];
+	}
+
+	bool consume(char c)
+	{
+		if (peek() != c) {
+			return false;
+		}
+		++m_pos;
+		return true;
+	}
+
+	void expect(char c)
+	{
+		if (!consume(c)) {
+			fail(cc::format("expected '$'", c));
+		}
+	}
+
+	/*
+	** Returns the contents of a string literal, without unescaping them.
+	*/
+	boost::string_ref raw_string()
+	{
+		expect('"');
+		auto beg = m_pos;
+		while (m_pos < m_buf.size() && m_buf[m_pos] != '"') {
+			m_pos += m_buf[m_pos] == '\\' ? 2 : 1;
+		}
+		if (m_pos >= m_buf.size()) {
+			fail("unterminated string");
+		}
+		return m_buf.substr(beg, m_pos++ - beg);
+	}
+
+	/*
+	** Unescapes the next string literal into `out`, which has room for `cap`
+	** bytes, and returns the number of bytes written. Characters outside of
+	** Latin-1 are replaced by '?', since the strings that we serialize are
+	** CPUID brand strings.
+	*/
+	size_t string(char* out, size_t cap)
+	{
+		auto s = raw_string();
+		auto n = size_t{};
+		for (auto i = size_t{}; i != s.size() && n != cap; ++i) {
+			auto c = s[i];
+			if (c == '\\') {
+				switch (s[++i]) {
+				case 'b': c = '\b'; break;
+				case 'f': c = '\f'; break;
+				case 'n': c = '\n'; break;
+				case 'r': c = '\r'; break;
+				case 't': c = '\t'; break;
+				case 'u': {
+					if (s.size() - i < 5) {
+						fail("truncated escape sequence");
+					}
+					auto buf = std::array<char, 5>{};
+					std::copy(s.begin() + i + 1, s.begin() + i + 5,
+						buf.begin());
+					auto x = std::strtoul(buf.data(), nullptr, 16);
+					c = x < 0x100 ? char(x) : '?';
+					i += 4;
+					break;
+				}
+				default: c = s[i];
+				}
+			}
+			out[n++] = c;
+		}
+		return n;
+	}
+
+	template <class Integer>
+	Integer integer()
+	{
+		peek();
+		auto beg = m_pos;
+		auto r = uint64_t{};
+		while (m_pos != m_buf.size() && std::isdigit(m_buf[m_pos])) {
+			auto d = uint64_t(m_buf[m_pos++] - '0');
+			if (r > (std::numeric_limits<Integer>::max() - d) / 10) {
+				m_pos = beg;
+				fail("integer out of range");
+			}
+			r = 10 * r + d;
+		}
+		if (m_pos == beg) {
+			fail("expected unsigned integer");
+		}
+		return Integer(r);
+	}
+
+	double number()
+	{
+		peek();
+		auto buf = std::array<char, 32>{};
+		auto n = size_t{};
+		while (m_pos + n != m_buf.size() && n != buf.size() - 1 &&
+			std::strchr("+-.eE0123456789", m_buf[m_pos + n]) &&
+			m_buf[m_pos + n] != '\0')
+		{
+			buf[n] = m_buf[m_pos + n];
+			++n;
+		}
+
+		auto end = (char*)nullptr;
+		auto r = std::strtod(buf.data(), &end);
+		if (n == 0 || end != buf.data() + n) {
+			fail("expected number");
+		}
+		m_pos += n;
+		return r;
+	}
+
+	bool boolean()
+	{
+		peek();
+		if (m_buf.substr(m_pos).starts_with("true")) {
+			m_pos += 4;
+			return true;
+		}
+		if (m_buf.substr(m_pos).starts_with("false")) {
+			m_pos += 5;
+			return false;
+		}
+		fail("expected boolean");
+	}
+
+	/*
+	** Calls `f` with each key of an object, positioned at the corresponding
+	** value. `f` must consume the value.
+	*/
+	template <class Function>
+	void object(Function f)
+	{
+		expect('{');
+		if (consume('}')) {
+			return;
+		}
+		do {
+			auto k = raw_string();
+			expect(':');
+			f(k);
+		}
+		while (consume(','));
+		expect('}');
+	}
+
+	/*
+	** Calls `f` once for each element of an array. `f` must consume the
+	** element.
+	*/
+	template <class Function>
+	void array(Function f)
+	{
+		expect('[');
+		if (consume(']')) {
+			return;
+		}
+		do {
+			f();
+		}
+		while (consume(','));
+		expect(']');
+	}
+
+	void skip_value()
+	{
+		switch (peek()) {
+		case '{': object([&](auto) { skip_value(); }); break;
+		case '[': array([&] { skip_value(); }); break;
+		case '"': raw_string(); break;
+		case 't':
+		case 'f': boolean(); break;
+		case 'n':
+			if (!m_buf.substr(m_pos).starts_with("null")) {
+				fail("unexpected token");
+			}
+			m_pos += 4;
+			break;
+		default: number();
+		}
+	}
+
+	/*
+	** Reads a string and returns its index in `names`.
+	*/
+	template <size_t N>
+	uint8_t name(const char* const (&names)[N])
+	{
+		auto s = raw_string();
+		for (auto i = size_t{}; i != N; ++i) {
+			if (s == names[i]) {
+				return i;
+			}
+		}
+		fail("unknown name");
+	}
+};
+
+/*
+** Replaces the contents of `info` with the system described by the JSON
+** document `buf`. The "threads" array must precede the "nodes" array, as it
+** does in the output of `write_json`.
+*/
+void read_json(const boost::string_ref& buf, system_info& info)
+{
+	auto r = json_reader{buf};
+	auto& cpu = info.cpu_info();
+	auto& v = cpu.version();
+
+	info.available_numa_nodes(0);
+	info.available_cpu_threads(0);
+	cpu.clear_caches();
+	cpu.clear_tlbs();
+
+	auto read_cache = [&] {
+		auto c = cpu_cache{};
+		r.object([&](const boost::string_ref& k) {
+			if (k == "level") c.level(r.integer<uint8_t>());
+			else if (k == "sharing_id_bits") c.sharing_id_bits(r.integer<uint8_t>());
+			else if (k == "type") c.type(cache_type(r.name(detail::cache_type_names)));
+			else if (k == "scope") c.scope(cpu_topology_level(r.name(detail::scope_names)));
+			else if (k == "size") c.size(r.integer<uint32_t>());
+			else if (k == "sets") c.sets(r.integer<uint32_t>());
+			else if (k == "line_size") c.line_size(r.integer<uint32_t>());
+			else if (k == "line_partitions") c.line_partitions(r.integer<uint32_t>());
+			else if (k == "associativity") c.associativity(r.integer<uint32_t>());
+			else if (k == "self_initializing") c.is_self_initializing(r.boolean());
+			else if (k == "fully_associative") c.is_fully_associative(r.boolean());
+			else if (k == "invalidate_propagation") c.has_invalidate_propagation(r.boolean());
+			else if (k == "inclusive") c.is_inclusive(r.boolean());
+			else if (k == "direct_mapped") c.is_direct_mapped(r.boolean());
+			else r.skip_value();
+		});
+		cpu.add(c);
+	};
+
+	auto read_tlb = [&] {
+		auto t = cpu_tlb{};
+		r.object([&](const boost::string_ref& k) {
+			if (k == "level") t.level(r.integer<uint8_t>());
+			else if (k == "type") t.type(cache_type(r.name(detail::cache_type_names)));
+			else if (k == "entries") t.entries(r.integer<uint32_t>());
+			else if (k == "associativity") t.associativity(r.integer<uint32_t>());
+			else if (k == "sharing_threads") t.sharing_threads(r.integer<uint32_t>());
+			else if (k == "page_sizes") {
+				auto f = uint8_t{};
+				r.array([&] { f |= 1 << r.name(detail::page_size_names); });
+				detail::set_page_flags(t, f);
+			}
+			else r.skip_value();
+		});
+		cpu.add(t);
+	};
+
+	auto read_cpu = [&] {
+		r.object([&](const boost::string_ref& k) {
+			if (k == "vendor") v.vendor(cpu_vendor(r.name(detail::vendor_names)));
+			else if (k == "type") {
+				auto t = r.integer<uint8_t>();
+				if (t > 3) {
+					r.fail("CPU type out of range");
+				}
+				v.type(cpu_type(t));
+			}
+			else if (k == "brand") {
+				auto b = std::array<char, 48>{};
+				v.brand({b.data(), r.string(b.data(), b.size())});
+			}
+			else if (k == "family") v.family(r.integer<uint8_t>());
+			else if (k == "model") v.model(r.integer<uint8_t>());
+			else if (k == "stepping") v.stepping(r.integer<uint8_t>());
+			else if (k == "base_frequency_mhz") v.base_frequency(r.number());
+			else if (k == "max_frequency_mhz") v.max_frequency(r.number());
+			else if (k == "bus_frequency_mhz") v.bus_frequency(r.number());
+			else if (k == "thread_ids_per_package") cpu.thread_ids_per_package(r.integer<uint32_t>());
+			else if (k == "core_ids_per_package") cpu.core_ids_per_package(r.integer<uint32_t>());
+			else if (k == "total_threads") cpu.total_threads(r.integer<uint32_t>());
+			else if (k == "total_cores") cpu.total_cores(r.integer<uint32_t>());
+			else if (k == "smt_id_bits") cpu.smt_id_bits(r.integer<uint8_t>());
+			else if (k == "core_id_bits") cpu.core_id_bits(r.integer<uint8_t>());
+			else if (k == "package_id_bits") cpu.package_id_bits(r.integer<uint8_t>());
+			else if (k == "caches") r.array(read_cache);
+			else if (k == "tlbs") r.array(read_tlb);
+			else r.skip_value();
+		});
+	};
+
+	auto read_thread = [&] {
+		auto t = cpu_thread_info{};
+		r.object([&](const boost::string_ref& k) {
+			if (k == "os_id") t.os_id(r.integer<uint32_t>());
+			else if (k == "x2apic_id") t.x2apic_id(r.integer<uint32_t>());
+			else r.skip_value();
+		});
+		info.add(t);
+	};
+
+	auto read_node = [&] {
+		auto n = numa_node_info{};
+		auto first = uint32_t{};
+		auto count = uint32_t{};
+		auto smt = false;
+		r.object([&](const boost::string_ref& k) {
+			if (k == "id") n.id(r.integer<uint32_t>());
+			else if (k == "first_thread") first = r.integer<uint32_t>();
+			else if (k == "threads") count = r.integer<uint32_t>();
+			else if (k == "uses_smt") smt = r.boolean();
+			else r.skip_value();
+		});
+		if (uint64_t(first) + count > info.available_cpu_threads().size()) {
+			r.fail("thread range out of bounds");
+		}
+		n.cpu_info().thread_data(detail::thread_data(info, first)).
+			available_threads(count).uses_smt(smt);
+		info.add(n);
+	};
+
+	auto seen_nodes = false;
+	r.object([&](const boost::string_ref& k) {
+		if (k == "format") {
+			if (r.raw_string() != "ctop") {
+				r.fail("unknown format");
+			}
+		}
+		else if (k == "version") {
+			if (r.integer<uint16_t>() > serialization_version) {
+				r.fail("unsupported version");
+			}
+		}
+		else if (k == "total_numa_nodes") info.total_numa_nodes(r.integer<uint32_t>());
+		else if (k == "cpu") read_cpu();
+		else if (k == "threads") {
+			if (seen_nodes) {
+				r.fail("\"threads\" must precede \"nodes\"");
+			}
+			r.array(read_thread);
+		}
+		else if (k == "nodes") {
+			seen_nodes = true;
+			r.array(read_node);
+		}
+		else r.skip_value();
+	});
+}
+
+system_info from_json(const boost::string_ref& buf)
+{
+	auto info = system_info{};
+	read_json(buf, info);
+	return info;
+}
+
+}
+
+#endif
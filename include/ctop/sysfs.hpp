@@ -0,0 +1,306 @@
+/*
+** File Name: sysfs.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z3113B142_CB3D_48D1_AE89_000AB44E4628
+#define Z3113B142_CB3D_48D1_AE89_000AB44E4628
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/scope_exit.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/sysfs_error.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+/*
+** The functions that read sysfs, procfs, or device files take the mount point
+** as an argument, so that they can be pointed at a fake tree during testing.
+*/
+static constexpr auto default_sysfs_root = "/sys";
+static constexpr auto default_procfs_root = "/proc";
+static constexpr auto default_dev_root = "/dev";
+
+/*
+** Returns the contents of the file at the given path, without the trailing
+** newline. Files in sysfs and procfs report a size of zero, so we read until
+** EOF instead of relying on `stat`. Returns `boost::none` if the file does not
+** exist.
+*/
+boost::optional<std::string>
+try_read_file(const std::string& path)
+{
+	auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		if (errno == ENOENT) {
+			return boost::none;
+		}
+		throw sysfs_error{path, std::strerror(errno)};
+	}
+
+	BOOST_SCOPE_EXIT_ALL(&) {
+		::close(fd);
+	};
+
+	auto buf = std::array<char, 4096>{};
+	auto s = std::string{};
+
+	for (;;) {
+		auto r = ::read(fd, buf.data(), buf.size());
+		if (r == 0) {
+			break;
+		}
+		else if (r == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw sysfs_error{path, std::strerror(errno)};
+		}
+		s.append(buf.data(), r);
+	}
+
+	if (!s.empty() && s.back() == '\n') {
+		s.pop_back();
+	}
+	return s;
+}
+
+std::string read_file(const std::string& path)
+{
+	auto s = try_read_file(path);
+	if (!s) {
+		throw sysfs_error{path, "file does not exist"};
+	}
+	return std::move(*s);
+}
+
+/*
+** Parses a nonnegative decimal integer, ignoring surrounding whitespace. The
+** path is only used for error reporting.
+*/
+uint64_t parse_integer(boost::string_ref s, const std::string& path)
+{
+	while (!s.empty() && std::isspace(s.front())) {
+		s.remove_prefix(1);
+	}
+	while (!s.empty() && std::isspace(s.back())) {
+		s.remove_suffix(1);
+	}
+	if (s.empty()) {
+		throw sysfs_error{path, "expected integer"};
+	}
+
+	auto r = uint64_t{};
+	for (auto c : s) {
+		if (c < '0' || c > '9') {
+			throw sysfs_error{path, "expected integer"};
+		}
+		r = 10 * r + (c - '0');
+	}
+	return r;
+}
+
+uint64_t read_integer(const std::string& path)
+{ return parse_integer(read_file(path), path); }
+
+boost::optional<uint64_t>
+try_read_integer(const std::string& path)
+{
+	auto s = try_read_file(path);
+	if (!s) {
+		return boost::none;
+	}
+	return parse_integer(*s, path);
+}
+
+/*
+** Parses a list of CPU or node IDs in the format used by the kernel, e.g.
+** "0-3,8-11". Ranges are inserted a word at a time. An empty string
+** corresponds to an empty set.
+*/
+cpu_set parse_cpu_set(boost::string_ref s, const std::string& path)
+{
+	// Far above any kernel's limit, but small enough that a corrupt list
+	// cannot make us allocate gigabytes.
+	static constexpr auto max_id = uint64_t{1} << 24;
+	auto id = [&](boost::string_ref t) {
+		auto r = parse_integer(t, path);
+		if (r >= max_id) {
+			throw sysfs_error{path, "ID out of range in CPU list"};
+		}
+		return uint32_t(r);
+	};
+	auto r = cpu_set{};
+
+	while (!s.empty() && std::isspace(s.back())) {
+		s.remove_suffix(1);
+	}
+
+	while (!s.empty()) {
+		auto end = s.find(',');
+		auto item = s.substr(0, end);
+		s = end == boost::string_ref::npos ?
+			boost::string_ref{} : s.substr(end + 1);
+
+		auto dash = item.find('-');
+		if (dash == boost::string_ref::npos) {
+			r.insert(id(item));
+			continue;
+		}
+
+		auto first = id(item.substr(0, dash));
+		auto last = id(item.substr(dash + 1));
+		if (first > last) {
+			throw sysfs_error{path, "invalid range in CPU list"};
+		}
+		r.insert(first, last);
+	}
+	return r;
+}
+
+/*
+** Like `parse_cpu_set`, but returns the IDs in increasing order.
+*/
+std::vector<uint32_t>
+parse_cpu_list(boost::string_ref s, const std::string& path)
+{ return parse_cpu_set(s, path).to_vector(); }
+
+cpu_set read_cpu_set(const std::string& path)
+{ return parse_cpu_set(read_file(path), path); }
+
+std::vector<uint32_t>
+read_cpu_list(const std::string& path)
+{ return parse_cpu_list(read_file(path), path); }
+
+/*
+** A file that is reread from the beginning on each call to `read`, e.g. a file
+** in procfs that is sampled periodically. The file stays open, and the buffer
+** only grows when the file does, so that steady-state sampling makes one
+** system call and no allocations. The contents are followed by eight zero
+** bytes, so that parsers can read whole words past the end.
+*/
+class pread_file final
+{
+	static constexpr auto padding = 8u;
+
+	std::string m_path;
+	std::vector<char> m_buf{};
+	int m_fd{-1};
+public:
+	explicit pread_file(const std::string& path, size_t size_hint = 4096)
+	: m_path{path}
+	{
+		m_fd = ::open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_fd == -1) {
+			throw sysfs_error{m_path, std::strerror(errno)};
+		}
+		m_buf.resize(size_hint + padding);
+	}
+
+	~pread_file()
+	{
+		if (m_fd != -1) {
+			::close(m_fd);
+		}
+	}
+
+	pread_file(pread_file&& rhs) noexcept :
+	m_path{std::move(rhs.m_path)}, m_buf{std::move(rhs.m_buf)},
+	m_fd{rhs.m_fd} { rhs.m_fd = -1; }
+
+	pread_file(const pread_file&) = delete;
+	pread_file& operator=(const pread_file&) = delete;
+
+	const std::string& path() const noexcept
+	{ return m_path; }
+
+	/*
+	** Returns the current contents of the file. The result is invalidated
+	** by the next call.
+	*/
+	boost::string_ref read()
+	{
+		auto n = read_once();
+		while (n == capacity()) {
+			// Leave room for growth, e.g. CPUs brought online later.
+			m_buf.resize(2 * m_buf.size());
+			n = read_once();
+		}
+		std::fill(m_buf.begin() + n, m_buf.begin() + n + padding, '\0');
+		return {m_buf.data(), n};
+	}
+private:
+	size_t capacity() const noexcept
+	{ return m_buf.size() - padding; }
+
+	size_t read_once()
+	{
+		for (;;) {
+			auto r = ::pread(m_fd, m_buf.data(), capacity(), 0);
+			if (r != -1) {
+				return r;
+			}
+			if (errno != EINTR) {
+				throw sysfs_error{m_path, std::strerror(errno)};
+			}
+		}
+	}
+};
+
+/*
+** Returns the names of the entries in the given directory, excluding "." and
+** "..", in lexicographical order. Returns an empty list if the directory does
+** not exist.
+*/
+std::vector<std::string>
+list_directory(const std::string& path)
+{
+	auto r = std::vector<std::string>{};
+	auto dir = ::opendir(path.c_str());
+	if (dir == nullptr) {
+		if (errno == ENOENT) {
+			return r;
+		}
+		throw sysfs_error{path, std::strerror(errno)};
+	}
+
+	BOOST_SCOPE_EXIT_ALL(&) {
+		::closedir(dir);
+	};
+
+	while (auto e = ::readdir(dir)) {
+		auto name = boost::string_ref{e->d_name};
+		if (name == "." || name == "..") {
+			continue;
+		}
+		r.emplace_back(name.begin(), name.end());
+	}
+
+	std::sort(r.begin(), r.end());
+	return r;
+}
+
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*
+** File Name: sysfs_error.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef ZC73A2AF8_E150_4999_B0CD_80C505B345D6
+#define ZC73A2AF8_E150_4999_B0CD_80C505B345D6
+
+#include <exception>
+#include <ccbase/format.hpp>
+#include <ccbase/utility.hpp>
+#include <boost/utility/string_ref.hpp>
+
+namespace ctop {
+
+/*
+** Thrown when a file under sysfs or procfs cannot be read or does not have the
+** expected format.
+*/
+class sysfs_error final : public std::exception
+{
+	std::string m_path{};
+	std::string m_msg{};
+public:
+	explicit sysfs_error(const std::string& path, const boost::string_ref& msg)
+	noexcept : m_path{path}
+	{
+		m_msg = cc::format("sysfs error (file ${quote}): $.", path, msg);
+	}
+
+	const char* what() const noexcept override
+	{ return m_msg.c_str(); }
+
+	const std::string& path() const noexcept
+	{ return m_path; }
+};
+
+}
+
+#endif
@@ -8,14 +8,19 @@
 #ifndef Z81EA1B11_A653_467B_BFC2_F5F532D5D3F8
 #define Z81EA1B11_A653_467B_BFC2_F5F532D5D3F8
 
+#include <algorithm>
 #include <array>
+#include <map>
 #include <vector>
 #include <ostream>
+#include <stdexcept>
 
 #include <boost/range/iterator_range.hpp>
 #include <boost/utility/string_ref.hpp>
 #include <ccbase/format.hpp>
 #include <ccbase/utility.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/device.hpp>
 
 #if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
 	#include <numa.h>
@@ -80,7 +85,10 @@ class cpu_version final
 {
 	static constexpr auto brand_length = 48;
 
-	double m_base_freq_mhz;
+	// Frequencies are in MHz, and zero if unknown.
+	double m_base_freq_mhz{};
+	double m_max_freq_mhz{};
+	double m_bus_freq_mhz{};
 	cpu_vendor m_vendor;
 	cpu_type m_type;
 	uint8_t m_brand_off{};
@@ -107,7 +115,22 @@ public:
 		};
 	}
 
+	/*
+	** Replaces the brand string, truncating it if necessary and resetting
+	** the brand offset.
+	*/
+	cpu_version& brand(const boost::string_ref& s) noexcept
+	{
+		auto n = std::min(s.size(), (size_t)brand_length);
+		m_brand.fill('\0');
+		std::copy(s.begin(), s.begin() + n, m_brand.begin());
+		m_brand_off = 0;
+		return *this;
+	}
+
 	DEFINE_COPY_GETTER_SETTER(cpu_version, base_frequency, m_base_freq_mhz)
+	DEFINE_COPY_GETTER_SETTER(cpu_version, max_frequency, m_max_freq_mhz)
+	DEFINE_COPY_GETTER_SETTER(cpu_version, bus_frequency, m_bus_freq_mhz)
 	DEFINE_COPY_GETTER_SETTER(cpu_version, vendor, m_vendor)
 	DEFINE_COPY_GETTER_SETTER(cpu_version, type, m_type)
 	DEFINE_COPY_GETTER_SETTER(cpu_version, brand_offset, m_brand_off)
@@ -127,6 +150,9 @@ enum class cpu_topology_level : uint8_t
 	thread,
 	core,
 	processor,
+	// A group of cores within a package, e.g. a module, die, or core
+	// complex, whose extent is only known from the sharing mask.
+	cluster,
 };
 
 std::ostream& operator<<(std::ostream& os, const cpu_topology_level& t)
@@ -141,6 +167,9 @@ std::ostream& operator<<(std::ostream& os, const cpu_topology_level& t)
 	case cpu_topology_level::processor:
 		cc::write(os, "processor");
 		return os;
+	case cpu_topology_level::cluster:
+		cc::write(os, "cluster");
+		return os;
 	default:
 		cc::write(os, "unknown");
 		return os;
@@ -188,11 +217,23 @@ class cpu_cache final
 
 	cpu_topology_level m_scope;
 	uint8_t m_level;
+	// The number of low-order bits of the x2APIC ID that differ between
+	// threads sharing one instance of the cache.
+	uint8_t m_sharing_id_bits{};
 	uint32_t m_size;
 	uint32_t m_sets;
 	uint32_t m_line_size;
 	uint32_t m_line_partitions;
 	uint32_t m_assoc;
+
+	// Filled in by `measure_caches`, and zero otherwise. The latency is in
+	// nanoseconds, the bandwidths are in bytes per second, and the size is
+	// the largest working set that still fit in the cache.
+	double m_measured_latency{};
+	double m_measured_read_bw{};
+	double m_measured_write_bw{};
+	uint32_t m_measured_size{};
+	bool m_size_mismatch{};
 public:
 	explicit cpu_cache() noexcept {}
 
@@ -205,11 +246,18 @@ public:
 
 	DEFINE_COPY_GETTER_SETTER(cpu_cache, scope, m_scope)
 	DEFINE_COPY_GETTER_SETTER(cpu_cache, level, m_level)
+	DEFINE_COPY_GETTER_SETTER(cpu_cache, sharing_id_bits, m_sharing_id_bits)
 	DEFINE_COPY_GETTER_SETTER(cpu_cache, size, m_size)
 	DEFINE_COPY_GETTER_SETTER(cpu_cache, sets, m_sets)
 	DEFINE_COPY_GETTER_SETTER(cpu_cache, line_size, m_line_size)
 	DEFINE_COPY_GETTER_SETTER(cpu_cache, line_partitions, m_line_partitions)
 	DEFINE_COPY_GETTER_SETTER(cpu_cache, associativity, m_assoc)
+
+	DEFINE_COPY_GETTER_SETTER(cpu_cache, measured_latency, m_measured_latency)
+	DEFINE_COPY_GETTER_SETTER(cpu_cache, measured_read_bandwidth, m_measured_read_bw)
+	DEFINE_COPY_GETTER_SETTER(cpu_cache, measured_write_bandwidth, m_measured_write_bw)
+	DEFINE_COPY_GETTER_SETTER(cpu_cache, measured_size, m_measured_size)
+	DEFINE_COPY_GETTER_SETTER(cpu_cache, has_size_mismatch, m_size_mismatch)
 };
 
 std::ostream& operator<<(std::ostream& os, const cpu_cache& c)
@@ -219,6 +267,53 @@ std::ostream& operator<<(std::ostream& os, const cpu_cache& c)
 	return os;
 }
 
+/*
+** Describes one TLB. A TLB that supports several page sizes is reported as a
+** single entry; the page sizes share the entries. An associativity of zero
+** means that the TLB is fully associative.
+*/
+class cpu_tlb final
+{
+	cache_type m_type;
+	bool m_4k_pages{};
+	bool m_2m_pages{};
+	bool m_4m_pages{};
+	bool m_1g_pages{};
+
+	uint8_t m_level;
+	uint32_t m_entries;
+	uint32_t m_assoc;
+	uint32_t m_sharing_threads{1};
+public:
+	explicit cpu_tlb() noexcept {}
+
+	bool is_fully_associative() const noexcept
+	{ return m_assoc == 0; }
+
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, type, m_type)
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, has_4k_pages, m_4k_pages)
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, has_2m_pages, m_2m_pages)
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, has_4m_pages, m_4m_pages)
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, has_1g_pages, m_1g_pages)
+
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, level, m_level)
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, entries, m_entries)
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, associativity, m_assoc)
+	DEFINE_COPY_GETTER_SETTER(cpu_tlb, sharing_threads, m_sharing_threads)
+};
+
+std::ostream& operator<<(std::ostream& os, const cpu_tlb& t)
+{
+	cc::write(os, "L${num} $ TLB (${num} entries, pages:",
+		t.level(), t.type(), t.entries());
+	if (t.has_4k_pages()) { cc::write(os, " 4K"); }
+	if (t.has_2m_pages()) { cc::write(os, " 2M"); }
+	if (t.has_4m_pages()) { cc::write(os, " 4M"); }
+	if (t.has_1g_pages()) { cc::write(os, " 1G"); }
+	cc::write(os, ")");
+	return os;
+}
+
 class cpu_thread_info final
 {
 	uint32_t m_os_id;
@@ -240,7 +335,7 @@ std::ostream& operator<<(std::ostream& os, const cpu_thread_info& i)
 class local_cpu_info final
 {
 	cpu_thread_info* m_thread_data;
-	uint8_t m_avail_threads;
+	uint32_t m_avail_threads;
 	uint8_t m_uses_smt;
 
 	using thread_range       = boost::iterator_range<cpu_thread_info*>;
@@ -254,6 +349,18 @@ public:
 	const_thread_range available_threads() const noexcept
 	{ return {m_thread_data, m_thread_data + m_avail_threads}; }
 
+	/*
+	** The OS IDs of the available threads.
+	*/
+	cpu_set cpus() const
+	{
+		auto r = cpu_set{};
+		for (const auto& t : available_threads()) {
+			r.insert(t.os_id());
+		}
+		return r;
+	}
+
 	DEFINE_SETTER(local_cpu_info, thread_data, m_thread_data)
 	DEFINE_SETTER(local_cpu_info, available_threads, m_avail_threads)
 	DEFINE_COPY_GETTER_SETTER(local_cpu_info, uses_smt, m_uses_smt)
@@ -269,11 +376,16 @@ std::ostream& operator<<(std::ostream& os, const local_cpu_info& i)
 class global_cpu_info final
 {
 	std::vector<cpu_cache> m_caches{};
+	std::vector<cpu_tlb> m_tlbs{};
 	cpu_version m_version{};
-	uint8_t m_thread_ids_per_pkg{};
-	uint8_t m_core_ids_per_pkg{};
-	uint8_t m_total_threads;
-	uint8_t m_total_cores;
+	// The counts are per package. Hosts with more than 255 CPU threads are
+	// common, so none of them fit in eight bits.
+	uint32_t m_thread_ids_per_pkg{};
+	uint32_t m_core_ids_per_pkg{};
+	uint32_t m_total_threads;
+	uint32_t m_total_cores;
+	// The widths of the fields of the x2APIC ID, from the least significant:
+	// the SMT ID, the core ID, and the package ID.
 	uint8_t m_smt_id_bits;
 	uint8_t m_core_id_bits;
 	uint8_t m_pkg_id_bits;
@@ -282,6 +394,11 @@ class global_cpu_info final
 	using const_cache_iterator = decltype(m_caches.cbegin());
 	using cache_range          = boost::iterator_range<cache_iterator>;
 	using const_cache_range    = boost::iterator_range<const_cache_iterator>;
+
+	using tlb_iterator       = decltype(m_tlbs.begin());
+	using const_tlb_iterator = decltype(m_tlbs.cbegin());
+	using tlb_range          = boost::iterator_range<tlb_iterator>;
+	using const_tlb_range    = boost::iterator_range<const_tlb_iterator>;
 public:
 	explicit global_cpu_info() noexcept {}
 
@@ -291,12 +408,22 @@ public:
 	const_cache_range caches() const noexcept
 	{ return {m_caches.cbegin(), m_caches.cend()}; }
 
+	tlb_range tlbs() noexcept
+	{ return {m_tlbs.begin(), m_tlbs.end()}; }
+
+	const_tlb_range tlbs() const noexcept
+	{ return {m_tlbs.cbegin(), m_tlbs.cend()}; }
+
 	void add(class cpu_cache& c) { m_caches.push_back(c); }
+	void add(class cpu_tlb& t) { m_tlbs.push_back(t); }
 
-	uint8_t thread_ids_per_core() const noexcept
+	void clear_caches() noexcept { m_caches.clear(); }
+	void clear_tlbs() noexcept { m_tlbs.clear(); }
+
+	uint32_t thread_ids_per_core() const noexcept
 	{ return m_thread_ids_per_pkg / m_core_ids_per_pkg; }
 
-	uint8_t threads_per_core() const noexcept
+	uint32_t threads_per_core() const noexcept
 	{ return m_total_threads / m_total_cores; }
 
 	DEFINE_REF_GETTER_SETTER(global_cpu_info, version, m_version)
@@ -340,6 +467,18 @@ uint32_t package_id(
 	return thread.x2apic_id() >> (info.smt_id_bits() + info.core_id_bits());
 }
 
+/*
+** Returns the ID of the instance of the cache used by the thread. Threads share
+** an instance if and only if they have the same ID.
+*/
+uint32_t cache_instance_id(
+	const cpu_thread_info& thread,
+	const cpu_cache& cache
+) noexcept
+{
+	return thread.x2apic_id() >> cache.sharing_id_bits();
+}
+
 /*
 ** Precondition: `threads` must be a sorted based on x2APIC IDs.
 */
@@ -361,6 +500,21 @@ uint32_t count_unique_cores(const Range& threads, const global_cpu_info& info)
 	return count;
 }
 
+/*
+** Returns the line size of the L1 data cache, which is the granularity at
+** which data shared between threads should be padded. Falls back to 64 bytes
+** if no data cache was reported.
+*/
+uint32_t cache_line_size(const global_cpu_info& info) noexcept
+{
+	for (const auto& c : info.caches()) {
+		if (c.level() == 1 && c.type() != cache_type::instruction) {
+			return c.line_size();
+		}
+	}
+	return 64;
+}
+
 class numa_node_info final
 {
 	local_cpu_info m_cpu_info{};
@@ -395,6 +549,13 @@ class system_info final
 	global_cpu_info m_cpu_info{};
 	std::vector<numa_node_info> m_node_info{};
 	std::vector<cpu_thread_info> m_cpu_thread_info{};
+	std::vector<pci_device_info> m_pci_devices{};
+	std::vector<irq_info> m_irqs{};
+	// The OS IDs of the CPU threads that the kernel keeps free of
+	// housekeeping work, in increasing order. See `isolation.hpp`.
+	std::vector<uint32_t> m_isolated_cpus{};
+	std::vector<uint32_t> m_nohz_full_cpus{};
+	std::vector<uint32_t> m_rcu_nocb_cpus{};
 	uint32_t m_total_nodes;
 
 	using numa_node_iterator       = decltype(m_node_info.begin());
@@ -409,6 +570,38 @@ class system_info final
 public:
 	explicit system_info() noexcept {}
 
+	/*
+	** The thread ranges of the nodes point into `m_cpu_thread_info`, so a
+	** copy must point them into its own vector. A move keeps the buffer, so
+	** the pointers stay valid.
+	*/
+	system_info(const system_info& rhs) :
+	m_cpu_info{rhs.m_cpu_info}, m_node_info{rhs.m_node_info},
+	m_cpu_thread_info{rhs.m_cpu_thread_info},
+	m_pci_devices{rhs.m_pci_devices}, m_irqs{rhs.m_irqs},
+	m_isolated_cpus{rhs.m_isolated_cpus},
+	m_nohz_full_cpus{rhs.m_nohz_full_cpus},
+	m_rcu_nocb_cpus{rhs.m_rcu_nocb_cpus}, m_total_nodes{rhs.m_total_nodes}
+	{
+		for (auto& n : m_node_info) {
+			auto p = n.cpu_info().available_threads().begin();
+			if (p != nullptr) {
+				n.cpu_info().thread_data(m_cpu_thread_info.data() +
+					(p - rhs.m_cpu_thread_info.data()));
+			}
+		}
+	}
+
+	system_info(system_info&&) = default;
+
+	system_info& operator=(const system_info& rhs)
+	{
+		auto tmp = system_info{rhs};
+		return *this = std::move(tmp);
+	}
+
+	system_info& operator=(system_info&&) = default;
+
 	size_t total_numa_nodes() const noexcept
 	{ return m_total_nodes; }
 
@@ -448,11 +641,29 @@ public:
 	const_cpu_thread_range available_cpu_threads() const noexcept
 	{ return {m_cpu_thread_info.cbegin(), m_cpu_thread_info.cend()}; }
 
+	/*
+	** The OS IDs of the available CPU threads.
+	*/
+	cpu_set available_cpus() const
+	{
+		auto r = cpu_set{};
+		for (const auto& t : m_cpu_thread_info) {
+			r.insert(t.os_id());
+		}
+		return r;
+	}
+
 	global_cpu_info& cpu_info() noexcept
 	{ return m_cpu_info; }
 
 	const global_cpu_info& cpu_info() const noexcept
 	{ return m_cpu_info; }
+
+	DEFINE_REF_GETTER_SETTER(system_info, pci_devices, m_pci_devices)
+	DEFINE_REF_GETTER_SETTER(system_info, irqs, m_irqs)
+	DEFINE_REF_GETTER_SETTER(system_info, isolated_cpus, m_isolated_cpus)
+	DEFINE_REF_GETTER_SETTER(system_info, nohz_full_cpus, m_nohz_full_cpus)
+	DEFINE_REF_GETTER_SETTER(system_info, rcu_nocb_cpus, m_rcu_nocb_cpus)
 };
 
 std::ostream& operator<<(std::ostream& os, const system_info& i)
@@ -463,6 +674,141 @@ std::ostream& operator<<(std::ostream& os, const system_info& i)
 	return os;
 }
 
+/*
+** Returns the NUMA node containing the CPU thread with the given OS ID, or
+** `nullptr` if the thread is not available to this process.
+*/
+const numa_node_info*
+find_numa_node(uint32_t os_id, const system_info& info) noexcept
+{
+	for (const auto& n : info.available_numa_nodes()) {
+		for (const auto& t : n.cpu_info().available_threads()) {
+			if (t.os_id() == os_id) {
+				return &n;
+			}
+		}
+	}
+	return nullptr;
+}
+
+const cpu_thread_info*
+find_cpu_thread(uint32_t os_id, const system_info& info) noexcept
+{
+	for (const auto& t : info.available_cpu_threads()) {
+		if (t.os_id() == os_id) {
+			return &t;
+		}
+	}
+	return nullptr;
+}
+
+/*
+** The levels of the topology by which CPU threads can be grouped.
+*/
+enum class topology_domain : uint8_t
+{
+	thread,
+	core,
+	package,
+	numa_node,
+};
+
+std::ostream& operator<<(std::ostream& os, const topology_domain& d)
+{
+	switch (d) {
+	case topology_domain::thread:
+		cc::write(os, "thread");
+		return os;
+	case topology_domain::core:
+		cc::write(os, "core");
+		return os;
+	case topology_domain::package:
+		cc::write(os, "package");
+		return os;
+	case topology_domain::numa_node:
+		cc::write(os, "NUMA node");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** Returns the ID of the domain at the given level that contains the thread.
+** Thread IDs are OS IDs; core and package IDs are derived from the x2APIC ID,
+** so they are unique across the whole system.
+*/
+uint32_t domain_id(
+	const cpu_thread_info& thread,
+	topology_domain d,
+	const system_info& info
+)
+{
+	switch (d) {
+	case topology_domain::thread:
+		return thread.os_id();
+	case topology_domain::core:
+		return core_id(thread, info.cpu_info());
+	case topology_domain::package:
+		return package_id(thread, info.cpu_info());
+	case topology_domain::numa_node: {
+		auto n = find_numa_node(thread.os_id(), info);
+		if (n == nullptr) {
+			throw std::invalid_argument{"CPU thread does not belong "
+				"to an available NUMA node"};
+		}
+		return n->id();
+	}
+	default:
+		throw std::invalid_argument{"unknown topology domain"};
+	}
+}
+
+/*
+** Returns the OS IDs of the available CPU threads in the domain with the given
+** ID, e.g. the SMT siblings of a core. IDs are as given by `domain_id`.
+*/
+cpu_set domain_cpus(topology_domain d, uint32_t id, const system_info& info)
+{
+	if (d == topology_domain::numa_node) {
+		for (const auto& n : info.available_numa_nodes()) {
+			if (n.id() == id) {
+				return n.cpu_info().cpus();
+			}
+		}
+		return cpu_set{};
+	}
+
+	auto r = cpu_set{};
+	for (const auto& t : info.available_cpu_threads()) {
+		if (domain_id(t, d, info) == id) {
+			r.insert(t.os_id());
+		}
+	}
+	return r;
+}
+
+/*
+** Returns the OS IDs of the available CPU threads in each domain at the given
+** level, indexed by domain ID.
+*/
+std::map<uint32_t, cpu_set>
+domain_cpus(topology_domain d, const system_info& info)
+{
+	auto r = std::map<uint32_t, cpu_set>{};
+	if (d == topology_domain::numa_node) {
+		for (const auto& n : info.available_numa_nodes()) {
+			r[n.id()] = n.cpu_info().cpus();
+		}
+		return r;
+	}
+	for (const auto& t : info.available_cpu_threads()) {
+		r[domain_id(t, d, info)].insert(t.os_id());
+	}
+	return r;
+}
+
 }
 
 #endif
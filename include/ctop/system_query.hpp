@@ -14,11 +14,17 @@
 #include <cstring>
 
 #include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
 #include <boost/scope_exit.hpp>
 #include <ccbase/error.hpp>
 
+#include <ctop/affinity.hpp>
+#include <ctop/cpu_set.hpp>
 #include <ctop/cpuid.hpp>
 #include <ctop/cpuid_error.hpp>
+#include <ctop/device_query.hpp>
+#include <ctop/hypervisor.hpp>
+#include <ctop/isolation.hpp>
 #include <ctop/numa_error.hpp>
 #include <ctop/system.hpp>
 
@@ -43,19 +49,63 @@ namespace ctop {
 CC_CONST CC_ALWAYS_INLINE uint32_t 
 roundup_to_pot(uint32_t x)
 {
-	return 1 << (32 - __builtin_clz(x - 1));
+	// `__builtin_clz` is undefined for zero.
+	return x <= 1 ? 1 : 1 << (32 - __builtin_clz(x - 1));
 }
 
 #else
 	#error "Unsupported compiler."
 #endif
 
+/*
+** Parses the base frequency in MHz from a brand string such as "Intel(R)
+** Xeon(R) CPU E5-2670 0 @ 2.60GHz". Returns `boost::none` if the brand string
+** does not end with a frequency.
+*/
+boost::optional<double>
+parse_brand_frequency(const boost::string_ref& brand)
+{
+	auto s = brand.substr(0, brand.find('\0'));
+	while (!s.empty() && s.back() == ' ') {
+		s.remove_suffix(1);
+	}
+	if (s.length() < 4) {
+		return boost::none;
+	}
+
+	auto units = s.substr(s.length() - 3);
+	auto scale = double{};
+	if (units == "MHz") {
+		scale = 1;
+	}
+	else if (units == "GHz") {
+		scale = 1000;
+	}
+	else if (units == "THz") {
+		scale = 1000000;
+	}
+	else {
+		return boost::none;
+	}
+
+	auto num = s.substr(0, s.length() - 3);
+	auto first_digit = num.rfind(' ');
+	num = first_digit == boost::string_ref::npos ?
+		num : num.substr(first_digit + 1);
+
+	auto sig = double{};
+	if (!boost::conversion::try_lexical_convert(num, sig) || sig <= 0) {
+		return boost::none;
+	}
+	return scale * sig;
+}
+
 void get_basic_cpu_info(global_cpu_info& info)
 {
 	static const auto _ = std::ignore;
 
-	std::array<char, 13> buf;
-	buf[12] = '\0';
+	// Room for all four registers; the vendor string is in the last three.
+	std::array<char, 16> buf;
 
 	auto regs = (uint32_t*)buf.data();
 	auto& eax = regs[0];
@@ -68,6 +118,7 @@ void get_basic_cpu_info(global_cpu_info& info)
 	*/
 	auto vendor_str = boost::string_ref{buf.data() + 4, 12};
 	std::tie(eax, ebx, edx, ecx) = cpuid(cpuid_leaf::basic_info);
+	auto max_leaf = eax;
 
 	if (vendor_str == "GenuineIntel") {
 		info.version().vendor(cpu_vendor::intel);
@@ -151,50 +202,20 @@ void get_basic_cpu_info(global_cpu_info& info)
 	auto brand_str = info.version().brand();
 
 	/*
-	** Extract the base frequency.
+	** Leaf 0x16 reports the base, maximum, and bus frequencies directly.
+	** Otherwise, fall back to the base frequency in the brand string. The
+	** brand strings of some processors and hypervisors do not include it,
+	** in which case the frequencies are left as zero.
 	*/
-	if (brand_str.length() < 5) {
-		throw cpuid_error{cpuid_leaf::brand_string_part_1,
-			"brand string is too small"};
-	}
-
-	auto units = brand_str.length() - 4;
-	auto first_digit = brand_str.rfind(' ');
-
-	if (first_digit == boost::string_ref::npos) {
-		throw cpuid_error{cpuid_leaf::brand_string_part_1,
-			"brand string has no spaces"};
-	}
-	++first_digit;
-
-	if (first_digit >= units) {
-		throw cpuid_error{cpuid_leaf::brand_string_part_2,
-			"brand string has unexpected space"};
-	}
-
-	auto freq = brand_str.substr(first_digit, units - first_digit);
-	auto sig = double{};
-	try {
-		sig = boost::lexical_cast<double>(freq);
-	}
-	catch (const boost::bad_lexical_cast&) {
-		throw cpuid_error{cpuid_leaf::brand_string_part_1,
-			"failed to parse base frequency"};
-	}
-
-	auto units_str = brand_str.substr(units, 3);
-	if (units_str == "MHz") {
-		info.version().base_frequency(sig);
-	}
-	else if (units_str == "GHz") {
-		info.version().base_frequency(1000 * sig);
-	}
-	else if (units_str == "THz") {
-		info.version().base_frequency(1000000 * sig);
-	}
-	else {
-		throw cpuid_error{cpuid_leaf::brand_string_part_1,
-			"failed to parse base frequency"};
+	if (max_leaf >= cpuid_leaf::frequency_info) {
+		std::tie(eax, ebx, ecx, _) = cpuid(cpuid_leaf::frequency_info);
+		info.version().base_frequency(eax & 0xFFFF).
+			max_frequency(ebx & 0xFFFF).bus_frequency(ecx & 0xFFFF);
+	}
+	if (info.version().base_frequency() == 0) {
+		if (auto f = parse_brand_frequency(brand_str)) {
+			info.version().base_frequency(*f);
+		}
 	}
 }
 
@@ -231,7 +252,13 @@ void get_cpu_layout_info(global_cpu_info& info)
 			++checked;
 		}
 		else if (type == 2) {
-			info.core_id_bits(shift);
+			// The shift at the core level covers the SMT ID as
+			// well as the core ID.
+			if (checked != 1 || shift < info.smt_id_bits()) {
+				throw cpuid_error{leaf, "core level precedes or is "
+					"narrower than SMT level"};
+			}
+			info.core_id_bits(shift - info.smt_id_bits());
 			info.total_threads(count);
 			++checked;
 		}
@@ -258,6 +285,13 @@ void get_cpu_layout_info(global_cpu_info& info)
 	}
 	info.package_id_bits(32 - info.smt_id_bits() - info.core_id_bits());
 	info.total_cores(info.total_threads() / smt_count);
+
+	// Leaf 1 has room for at most 255 thread IDs per package, and leaf 4 for
+	// at most 64 core IDs, so the widths of the x2APIC ID fields are used
+	// instead.
+	info.thread_ids_per_package(uint32_t{1} <<
+		(info.smt_id_bits() + info.core_id_bits()));
+	info.core_ids_per_package(uint32_t{1} << info.core_id_bits());
 }
 
 void get_cpu_cache_info(global_cpu_info& info)
@@ -283,26 +317,23 @@ void get_cpu_cache_info(global_cpu_info& info)
 		c.is_self_initializing((eax >> 8) & 0x1);
 		c.is_fully_associative((eax >> 9) & 0x1);
 
-		info.core_ids_per_package(roundup_to_pot((eax >> 26) + 1));
-		if (info.thread_ids_per_package() < info.core_ids_per_package()) {
-			throw cpuid_error{leaf, "fewer thread IDs per package "
-				"than core IDs per package"};
-		}
-		else if (info.thread_ids_per_package() % info.core_ids_per_package() != 0) {
-			throw cpuid_error{leaf, "number of thread IDs per "
-				"package not a multiple of number of core "
-				"IDs per package"};
-		}
-
+		// Threads share an instance of the cache if their x2APIC IDs
+		// agree after shifting out the bits that cover `sharing_ids`.
+		// The scope is only a summary: caches shared by a module or a
+		// die fall between a core and a package.
 		auto sharing_ids = roundup_to_pot(((eax >> 14) & 0xFFF) + 1);
-		if (sharing_ids == info.thread_ids_per_core()) {
+		c.sharing_id_bits(__builtin_ctz(sharing_ids));
+		if (sharing_ids < info.thread_ids_per_core()) {
+			c.scope(cpu_topology_level::thread);
+		}
+		else if (sharing_ids == info.thread_ids_per_core()) {
 			c.scope(cpu_topology_level::core);
 		}
-		else if (sharing_ids == info.thread_ids_per_package()) {
+		else if (sharing_ids >= info.thread_ids_per_package()) {
 			c.scope(cpu_topology_level::processor);
 		}
 		else {
-			throw cpuid_error{leaf, "failed to determine scope of cache"};
+			c.scope(cpu_topology_level::cluster);
 		}
 
 		c.line_size((ebx & 0xFFF) + 1);
@@ -321,12 +352,200 @@ void get_cpu_cache_info(global_cpu_info& info)
 	}
 }
 
+/*
+** Page size flags used by the TLB descriptor table below.
+*/
+static constexpr auto tlb_4k = uint8_t{0x1};
+static constexpr auto tlb_2m = uint8_t{0x2};
+static constexpr auto tlb_4m = uint8_t{0x4};
+static constexpr auto tlb_1g = uint8_t{0x8};
+
+struct tlb_descriptor
+{
+	uint8_t value;
+	cache_type type;
+	uint8_t level;
+	uint8_t pages;
+	uint16_t entries;
+	uint8_t assoc;
+};
+
+/*
+** The TLB descriptors reported by leaf 2 on Nehalem and later processors. See
+** table 3-12 in volume 2A of the instruction reference manual. Descriptors for
+** caches and prefetchers are ignored.
+*/
+static constexpr tlb_descriptor tlb_descriptors[] = {
+	{0x01, cache_type::instruction, 1, tlb_4k,                     32, 4},
+	{0x02, cache_type::instruction, 1, tlb_4m,                      2, 0},
+	{0x03, cache_type::data,        1, tlb_4k,                     64, 4},
+	{0x04, cache_type::data,        1, tlb_4m,                      8, 4},
+	{0x05, cache_type::data,        1, tlb_4m,                     32, 4},
+	{0x0B, cache_type::instruction, 1, tlb_4m,                      4, 4},
+	{0x4F, cache_type::instruction, 1, tlb_4k,                     32, 0},
+	{0x50, cache_type::instruction, 1, tlb_4k | tlb_2m | tlb_4m,   64, 0},
+	{0x51, cache_type::instruction, 1, tlb_4k | tlb_2m | tlb_4m,  128, 0},
+	{0x52, cache_type::instruction, 1, tlb_4k | tlb_2m | tlb_4m,  256, 0},
+	{0x55, cache_type::instruction, 1, tlb_2m | tlb_4m,             7, 0},
+	{0x56, cache_type::data,        1, tlb_4m,                     16, 4},
+	{0x57, cache_type::data,        1, tlb_4k,                     16, 4},
+	{0x59, cache_type::data,        1, tlb_4k,                     16, 0},
+	{0x5A, cache_type::data,        1, tlb_2m | tlb_4m,            32, 4},
+	{0x5B, cache_type::data,        1, tlb_4k | tlb_4m,            64, 0},
+	{0x5C, cache_type::data,        1, tlb_4k | tlb_4m,           128, 0},
+	{0x5D, cache_type::data,        1, tlb_4k | tlb_4m,           256, 0},
+	{0x61, cache_type::instruction, 1, tlb_4k,                     48, 0},
+	{0x63, cache_type::data,        1, tlb_2m | tlb_4m,            32, 4},
+	{0x63, cache_type::data,        1, tlb_1g,                      4, 4},
+	{0x64, cache_type::data,        1, tlb_4k,                    512, 4},
+	{0x6A, cache_type::data,        1, tlb_4k,                     64, 8},
+	{0x6B, cache_type::data,        1, tlb_4k,                    256, 8},
+	{0x6C, cache_type::data,        1, tlb_2m | tlb_4m,           128, 8},
+	{0x6D, cache_type::data,        1, tlb_1g,                     16, 0},
+	{0x76, cache_type::instruction, 1, tlb_2m | tlb_4m,             8, 0},
+	{0xA0, cache_type::data,        1, tlb_4k,                     32, 0},
+	{0xB0, cache_type::instruction, 1, tlb_4k,                    128, 4},
+	{0xB1, cache_type::instruction, 1, tlb_2m,                      8, 4},
+	{0xB2, cache_type::instruction, 1, tlb_4k,                     64, 4},
+	{0xB3, cache_type::data,        1, tlb_4k,                    128, 4},
+	{0xB4, cache_type::data,        1, tlb_4k,                    256, 4},
+	{0xB5, cache_type::instruction, 1, tlb_4k,                     64, 8},
+	{0xB6, cache_type::instruction, 1, tlb_4k,                    128, 8},
+	{0xBA, cache_type::data,        1, tlb_4k,                     64, 4},
+	{0xC0, cache_type::data,        1, tlb_4k | tlb_4m,             8, 4},
+	{0xC1, cache_type::unified,     2, tlb_4k | tlb_2m,          1024, 8},
+	{0xC2, cache_type::data,        1, tlb_4k | tlb_2m,            16, 4},
+	{0xC3, cache_type::unified,     2, tlb_4k | tlb_2m,          1536, 6},
+	{0xC3, cache_type::unified,     2, tlb_1g,                     16, 4},
+	{0xC4, cache_type::data,        1, tlb_2m | tlb_4m,            32, 4},
+	{0xCA, cache_type::unified,     2, tlb_4k,                    512, 4},
+};
+
+/*
+** Decodes the TLB descriptors reported by leaf 2. This is only used on Intel
+** processors that do not support leaf 0x18; other vendors report zeros. If AL
+** is not one, the leaf does not hold descriptors in the expected form, and no
+** TLBs are added.
+*/
+template <class CpuidFn>
+void get_legacy_tlb_info(global_cpu_info& info, const CpuidFn& cpuid_fn)
+{
+	static constexpr auto leaf = cpuid_leaf::cache_tlb_info;
+	std::array<uint32_t, 4> regs;
+	std::tie(regs[0], regs[1], regs[2], regs[3]) = cpuid_fn(leaf, 0);
+
+	if ((regs[0] & 0xFF) != 0x1) {
+		return;
+	}
+	regs[0] &= ~uint32_t{0xFF};
+
+	for (auto r : regs) {
+		// The register does not contain valid descriptors if bit 31 is set.
+		if (r & (uint32_t{1} << 31)) {
+			continue;
+		}
+
+		for (auto i = 0; i != 4; ++i) {
+			auto value = uint8_t((r >> (8 * i)) & 0xFF);
+			for (const auto& d : tlb_descriptors) {
+				if (d.value != value) {
+					continue;
+				}
+
+				auto t = cpu_tlb{};
+				t.type(d.type);
+				t.level(d.level);
+				t.entries(d.entries);
+				t.associativity(d.assoc);
+				t.has_4k_pages(d.pages & tlb_4k);
+				t.has_2m_pages(d.pages & tlb_2m);
+				t.has_4m_pages(d.pages & tlb_4m);
+				t.has_1g_pages(d.pages & tlb_1g);
+				info.add(t);
+			}
+		}
+	}
+}
+
+template <class CpuidFn>
+void get_deterministic_tlb_info(global_cpu_info& info, const CpuidFn& cpuid_fn)
+{
+	static constexpr auto leaf = cpuid_leaf::enumerable_tlb_info;
+	uint32_t eax, ebx, ecx, edx;
+	std::tie(eax, ebx, ecx, edx) = cpuid_fn(leaf, 0);
+	auto max_subleaf = eax;
+
+	for (auto i = 0u; i <= max_subleaf; ++i) {
+		if (i != 0) {
+			std::tie(eax, ebx, ecx, edx) = cpuid_fn(leaf, i);
+		}
+
+		auto t = cpu_tlb{};
+		switch (edx & 0x1F) {
+		case 0: continue;
+		case 1: t.type(cache_type::data);        break;
+		case 2: t.type(cache_type::instruction); break;
+		case 3: t.type(cache_type::unified);     break;
+		// Load-only and store-only TLBs.
+		case 4: t.type(cache_type::data);        break;
+		case 5: t.type(cache_type::data);        break;
+		default: throw cpuid_error{leaf, "encountered unknown TLB type"};
+		}
+
+		auto ways = (ebx >> 16) & 0xFFFF;
+		auto fully_assoc = (edx >> 8) & 0x1;
+
+		t.level((edx >> 5) & 0x7);
+		t.has_4k_pages(ebx & 0x1);
+		t.has_2m_pages((ebx >> 1) & 0x1);
+		t.has_4m_pages((ebx >> 2) & 0x1);
+		t.has_1g_pages((ebx >> 3) & 0x1);
+		t.entries(ways * ecx);
+		t.associativity(fully_assoc ? 0 : ways);
+		t.sharing_threads(((edx >> 14) & 0xFFF) + 1);
+		info.add(t);
+	}
+}
+
+/*
+** Fills in the TLBs from the output of `cpuid_fn(leaf, subleaf)`, which must
+** return EAX, EBX, ECX, and EDX. The vendor in `info` must already be set.
+** Leaf 0x18 is preferred when it is available. Hypervisors sometimes report
+** that leaf 0x18 should be used without populating it, in which case Intel
+** processors fall back to leaf 2. The TLBs are optional, so the list is left
+** empty when neither leaf describes them.
+*/
+template <class CpuidFn>
+void get_cpu_tlb_info(global_cpu_info& info, const CpuidFn& cpuid_fn)
+{
+	auto max_leaf = std::get<0>(cpuid_fn(cpuid_leaf::basic_info, 0));
+	if (max_leaf >= cpuid_leaf::enumerable_tlb_info) {
+		get_deterministic_tlb_info(info, cpuid_fn);
+		if (!info.tlbs().empty()) {
+			return;
+		}
+	}
+	if (info.version().vendor() == cpu_vendor::intel &&
+		max_leaf >= cpuid_leaf::cache_tlb_info)
+	{
+		get_legacy_tlb_info(info, cpuid_fn);
+	}
+}
+
+void get_cpu_tlb_info(global_cpu_info& info)
+{
+	get_cpu_tlb_info(info, [](uint32_t leaf, uint32_t subleaf) {
+		return cpuid(leaf, subleaf);
+	});
+}
+
 void get_global_info(system_info& info)
 {
 	auto& cpu = info.cpu_info();
 	get_basic_cpu_info(cpu);
 	get_cpu_layout_info(cpu);
 	get_cpu_cache_info(cpu);
+	get_cpu_tlb_info(cpu);
 }
 
 void get_numa_inventory(system_info& info)
@@ -353,7 +572,16 @@ void get_numa_inventory(system_info& info)
 	}
 	info.available_numa_nodes(count);
 
-	if ((uint32_t)::numa_num_configured_cpus() != info.total_cpu_threads()) {
+	// Hypervisors often report a layout in leaf 0xB that does not add up to
+	// the vCPUs that they give the guest, e.g. claiming SMT where there is
+	// none, or folding several sockets into one NUMA node. The counts of the
+	// kernel are the ones that the walk over the CPU threads relies on, so
+	// only bare metal is held to agree with them. See `virtualization.hpp`
+	// for how far to trust the layout in this case.
+	auto strict = !detect_hypervisor().present();
+	if (strict && (uint32_t)::numa_num_configured_cpus() !=
+		info.total_cpu_threads())
+	{
 		throw numa_error{"total CPU count disagrees with information "
 			"reported by libnuma"};
 	}
@@ -362,7 +590,7 @@ void get_numa_inventory(system_info& info)
 	if (count <= 0) {
 		throw numa_error{"failed to get available CPU thread count"};
 	}
-	if ((uint32_t)count > info.total_cpu_threads()) {
+	if (strict && (uint32_t)count > info.total_cpu_threads()) {
 		throw numa_error{"libnuma reports more available CPU threads "
 			"than total CPU threads"};
 	}
@@ -392,7 +620,11 @@ void get_cpu_topology_info(
 		}
 	}
 
-	auto avail_threads = ::numa_bitmask_weight(cpus);
+	// The node lists all of its CPU threads, including those outside the
+	// affinity of the process, e.g. the ones isolated by `isolcpus`.
+	auto members = cpu_set::from_bitmask(cpus) &
+		cpu_set::from_bitmask(::numa_all_cpus_ptr);
+	auto avail_threads = uint32_t(members.count());
 	if (avail_threads == 0) {
 		throw numa_error{node.id(), "node reported accessible but "
 			"contains no usable CPU threads"};
@@ -406,21 +638,19 @@ void get_cpu_topology_info(
 	cpu.thread_data(&info.available_cpu_threads()[cur_thread_count]);
 	cur_thread_count += avail_threads;
 
-	for (auto i = 0u, cur_thread = 0u; i != info.total_cpu_threads(); ++i) {
-		if (::numa_bitmask_isbitset(cpus, i)) {
-			::numa_bitmask_setbit(cur_cpu, i);
-			if (::numa_sched_setaffinity(0, cur_cpu) == -1) {
-				auto msg = cc::format("failed to schedule "
-					"thread on CPU $: $", i,
-					std::strerror(errno));
-				throw numa_error{node.id(), msg};
-			}
-			::numa_bitmask_clearbit(cur_cpu, i);
-
-			auto& thread = cpu.available_threads()[cur_thread++];
-			thread.os_id(i);
-			std::tie(_, _, _, thread.x2apic_id()) = cpuid(leaf, 0);
+	auto cur_thread = 0u;
+	for (auto i : members) {
+		::numa_bitmask_setbit(cur_cpu, i);
+		if (::numa_sched_setaffinity(0, cur_cpu) == -1) {
+			auto msg = cc::format("failed to schedule thread on "
+				"CPU $: $", i, std::strerror(errno));
+			throw numa_error{node.id(), msg};
 		}
+		::numa_bitmask_clearbit(cur_cpu, i);
+
+		auto& thread = cpu.available_threads()[cur_thread++];
+		thread.os_id(i);
+		std::tie(_, _, _, thread.x2apic_id()) = cpuid(leaf, 0);
 	}
 
 	boost::sort(cpu.available_threads(),
@@ -449,16 +679,20 @@ void get_cpu_topology_info(
 		unique_cores < avail_threads);
 }
 
+/*
+** Reads the x2APIC ID of each CPU thread by moving the calling thread onto it,
+** so the affinity of the calling thread is restored afterwards.
+*/
 void get_numa_topology_info(system_info& info)
 {
-	auto max_node = ::numa_max_possible_node();
-	if (max_node <= 0) {
-		throw numa_error{"failed to get maximum NUMA node number"};
-	}
+	thread_state_guard saved{};
 
+	// libnuma caches the CPU mask of each node after the first query, and
+	// refuses to copy it into a buffer smaller than the cached one, so the
+	// masks are sized for the kernel rather than for this system.
 	auto nodes = ::numa_all_nodes_ptr;
-	auto cpus = ::numa_bitmask_alloc(info.total_cpu_threads());
-	auto cur_cpu = ::numa_bitmask_alloc(info.total_cpu_threads());
+	auto cpus = ::numa_allocate_cpumask();
+	auto cur_cpu = ::numa_allocate_cpumask();
 
 	BOOST_SCOPE_EXIT_ALL(&) {
 		if (cpus != nullptr) {
@@ -477,12 +711,11 @@ void get_numa_topology_info(system_info& info)
 	}
 
 	auto cur_thread_count = uint32_t{};
-	for (auto i = 0u, cur_node = 0u; i != (unsigned)max_node; ++i) {
-		if (::numa_bitmask_isbitset(nodes, i)) {
-			auto& node = info.available_numa_nodes()[cur_node++].id(i);
-			get_cpu_topology_info(cur_thread_count, cpus, cur_cpu,
-				node, info);
-		}
+	auto cur_node = 0u;
+	for (auto i : cpu_set::from_bitmask(nodes)) {
+		auto& node = info.available_numa_nodes()[cur_node++].id(i);
+		get_cpu_topology_info(cur_thread_count, cpus, cur_cpu, node,
+			info);
 	}
 
 	if (cur_thread_count != info.available_cpu_threads().size()) {
@@ -513,6 +746,8 @@ system_query()
 		auto info = system_info{};
 		get_global_info(info);
 		get_numa_info(info);
+		try_get_device_info(info);
+		get_isolation_info(info);
 		return info;
 	});
 }
@@ -0,0 +1,666 @@
+/*
+** File Name: telemetry.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Continuous recording of per-CPU utilization, frequency, interrupts, and
+** context switches. A sampling thread pushes one record per CPU thread per
+** interval into per-CPU rings, and a flushing thread drains the rings into a
+** columnar time-series file and a Prometheus textfile-collector file.
+**
+** The time-series file starts with a header and the binary encoding of the
+** `system_info` of the host, followed by one block per flush. Each block holds
+** the records of the flush column by column, with every column aligned to
+** eight bytes, so that the file can be mapped and scanned without parsing.
+** Integers are stored in native byte order.
+*/
+
+#ifndef Z75C31CB2_B14A_429B_9CE9_2B47FCA1F44D
+#define Z75C31CB2_B14A_429B_9CE9_2B47FCA1F44D
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/scope_exit.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/cpu_stat.hpp>
+#include <ctop/frequency.hpp>
+#include <ctop/node_memory.hpp>
+#include <ctop/parse_error.hpp>
+#include <ctop/per_cpu.hpp>
+#include <ctop/proc_counters.hpp>
+#include <ctop/ring_buffer.hpp>
+#include <ctop/serialization.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+struct telemetry_sample
+{
+	// Wall-clock time, in nanoseconds since the epoch.
+	uint64_t timestamp_ns;
+	// Cumulative counts; context switches are zero if schedstat is not
+	// available.
+	uint64_t interrupts;
+	uint64_t context_switches;
+	// Utilization over the last interval, in [0, 1].
+	float utilization;
+	// Effective frequency over the last interval, or zero if unknown.
+	float frequency_mhz;
+};
+
+/*
+** One flush worth of records, stored column by column.
+*/
+struct telemetry_columns
+{
+	std::vector<uint64_t> timestamp_ns{};
+	std::vector<uint32_t> cpu{};
+	std::vector<float> utilization{};
+	std::vector<float> frequency_mhz{};
+	std::vector<uint64_t> interrupts{};
+	std::vector<uint64_t> context_switches{};
+
+	size_t size() const noexcept
+	{ return cpu.size(); }
+
+	void clear() noexcept
+	{
+		timestamp_ns.clear();
+		cpu.clear();
+		utilization.clear();
+		frequency_mhz.clear();
+		interrupts.clear();
+		context_switches.clear();
+	}
+
+	void add(uint32_t c, const telemetry_sample& s)
+	{
+		timestamp_ns.push_back(s.timestamp_ns);
+		cpu.push_back(c);
+		utilization.push_back(s.utilization);
+		frequency_mhz.push_back(s.frequency_mhz);
+		interrupts.push_back(s.interrupts);
+		context_switches.push_back(s.context_switches);
+	}
+};
+
+namespace detail {
+
+static constexpr char telemetry_magic[] = {'C', 'T', 'T', 'S'};
+static constexpr char telemetry_block_magic[] = {'C', 'T', 'T', 'B'};
+static constexpr auto telemetry_version = uint16_t{1};
+
+struct telemetry_file_header
+{
+	char magic[4];
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t topology_size;
+	uint32_t reserved2;
+};
+
+struct telemetry_block_header
+{
+	char magic[4];
+	uint32_t rows;
+	uint64_t begin_ns;
+	uint64_t end_ns;
+};
+
+template <class T>
+void append_column(std::string& buf, const std::vector<T>& v)
+{
+	buf.append((const char*)v.data(), v.size() * sizeof(T));
+	buf.resize(round_up(buf.size(), 8), '\0');
+}
+
+void write_all(int fd, const std::string& buf, const std::string& path)
+{
+	auto p = buf.data();
+	auto n = buf.size();
+	while (n != 0) {
+		auto r = ::write(fd, p, n);
+		if (r == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::system_error{errno, std::system_category(),
+				"failed to write to " + path};
+		}
+		p += r;
+		n -= r;
+	}
+}
+
+}
+
+/*
+** Appends blocks to a time-series file, creating it with the given topology if
+** it does not exist.
+*/
+class telemetry_file_writer final
+{
+	std::string m_path;
+	std::string m_buf{};
+	int m_fd{-1};
+public:
+	explicit telemetry_file_writer(const std::string& path,
+		const system_info& info) : m_path{path}
+	{
+		m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+			0644);
+		if (m_fd == -1) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to open " + path};
+		}
+
+		struct stat st;
+		if (::fstat(m_fd, &st) == -1) {
+			::close(m_fd);
+			throw std::system_error{errno, std::system_category(),
+				"failed to stat " + path};
+		}
+		if (st.st_size != 0) {
+			return;
+		}
+
+		auto topology = to_binary(info);
+		auto h = detail::telemetry_file_header{};
+		std::memcpy(h.magic, detail::telemetry_magic, sizeof(h.magic));
+		h.version = detail::telemetry_version;
+		h.topology_size = topology.size();
+
+		m_buf.append((const char*)&h, sizeof(h));
+		m_buf.append(topology);
+		m_buf.resize(round_up(m_buf.size(), 8), '\0');
+		detail::write_all(m_fd, m_buf, m_path);
+	}
+
+	~telemetry_file_writer()
+	{
+		if (m_fd != -1) {
+			::close(m_fd);
+		}
+	}
+
+	telemetry_file_writer(const telemetry_file_writer&) = delete;
+	telemetry_file_writer& operator=(const telemetry_file_writer&) = delete;
+
+	/*
+	** Appends the records as one block, with a single `write`, so that a
+	** concurrent reader sees either none or all of the block.
+	*/
+	void append(const telemetry_columns& c)
+	{
+		if (c.size() == 0) {
+			return;
+		}
+
+		auto h = detail::telemetry_block_header{};
+		std::memcpy(h.magic, detail::telemetry_block_magic, sizeof(h.magic));
+		h.rows = c.size();
+		h.begin_ns = *std::min_element(c.timestamp_ns.begin(),
+			c.timestamp_ns.end());
+		h.end_ns = *std::max_element(c.timestamp_ns.begin(),
+			c.timestamp_ns.end());
+
+		m_buf.clear();
+		m_buf.append((const char*)&h, sizeof(h));
+		detail::append_column(m_buf, c.timestamp_ns);
+		detail::append_column(m_buf, c.cpu);
+		detail::append_column(m_buf, c.utilization);
+		detail::append_column(m_buf, c.frequency_mhz);
+		detail::append_column(m_buf, c.interrupts);
+		detail::append_column(m_buf, c.context_switches);
+		detail::write_all(m_fd, m_buf, m_path);
+	}
+};
+
+/*
+** Pointers to the columns of one block of a mapped time-series file.
+*/
+struct telemetry_block
+{
+	uint32_t rows;
+	uint64_t begin_ns;
+	uint64_t end_ns;
+	const uint64_t* timestamp_ns;
+	const uint32_t* cpu;
+	const float* utilization;
+	const float* frequency_mhz;
+	const uint64_t* interrupts;
+	const uint64_t* context_switches;
+};
+
+/*
+** A read-only mapping of a time-series file. A block that was only partially
+** written, e.g. because the recorder was killed, is ignored.
+*/
+class telemetry_file final
+{
+	void* m_data{MAP_FAILED};
+	size_t m_size{};
+	system_info m_info{};
+	std::vector<telemetry_block> m_blocks{};
+public:
+	explicit telemetry_file(const std::string& path)
+	{
+		auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd == -1) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to open " + path};
+		}
+		BOOST_SCOPE_EXIT_ALL(&) {
+			::close(fd);
+		};
+
+		struct stat st;
+		if (::fstat(fd, &st) == -1) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to stat " + path};
+		}
+		m_size = st.st_size;
+		if (m_size < sizeof(detail::telemetry_file_header)) {
+			throw parse_error{0, "missing file header"};
+		}
+
+		m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (m_data == MAP_FAILED) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to map " + path};
+		}
+		try {
+			parse();
+		}
+		catch (...) {
+			::munmap(m_data, m_size);
+			throw;
+		}
+	}
+
+	~telemetry_file()
+	{
+		if (m_data != MAP_FAILED) {
+			::munmap(m_data, m_size);
+		}
+	}
+
+	telemetry_file(const telemetry_file&) = delete;
+	telemetry_file& operator=(const telemetry_file&) = delete;
+
+	/*
+	** The topology of the host that recorded the file.
+	*/
+	const system_info& topology() const noexcept
+	{ return m_info; }
+
+	const std::vector<telemetry_block>& blocks() const noexcept
+	{ return m_blocks; }
+private:
+	void parse()
+	{
+		auto base = (const char*)m_data;
+		auto h = detail::telemetry_file_header{};
+		std::memcpy(&h, base, sizeof(h));
+		if (std::memcmp(h.magic, detail::telemetry_magic, sizeof(h.magic))) {
+			throw parse_error{0, "bad magic"};
+		}
+		if (h.version > detail::telemetry_version) {
+			throw parse_error{4, "unsupported version"};
+		}
+
+		auto off = sizeof(h);
+		if (m_size - off < h.topology_size) {
+			throw parse_error{off, "truncated topology"};
+		}
+		read_binary({base + off, h.topology_size}, m_info);
+		off = round_up(off + h.topology_size, 8);
+
+		while (m_size > off && m_size - off >=
+			sizeof(detail::telemetry_block_header))
+		{
+			auto b = detail::telemetry_block_header{};
+			std::memcpy(&b, base + off, sizeof(b));
+			if (std::memcmp(b.magic, detail::telemetry_block_magic,
+				sizeof(b.magic)))
+			{
+				throw parse_error{off, "bad block magic"};
+			}
+
+			auto col = off + sizeof(b);
+			auto column = [&](size_t elem_size) {
+				auto r = base + col;
+				col += round_up(b.rows * elem_size, 8);
+				return r;
+			};
+
+			auto x = telemetry_block{};
+			x.rows = b.rows;
+			x.begin_ns = b.begin_ns;
+			x.end_ns = b.end_ns;
+			x.timestamp_ns = (const uint64_t*)column(8);
+			x.cpu = (const uint32_t*)column(4);
+			x.utilization = (const float*)column(4);
+			x.frequency_mhz = (const float*)column(4);
+			x.interrupts = (const uint64_t*)column(8);
+			x.context_switches = (const uint64_t*)column(8);
+			if (col > m_size) {
+				break;
+			}
+			m_blocks.push_back(x);
+			off = col;
+		}
+	}
+};
+
+/*
+** Samples every available CPU thread at a fixed interval on a background
+** thread, and periodically flushes the samples on another. Either output path
+** may be empty to disable that output. Frequency and context switches are
+** recorded as zero if the machine does not expose them.
+**
+** Errors on the background threads, e.g. a full disk, do not stop the
+** recorder; they are counted, and the last one is kept for the host to
+** inspect.
+*/
+class telemetry_recorder final
+{
+public:
+	static constexpr auto ring_capacity = size_t{1024};
+private:
+	using ring = spsc_ring<telemetry_sample, ring_capacity>;
+
+	// Latest values and maximum utilization over the flush window, for the
+	// Prometheus output.
+	struct cpu_state
+	{
+		telemetry_sample latest;
+		float max_utilization;
+		uint64_t dropped;
+	};
+
+	std::chrono::milliseconds m_interval;
+	std::chrono::milliseconds m_flush_interval;
+	std::string m_prometheus_path;
+
+	per_cpu<ring> m_rings;
+	utilization_monitor m_util;
+	boost::optional<frequency_sampler> m_freq{};
+	interrupt_sampler m_intr{};
+	boost::optional<schedstat_sampler> m_sched{};
+	boost::optional<telemetry_file_writer> m_writer{};
+
+	std::vector<uint64_t> m_intr_counts{};
+	std::vector<uint64_t> m_sched_counts{};
+	std::vector<cpu_state> m_state{};
+	telemetry_columns m_columns{};
+
+	std::mutex m_mutex{};
+	std::condition_variable m_cv{};
+	bool m_stop{};
+	// Errors thrown by the background threads, which must not escape them.
+	uint64_t m_errors{};
+	std::exception_ptr m_last_error{};
+	std::thread m_sampler{};
+	std::thread m_flusher{};
+public:
+	explicit telemetry_recorder(
+		const system_info& info,
+		const std::string& data_path,
+		const std::string& prometheus_path,
+		std::chrono::milliseconds interval = std::chrono::milliseconds(100),
+		std::chrono::milliseconds flush_interval = std::chrono::seconds(10)
+	) : m_interval{interval}, m_flush_interval{flush_interval},
+	m_prometheus_path{prometheus_path}, m_rings{info}, m_util{info}
+	{
+		try {
+			m_freq.emplace(info);
+		}
+		catch (const sysfs_error&) {}
+		try {
+			m_sched.emplace();
+		}
+		catch (const sysfs_error&) {}
+		if (!data_path.empty()) {
+			m_writer.emplace(data_path, info);
+		}
+
+		auto size = m_rings.cpus().empty() ? 0 : m_rings.cpus().back() + 1;
+		m_intr_counts.resize(size);
+		m_sched_counts.resize(size);
+		m_state.resize(size);
+	}
+
+	~telemetry_recorder()
+	{ stop(); }
+
+	telemetry_recorder(const telemetry_recorder&) = delete;
+	telemetry_recorder& operator=(const telemetry_recorder&) = delete;
+
+	void start()
+	{
+		m_sampler = std::thread{[this] { run(m_interval, [&] { sample(); }); }};
+		m_flusher = std::thread{[this] { run(m_flush_interval, [&] { flush(); }); }};
+	}
+
+	/*
+	** The number of samples or flushes that failed, and the exception
+	** thrown by the last one, or `nullptr`.
+	*/
+	uint64_t errors()
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_errors;
+	}
+
+	std::exception_ptr last_error()
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_last_error;
+	}
+
+	/*
+	** Stops both threads, and flushes the remaining samples.
+	*/
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		if (m_sampler.joinable()) {
+			m_sampler.join();
+		}
+		if (m_flusher.joinable()) {
+			m_flusher.join();
+			guarded([&] { flush(); });
+		}
+	}
+
+	bool records_frequency() const noexcept
+	{ return bool(m_freq); }
+
+	bool records_context_switches() const noexcept
+	{ return bool(m_sched); }
+
+	/*
+	** Takes one sample of every CPU thread. Called by the sampling thread.
+	*/
+	void sample()
+	{
+		m_util.update();
+		if (m_freq) {
+			m_freq->update();
+		}
+		m_intr.sample(m_intr_counts);
+		if (m_sched) {
+			m_sched->sample(m_sched_counts);
+		}
+
+		auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		for (auto cpu : m_rings.cpus()) {
+			m_rings[cpu].try_push({
+				uint64_t(now),
+				m_intr_counts[cpu],
+				m_sched_counts[cpu],
+				float(m_util.utilization(cpu)),
+				m_freq ? float(m_freq->frequency(cpu)) : 0.f
+			});
+		}
+	}
+
+	/*
+	** Drains the rings and writes both outputs. Called by the flushing
+	** thread.
+	*/
+	void flush()
+	{
+		m_columns.clear();
+		for (auto cpu : m_rings.cpus()) {
+			auto& st = m_state[cpu];
+			auto max = 0.f;
+			auto n = m_rings[cpu].consume([&](const telemetry_sample& s) {
+				m_columns.add(cpu, s);
+				st.latest = s;
+				max = std::max(max, s.utilization);
+			});
+			if (n != 0) {
+				st.max_utilization = max;
+			}
+			st.dropped = m_rings[cpu].dropped();
+		}
+
+		if (m_writer) {
+			m_writer->append(m_columns);
+		}
+		if (!m_prometheus_path.empty()) {
+			write_prometheus();
+		}
+	}
+private:
+	template <class Function>
+	void run(std::chrono::milliseconds interval, Function f)
+	{
+		auto next = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> lock{m_mutex};
+		for (;;) {
+			next += interval;
+			if (m_cv.wait_until(lock, next, [&] { return m_stop; })) {
+				return;
+			}
+			lock.unlock();
+			guarded(f);
+			lock.lock();
+		}
+	}
+
+	/*
+	** Calls `f`, and records any exception that it throws.
+	*/
+	template <class Function>
+	void guarded(const Function& f) noexcept
+	{
+		try {
+			f();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock{m_mutex};
+			++m_errors;
+			m_last_error = std::current_exception();
+		}
+	}
+
+	/*
+	** Writes the textfile to a temporary file and renames it, so that the
+	** collector never reads a partial file.
+	*/
+	void write_prometheus()
+	{
+		auto tmp = m_prometheus_path + ".tmp";
+		{
+			auto os = std::ofstream{tmp};
+			auto metric = [&](const char* name, const char* type,
+				const char* help, auto value)
+			{
+				cc::writeln(os, "# HELP ctop_$ $", name, help);
+				cc::writeln(os, "# TYPE ctop_$ $", name, type);
+				for (auto cpu : m_rings.cpus()) {
+					// The labels are formatted separately, since "${"
+					// would start a format specifier.
+					auto labels = cc::format("{cpu=\"$\",core=\"$\","
+						"package=\"$\",node=\"$\"}", cpu,
+						m_rings.domain(cpu, topology_domain::core),
+						m_rings.domain(cpu, topology_domain::package),
+						m_rings.domain(cpu, topology_domain::numa_node));
+					cc::writeln(os, "ctop_$$ $", name, labels,
+						value(m_state[cpu]));
+				}
+			};
+
+			metric("cpu_utilization", "gauge", "Utilization over the last "
+				"sampling interval.", [](const cpu_state& s) {
+				return s.latest.utilization; });
+			metric("cpu_utilization_max", "gauge", "Maximum utilization "
+				"over any sampling interval since the last flush.",
+				[](const cpu_state& s) { return s.max_utilization; });
+			if (m_freq) {
+				metric("cpu_frequency_mhz", "gauge", "Effective "
+					"frequency over the last sampling interval.",
+					[](const cpu_state& s) {
+					return s.latest.frequency_mhz; });
+			}
+			metric("cpu_interrupts_total", "counter", "Interrupts "
+				"handled.", [](const cpu_state& s) {
+				return s.latest.interrupts; });
+			if (m_sched) {
+				metric("cpu_schedule_calls_total", "counter", "Calls "
+					"to schedule(), an upper bound on context "
+					"switches.", [](const cpu_state& s) {
+					return s.latest.context_switches; });
+			}
+			metric("telemetry_dropped_samples_total", "counter",
+				"Samples dropped because a ring was full.",
+				[](const cpu_state& s) { return s.dropped; });
+
+			os.close();
+			if (!os) {
+				throw std::runtime_error{"failed to write " + tmp};
+			}
+		}
+
+		if (std::rename(tmp.c_str(), m_prometheus_path.c_str()) == -1) {
+			throw std::system_error{errno, std::system_category(),
+				"failed to rename " + tmp};
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,466 @@
+/*
+** File Name: thermal.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Thermal capabilities and throttling. Leaf 6 describes the thermal and power
+** management features of the processor. On Linux, the kernel counts the
+** thermal throttling events of each core and package under
+** `/sys/devices/system/cpu/cpuN/thermal_throttle`, and the hwmon drivers
+** report their temperatures. `thermal_monitor` samples both, and calls back
+** when a core or package starts to throttle, so that load can be moved off
+** it before latency suffers.
+*/
+
+#ifndef Z6D551648_2A4F_455F_906C_CE9F37D0A38E
+#define Z6D551648_2A4F_455F_906C_CE9F37D0A38E
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/cpuid.hpp>
+#include <ctop/cpuid_leaf.hpp>
+#include <ctop/domain_stats.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+/*
+** The features reported by leaf 6. All are false if the leaf is unsupported.
+*/
+struct thermal_features
+{
+	// Each core reports its temperature relative to the throttling point.
+	bool digital_thermal_sensor{};
+	bool turbo_boost{};
+	// The local APIC timer runs in deep C-states.
+	bool always_running_apic_timer{};
+	bool power_limit_notification{};
+	// The package reports its temperature, and can throttle as a whole.
+	bool package_thermal_management{};
+	// Hardware-controlled P-states, i.e. Intel Speed Shift.
+	bool hwp{};
+	bool hwp_notification{};
+	bool hwp_energy_performance_preference{};
+	bool hwp_package_request{};
+	bool hardware_duty_cycling{};
+	bool turbo_boost_max{};
+	// Intel Hardware Feedback Interface, on which Thread Director builds.
+	bool hardware_feedback{};
+	// The APERF and MPERF MSRs, which `frequency_sampler` reads.
+	bool effective_frequency{};
+	bool energy_performance_bias{};
+	// The number of interrupt thresholds of the digital thermal sensor.
+	uint8_t interrupt_thresholds{};
+};
+
+std::ostream& operator<<(std::ostream& os, const thermal_features& f)
+{
+	static constexpr std::pair<bool thermal_features::*, const char*>
+	names[] = {
+		{&thermal_features::digital_thermal_sensor, "DTS"},
+		{&thermal_features::turbo_boost, "turbo"},
+		{&thermal_features::always_running_apic_timer, "ARAT"},
+		{&thermal_features::power_limit_notification, "PLN"},
+		{&thermal_features::package_thermal_management, "PTM"},
+		{&thermal_features::hwp, "HWP"},
+		{&thermal_features::hwp_notification, "HWP notification"},
+		{&thermal_features::hwp_energy_performance_preference, "HWP EPP"},
+		{&thermal_features::hwp_package_request, "HWP package request"},
+		{&thermal_features::hardware_duty_cycling, "HDC"},
+		{&thermal_features::turbo_boost_max, "turbo max"},
+		{&thermal_features::hardware_feedback, "HFI"},
+		{&thermal_features::effective_frequency, "APERF/MPERF"},
+		{&thermal_features::energy_performance_bias, "EPB"},
+	};
+
+	cc::write(os, "thermal features: {");
+	auto first = true;
+	for (const auto& p : names) {
+		if (f.*p.first) {
+			cc::write(os, first ? "$" : ", $", p.second);
+			first = false;
+		}
+	}
+	cc::write(os, "}");
+	return os;
+}
+
+/*
+** Decodes leaf 6 from the output of `cpuid_fn(leaf)`, which must return EAX,
+** EBX, ECX, and EDX like `cpuid`.
+*/
+template <class CpuidFn>
+thermal_features detect_thermal_features(const CpuidFn& cpuid_fn)
+{
+	auto r = thermal_features{};
+	uint32_t eax, ebx, ecx;
+	std::tie(eax, std::ignore, std::ignore, std::ignore) =
+		cpuid_fn(cpuid_leaf::basic_info);
+	if (eax < cpuid_leaf::thermal_power_management_info) {
+		return r;
+	}
+
+	std::tie(eax, ebx, ecx, std::ignore) =
+		cpuid_fn(cpuid_leaf::thermal_power_management_info);
+	auto bit = [](uint32_t reg, unsigned n) { return (reg >> n) & 1; };
+	r.digital_thermal_sensor            = bit(eax, 0);
+	r.turbo_boost                       = bit(eax, 1);
+	r.always_running_apic_timer         = bit(eax, 2);
+	r.power_limit_notification          = bit(eax, 4);
+	r.package_thermal_management        = bit(eax, 6);
+	r.hwp                               = bit(eax, 7);
+	r.hwp_notification                  = bit(eax, 8);
+	r.hwp_energy_performance_preference = bit(eax, 10);
+	r.hwp_package_request               = bit(eax, 11);
+	r.hardware_duty_cycling             = bit(eax, 13);
+	r.turbo_boost_max                   = bit(eax, 14);
+	r.hardware_feedback                 = bit(eax, 19);
+	r.effective_frequency               = bit(ecx, 0);
+	r.energy_performance_bias           = bit(ecx, 3);
+	r.interrupt_thresholds              = ebx & 0xF;
+	return r;
+}
+
+thermal_features detect_thermal_features()
+{
+	return detect_thermal_features([](uint32_t leaf) { return cpuid(leaf); });
+}
+
+enum class throttle_scope : uint8_t
+{
+	core,
+	package,
+};
+
+std::ostream& operator<<(std::ostream& os, const throttle_scope& s)
+{
+	switch (s) {
+	case throttle_scope::core:
+		cc::write(os, "core");
+		return os;
+	case throttle_scope::package:
+		cc::write(os, "package");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** Passed to the callbacks of `thermal_monitor` when a core or package that
+** did not throttle during the previous interval does so during this one.
+*/
+struct throttle_event
+{
+	throttle_scope scope;
+	// The core or package ID, as given by `domain_id`.
+	uint32_t id;
+	// The available CPU threads of the core or package.
+	const cpu_set& cpus;
+	// The number of throttling events during the interval.
+	uint64_t events;
+	// The temperature of the core or package in degrees Celsius, or NaN.
+	double celsius;
+};
+
+/*
+** Samples the throttling counters and temperatures of each core and package
+** between successive calls to `update`. Counters that the kernel does not
+** expose, e.g. in virtual machines, read as zero, and temperatures that no
+** hwmon driver reports read as NaN. Temperatures are read from `coretemp`,
+** which reports each core and package, and from `k10temp`, whose control
+** temperature is used for the package if there is only one.
+*/
+class thermal_monitor final
+{
+public:
+	using callback = std::function<void(const throttle_event&)>;
+private:
+	/*
+	** A core or package. The counters are read from the directory of its
+	** first CPU thread, since the kernel reports the same values for all
+	** of them.
+	*/
+	struct group
+	{
+		uint32_t id;
+		cpu_set cpus;
+		std::string counter_path;
+		std::string sensor_path{};
+		uint64_t count{};
+		uint64_t events{};
+		double celsius{std::numeric_limits<double>::quiet_NaN()};
+		bool throttling{};
+	};
+
+	std::vector<uint32_t> m_cpus;
+	std::vector<group> m_cores{};
+	std::vector<group> m_packages{};
+	// The index of the core and package of each CPU thread.
+	std::vector<uint32_t> m_core_index{};
+	std::vector<uint32_t> m_package_index{};
+	std::vector<callback> m_callbacks{};
+public:
+	explicit thermal_monitor(
+		const system_info& info,
+		const std::string& sysfs_root = default_sysfs_root
+	) : m_cpus{available_cpus(info)}
+	{
+		auto size = m_cpus.empty() ? 0 : m_cpus.back() + 1;
+		m_core_index.resize(size);
+		m_package_index.resize(size);
+
+		auto dir = sysfs_root + "/devices/system/cpu/cpu";
+		add_groups(info, topology_domain::core, m_cores, m_core_index,
+			dir, "core_throttle_count");
+		add_groups(info, topology_domain::package, m_packages,
+			m_package_index, dir, "package_throttle_count");
+		find_sensors(sysfs_root);
+		update_groups(m_cores, throttle_scope::core, false);
+		update_groups(m_packages, throttle_scope::package, false);
+	}
+
+	/*
+	** Registers a function to call from `update` whenever a core or package
+	** starts to throttle.
+	*/
+	void on_throttle(callback f)
+	{ m_callbacks.push_back(std::move(f)); }
+
+	/*
+	** Rereads the counters and temperatures, and calls the callbacks for
+	** each core and package that throttled during the interval since the
+	** previous call, but not during the one before it.
+	*/
+	void update()
+	{
+		update_groups(m_cores, throttle_scope::core, true);
+		update_groups(m_packages, throttle_scope::package, true);
+	}
+
+	const std::vector<uint32_t>& cpus() const noexcept
+	{ return m_cpus; }
+
+	/*
+	** Returns the temperature of the core of the CPU thread in degrees
+	** Celsius, that of its package if the core has no sensor, or NaN.
+	*/
+	double temperature(uint32_t cpu) const noexcept
+	{
+		auto c = m_cores[m_core_index[cpu]].celsius;
+		return c == c ? c : m_packages[m_package_index[cpu]].celsius;
+	}
+
+	/*
+	** Returns true if the core or package of the CPU thread throttled during
+	** the last interval.
+	*/
+	bool throttling(uint32_t cpu) const noexcept
+	{
+		return m_cores[m_core_index[cpu]].throttling ||
+			m_packages[m_package_index[cpu]].throttling;
+	}
+
+	/*
+	** Returns the CPU threads that throttled during the last interval.
+	*/
+	cpu_set throttling_cpus() const
+	{
+		auto r = cpu_set{};
+		for (auto cpu : m_cpus) {
+			if (throttling(cpu)) {
+				r.insert(cpu);
+			}
+		}
+		return r;
+	}
+
+	/*
+	** Returns the total number of throttling events that the kernel has
+	** counted for the core or package of the CPU thread.
+	*/
+	uint64_t throttle_count(uint32_t cpu, throttle_scope s) const noexcept
+	{
+		return s == throttle_scope::core ?
+			m_cores[m_core_index[cpu]].count :
+			m_packages[m_package_index[cpu]].count;
+	}
+private:
+	void add_groups(
+		const system_info& info,
+		topology_domain d,
+		std::vector<group>& groups,
+		std::vector<uint32_t>& index,
+		const std::string& dir,
+		const char* counter
+	)
+	{
+		for (const auto& p : domain_cpus(d, info)) {
+			for (auto cpu : p.second) {
+				index[cpu] = groups.size();
+			}
+			groups.push_back({p.first, p.second, cc::format(
+				"$$/thermal_throttle/$", dir, p.second.front(),
+				counter)});
+		}
+	}
+
+	/*
+	** Assigns the temperature inputs of the hwmon devices to the cores and
+	** packages, by the package and core IDs that the kernel reports for
+	** each CPU thread.
+	*/
+	void find_sensors(const std::string& sysfs_root)
+	{
+		auto dir = sysfs_root + "/devices/system/cpu/cpu";
+		// The cores and packages by kernel package and core ID.
+		auto cores = std::map<std::pair<uint64_t, uint64_t>, uint32_t>{};
+		auto packages = std::map<uint64_t, uint32_t>{};
+		for (auto cpu : m_cpus) {
+			auto p = try_read_integer(cc::format("$$/topology/"
+				"physical_package_id", dir, cpu));
+			auto c = try_read_integer(cc::format("$$/topology/core_id",
+				dir, cpu));
+			if (p) {
+				packages[*p] = m_package_index[cpu];
+				if (c) {
+					cores[{*p, *c}] = m_core_index[cpu];
+				}
+			}
+		}
+
+		auto hwmon = sysfs_root + "/class/hwmon";
+		for (const auto& h : list_directory(hwmon)) {
+			auto path = hwmon + "/" + h;
+			auto name = try_read_file(path + "/name");
+			if (!name) {
+				continue;
+			}
+			auto driver = boost::string_ref{*name};
+			while (!driver.empty() && driver.back() == '\n') {
+				driver.remove_suffix(1);
+			}
+			if (driver == "coretemp") {
+				add_coretemp(path, cores, packages);
+			}
+			else if ((driver == "k10temp" || driver == "zenpower") &&
+				m_packages.size() == 1)
+			{
+				add_k10temp(path);
+			}
+		}
+	}
+
+	/*
+	** Each coretemp device covers one package, which the label of its
+	** package input names, e.g. "Package id 1"; the other inputs are
+	** labeled by the kernel core ID, e.g. "Core 4".
+	*/
+	void add_coretemp(
+		const std::string& path,
+		const std::map<std::pair<uint64_t, uint64_t>, uint32_t>& cores,
+		const std::map<uint64_t, uint32_t>& packages
+	)
+	{
+		auto labels = std::vector<std::pair<std::string, std::string>>{};
+		auto package = boost::optional<uint64_t>{};
+		for (const auto& f : list_directory(path)) {
+			auto s = boost::string_ref{f};
+			if (!s.starts_with("temp") || !s.ends_with("_label")) {
+				continue;
+			}
+			auto label = try_read_file(path + "/" + f);
+			if (!label) {
+				continue;
+			}
+			auto input = path + "/" + f.substr(0, f.size() - 6) +
+				"_input";
+			auto l = boost::string_ref{*label};
+			if (l.starts_with("Package id ")) {
+				l.remove_prefix(11);
+				package = parse_integer(l, path + "/" + f);
+				auto it = packages.find(*package);
+				if (it != packages.end()) {
+					m_packages[it->second].sensor_path = input;
+				}
+			}
+			else if (l.starts_with("Core ")) {
+				labels.emplace_back(l.substr(5).to_string(), input);
+			}
+		}
+
+		if (!package) {
+			return;
+		}
+		for (const auto& p : labels) {
+			auto core = parse_integer(p.first, path);
+			auto it = cores.find({*package, core});
+			if (it != cores.end()) {
+				m_cores[it->second].sensor_path = p.second;
+			}
+		}
+	}
+
+	void add_k10temp(const std::string& path)
+	{
+		for (const auto& f : list_directory(path)) {
+			auto s = boost::string_ref{f};
+			if (!s.starts_with("temp") || !s.ends_with("_label")) {
+				continue;
+			}
+			auto label = try_read_file(path + "/" + f);
+			if (label && boost::string_ref{*label}.starts_with("Tctl")) {
+				m_packages[0].sensor_path = path + "/" +
+					f.substr(0, f.size() - 6) + "_input";
+			}
+		}
+	}
+
+	void update_groups(
+		std::vector<group>& groups,
+		throttle_scope s,
+		bool notify
+	)
+	{
+		for (auto& g : groups) {
+			auto count = try_read_integer(g.counter_path).value_or(0);
+			auto was_throttling = g.throttling;
+			g.events = count > g.count ? count - g.count : 0;
+			g.count = count;
+			g.throttling = notify && g.events != 0;
+
+			if (!g.sensor_path.empty()) {
+				auto t = try_read_integer(g.sensor_path);
+				g.celsius = t ? *t / 1000.0 :
+					std::numeric_limits<double>::quiet_NaN();
+			}
+			if (g.throttling && !was_throttling) {
+				auto e = throttle_event{s, g.id, g.cpus, g.events,
+					g.celsius};
+				for (const auto& f : m_callbacks) {
+					f(e);
+				}
+			}
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,542 @@
+/*
+** File Name: topology_builder.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Builds the `system_info` of a machine that need not exist, from a
+** description of its packages, dies, cores, SMT threads, NUMA nodes, and
+** caches. The x2APIC IDs and OS IDs are assigned the way that the processor
+** and Linux would assign them, so that placement and scheduling code can be
+** tested and benchmarked against hosts with hundreds of CPU threads on any
+** machine. `write_sysfs` writes the matching sysfs tree for the code that
+** reads one.
+*/
+
+#ifndef Z4327A496_45F2_4B9A_9680_B47E8FD07AEC
+#define Z4327A496_45F2_4B9A_9680_B47E8FD07AEC
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/sysfs_error.hpp>
+#include <ctop/system.hpp>
+
+#if PLATFORM_KERNEL == PLATFORM_KERNEL_LINUX
+	#include <sys/stat.h>
+#else
+	#error "Unsupported kernel."
+#endif
+
+namespace ctop {
+
+namespace detail {
+
+/*
+** The number of bits needed for the IDs `0` through `n - 1`.
+*/
+uint8_t id_bits(uint32_t n) noexcept
+{
+	auto r = uint8_t{};
+	while ((uint64_t{1} << r) < n) {
+		++r;
+	}
+	return r;
+}
+
+void make_directory(const std::string& path)
+{
+	if (::mkdir(path.c_str(), 0755) == -1 && errno != EEXIST) {
+		throw sysfs_error{path, std::strerror(errno)};
+	}
+}
+
+template <class T>
+void write_sysfs_file(const std::string& path, const T& value)
+{
+	auto f = std::ofstream{path};
+	f << value << "\n";
+	if (!f) {
+		throw sysfs_error{path, "failed to write file"};
+	}
+}
+
+}
+
+/*
+** Describes a machine in which every package has the same number of dies,
+** every die the same number of cores, and every core the same number of SMT
+** threads. The cores of each package are split evenly among its NUMA nodes,
+** in order, as with sub-NUMA clustering or NPS modes.
+**
+** Each level of the x2APIC ID is as wide as its count requires, with the die
+** ID in the upper bits of the core ID. OS IDs are assigned as by Linux on
+** most servers: the first SMT thread of every core, in order of package, die,
+** and core, followed by the second SMT thread of every core.
+*/
+class topology_builder final
+{
+	cpu_version m_version{};
+	std::vector<cpu_cache> m_caches{};
+	std::vector<std::vector<uint32_t>> m_distances{};
+	cpu_set m_offline{};
+	uint32_t m_packages{1};
+	uint32_t m_dies{1};
+	uint32_t m_cores{1};
+	uint32_t m_threads{1};
+	uint32_t m_nodes{1};
+public:
+	explicit topology_builder() noexcept
+	{
+		m_version.vendor(cpu_vendor::intel).
+			type(cpu_type::original_oem).family(6).model(0).
+			stepping(0).brand("Synthetic CPU");
+	}
+
+	DEFINE_REF_GETTER_SETTER(topology_builder, version, m_version)
+	DEFINE_COPY_GETTER_SETTER(topology_builder, packages, m_packages)
+	DEFINE_COPY_GETTER_SETTER(topology_builder, dies_per_package, m_dies)
+	DEFINE_COPY_GETTER_SETTER(topology_builder, cores_per_die, m_cores)
+	DEFINE_COPY_GETTER_SETTER(topology_builder, threads_per_core, m_threads)
+	DEFINE_COPY_GETTER_SETTER(topology_builder, nodes_per_package, m_nodes)
+
+	const cpu_set& offline_cpus() const noexcept
+	{ return m_offline; }
+
+	/*
+	** Sets the OS IDs of the CPU threads to leave out, as if they had been
+	** taken offline.
+	*/
+	topology_builder& offline_cpus(const cpu_set& s)
+	{
+		m_offline = s;
+		return *this;
+	}
+
+	/*
+	** Adds a cache with 64-byte lines that is shared by the SMT threads of
+	** a core, by the cores of a die (`cluster`), or by the whole package
+	** (`processor`).
+	*/
+	topology_builder& cache(
+		uint8_t level,
+		cache_type type,
+		uint32_t size,
+		uint32_t assoc,
+		cpu_topology_level scope
+	)
+	{
+		if (scope == cpu_topology_level::thread) {
+			throw std::invalid_argument{"caches are shared by at "
+				"least the SMT threads of a core"};
+		}
+		auto c = cpu_cache{};
+		c.is_self_initializing(true).is_fully_associative(false).
+			has_invalidate_propagation(false).is_direct_mapped(false).
+			line_size(64).line_partitions(1).associativity(assoc).
+			sets(size / (64 * assoc)).level(level).type(type).
+			size(size).scope(scope);
+		m_caches.push_back(c);
+		return *this;
+	}
+
+	/*
+	** Sets the distance between each pair of NUMA nodes, as reported in
+	** `/sys/devices/system/node/nodeN/distance`. By default, a node is at
+	** distance 10 from itself, 12 from the other nodes in its package, and
+	** 21 from the rest.
+	*/
+	topology_builder&
+	distances(const std::vector<std::vector<uint32_t>>& d)
+	{
+		m_distances = d;
+		return *this;
+	}
+
+	uint32_t total_numa_nodes() const noexcept
+	{ return m_packages * m_nodes; }
+
+	uint32_t total_cpu_threads() const noexcept
+	{ return m_packages * m_dies * m_cores * m_threads; }
+
+	std::vector<std::vector<uint32_t>> distances() const
+	{
+		if (!m_distances.empty()) {
+			return m_distances;
+		}
+		auto n = total_numa_nodes();
+		auto r = std::vector<std::vector<uint32_t>>(n,
+			std::vector<uint32_t>(n));
+		for (auto i = 0u; i != n; ++i) {
+			for (auto j = 0u; j != n; ++j) {
+				r[i][j] = i == j ? 10 :
+					i / m_nodes == j / m_nodes ? 12 : 21;
+			}
+		}
+		return r;
+	}
+
+	/*
+	** Returns the OS ID of the given CPU thread, where `core` counts the
+	** cores of the package across all of its dies.
+	*/
+	uint32_t os_id(uint32_t package, uint32_t core, uint32_t smt)
+	const noexcept
+	{
+		auto cores = m_dies * m_cores;
+		return smt * m_packages * cores + package * cores + core;
+	}
+
+	uint32_t x2apic_id(uint32_t package, uint32_t core, uint32_t smt)
+	const noexcept
+	{
+		auto smt_bits = detail::id_bits(m_threads);
+		auto core_bits = detail::id_bits(m_cores);
+		auto die_bits = detail::id_bits(m_dies);
+		auto die = core / m_cores;
+		return (package << (die_bits + core_bits) |
+			die << core_bits | core % m_cores) << smt_bits | smt;
+	}
+
+	/*
+	** Returns the NUMA node of the given core, numbered as by `os_id`.
+	*/
+	uint32_t numa_node(uint32_t package, uint32_t core) const noexcept
+	{ return package * m_nodes + core / (m_dies * m_cores / m_nodes); }
+
+	/*
+	** Returns a `system_info` equivalent to what `system_query` would
+	** return on the described machine, with the CPU threads of each node
+	** in increasing order of x2APIC ID. Nodes whose CPU threads are all
+	** offline are left out. Throws `std::invalid_argument` if the
+	** description is inconsistent.
+	*/
+	system_info build() const
+	{
+		validate();
+		auto info = system_info{};
+		auto& cpu = info.cpu_info();
+		auto smt_bits = detail::id_bits(m_threads);
+		auto core_bits = uint8_t(detail::id_bits(m_dies) +
+			detail::id_bits(m_cores));
+		cpu.version() = m_version;
+		cpu.smt_id_bits(smt_bits).core_id_bits(core_bits).
+			package_id_bits(32 - smt_bits - core_bits).
+			total_threads(m_dies * m_cores * m_threads).
+			total_cores(m_dies * m_cores).
+			thread_ids_per_package(uint32_t{1} <<
+				(smt_bits + core_bits)).
+			core_ids_per_package(uint32_t{1} << core_bits);
+
+		for (auto c : m_caches) {
+			switch (c.scope()) {
+			case cpu_topology_level::core:
+				c.sharing_id_bits(smt_bits);
+				break;
+			case cpu_topology_level::cluster:
+				c.sharing_id_bits(smt_bits +
+					detail::id_bits(m_cores));
+				break;
+			default:
+				c.sharing_id_bits(smt_bits + core_bits);
+				break;
+			}
+			cpu.add(c);
+		}
+
+		// Threads are added node by node, since each node refers to a
+		// contiguous range of them.
+		auto counts = std::vector<uint32_t>(total_numa_nodes());
+		auto cores = m_dies * m_cores;
+		for (auto p = 0u; p != m_packages; ++p) {
+			for (auto c = 0u; c != cores; ++c) {
+				for (auto t = 0u; t != m_threads; ++t) {
+					if (m_offline.contains(os_id(p, c, t))) {
+						continue;
+					}
+					auto i = cpu_thread_info{};
+					i.os_id(os_id(p, c, t)).
+						x2apic_id(x2apic_id(p, c, t));
+					info.add(i);
+					++counts[numa_node(p, c)];
+				}
+			}
+		}
+
+		info.total_numa_nodes(total_numa_nodes());
+		auto first = info.available_cpu_threads().begin();
+		for (auto i = 0u; i != counts.size(); ++i) {
+			if (counts[i] == 0) {
+				continue;
+			}
+			auto n = numa_node_info{};
+			n.id(i);
+			n.cpu_info().thread_data(&*first).
+				available_threads(counts[i]);
+			auto unique = count_unique_cores(
+				n.cpu_info().available_threads(), cpu);
+			n.cpu_info().uses_smt(unique < counts[i]);
+			info.add(n);
+			first += counts[i];
+		}
+		return info;
+	}
+
+	/*
+	** Writes the parts of sysfs that describe the CPU threads and NUMA nodes
+	** under `root`, which must exist: the online CPU threads, and for each
+	** one, its package, die, core, and siblings; and for each node, its CPU
+	** threads and distances. Offline CPU threads have `online` set to zero
+	** and no topology directory, as on Linux.
+	*/
+	void write_sysfs(const std::string& root) const
+	{
+		validate();
+		auto cpu_dir = root + "/devices/system/cpu";
+		auto node_dir = root + "/devices/system/node";
+		for (const auto& d : {root + "/devices", root + "/devices/system",
+			cpu_dir, node_dir})
+		{
+			detail::make_directory(d);
+		}
+
+		auto cores = m_dies * m_cores;
+		auto all = cpu_set{};
+		all.insert(0, total_cpu_threads() - 1);
+		auto online = all - m_offline;
+		detail::write_sysfs_file(cpu_dir + "/possible", all);
+		detail::write_sysfs_file(cpu_dir + "/present", all);
+		detail::write_sysfs_file(cpu_dir + "/online", online);
+		detail::write_sysfs_file(cpu_dir + "/offline", all & m_offline);
+
+		auto nodes = std::vector<cpu_set>(total_numa_nodes());
+		for (auto p = 0u; p != m_packages; ++p) {
+			auto package = cpu_set{};
+			auto dies = std::vector<cpu_set>(m_dies);
+			for (auto c = 0u; c != cores; ++c) {
+				for (auto t = 0u; t != m_threads; ++t) {
+					auto id = os_id(p, c, t);
+					if (online.contains(id)) {
+						package.insert(id);
+						dies[c / m_cores].insert(id);
+						nodes[numa_node(p, c)].insert(id);
+					}
+				}
+			}
+
+			for (auto c = 0u; c != cores; ++c) {
+				auto siblings = cpu_set{};
+				for (auto t = 0u; t != m_threads; ++t) {
+					if (online.contains(os_id(p, c, t))) {
+						siblings.insert(os_id(p, c, t));
+					}
+				}
+				for (auto t = 0u; t != m_threads; ++t) {
+					auto dir = cc::format("$/cpu$", cpu_dir,
+						os_id(p, c, t));
+					detail::make_directory(dir);
+					if (!online.contains(os_id(p, c, t))) {
+						detail::write_sysfs_file(dir +
+							"/online", 0);
+						continue;
+					}
+					detail::write_sysfs_file(dir + "/online", 1);
+					write_topology(dir + "/topology", p,
+						c / m_cores, c, siblings,
+						dies[c / m_cores], package);
+				}
+			}
+		}
+
+		auto d = distances();
+		auto has_cpus = cpu_set{};
+		for (auto i = 0u; i != nodes.size(); ++i) {
+			auto dir = cc::format("$/node$", node_dir, i);
+			detail::make_directory(dir);
+			detail::write_sysfs_file(dir + "/cpulist", nodes[i]);
+			auto s = std::string{};
+			for (auto x : d[i]) {
+				s += s.empty() ? "" : " ";
+				s += std::to_string(x);
+			}
+			detail::write_sysfs_file(dir + "/distance", s);
+			if (!nodes[i].empty()) {
+				has_cpus.insert(i);
+			}
+		}
+		auto all_nodes = cpu_set{};
+		all_nodes.insert(0, nodes.size() - 1);
+		detail::write_sysfs_file(node_dir + "/possible", all_nodes);
+		detail::write_sysfs_file(node_dir + "/online", all_nodes);
+		detail::write_sysfs_file(node_dir + "/has_cpu", has_cpus);
+	}
+private:
+	void validate() const
+	{
+		if (m_packages == 0 || m_dies == 0 || m_cores == 0 ||
+			m_threads == 0 || m_nodes == 0)
+		{
+			throw std::invalid_argument{"every count must be positive"};
+		}
+		// `system_query` rejects wider SMT, so this keeps the result
+		// within what it could return.
+		if (m_threads > 2) {
+			throw std::invalid_argument{"more than two SMT threads "
+				"per core"};
+		}
+		if ((m_dies * m_cores) % m_nodes != 0) {
+			throw std::invalid_argument{"cores of a package cannot be "
+				"split evenly among its NUMA nodes"};
+		}
+		if (detail::id_bits(m_threads) + detail::id_bits(m_dies) +
+			detail::id_bits(m_cores) + detail::id_bits(m_packages) > 32)
+		{
+			throw std::invalid_argument{"x2APIC ID wider than 32 bits"};
+		}
+		if (!m_offline.empty() && m_offline.back() >= total_cpu_threads()) {
+			throw std::invalid_argument{"offline CPU thread does not "
+				"exist"};
+		}
+
+		auto n = total_numa_nodes();
+		if (m_distances.empty()) {
+			return;
+		}
+		if (m_distances.size() != n) {
+			throw std::invalid_argument{"distance matrix does not "
+				"match node count"};
+		}
+		for (auto i = 0u; i != n; ++i) {
+			if (m_distances[i].size() != n) {
+				throw std::invalid_argument{"distance matrix does "
+					"not match node count"};
+			}
+		}
+	}
+
+	void write_topology(
+		const std::string& dir,
+		uint32_t package,
+		uint32_t die,
+		uint32_t core,
+		const cpu_set& siblings,
+		const cpu_set& die_cpus,
+		const cpu_set& package_cpus
+	) const
+	{
+		detail::make_directory(dir);
+		detail::write_sysfs_file(dir + "/physical_package_id", package);
+		detail::write_sysfs_file(dir + "/die_id", die);
+		// Linux numbers cores within each package.
+		detail::write_sysfs_file(dir + "/core_id", core);
+		detail::write_sysfs_file(dir + "/thread_siblings_list", siblings);
+		detail::write_sysfs_file(dir + "/core_cpus_list", siblings);
+		detail::write_sysfs_file(dir + "/die_cpus_list", die_cpus);
+		detail::write_sysfs_file(dir + "/core_siblings_list",
+			package_cpus);
+		detail::write_sysfs_file(dir + "/package_cpus_list",
+			package_cpus);
+	}
+};
+
+enum class server_preset : uint8_t
+{
+	// Two Intel Xeon Platinum 8480+ (Sapphire Rapids): four dies of 14
+	// cores each per package, with a 105 MiB L3 cache per package.
+	xeon_platinum_8480,
+	// Two AMD EPYC 9654 (Genoa): twelve CCDs of eight cores each per
+	// package, with a 32 MiB L3 cache per CCD.
+	epyc_9654,
+	// Two AMD EPYC 9754 (Bergamo): 32 CCXs of four cores each per package,
+	// with a 16 MiB L3 cache per CCX.
+	epyc_9754,
+};
+
+std::ostream& operator<<(std::ostream& os, const server_preset& p)
+{
+	switch (p) {
+	case server_preset::xeon_platinum_8480:
+		cc::write(os, "Xeon Platinum 8480+");
+		return os;
+	case server_preset::epyc_9654:
+		cc::write(os, "EPYC 9654");
+		return os;
+	case server_preset::epyc_9754:
+		cc::write(os, "EPYC 9754");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** Returns a builder for a dual-socket server with SMT enabled and one NUMA
+** node per package. Sub-NUMA clustering or NPS modes can be set on the result
+** with `nodes_per_package`, and further sockets with `packages`.
+*/
+topology_builder server_topology(server_preset p)
+{
+	auto b = topology_builder{};
+	b.packages(2).threads_per_core(2);
+	auto& v = b.version();
+
+	switch (p) {
+	case server_preset::xeon_platinum_8480:
+		v.vendor(cpu_vendor::intel).family(6).model(143).stepping(8).
+			base_frequency(2000).max_frequency(3800).
+			brand("Intel(R) Xeon(R) Platinum 8480+");
+		b.dies_per_package(4).cores_per_die(14).
+			cache(1, cache_type::data, 48 << 10, 12,
+				cpu_topology_level::core).
+			cache(1, cache_type::instruction, 32 << 10, 8,
+				cpu_topology_level::core).
+			cache(2, cache_type::unified, 2 << 20, 16,
+				cpu_topology_level::core).
+			cache(3, cache_type::unified, 105 << 20, 15,
+				cpu_topology_level::processor);
+		return b;
+	case server_preset::epyc_9654:
+		v.vendor(cpu_vendor::amd).family(25).model(17).stepping(1).
+			base_frequency(2400).max_frequency(3700).
+			brand("AMD EPYC 9654 96-Core Processor");
+		b.dies_per_package(12).cores_per_die(8).
+			cache(1, cache_type::data, 32 << 10, 8,
+				cpu_topology_level::core).
+			cache(1, cache_type::instruction, 32 << 10, 8,
+				cpu_topology_level::core).
+			cache(2, cache_type::unified, 1 << 20, 8,
+				cpu_topology_level::core).
+			cache(3, cache_type::unified, 32 << 20, 16,
+				cpu_topology_level::cluster);
+		return b;
+	case server_preset::epyc_9754:
+		v.vendor(cpu_vendor::amd).family(25).model(160).stepping(2).
+			base_frequency(2250).max_frequency(3100).
+			brand("AMD EPYC 9754 128-Core Processor");
+		b.dies_per_package(32).cores_per_die(4).
+			cache(1, cache_type::data, 32 << 10, 8,
+				cpu_topology_level::core).
+			cache(1, cache_type::instruction, 32 << 10, 8,
+				cpu_topology_level::core).
+			cache(2, cache_type::unified, 1 << 20, 8,
+				cpu_topology_level::core).
+			cache(3, cache_type::unified, 16 << 20, 16,
+				cpu_topology_level::cluster);
+		return b;
+	default:
+		throw std::invalid_argument{"unknown server preset"};
+	}
+}
+
+}
+
+#endif
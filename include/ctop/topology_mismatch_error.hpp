@@ -0,0 +1,43 @@
+/*
+** File Name: topology_mismatch_error.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#ifndef Z882849C8_1D23_444B_A93E_74F48492FED2
+#define Z882849C8_1D23_444B_A93E_74F48492FED2
+
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace ctop {
+
+/*
+** Thrown when a binary specialized for one machine is run on another.
+*/
+class topology_mismatch_error final : public std::exception
+{
+	std::vector<std::string> m_mismatches{};
+	std::string m_msg{"Topology mismatch: "};
+public:
+	explicit topology_mismatch_error(std::vector<std::string> mismatches)
+	noexcept : m_mismatches{std::move(mismatches)}
+	{
+		for (auto i = size_t{}; i != m_mismatches.size(); ++i) {
+			m_msg += m_mismatches[i];
+			m_msg += i + 1 == m_mismatches.size() ? "." : "; ";
+		}
+	}
+
+	const char* what() const noexcept override
+	{ return m_msg.c_str(); }
+
+	const std::vector<std::string>& mismatches() const noexcept
+	{ return m_mismatches; }
+};
+
+}
+
+#endif
@@ -0,0 +1,284 @@
+/*
+** File Name: virtualization.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Inside a virtual machine, the layout in CPUID is whatever the hypervisor
+** chose to report: vCPUs that claim to be SMT siblings may run on different
+** cores, sockets may be folded together, and the physical CPU thread under a
+** vCPU can change at any time. This header rates how far each part of the
+** layout can be trusted, and measures steal time, i.e. the time during which
+** a vCPU was runnable but the hypervisor ran something else, so that
+** placement can avoid the vCPUs whose physical CPU threads are overcommitted.
+*/
+
+#ifndef ZA5269FC6_38CD_4439_8115_1D907EADC307
+#define ZA5269FC6_38CD_4439_8115_1D907EADC307
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <ccbase/format.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/cpu_stat.hpp>
+#include <ctop/hypervisor.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+enum class topology_trust : uint8_t
+{
+	// Read from the processor, on bare metal.
+	hardware,
+	// Reported by a hypervisor, and consistent with what the kernel sees,
+	// but only as good as the pinning of the vCPUs.
+	hypervisor,
+	// Contradicted by the kernel or by another part of the layout.
+	inconsistent,
+};
+
+std::ostream& operator<<(std::ostream& os, const topology_trust& t)
+{
+	switch (t) {
+	case topology_trust::hardware:
+		cc::write(os, "hardware");
+		return os;
+	case topology_trust::hypervisor:
+		cc::write(os, "hypervisor");
+		return os;
+	case topology_trust::inconsistent:
+		cc::write(os, "inconsistent");
+		return os;
+	default:
+		cc::write(os, "unknown");
+		return os;
+	}
+}
+
+/*
+** How far to trust each part of the layout in a `system_info`.
+*/
+struct topology_trust_info
+{
+	// Which CPU threads are SMT siblings of one another.
+	topology_trust smt;
+	// Which CPU threads are in the same package.
+	topology_trust packages;
+	// Which CPU threads share each cache.
+	topology_trust caches;
+	// Which CPU threads belong to each NUMA node.
+	topology_trust numa_nodes;
+};
+
+std::ostream& operator<<(std::ostream& os, const topology_trust_info& t)
+{
+	cc::write(os, "topology trust: {SMT: $, packages: $, caches: $, NUMA "
+		"nodes: $}", t.smt, t.packages, t.caches, t.numa_nodes);
+	return os;
+}
+
+namespace detail {
+
+/*
+** Returns false if the kernel and `info` group the available CPU threads
+** differently, where `kernel` maps each OS ID to the group that the kernel
+** reports, and `ours` maps it to the group given by `info`. Groups are
+** compared by their members, so their IDs need not agree.
+*/
+template <class KernelFn, class OurFn>
+bool same_partition(const system_info& info, const KernelFn& kernel,
+	const OurFn& ours)
+{
+	auto a = std::map<uint64_t, uint64_t>{};
+	auto b = std::map<uint64_t, uint64_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		auto k = kernel(t.os_id());
+		if (!k) {
+			// Without the kernel's view there is nothing to compare.
+			return true;
+		}
+		auto o = ours(t);
+		if (a.emplace(*k, o).first->second != o ||
+			b.emplace(o, *k).first->second != *k)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+/*
+** Rates each part of the layout of `info`. The base level is `hardware` on
+** bare metal and `hypervisor` otherwise. A part is `inconsistent` if the
+** kernel, whose view is read from the sysfs tree at `sysfs_root`, groups the
+** CPU threads differently, or if the layout contradicts itself, e.g. by
+** claiming SMT when no two available CPU threads share a core.
+*/
+topology_trust_info assess_topology(
+	const system_info& info,
+	const hypervisor_info& hv,
+	const std::string& sysfs_root = default_sysfs_root
+)
+{
+	const auto& cpu = info.cpu_info();
+	auto base = hv.present() ? topology_trust::hypervisor :
+		topology_trust::hardware;
+	auto r = topology_trust_info{base, base, base, base};
+	auto dir = sysfs_root + "/devices/system/cpu/cpu";
+
+	auto cores = domain_cpus(topology_domain::core, info);
+	auto shared_core = std::any_of(cores.begin(), cores.end(),
+		[](const auto& p) { return p.second.count() > 1; });
+	auto siblings = [&](uint32_t id) -> boost::optional<uint64_t> {
+		auto path = cc::format("$$/topology/thread_siblings_list", dir,
+			id);
+		auto s = try_read_file(path);
+		if (!s) {
+			return boost::none;
+		}
+		// Key each group by its smallest member.
+		return parse_cpu_set(*s, path).front();
+	};
+	auto core = [&](const cpu_thread_info& t) { return core_id(t, cpu); };
+	if ((cpu.threads_per_core() > 1 && !shared_core) ||
+		!detail::same_partition(info, siblings, core))
+	{
+		r.smt = topology_trust::inconsistent;
+	}
+
+	auto package = [&](uint32_t id) {
+		return try_read_integer(cc::format("$$/topology/"
+			"physical_package_id", dir, id));
+	};
+	auto our_package = [&](const cpu_thread_info& t) {
+		return package_id(t, cpu);
+	};
+	if (!detail::same_partition(info, package, our_package)) {
+		r.packages = topology_trust::inconsistent;
+	}
+
+	// A cache cannot be shared by CPU threads in different packages.
+	auto package_bits = cpu.smt_id_bits() + cpu.core_id_bits();
+	for (const auto& c : cpu.caches()) {
+		if (c.sharing_id_bits() > package_bits) {
+			r.caches = topology_trust::inconsistent;
+		}
+	}
+	return r;
+}
+
+/*
+** Tracks the fraction of time stolen from each available CPU thread between
+** successive calls to `update`. All storage is allocated by the constructor.
+*/
+class steal_monitor final
+{
+	std::vector<uint32_t> m_cpus;
+	cpu_stat_interval m_stat;
+	std::vector<double> m_steal;
+public:
+	explicit steal_monitor(
+		const system_info& info,
+		const std::string& root = default_procfs_root
+	) : m_cpus{available_cpus(info)}, m_stat{slots(), root},
+	m_steal(slots()) {}
+
+	/*
+	** Takes a new sample, and recomputes the steal time over the interval
+	** since the previous one. A vCPU that is missing from the sample, e.g.
+	** because it went offline, has no steal time over the interval.
+	*/
+	void update()
+	{
+		m_stat.update();
+		for (auto cpu : m_cpus) {
+			auto d = m_stat.delta(cpu);
+			auto total = d.total();
+			m_steal[cpu] = total == 0 ? 0 :
+				double(d[cpu_time::steal]) / total;
+		}
+	}
+
+	const std::vector<uint32_t>& cpus() const noexcept
+	{ return m_cpus; }
+
+	/*
+	** The fraction of the last interval during which the CPU thread was
+	** runnable but not running.
+	*/
+	double steal(uint32_t cpu) const noexcept
+	{ return m_steal[cpu]; }
+
+	/*
+	** Returns the CPU threads that lost more than `max_steal` of the last
+	** interval.
+	*/
+	cpu_set overcommitted(double max_steal) const
+	{
+		auto r = cpu_set{};
+		for (auto cpu : m_cpus) {
+			if (m_steal[cpu] > max_steal) {
+				r.insert(cpu);
+			}
+		}
+		return r;
+	}
+private:
+	size_t slots() const noexcept
+	{ return m_cpus.empty() ? 0 : m_cpus.back() + 1; }
+};
+
+/*
+** Like `place_threads`, but adjusted for a virtual machine. The CPU threads
+** that lost at most `max_steal` of the last interval of `steal` come first, in
+** the order of the policy, followed by the rest in increasing order of steal
+** time. If the SMT siblings in the layout are `inconsistent`, the policies
+** that rely on them fall back to the ones that do not: `one_per_core` to
+** `scatter`, and `smt_pairs` to `compact`.
+*/
+std::vector<uint32_t> place_virtual_threads(
+	const system_info& info,
+	const topology_trust_info& trust,
+	const steal_monitor& steal,
+	placement_policy p,
+	size_t count,
+	double max_steal = 0.05
+)
+{
+	if (trust.smt == topology_trust::inconsistent) {
+		if (p == placement_policy::one_per_core) {
+			p = placement_policy::scatter;
+		}
+		else if (p == placement_policy::smt_pairs) {
+			p = placement_policy::compact;
+		}
+	}
+
+	auto r = place_threads(info, p, placement_capacity(info, p));
+	if (count > r.size()) {
+		throw std::invalid_argument{"more threads requested than CPU "
+			"threads available"};
+	}
+	auto over = std::stable_partition(r.begin(), r.end(),
+		[&](uint32_t cpu) { return steal.steal(cpu) <= max_steal; });
+	std::stable_sort(over, r.end(), [&](uint32_t a, uint32_t b) {
+		return steal.steal(a) < steal.steal(b);
+	});
+	r.resize(count);
+	return r;
+}
+
+}
+
+#endif
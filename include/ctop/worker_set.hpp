@@ -0,0 +1,185 @@
+/*
+** File Name: worker_set.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** A persistent set of worker threads, each pinned to one CPU thread and
+** ordered by NUMA node, that runs one job at a time across all of them. Idle
+** workers wait on a `wait_word`, so that a job that follows closely on the
+** previous one is picked up without a futex wakeup, while workers that stay
+** idle stop taking cycles from the rest of the system.
+*/
+
+#ifndef ZFF607FE4_19D4_411D_B4BA_4DB9BD02499B
+#define ZFF607FE4_19D4_411D_B4BA_4DB9BD02499B
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/adaptive_wait.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/numa_error.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/system.hpp>
+
+namespace ctop {
+
+class worker_set final
+{
+	std::vector<uint32_t> m_cpus{};
+	std::vector<uint32_t> m_nodes{};
+	std::vector<std::thread> m_threads{};
+	wait_policy m_policy;
+
+	// The generation of the current job, and of the last one to finish.
+	wait_word m_start{0};
+	wait_word m_done{0};
+	alignas(64) std::atomic<uint32_t> m_remaining{0};
+	std::atomic<bool> m_failed{false};
+	std::exception_ptr m_error{};
+	void (*m_invoke)(const void*, size_t){};
+	const void* m_job{};
+	bool m_stop{};
+public:
+	/*
+	** Starts one worker on each core available to the process.
+	*/
+	explicit worker_set(const system_info& info)
+	: worker_set{info, place_threads(info, placement_policy::one_per_core,
+		placement_capacity(info, placement_policy::one_per_core))} {}
+
+	/*
+	** Starts one worker on each of the given CPU threads, which must be
+	** available. The workers are reordered by NUMA node, in the order of
+	** the nodes in `info`, and keep their relative order within each node.
+	*/
+	explicit worker_set(
+		const system_info& info,
+		const std::vector<uint32_t>& cpus
+	) : m_policy{calibrate_wait(info, detect_wait_features())}
+	{
+		if (cpus.empty()) {
+			throw std::invalid_argument{"worker set has no CPU "
+				"threads"};
+		}
+		for (const auto& n : info.available_numa_nodes()) {
+			auto members = n.cpu_info().cpus();
+			for (auto cpu : cpus) {
+				if (members.contains(cpu)) {
+					m_cpus.push_back(cpu);
+					m_nodes.push_back(n.id());
+				}
+			}
+		}
+		if (m_cpus.size() != cpus.size()) {
+			throw numa_error{"worker CPU thread does not belong to an "
+				"available NUMA node"};
+		}
+
+		// Pinning is the first job, so that its errors reach the caller.
+		try {
+			for (auto i = size_t{}; i != m_cpus.size(); ++i) {
+				m_threads.emplace_back([this, i] { work(i); });
+			}
+			run([this](size_t i) { pin_current_thread(m_cpus[i]); });
+		}
+		catch (...) {
+			stop();
+			throw;
+		}
+	}
+
+	~worker_set()
+	{ stop(); }
+
+	worker_set(const worker_set&) = delete;
+	worker_set& operator=(const worker_set&) = delete;
+
+	size_t size() const noexcept
+	{ return m_cpus.size(); }
+
+	/*
+	** The OS ID of the CPU thread of each worker.
+	*/
+	const std::vector<uint32_t>& cpus() const noexcept
+	{ return m_cpus; }
+
+	/*
+	** The NUMA node of each worker, in nondecreasing order of position in
+	** `system_info`.
+	*/
+	const std::vector<uint32_t>& nodes() const noexcept
+	{ return m_nodes; }
+
+	const wait_policy& policy() const noexcept
+	{ return m_policy; }
+
+	/*
+	** Calls `f(i)` on worker `i` for every worker, and returns once all
+	** calls have returned. If any call throws, one of the exceptions is
+	** rethrown here. Jobs must not call `run` on the same set.
+	*/
+	template <class Function>
+	void run(const Function& f)
+	{
+		m_job = &f;
+		m_invoke = [](const void* job, size_t i) {
+			(*static_cast<const Function*>(job))(i);
+		};
+		m_error = nullptr;
+		m_failed.store(false, std::memory_order_relaxed);
+		m_remaining.store(m_cpus.size(), std::memory_order_relaxed);
+
+		auto g = m_start.load(std::memory_order_relaxed) + 1;
+		m_start.notify(g);
+		m_done.wait(g - 1, m_policy);
+		if (m_error) {
+			std::rethrow_exception(m_error);
+		}
+	}
+private:
+	void work(size_t i) noexcept
+	{
+		auto seen = uint32_t{};
+		for (;;) {
+			m_start.wait(seen, m_policy);
+			seen = m_start.load();
+			if (m_stop) {
+				return;
+			}
+
+			try {
+				m_invoke(m_job, i);
+			}
+			catch (...) {
+				if (!m_failed.exchange(true)) {
+					m_error = std::current_exception();
+				}
+			}
+			if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				m_done.notify(seen);
+			}
+		}
+	}
+
+	void stop() noexcept
+	{
+		m_stop = true;
+		m_start.notify(m_start.load(std::memory_order_relaxed) + 1);
+		for (auto& t : m_threads) {
+			t.join();
+		}
+		m_threads.clear();
+	}
+};
+
+}
+
+#endif
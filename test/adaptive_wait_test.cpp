@@ -0,0 +1,99 @@
+/*
+** File Name: adaptive_wait_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <tuple>
+
+#include <ccbase/format.hpp>
+#include <ctop/adaptive_wait.hpp>
+#include <ctop/system_query.hpp>
+
+using ctop::wait_phase;
+using regs = std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>;
+
+static constexpr auto round_trips = 10000u;
+
+int main()
+{
+	auto leaves = std::map<uint32_t, regs>{
+		{0x0, regs{0x20, 0, 0, 0}},
+		{0x1, regs{0x806EC, 0, 1 << 3, 0}},
+		{0x5, regs{64, 64, 3, 0}},
+		{0x7, regs{0, 0, 1 << 5, 0}},
+	};
+	auto detect = [&] {
+		return ctop::detect_wait_features([&](uint32_t leaf) {
+			return leaves.at(leaf);
+		});
+	};
+	auto f = detect();
+	assert(f.monitor_mwait && f.waitpkg);
+	assert(f.min_monitor_line == 64 && f.max_monitor_line == 64);
+	leaves[0x1] = regs{0x806EC, 0, 0, 0};
+	leaves[0x7] = regs{};
+	f = detect();
+	assert(!f.monitor_mwait && !f.waitpkg && f.max_monitor_line == 0);
+
+	auto info = *ctop::system_query();
+	auto live = ctop::detect_wait_features();
+	auto p = ctop::calibrate_wait(info, live);
+	cc::println("$; $.", live, p);
+	assert(p.pause_latency() > 0 && p.spin_iterations() > 0);
+	assert(p.uses_monitor() == live.waitpkg);
+
+	// A value that has already changed is seen while spinning.
+	ctop::wait_word w{1};
+	assert(w.wait(0, p) == wait_phase::spin);
+
+	// Without spinning or WAITPKG, the waiter parks until notified.
+	auto park = ctop::wait_policy{};
+	auto t = std::thread{[&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		w.notify(2);
+	}};
+	assert(w.wait(1, park) == wait_phase::park);
+	assert(w.load() == 2);
+	t.join();
+
+	if (live.waitpkg) {
+		auto monitor = ctop::wait_policy{p};
+		monitor.spin_iterations(0).monitor_cycles(uint64_t(1e9 *
+			p.tsc_per_ns()));
+		t = std::thread{[&] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			w.notify(3);
+		}};
+		assert(w.wait(2, monitor) == wait_phase::monitor);
+		t.join();
+	}
+
+	// Two threads hand a token back and forth.
+	ctop::wait_word ping{0};
+	ctop::wait_word pong{0};
+	auto phases = std::map<wait_phase, uint32_t>{};
+	auto start = std::chrono::steady_clock::now();
+	t = std::thread{[&] {
+		for (auto i = 1u; i <= round_trips; ++i) {
+			ping.wait(i - 1, p);
+			pong.notify(i);
+		}
+	}};
+	for (auto i = 1u; i <= round_trips; ++i) {
+		ping.notify(i);
+		++phases[pong.wait(i - 1, p)];
+		assert(pong.load() == i);
+	}
+	t.join();
+	auto ns = std::chrono::duration<double, std::nano>(
+		std::chrono::steady_clock::now() - start).count();
+	cc::println("Round trip: $ ns; spin: $, monitor: $, park: $.",
+		ns / round_trips, phases[wait_phase::spin],
+		phases[wait_phase::monitor], phases[wait_phase::park]);
+}
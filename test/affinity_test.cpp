@@ -0,0 +1,43 @@
+/*
+** File Name: affinity_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/system_query.hpp>
+
+static std::vector<uint32_t> current_affinity()
+{
+	auto set = ctop::detail::dynamic_cpu_set{};
+	set.get();
+	return set.members().to_vector();
+}
+
+int main()
+{
+	// Querying the system must not move the calling thread.
+	auto before = current_affinity();
+	auto info = *ctop::system_query();
+	assert(current_affinity() == before);
+
+	const auto& node = info.available_numa_nodes()[0];
+	auto cpu = node.cpu_info().available_threads()[0].os_id();
+	{
+		ctop::scoped_binding b{cpu, ctop::memory_policy::bind,
+			{node.id()}};
+		assert((current_affinity() == std::vector<uint32_t>{cpu}));
+		assert(::sched_getcpu() == int(cpu));
+	}
+	assert(current_affinity() == before);
+
+	auto mode = 0;
+	::get_mempolicy(&mode, nullptr, 0, nullptr, 0);
+	assert(mode == MPOL_DEFAULT);
+	cc::println("Bound to CPU $ and node $, then restored $ CPUs.", cpu,
+		node.id(), before.size());
+}
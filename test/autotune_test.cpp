@@ -0,0 +1,95 @@
+/*
+** File Name: autotune_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/autotune.hpp>
+#include <ctop/system_query.hpp>
+
+#include "fake_tree.hpp"
+
+int main()
+{
+	auto info = *ctop::system_query();
+	auto n = size_t(info.available_cpu_threads().size());
+
+	// Every policy places distinct CPU threads.
+	for (auto p : {ctop::placement_policy::compact,
+		ctop::placement_policy::scatter,
+		ctop::placement_policy::smt_pairs})
+	{
+		auto cpus = ctop::place_threads(info, p, n);
+		assert(std::set<uint32_t>(cpus.begin(), cpus.end()).size() == n);
+	}
+
+	// A kernel that streams over a private buffer.
+	auto opts = ctop::placement_tuning_options{};
+	opts.repetitions = 3;
+	opts.duration = std::chrono::milliseconds{20};
+	auto bufs = std::vector<std::vector<uint64_t>>(n,
+		std::vector<uint64_t>(1 << 14));
+	auto t = ctop::tune_placement(info, [&](size_t i, size_t) {
+		auto& b = bufs[i];
+		for (auto& x : b) {
+			++x;
+		}
+		return uint64_t{1};
+	}, opts);
+
+	for (auto p : opts.policies) {
+		for (const auto& s : t.scaling_curve(p)) {
+			cc::println("$", s);
+		}
+	}
+	const auto& best = t.best();
+	cc::println("Best: $.", best);
+	assert(best.mean > 0);
+
+	fake_tree dir{"autotune"};
+	auto path = dir.path("/cache/placements");
+	assert(!ctop::load_tuned_placement(info, "stream", path));
+
+	ctop::store_tuned_placement(info, "other", {ctop::placement_policy::
+		compact, 1, 1}, path);
+	ctop::store_tuned_placement(info, "stream", {best.policy, best.threads,
+		best.mean}, path);
+	ctop::store_tuned_placement(info, "stream", {best.policy, best.threads,
+		best.mean}, path);
+
+	auto l = ctop::load_tuned_placement(info, "stream", path);
+	assert(l && l->policy == best.policy && l->threads == best.threads);
+	assert(l->cpus(info) == best.cpus);
+	assert(ctop::load_tuned_placement(info, "other", path)->threads == 1);
+
+	// Concurrent stores of different kernels all survive.
+	auto writers = std::vector<std::thread>{};
+	for (auto i = 0u; i != 8; ++i) {
+		writers.emplace_back([&, i] {
+			for (auto j = 0u; j != 10; ++j) {
+				ctop::store_tuned_placement(info, cc::format(
+					"kernel$", i), {ctop::placement_policy::
+					scatter, j + 1, 1}, path);
+			}
+		});
+	}
+	for (auto& t : writers) {
+		t.join();
+	}
+	for (auto i = 0u; i != 8; ++i) {
+		auto t = ctop::load_tuned_placement(info, cc::format("kernel$",
+			i), path);
+		assert(t && t->threads == 10);
+	}
+	assert(ctop::load_tuned_placement(info, "stream", path));
+	cc::println("Stored the placement for $.", ctop::cpu_signature(info));
+}
@@ -0,0 +1,65 @@
+/*
+** File Name: cache_domain_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+#include <ccbase/format.hpp>
+#include <ctop/cache_domain.hpp>
+#include <ctop/system_query.hpp>
+
+static void print(const ctop::cache_domain& d, unsigned depth)
+{
+	auto threads = std::string{};
+	for (auto t : d.threads()) {
+		threads += (threads.empty() ? "" : " ") + std::to_string(t);
+	}
+	cc::println("$$ [$]", std::string(2 * depth, ' '), d, threads);
+	for (auto c : d.children()) {
+		print(*c, depth + 1);
+	}
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	ctop::cache_domains domains{info};
+
+	for (auto r : domains.roots()) {
+		print(*r, 0);
+	}
+
+	// Every available thread belongs to exactly one instance of each cache,
+	// and each instance is contained in its parent.
+	for (const auto& c : info.cpu_info().caches()) {
+		auto count = size_t{};
+		for (const auto& d : domains.all()) {
+			if (d.cache().level() == c.level() &&
+				d.cache().type() == c.type())
+			{
+				count += d.threads().size();
+			}
+		}
+		assert(count == size_t(info.available_cpu_threads().size()));
+	}
+	for (const auto& d : domains.all()) {
+		if (auto p = d.parent()) {
+			assert(std::includes(p->threads().begin(),
+				p->threads().end(), d.threads().begin(),
+				d.threads().end()));
+			assert(p->cache().level() > d.cache().level());
+		}
+	}
+
+	for (const auto& t : info.available_cpu_threads()) {
+		auto llc = domains.last_level(t.os_id());
+		assert(llc != nullptr);
+		cc::println("CPU $: LLC instance $, ${data} per thread.",
+			t.os_id(), llc->id(), llc->bytes_per_thread());
+	}
+}
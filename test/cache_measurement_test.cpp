@@ -0,0 +1,107 @@
+/*
+** File Name: cache_measurement_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <vector>
+
+#include <ctop/cache_measurement.hpp>
+
+using ctop::cache_type;
+
+static constexpr auto kib = size_t{1} << 10;
+static constexpr auto mib = size_t{1} << 20;
+
+/*
+** A sweep over a machine with a 32 KiB L1, a 1 MiB L2, and a 32 MiB L3. One
+** sample in the L2 range is a noise spike, and one sample between the L2 and
+** the L3 is in the transition between them.
+*/
+static std::vector<ctop::cache_sample> make_curve()
+{
+	auto r = std::vector<ctop::cache_sample>{};
+	for (auto b : ctop::working_set_sizes(4 * kib, 256 * mib, 4, 64)) {
+		auto lat = b <= 32 * kib ? 1.0 : b <= mib ? 4.0 :
+			b <= mib * 6 / 5 ? 8.0 : b <= 32 * mib ? 15.0 : 80.0;
+		if (b == 256 * kib) {
+			lat = 10;
+		}
+		r.push_back({b, lat, 64e9 / lat, 32e9 / lat});
+	}
+	return r;
+}
+
+static ctop::system_info make_info(size_t l3)
+{
+	auto info = ctop::system_info{};
+	auto add = [&](uint8_t level, cache_type t, size_t size) {
+		auto c = ctop::cpu_cache{};
+		c.type(t).level(level).size(size);
+		info.cpu_info().add(c);
+	};
+	add(3, cache_type::unified, l3);
+	add(1, cache_type::instruction, 32 * kib);
+	add(1, cache_type::data, 32 * kib);
+	add(2, cache_type::unified, mib);
+	return info;
+}
+
+static const ctop::cpu_cache&
+find_cache(const ctop::system_info& info, uint8_t level)
+{
+	for (const auto& c : info.cpu_info().caches()) {
+		if (c.level() == level && c.type() != cache_type::instruction) {
+			return c;
+		}
+	}
+	assert(false);
+	return info.cpu_info().caches().front();
+}
+
+int main()
+{
+	auto p = ctop::detect_plateaus(make_curve());
+	assert(p.size() == 4);
+	assert(p[0].bytes == 32 * kib && p[0].latency == 1);
+	assert(p[1].bytes == mib && p[1].latency == 4);
+	assert(p[2].bytes == 32 * mib && p[2].latency == 15);
+	assert(p[3].bytes == 256 * mib && p[3].latency == 80);
+	assert(p[1].read_bandwidth == 16e9 && p[1].write_bandwidth == 8e9);
+
+	// The sizes agree with CPUID, and the last range is main memory.
+	auto info = make_info(32 * mib);
+	auto memory = ctop::attach_measurements(info, p);
+	assert(memory && memory->bytes == 256 * mib && memory->latency == 80);
+	for (auto level = uint8_t{1}; level <= 3; ++level) {
+		const auto& c = find_cache(info, level);
+		assert(c.measured_size() == p[level - 1].bytes);
+		assert(c.measured_latency() == p[level - 1].latency);
+		assert(!c.has_size_mismatch());
+	}
+	for (const auto& c : info.cpu_info().caches()) {
+		if (c.type() == cache_type::instruction) {
+			assert(c.measured_size() == 0);
+		}
+	}
+
+	// CPUID reports an 8 MiB L3, but the thread can use 32 MiB of it.
+	info = make_info(8 * mib);
+	memory = ctop::attach_measurements(info, p);
+	assert(memory && memory->bytes == 256 * mib);
+	assert(!find_cache(info, 2).has_size_mismatch());
+	assert(find_cache(info, 3).has_size_mismatch());
+	assert(find_cache(info, 3).measured_size() == 32 * mib);
+
+	// Without the L3 range, the L3 has nothing to match, and the sweep ends
+	// before main memory.
+	p.erase(p.begin() + 2, p.end());
+	info = make_info(32 * mib);
+	memory = ctop::attach_measurements(info, p);
+	assert(!memory);
+	assert(find_cache(info, 2).measured_size() == mib);
+	assert(find_cache(info, 3).has_size_mismatch());
+	assert(find_cache(info, 3).measured_size() == 0);
+}
@@ -0,0 +1,135 @@
+/*
+** File Name: core_registry_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+
+#include <ccbase/format.hpp>
+#include <ctop/core_registry.hpp>
+#include <ctop/system_query.hpp>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fake_tree.hpp"
+
+/*
+** Forks a process that claims the CPU thread and then waits for a byte on
+** `go` before exiting without releasing it, as if it had crashed.
+*/
+static pid_t spawn_owner(const std::string& name, uint32_t cpu, int go[2])
+{
+	int ready[2];
+	::pipe(ready);
+	::pipe(go);
+
+	auto pid = ::fork();
+	if (pid == 0) {
+		ctop::core_registry r{name};
+		auto ok = char(r.try_claim(cpu));
+		::write(ready[1], &ok, 1);
+		::read(go[0], &ok, 1);
+		::_exit(0);
+	}
+
+	auto ok = char{};
+	::read(ready[0], &ok, 1);
+	assert(ok);
+	return pid;
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	auto name = cc::format("/ctop_registry_test_$", ::getpid());
+	auto cpu = info.available_cpu_threads()[0].os_id();
+
+	{
+		ctop::core_registry r{name};
+		int go[2];
+		auto pid = spawn_owner(name, cpu, go);
+
+		// A live owner keeps its claim.
+		assert(r.owner(cpu) && *r.owner(cpu) == pid);
+		assert(!r.try_claim(cpu));
+		auto free = r.unclaimed_cpus(info);
+		assert(!free.contains(cpu));
+
+		// The claim lapses when the owner exits.
+		::write(go[1], "x", 1);
+		::waitpid(pid, nullptr, 0);
+		assert(!r.owner(cpu));
+		assert(r.reap() == 1);
+
+		auto cpus = r.claim(info, 1, ctop::claim_scope::core);
+		assert(std::find(cpus.begin(), cpus.end(), cpu) != cpus.end());
+		assert(r.claimed() == cpus);
+		assert(*r.owner(cpu) == ::getpid());
+
+		// Every CPU thread of the node is claimed, or none is.
+		auto nodes = info.available_numa_nodes().size();
+		auto threw = false;
+		try {
+			r.claim(info, nodes + 1, ctop::claim_scope::numa_node);
+		}
+		catch (const std::runtime_error&) {
+			threw = true;
+		}
+		assert(threw && r.claimed() == cpus);
+		cc::println("Claimed $ CPU threads of the first core.",
+			cpus.size());
+
+		// Another object in this process leaves the claims of `r` alone
+		// when destroyed.
+		{
+			ctop::core_registry other{name};
+			assert(other.try_claim(cpu) && other.claimed().empty());
+		}
+		assert(r.owner(cpu) && *r.owner(cpu) == ::getpid());
+
+		// So does the copy of an object inherited by a forked child.
+		r.release(cpus);
+		auto inherited = new ctop::core_registry{name};
+		assert(inherited->try_claim(cpu));
+		auto child = ::fork();
+		if (child == 0) {
+			delete inherited;
+			::_exit(0);
+		}
+		::waitpid(child, nullptr, 0);
+		assert(r.owner(cpu) && *r.owner(cpu) == ::getpid());
+		delete inherited;
+		assert(!r.owner(cpu));
+		assert(r.claim(info, 1, ctop::claim_scope::core) == cpus);
+		assert(r.claimed() == cpus);
+	}
+
+	// The destructor releases the claims.
+	{
+		ctop::core_registry r{name};
+		assert(!r.owner(cpu));
+	}
+
+	// A process in another PID namespace cannot open the registry. The
+	// fake procfs tree has the stat file of this process, but a PID
+	// namespace with another inode.
+	{
+		fake_tree proc{"registry"};
+		proc.write(cc::format("/$/stat", ::getpid()),
+			ctop::read_file("/proc/self/stat"));
+		proc.write("/self/ns/pid", "");
+		auto threw = false;
+		try {
+			ctop::core_registry r{name, proc.root()};
+		}
+		catch (const std::runtime_error&) {
+			threw = true;
+		}
+		assert(threw);
+	}
+	::shm_unlink(name.c_str());
+}
@@ -0,0 +1,94 @@
+/*
+** File Name: cpu_stat_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <cmath>
+#include <string>
+
+#include <ccbase/format.hpp>
+#include <ctop/cpu_stat.hpp>
+#include <ctop/topology_builder.hpp>
+
+#include "fake_tree.hpp"
+
+using ctop::cpu_time;
+using ctop::topology_domain;
+
+static constexpr auto user = uint64_t{99999990};
+static constexpr auto system_ticks = uint64_t{123456789};
+static constexpr auto idle = uint64_t{12345678901234567};
+
+/*
+** Returns a "cpuN" line for a CPU thread that has been busy for `busy` of the
+** `elapsed` ticks since the first sample. The last three columns are left out
+** if `short_line` is set, as on older kernels.
+*/
+static std::string line(uint32_t cpu, uint64_t elapsed, uint64_t busy,
+	uint64_t iowait, bool short_line = false)
+{
+	auto s = cc::format("cpu$ $ 0 $ $ $ 0 0", cpu, user + busy,
+		system_ticks, idle + elapsed - busy, iowait);
+	return s + (short_line ? "" : " 7 0 0") + "\n";
+}
+
+static bool near(double a, double b)
+{ return std::abs(a - b) < 1e-9; }
+
+int main()
+{
+	// Two packages with two cores of two SMT threads each. CPU thread 5,
+	// the second thread of core 1 of package 0, is offline.
+	auto info = ctop::topology_builder{}.packages(2).cores_per_die(2).
+		threads_per_core(2).offline_cpus({5}).build();
+
+	fake_tree root{"stat"};
+	auto write_stat = [&](const std::string& cpus) {
+		root.write("/stat", "cpu  0 0 0 0 0 0 0 0 0 0\n" + cpus +
+			"intr 0");
+	};
+	write_stat(line(0, 0, 0, 10) + line(1, 0, 0, 10) + line(2, 0, 0, 10) +
+		line(3, 0, 0, 10) + line(4, 0, 0, 10) +
+		line(6, 0, 0, 10, true) + line(7, 0, 0, 10));
+	auto m = ctop::utilization_monitor{info, root.root()};
+
+	// The user time crosses from eight to nine digits. The iowait of CPU
+	// thread 1 goes backwards, and CPU thread 7 goes offline.
+	write_stat(line(0, 100, 10, 10) + line(1, 100, 20, 5) +
+		line(2, 100, 30, 10) + line(3, 100, 40, 10) +
+		line(4, 100, 50, 10) + line(6, 100, 60, 10, true));
+	m.update();
+
+	const auto& t = m.times(4);
+	assert(t[cpu_time::user] == 100000040);
+	assert(t[cpu_time::system] == system_ticks);
+	assert(t[cpu_time::idle] == idle + 50);
+	assert(t[cpu_time::iowait] == 10 && t[cpu_time::steal] == 7);
+	assert(m.times(6)[cpu_time::steal] == 0);
+	assert(m.times(1)[cpu_time::iowait] == 5);
+	assert(m.times(7)[cpu_time::user] == user);
+
+	assert(near(m.utilization(0), 0.1));
+	assert(near(m.utilization(1), 0.2));
+	assert(near(m.utilization(2), 0.3));
+	assert(near(m.utilization(3), 0.4));
+	assert(near(m.utilization(4), 0.5));
+	assert(near(m.utilization(6), 0.6));
+	assert(m.utilization(7) == 0);
+
+	// Core 0 of each package has CPU threads n and n + 4, and core 1 has
+	// n + 1 and n + 5.
+	assert(m.by(topology_domain::core).size() == 4);
+	assert(near(m.domain(0, topology_domain::core).value, 0.3));
+	assert(near(m.domain(1, topology_domain::core).value, 0.2));
+	assert(near(m.domain(2, topology_domain::core).value, 0.45));
+	assert(near(m.domain(3, topology_domain::core).value, 0.2));
+	for (auto d : {topology_domain::package, topology_domain::numa_node}) {
+		assert(m.by(d).size() == 2);
+		assert(near(m.domain(0, d).value, 0.8 / 3));
+		assert(near(m.domain(2, d).value, 1.3 / 4));
+	}
+}
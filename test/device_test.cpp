@@ -0,0 +1,141 @@
+/*
+** File Name: device_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+
+#include <ccbase/format.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/system_query.hpp>
+
+#include "fake_tree.hpp"
+
+/*
+** Fills in a tree with a NIC local to the first node and a disk controller
+** without locality information. The NIC raises IRQs 40 and 41, which are
+** handled by the first CPU thread of the node, and the disk controller raises
+** IRQ 16. The sysfs tree is under `/sys`, and the procfs tree under `/proc`.
+*/
+static void
+make_fake_root(const fake_tree& root, const ctop::system_info& info)
+{
+	const auto& node = info.available_numa_nodes()[0];
+	auto local = std::vector<uint32_t>{};
+	for (const auto& t : node.cpu_info().available_threads()) {
+		local.push_back(t.os_id());
+	}
+	std::sort(local.begin(), local.end());
+	auto list = std::string{};
+	for (auto cpu : local) {
+		list += (list.empty() ? "" : ",") + std::to_string(cpu);
+	}
+
+	auto nic = std::string{"/sys/bus/pci/devices/0000:3b:00.0"};
+	root.make_dirs(nic + "/net/eth0");
+	root.make_dirs(nic + "/msi_irqs/40");
+	root.make_dirs(nic + "/msi_irqs/41");
+	root.write(nic + "/class", "0x020000");
+	root.write(nic + "/vendor", "0x8086");
+	root.write(nic + "/device", "0x1572");
+	root.write(nic + "/numa_node", node.id());
+	root.write(nic + "/local_cpulist", list);
+
+	auto disk = std::string{"/sys/bus/pci/devices/0000:00:1f.2"};
+	root.write(disk + "/class", "0x010601");
+	root.write(disk + "/vendor", "0x8086");
+	root.write(disk + "/device", "0x8d02");
+	root.write(disk + "/numa_node", -1);
+	root.write(disk + "/irq", 16);
+
+	root.write("/proc/irq/40/smp_affinity_list", local[0]);
+	root.write("/proc/irq/41/smp_affinity_list", local[0]);
+
+	auto cpus = std::vector<uint32_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		cpus.push_back(t.os_id());
+	}
+	std::sort(cpus.begin(), cpus.end());
+
+	auto os = std::ofstream{root.path("/proc/interrupts")};
+	os << "     ";
+	for (auto cpu : cpus) {
+		os << "      CPU" << cpu;
+	}
+	auto row = [&](const char* irq, uint32_t busy, const char* desc) {
+		os << "\n" << irq;
+		for (auto cpu : cpus) {
+			os << " " << (cpu == busy ? 1000000 : 0);
+		}
+		os << "   " << desc;
+	};
+	row(" 16:", cpus.back(), "IO-APIC   16-fasteoi   ahci[0000:00:1f.2]");
+	row(" 40:", local[0], "IR-PCI-MSI 524288-edge      eth0-TxRx-0");
+	row(" 41:", local[0], "IR-PCI-MSI 524289-edge      eth0-TxRx-1");
+	os << "\nNMI:";
+	for (auto i = size_t{}; i != cpus.size(); ++i) {
+		os << " 7";
+	}
+	os << "   Non-maskable interrupts\n";
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	for (const auto& d : info.pci_devices()) {
+		cc::println(d);
+	}
+
+	fake_tree root{"devices"};
+	make_fake_root(root, info);
+	auto sys = root.path("/sys");
+	auto proc = root.path("/proc");
+	ctop::get_device_info(info, sys, proc);
+	assert(info.pci_devices().size() == 2);
+	assert(info.irqs().size() == 3);
+
+	auto nic = ctop::find_pci_device("eth0", info);
+	assert(nic != nullptr);
+	assert(nic->device_class() == ctop::pci_device_class::network);
+	assert(nic->numa_node() == int32_t(info.available_numa_nodes()[0].id()));
+	assert((nic->irqs() == std::vector<uint32_t>{40, 41}));
+
+	auto disk = ctop::find_pci_device("0000:00:1f.2", info);
+	assert(disk != nullptr);
+	assert(disk->device_class() == ctop::pci_device_class::storage);
+	assert(disk->numa_node() == -1);
+	assert((disk->irqs() == std::vector<uint32_t>{16}));
+
+	auto irq = ctop::find_irq(40, info);
+	assert(irq != nullptr);
+	assert(irq->name() == "eth0-TxRx-0");
+	assert(irq->affinity().size() == 1);
+
+	// The IO thread goes where the NIC interrupts are handled, and the
+	// compute threads avoid that core if they can.
+	auto busy = irq->affinity()[0];
+	auto avail = size_t(info.available_cpu_threads().size());
+	auto p = ctop::place_io_threads(info, *nic, 1, avail - 1);
+	assert(p.io_threads.size() == 1 && p.io_threads[0] == busy);
+	assert(std::find(p.compute_threads.begin(), p.compute_threads.end(),
+		busy) == p.compute_threads.end());
+	cc::println("IO thread: $.", p.io_threads[0]);
+
+	// A device without a class file and an unexpected header in
+	// `/proc/interrupts`, as seen in some containers. The strict query
+	// fails, and the best-effort one leaves both lists empty.
+	std::remove((sys + "/bus/pci/devices/0000:00:1f.2/class").c_str());
+	root.write("/proc/interrupts", "unexpected");
+	try {
+		ctop::get_device_info(info, sys, proc);
+		assert(false);
+	}
+	catch (const ctop::sysfs_error&) {}
+	assert(!ctop::try_get_device_info(info, sys, proc));
+	assert(info.pci_devices().empty() && info.irqs().empty());
+}
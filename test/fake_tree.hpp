@@ -0,0 +1,98 @@
+/*
+** File Name: fake_tree.hpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** A temporary directory that the tests fill with files in the layout of sysfs
+** or procfs, and pass to the functions that take a root. The directory and
+** everything in it are removed on destruction.
+*/
+
+#ifndef Z5B617664_8437_4C11_A3FB_79680960ED7F
+#define Z5B617664_8437_4C11_A3FB_79680960ED7F
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <ftw.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+class fake_tree final
+{
+	std::string m_root;
+public:
+	/*
+	** Creates an empty directory named after `name` under `/tmp`.
+	*/
+	explicit fake_tree(const std::string& name)
+	{
+		auto tmpl = "/tmp/ctop_" + name + "_XXXXXX";
+		if (::mkdtemp(&tmpl[0]) == nullptr) {
+			throw std::runtime_error{"failed to create " + tmpl + ": " +
+				std::strerror(errno)};
+		}
+		m_root = tmpl;
+	}
+
+	~fake_tree()
+	{
+		::nftw(m_root.c_str(), [](const char* p, const struct stat*, int,
+			struct FTW*) { return std::remove(p); }, 16,
+			FTW_DEPTH | FTW_PHYS);
+	}
+
+	fake_tree(const fake_tree&) = delete;
+	fake_tree& operator=(const fake_tree&) = delete;
+
+	const std::string& root() const noexcept
+	{ return m_root; }
+
+	/*
+	** Returns the absolute path of `rel`, which starts with a slash.
+	*/
+	std::string path(const std::string& rel) const
+	{ return m_root + rel; }
+
+	/*
+	** Creates the directory `rel` and its missing parents.
+	*/
+	void make_dirs(const std::string& rel) const
+	{
+		auto p = path(rel);
+		for (auto i = p.find('/', m_root.size() + 1);; i = p.find('/',
+			i + 1))
+		{
+			auto d = p.substr(0, i);
+			if (::mkdir(d.c_str(), 0755) == -1 && errno != EEXIST) {
+				throw std::runtime_error{"failed to create " + d +
+					": " + std::strerror(errno)};
+			}
+			if (i == std::string::npos) {
+				return;
+			}
+		}
+	}
+
+	/*
+	** Writes `value` and a newline to the file `rel`, replacing its contents
+	** and creating its directory if needed.
+	*/
+	template <class T>
+	void write(const std::string& rel, const T& value) const
+	{
+		make_dirs(rel.substr(0, rel.rfind('/')));
+		auto os = std::ofstream{path(rel)};
+		os << value << "\n";
+		if (!os) {
+			throw std::runtime_error{"failed to write " + path(rel)};
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+** File Name: frequency_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include <ccbase/format.hpp>
+#include <ctop/frequency.hpp>
+#include <ctop/system_query.hpp>
+
+#include "fake_tree.hpp"
+
+using ctop::topology_domain;
+
+/*
+** Fills in a sysfs tree in which each CPU thread reports 1000 MHz plus 100 MHz
+** times its OS ID.
+*/
+static void
+make_fake_sysfs(const fake_tree& root, const ctop::system_info& info)
+{
+	for (const auto& t : info.available_cpu_threads()) {
+		root.write(cc::format("/devices/system/cpu/cpu$/cpufreq/"
+			"scaling_cur_freq", t.os_id()), 1000000 + 100000 * t.os_id());
+	}
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	const auto& v = info.cpu_info().version();
+	cc::println("Base: $ MHz, max: $ MHz, bus: $ MHz.", v.base_frequency(),
+		v.max_frequency(), v.bus_frequency());
+
+	// Check the cpufreq fallback against a fake sysfs tree.
+	fake_tree root{"sysfs"};
+	make_fake_sysfs(root, info);
+	ctop::frequency_sampler fake{info, root.path("/dev"), root.root()};
+	assert(fake.source() == ctop::frequency_source::cpufreq);
+	fake.update();
+	for (auto cpu : fake.cpus()) {
+		assert(fake.frequency(cpu) == 1000 + 100 * cpu);
+	}
+
+	// A sampler needs at least one CPU thread.
+	try {
+		ctop::frequency_sampler{ctop::system_info{}, root.path("/dev"),
+			root.root()};
+		assert(false);
+	}
+	catch (const std::invalid_argument&) {}
+
+	// Print the frequencies of this machine.
+	try {
+		ctop::frequency_sampler s{info};
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		s.update();
+		cc::println("Source: $.", s.source());
+		for (auto cpu : s.cpus()) {
+			cc::println("CPU $: $ MHz.", cpu, s.frequency(cpu));
+		}
+		for (const auto& p : s.by(topology_domain::package)) {
+			cc::println("Package $: $ MHz.", p.id, p.value);
+		}
+	}
+	catch (const ctop::sysfs_error& e) {
+		cc::println(e.what());
+	}
+}
@@ -0,0 +1,64 @@
+/*
+** File Name: huge_page_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <cstring>
+
+#include <ccbase/format.hpp>
+#include <ctop/huge_page.hpp>
+#include <ctop/system_query.hpp>
+
+#include "fake_tree.hpp"
+
+int main()
+{
+	auto info = *ctop::system_query();
+	cc::println("Transparent huge pages: $.", ctop::get_thp_mode());
+
+	for (const auto& node : info.available_numa_nodes()) {
+		auto pools = ctop::get_huge_page_info(node.id());
+		cc::println(node);
+		for (const auto& p : pools) {
+			cc::println(p);
+		}
+
+		auto size = ctop::choose_huge_page_size(ctop::huge_page_1g,
+			info.cpu_info(), pools);
+		auto pool = ctop::huge_page_pool{size, node.id(), 2};
+		auto p = pool.allocate();
+		pool.deallocate(p);
+		cc::println("Allocated $ byte page (THP fallback: ${bool}).",
+			pool.page_size(), pool.uses_transparent_huge_pages());
+	}
+
+	// The host may have free 2 MiB pages on other nodes, but this node has
+	// none, so the pool falls back to THP rather than faulting.
+	auto node = info.available_numa_nodes()[0].id();
+	fake_tree root{"hugepages"};
+	auto dir = cc::format("/devices/system/node/node$/hugepages/"
+		"hugepages-2048kB", node);
+	root.write(dir + "/nr_hugepages", 4);
+	root.write(dir + "/free_hugepages", 0);
+	root.write(dir + "/surplus_hugepages", 0);
+	auto empty = ctop::huge_page_pool{ctop::huge_page_2m, node, 2,
+		root.root()};
+	assert(empty.uses_transparent_huge_pages());
+	assert(empty.free_pages() == 2);
+	auto p = static_cast<char*>(empty.allocate());
+	std::memset(p, 1, ctop::huge_page_2m);
+
+	// If the node claims free pages that the host cannot supply, mapping
+	// them fails without a fault, and the pool still falls back. Whether
+	// hugetlbfs is used depends on the host.
+	root.write(dir + "/free_hugepages", 4);
+	auto claimed = ctop::huge_page_pool{ctop::huge_page_2m, node, 2,
+		root.root()};
+	p = static_cast<char*>(claimed.allocate());
+	std::memset(p, 1, ctop::huge_page_2m);
+	cc::println("Node $ with claimed pages: THP fallback: ${bool}.", node,
+		claimed.uses_transparent_huge_pages());
+}
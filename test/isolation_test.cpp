@@ -0,0 +1,105 @@
+/*
+** File Name: isolation_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+#include <ccbase/format.hpp>
+#include <ctop/isolation.hpp>
+#include <ctop/system_query.hpp>
+
+#include "fake_tree.hpp"
+
+/*
+** Fills in a tree in which the given CPU thread is isolated and nohz_full, CPU
+** threads 0 through `online` are online, and RCU callbacks are offloaded from
+** CPU threads 1 to 3. The tree serves as both the sysfs and the procfs root.
+*/
+static void
+make_fake_root(const fake_tree& root, uint32_t isolated, uint32_t online)
+{
+	root.write("/devices/system/cpu/isolated", isolated);
+	root.write("/devices/system/cpu/nohz_full", isolated);
+	root.write("/devices/system/cpu/online", "0-" + std::to_string(online));
+	root.write("/cmdline", "quiet isolcpus=" + std::to_string(isolated) +
+		" rcu_nocbs=1-3 nohz_full=" + std::to_string(isolated));
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	cc::println("Isolated: $, nohz_full: $, rcu_nocbs: $.",
+		info.isolated_cpus().size(), info.nohz_full_cpus().size(),
+		info.rcu_nocb_cpus().size());
+
+	auto cpus = std::vector<uint32_t>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		cpus.push_back(t.os_id());
+	}
+	std::sort(cpus.begin(), cpus.end());
+
+	// As with `isolcpus`, the isolated CPU thread is online but outside the
+	// affinity of the process, so it is not among the available ones.
+	auto outside = cpus.back() + 1;
+	fake_tree tree{"isolation"};
+	const auto& root = tree.root();
+	make_fake_root(tree, outside, outside);
+	ctop::get_isolation_info(info, root, root);
+	assert((info.isolated_cpus() == std::vector<uint32_t>{outside}));
+	assert((info.nohz_full_cpus() == std::vector<uint32_t>{outside}));
+	assert((info.rcu_nocb_cpus() == std::vector<uint32_t>{1, 2, 3}));
+	assert((ctop::isolated_cpus(info, root) ==
+		std::vector<uint32_t>{outside}));
+	assert(ctop::housekeeping_cpus(info) == cpus);
+	ctop::cpu_reservation outer{info, root};
+	assert((outer.isolated() == std::vector<uint32_t>{outside}));
+	assert(outer.housekeeping() == cpus);
+
+	// An isolated CPU thread that is offline cannot be reserved.
+	make_fake_root(tree, outside, outside - 1);
+	ctop::get_isolation_info(info, root, root);
+	assert(ctop::isolated_cpus(info, root).empty());
+
+	if (cpus.size() < 2) {
+		cc::println("Skipping the reservation test on one CPU thread.");
+		return 0;
+	}
+
+	make_fake_root(tree, cpus.back(), cpus.back());
+	ctop::get_isolation_info(info, root, root);
+	assert((info.isolated_cpus() == std::vector<uint32_t>{cpus.back()}));
+
+	ctop::cpu_reservation r{info, root};
+	assert(r.housekeeping().size() == cpus.size() - 1);
+	auto w = r.place_workers(cpus.size() - 1);
+	assert(std::find(w.begin(), w.end(), cpus.back()) == w.end());
+
+	// A general-purpose thread that is not confined violates the isolation
+	// until it is.
+	auto reserved = r.reserve_current_thread();
+	assert(reserved == cpus.back());
+	std::thread{[&] {
+		assert(!r.violations().empty());
+		r.confine_current_thread();
+		assert(r.violations().empty());
+	}}.join();
+
+	// Every isolated CPU thread is now taken.
+	auto taken = false;
+	std::thread{[&] {
+		try {
+			r.reserve_current_thread();
+		}
+		catch (const std::runtime_error&) {
+			taken = true;
+		}
+	}}.join();
+	assert(taken);
+	r.release_current_thread();
+	cc::println("Reserved and released CPU $.", reserved);
+}
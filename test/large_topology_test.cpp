@@ -0,0 +1,157 @@
+/*
+** File Name: large_topology_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Builds the topology of a host with four packages of 128 cores and two SMT
+** threads per core, for 1024 CPU threads in all, and checks that nothing
+** along the way is limited to 255 CPU threads.
+*/
+
+#include <cassert>
+#include <sstream>
+
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/cache_domain.hpp>
+#include <ctop/cpu_set.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/serialization.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/topology_builder.hpp>
+
+static constexpr auto packages = 4u;
+static constexpr auto cores = 128u;
+static constexpr auto threads = 2 * cores;
+
+static ctop::system_info make_info()
+{
+	auto b = ctop::topology_builder{};
+	b.version().model(143).stepping(8);
+	return b.packages(packages).cores_per_die(cores).threads_per_core(2).
+		cache(1, ctop::cache_type::data, 48 << 10, 12,
+			ctop::cpu_topology_level::core).
+		cache(2, ctop::cache_type::unified, 2 << 20, 16,
+			ctop::cpu_topology_level::core).
+		cache(3, ctop::cache_type::unified, 105 << 20, 15,
+			ctop::cpu_topology_level::processor).
+		build();
+}
+
+static std::string json(const ctop::system_info& info)
+{
+	auto ss = std::ostringstream{};
+	ctop::write_json(ss, info);
+	return ss.str();
+}
+
+int main()
+{
+	auto info = make_info();
+	const auto& cpu = info.cpu_info();
+	assert(info.total_cpu_threads() == packages * threads);
+	assert(cpu.threads_per_core() == 2);
+
+	for (const auto& n : info.available_numa_nodes()) {
+		auto ts = n.cpu_info().available_threads();
+		assert(ctop::count_unique_cores(ts, cpu) == cores);
+		for (const auto& t : ts) {
+			assert(ctop::package_id(t, cpu) == n.id());
+		}
+	}
+
+	// A node with 256 CPU threads must survive both encodings.
+	auto b = ctop::to_binary(info);
+	auto j = json(info);
+	auto from_b = ctop::from_binary(b);
+	auto from_j = ctop::from_json(j);
+	assert(ctop::to_binary(from_b) == b);
+	assert(ctop::to_binary(from_j) == b);
+	for (const auto& n : from_j.available_numa_nodes()) {
+		assert(n.cpu_info().available_threads().size() == threads);
+	}
+	assert(from_b.cpu_info().total_threads() == threads);
+
+	auto d = ctop::cache_domains{info};
+	assert(d.at_level(3).size() == packages);
+	assert(d.at_level(2).size() == packages * cores);
+	for (const auto& l3 : d.at_level(3)) {
+		assert(l3->threads().size() == threads);
+	}
+
+	auto all = ctop::cpu_set::from_range(ctop::place_threads(info,
+		ctop::placement_policy::compact, packages * threads));
+	assert(all.count() == packages * threads);
+	assert(all.front() == 0);
+
+	auto node0 = ctop::cpu_set{};
+	for (const auto& t : info.available_numa_nodes()[0].cpu_info().
+		available_threads())
+	{
+		node0.insert(t.os_id());
+	}
+	auto one_per_core = ctop::cpu_set::from_range(ctop::place_threads(info,
+		ctop::placement_policy::one_per_core, packages * cores));
+	assert(one_per_core.count() == packages * cores);
+	assert(one_per_core.is_subset_of(all));
+	assert((one_per_core & node0).count() == cores);
+	assert((all - one_per_core).count() == packages * cores);
+	assert((one_per_core | (all - one_per_core)) == all);
+	assert(!(node0 - one_per_core).intersects(one_per_core));
+
+	assert(node0 == info.available_numa_nodes()[0].cpu_info().cpus());
+	assert(node0 == ctop::domain_cpus(ctop::topology_domain::package, 0,
+		info));
+	auto per_core = ctop::domain_cpus(ctop::topology_domain::core, info);
+	assert(per_core.size() == packages * cores);
+	assert((per_core.at(0) == ctop::cpu_set{0, 512}));
+	assert(info.available_cpus() == all);
+
+	auto ss = std::ostringstream{};
+	ss << node0;
+	assert(ss.str() == "0-127,512-639");
+	assert(ctop::parse_cpu_set(ss.str(), "") == node0);
+	assert(ctop::parse_cpu_set("", "").empty());
+
+	// A `cpu_set_t` holds 1024 CPU threads, and a larger set must not be
+	// truncated silently.
+	auto mask = ::cpu_set_t{};
+	all.to_cpu_mask(&mask);
+	assert(CPU_COUNT(&mask) == int(packages * threads));
+	assert(ctop::cpu_set::from_cpu_mask(&mask) == all);
+	try {
+		ctop::cpu_set{1024}.to_cpu_mask(&mask);
+		assert(false);
+	}
+	catch (const std::out_of_range&) {}
+
+	// The mask that `pin_current_thread` passes to the kernel grows to hold
+	// the largest ID instead.
+	auto pin = ctop::detail::dynamic_cpu_set{};
+	pin.assign(ctop::cpu_set{3, 1024, 2047});
+	assert(pin.size() == 2048 / 8);
+	assert(CPU_ISSET_S(1024, pin.size(), pin.data()));
+	assert(CPU_ISSET_S(2047, pin.size(), pin.data()));
+	assert(CPU_COUNT_S(pin.size(), pin.data()) == 3);
+	pin.assign(all);
+	assert(pin.members() == all);
+
+	auto bm = ::numa_bitmask_alloc(2048);
+	node0.to_bitmask(bm);
+	assert(::numa_bitmask_weight(bm) == threads);
+	assert(ctop::cpu_set::from_bitmask(bm) == node0);
+	::numa_bitmask_free(bm);
+
+	// Copies and moves of sets that outgrow the inline words.
+	auto big = ctop::cpu_set{4095};
+	big.insert(0, 1000);
+	auto copy = big;
+	auto moved = std::move(big);
+	assert(copy == moved && copy.count() == 1002 && copy.back() == 4095);
+	assert(big.empty());
+	copy -= moved;
+	assert(copy.empty() && copy != moved);
+	cc::println("Node 0: $.", ss.str());
+	cc::println("Binary: $ bytes, JSON: $ bytes.", b.size(), j.size());
+}
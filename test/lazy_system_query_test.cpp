@@ -0,0 +1,55 @@
+/*
+** File Name: lazy_system_query_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <thread>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/lazy_system_query.hpp>
+#include <ctop/system_query.hpp>
+
+int main()
+{
+	auto eager = *ctop::system_query();
+
+	ctop::lazy_system_query q{};
+	assert(q.version().brand() == eager.cpu_info().version().brand());
+	assert(q.caches().size() == eager.cpu_info().caches().size());
+	cc::println("L1 line size: $.", q.caches().front().line_size());
+
+	// The walk runs on another thread while this one reads the CPU info,
+	// and any number of threads may wait for it.
+	auto f = q.start_async();
+	assert(q.cpu_info().total_threads() == eager.cpu_info().total_threads());
+
+	auto threads = std::vector<std::thread>{};
+	auto counts = std::vector<size_t>(4);
+	for (auto i = 0u; i != counts.size(); ++i) {
+		threads.emplace_back([&, i] {
+			counts[i] = q.info().available_cpu_threads().size();
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	f.get();
+
+	for (auto c : counts) {
+		assert(c == size_t(eager.available_cpu_threads().size()));
+	}
+	const auto& info = q.info();
+	for (auto i = size_t{}; i != size_t(info.available_cpu_threads().size());
+		++i)
+	{
+		assert(info.available_cpu_threads()[i].x2apic_id() ==
+			eager.available_cpu_threads()[i].x2apic_id());
+	}
+	cc::println("Found $ CPU threads on $ nodes.",
+		info.available_cpu_threads().size(),
+		info.available_numa_nodes().size());
+}
@@ -0,0 +1,100 @@
+/*
+** File Name: parallel_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/parallel.hpp>
+#include <ctop/system_query.hpp>
+
+static constexpr auto elements = size_t{1} << 20;
+
+int main()
+{
+	// Two nodes with two and three workers; the node boundary is aligned
+	// to 512 elements.
+	auto m = ctop::partition_map{{0, 0, 1, 1, 1}, 10000, 512};
+	assert(m.workers() == 5 && m.nodes().size() == 2);
+	assert(m.nodes()[0].node == 0 && m.nodes()[0].end == 3584);
+	assert(m.nodes()[1].begin == 3584 && m.nodes()[1].end == 10000);
+	assert(m.begin(0) == 0 && m.end(0) == 1792 && m.end(1) == 3584);
+	for (auto i = size_t{}; i != m.workers(); ++i) {
+		assert(m.begin(i) <= m.end(i));
+		assert(i == 0 || m.begin(i) == m.end(i - 1));
+	}
+	assert(m.end(4) == 10000);
+	// Fewer elements than workers.
+	auto tiny = ctop::partition_map{{0, 1, 1}, 2};
+	assert(tiny.end(2) == 2 && tiny.nodes()[0].end == 0);
+
+	// Four workers on the first CPU thread, so that the merging and
+	// reduction order are exercised on any machine.
+	auto info = *ctop::system_query();
+	auto cpu = info.available_cpu_threads()[0].os_id();
+	ctop::worker_set w{info, {cpu, cpu, cpu, cpu}};
+	assert(w.size() == 4);
+
+	auto a = ctop::partitioned_array<uint64_t>{w, elements};
+	assert(a.map().workers() == 4 && a[elements - 1] == 0);
+	ctop::parallel_for(w, a.map(), [&](size_t b, size_t e) {
+		for (auto i = b; i != e; ++i) {
+			a[i] = i;
+		}
+	});
+	auto sum = ctop::parallel_reduce(w, a.map(), a.begin(), uint64_t{},
+		std::plus<>{});
+	assert(sum == elements * (elements - 1) / 2);
+
+	auto b = ctop::partitioned_array<uint64_t>{w, elements};
+	ctop::parallel_transform(w, a.map(), a.begin(), b.begin(),
+		[](uint64_t x) { return 2 * x; });
+	assert(b[12345] == 24690);
+	ctop::parallel_for_each(w, b.begin(), b.end(), [](uint64_t& x) {
+		++x;
+	});
+	assert(b[0] == 1 && b[elements - 1] == 2 * elements - 1);
+
+	// The order of combination is fixed, so a non-commutative operation
+	// gives the sequential result.
+	auto words = std::vector<std::string>{"a", "b", "c", "d", "e", "f", "g"};
+	assert(ctop::parallel_reduce(w, words.begin(), words.end(),
+		std::string{">"}, std::plus<>{}) == ">abcdefg");
+
+	auto gen = std::mt19937_64{42};
+	auto v = std::vector<uint64_t>(100003);
+	for (auto& x : v) {
+		x = gen();
+	}
+	auto sorted = v;
+	std::sort(sorted.begin(), sorted.end());
+	ctop::parallel_sort(w, v.begin(), v.end());
+	assert(v == sorted);
+	ctop::parallel_sort(w, v.begin(), v.end(), std::greater<>{});
+	assert(std::is_sorted(v.rbegin(), v.rend()));
+
+	try {
+		ctop::parallel_for(w, 100, [](size_t b, size_t) {
+			if (b != 0) {
+				throw std::runtime_error{"worker failed"};
+			}
+		});
+		assert(false);
+	}
+	catch (const std::runtime_error&) {}
+	// The set is still usable after a job throws.
+	ctop::parallel_for(w, 4, [](size_t, size_t) {});
+
+	// One worker per core of this machine.
+	ctop::worker_set all{info};
+	cc::println("$ workers; $.", all.size(), all.policy());
+}
@@ -0,0 +1,108 @@
+/*
+** File Name: per_cpu_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/affinity.hpp>
+#include <ctop/per_cpu.hpp>
+#include <ctop/system_query.hpp>
+
+// More threads than CPU threads, so that they migrate and are preempted in
+// the middle of the restartable sequences.
+static constexpr auto threads = 8u;
+static constexpr auto items_per_thread = 20000u;
+static constexpr auto increments = 1000000u;
+
+struct item : ctop::per_cpu_stack_node
+{
+	uint32_t pops;
+};
+
+int main()
+{
+	auto info = *ctop::system_query();
+
+	auto counter = ctop::per_cpu_counter{info};
+	auto stack = ctop::per_cpu_stack<item>{info};
+	cc::println("rseq: ${bool}.", counter.uses_rseq());
+
+	auto items = std::vector<item>(threads * items_per_thread);
+	auto popped = std::vector<std::vector<item*>>(threads);
+	auto workers = std::vector<std::thread>{};
+	for (auto i = 0u; i != threads; ++i) {
+		workers.emplace_back([&, i] {
+			for (auto j = 0u; j != increments; ++j) {
+				counter.increment();
+			}
+			counter.add(-int64_t{i});
+
+			// Push every item of this thread, and pop one after every
+			// third push. The popped items are not pushed again.
+			auto first = &items[i * items_per_thread];
+			for (auto j = 0u; j != items_per_thread; ++j) {
+				stack.push(first + j);
+				if (j % 3 == 2) {
+					if (auto p = stack.pop()) {
+						popped[i].push_back(p);
+					}
+				}
+				if (j % 1024 == 0) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+	for (auto& t : workers) {
+		t.join();
+	}
+
+	// Drain the list of each CPU thread from that CPU thread.
+	auto drained = std::vector<item*>{};
+	for (const auto& t : info.available_cpu_threads()) {
+		ctop::scoped_binding b{t.os_id()};
+		while (auto p = stack.pop()) {
+			drained.push_back(p);
+		}
+	}
+	for (const auto& v : popped) {
+		drained.insert(drained.end(), v.begin(), v.end());
+	}
+
+	assert(drained.size() == items.size());
+	for (auto p : drained) {
+		assert(p >= items.data() && p < items.data() + items.size());
+		++p->pops;
+	}
+	for (const auto& x : items) {
+		assert(x.pops == 1);
+	}
+
+	auto expected = int64_t{threads} * increments -
+		int64_t{threads} * (threads - 1) / 2;
+	assert(counter.sum() == expected);
+	for (auto d : {ctop::topology_domain::thread,
+		ctop::topology_domain::core, ctop::topology_domain::package,
+		ctop::topology_domain::numa_node})
+	{
+		auto total = int64_t{};
+		for (const auto& p : counter.sum_by(d)) {
+			total += p.second;
+		}
+		assert(total == expected);
+	}
+	auto by_thread = counter.sum_by(ctop::topology_domain::thread);
+	assert(by_thread.size() == info.available_cpu_threads().size());
+	for (const auto& p : by_thread) {
+		assert(p.second == counter.value(p.first));
+	}
+	cc::println("$ items popped once each; counter: $.", items.size(),
+		counter.sum());
+}
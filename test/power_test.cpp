@@ -0,0 +1,125 @@
+/*
+** File Name: power_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+#include <ccbase/format.hpp>
+#include <ctop/power.hpp>
+#include <ctop/system_query.hpp>
+
+#include "fake_tree.hpp"
+
+static constexpr auto range = uint64_t{262143328850};
+
+static void write_zone(const fake_tree& root, const std::string& zone,
+	const char* name, uint64_t energy)
+{
+	auto dir = "/class/powercap/" + zone;
+	root.write(dir + "/name", name);
+	root.write(dir + "/max_energy_range_uj", range);
+	root.write(dir + "/energy_uj", energy);
+}
+
+/*
+** Fills in a powercap tree for package 0 with core and DRAM subzones and a
+** platform zone, in which every CPU thread belongs to package 0. The package
+** counter is about to wrap.
+*/
+static void
+make_fake_sysfs(const fake_tree& root, const ctop::system_info& info)
+{
+	for (const auto& t : info.available_cpu_threads()) {
+		root.write(cc::format("/devices/system/cpu/cpu$/topology/"
+			"physical_package_id", t.os_id()), 0);
+	}
+	write_zone(root, "intel-rapl:0", "package-0", range - 500000);
+	write_zone(root, "intel-rapl:0:0", "core", 1000000);
+	write_zone(root, "intel-rapl:0:1", "dram", 2000000);
+	write_zone(root, "intel-rapl:1", "psys", 0);
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+	auto pkg = ctop::package_id(info.available_cpu_threads()[0],
+		info.cpu_info());
+
+	fake_tree tree{"powercap"};
+	const auto& root = tree.root();
+	make_fake_sysfs(tree, info);
+	ctop::power_sampler s{info, root, tree.path("/dev")};
+	assert(s.source() == ctop::power_source::powercap);
+	assert(s.readings().size() == 3);
+
+	// The package counter wraps, and used 2 J in all.
+	tree.write("/class/powercap/intel-rapl:0/energy_uj", 1500000);
+	tree.write("/class/powercap/intel-rapl:0:0/energy_uj", 2500000);
+	tree.write("/class/powercap/intel-rapl:0:1/energy_uj", 2500000);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	s.update();
+
+	const auto& r = s.readings();
+	assert(r[0].package == pkg && r[0].domain == ctop::power_domain::package);
+	assert(r[1].domain == ctop::power_domain::core);
+	assert(r[2].domain == ctop::power_domain::dram);
+	assert(std::abs(r[0].joules - 2) < 1e-9);
+	assert(std::abs(r[1].joules - 1.5) < 1e-9);
+	assert(std::abs(s.joules(ctop::power_domain::dram) - 0.5) < 1e-9);
+	assert(s.interval() > 0);
+	assert(std::abs(r[0].watts - 2 / s.interval()) < 1e-9);
+	assert(std::abs(s.energy_per_operation(1000) - 2e-3) < 1e-12);
+
+	// Without powercap, the MSRs are read instead. The fake msr file holds
+	// the unit and energy MSRs of both vendors at their offsets, with an
+	// energy unit of 2^-14 J.
+	auto cpu = info.available_cpu_threads()[0].os_id();
+	auto msr_dir = cc::format("/dev/cpu/$", cpu);
+	tree.make_dirs(msr_dir);
+	auto msr = tree.path(msr_dir + "/msr");
+	auto write_msrs = [&](uint64_t energy) {
+		// Creates the file if needed, without truncating it.
+		std::ofstream{msr, std::ios::app};
+		auto f = std::fstream{msr, std::ios::in |
+			std::ios::out | std::ios::binary};
+		auto unit = uint64_t{14} << 8;
+		for (auto p : {std::make_pair(0x606u, unit),
+			std::make_pair(0xC0010299u, unit),
+			std::make_pair(0x611u, energy),
+			std::make_pair(0xC001029Bu, energy)})
+		{
+			f.seekp(p.first);
+			f.write((const char*)&p.second, sizeof(p.second));
+		}
+	};
+	write_msrs(0xFFFFF000);
+	ctop::power_sampler m{info, tree.path("/none"), tree.path("/dev")};
+	assert(m.source() == ctop::power_source::msr);
+	// The 32-bit counter wraps, and the upper bits are ignored.
+	write_msrs(uint64_t{0xABCD} << 32 | 0x1000);
+	m.update();
+	assert(m.readings().size() == 1);
+	assert(m.joules(ctop::power_domain::package) == 0x2000 / 16384.0);
+
+	// Print the power of this machine, if RAPL is readable.
+	try {
+		ctop::power_sampler live{info};
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		live.update();
+		cc::println("Source: $.", live.source());
+		for (const auto& x : live.readings()) {
+			cc::println("Package $ $: $ W.", x.package, x.domain,
+				x.watts);
+		}
+	}
+	catch (const ctop::sysfs_error& e) {
+		cc::println(e.what());
+	}
+}
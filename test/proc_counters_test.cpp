@@ -0,0 +1,73 @@
+/*
+** File Name: proc_counters_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include <ctop/proc_counters.hpp>
+
+#include "fake_tree.hpp"
+
+static constexpr auto untouched = uint64_t{999};
+
+int main()
+{
+	fake_tree root{"proc"};
+
+	// CPU threads 1 and 3 are offline, and CPU thread 5 is beyond the end
+	// of the output. Only the per-CPU rows are counted: ERR and MIS are
+	// totals, and the row for IRQ 9 has fewer count columns than CPUs.
+	root.write("/interrupts",
+		"           CPU0       CPU2       CPU5       \n"
+		"  0:         36          0          4   IO-APIC   2-edge      "
+		"timer\n"
+		"  9:          3   IO-APIC   9-fasteoi   acpi\n"
+		" 24:   12345678  123456789          1   PCI-MSI 512000-edge  "
+		"    ahci[0000:00:1f.2]\n"
+		"NMI:          1          2          3   Non-maskable "
+		"interrupts\n"
+		"LOC:        100        200        300   Local timer "
+		"interrupts\n"
+		"ERR:          5\n"
+		"MIS:          7");
+	auto irqs = ctop::interrupt_sampler{root.root()};
+	auto out = std::vector<uint64_t>(4, untouched);
+	irqs.sample(out);
+	assert(out[0] == 36 + 12345678 + 1 + 100);
+	assert(out[2] == 123456789 + 2 + 200);
+	assert(out[1] == untouched && out[3] == untouched);
+
+	// CPU thread 2 goes offline, and keeps its last total.
+	root.write("/interrupts",
+		"           CPU0       \n"
+		"  0:         40   IO-APIC   2-edge      timer\n"
+		"LOC:        110   Local timer interrupts\n"
+		"ERR:          5");
+	irqs.sample(out);
+	assert(out[0] == 150);
+	assert(out[2] == 123456789 + 2 + 200);
+
+	// The "cpuN" lines are interleaved with the version, the timestamp,
+	// and the scheduling domains of each CPU thread, and the third field
+	// is the count of calls to `schedule()`.
+	root.write("/schedstat",
+		"version 15\n"
+		"timestamp 4295026343\n"
+		"cpu0 0 0 12345 678 9 10 111 222 333\n"
+		"domain0 00000005 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15\n"
+		"domain1 00000005 16 17 18 19 20 21 22 23 24\n"
+		"cpu2 0 0 1234567890123456789 4 5 6 7 8 9\n"
+		"domain0 00000005 30 31 32 33 34 35 36\n"
+		"cpu7 0 0 1 2 3 4 5 6 7");
+	auto sched = ctop::schedstat_sampler{root.root()};
+	out.assign(4, untouched);
+	sched.sample(out);
+	assert(out[0] == 12345);
+	assert(out[2] == 1234567890123456789);
+	assert(out[1] == untouched && out[3] == untouched);
+}
@@ -0,0 +1,71 @@
+/*
+** File Name: serialization_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <string>
+
+#include <ccbase/format.hpp>
+#include <ctop/serialization.hpp>
+#include <ctop/system_query.hpp>
+
+static std::string json(const ctop::system_info& info)
+{
+	auto ss = std::ostringstream{};
+	ctop::write_json(ss, info);
+	return ss.str();
+}
+
+int main()
+{
+	auto info = *ctop::system_query();
+
+	auto b = ctop::to_binary(info);
+	auto j = json(info);
+	cc::println(j);
+	cc::println("Binary: $ bytes, JSON: $ bytes.", b.size(), j.size());
+
+	// Both encodings should survive a round trip, and agree with each other.
+	auto from_b = ctop::from_binary(b);
+	auto from_j = ctop::from_json(j);
+	assert(ctop::to_binary(from_b) == b);
+	assert(ctop::to_binary(from_j) == b);
+	assert(json(from_j) == j);
+
+	// Reading into an existing object should reuse its storage.
+	ctop::read_binary(b, from_j);
+	ctop::read_json(j, from_b);
+	assert(json(from_b) == j);
+
+	auto expect_error = [](const std::string& buf) {
+		try {
+			ctop::from_binary(buf);
+			assert(false);
+		}
+		catch (const ctop::parse_error& e) {
+			cc::println(e.what());
+		}
+	};
+	expect_error(b.substr(0, b.size() - 1));
+
+	// A corrupt thread count must be rejected before anything is sized by
+	// it, and so must a valid count whose records were truncated.
+	auto nodes = info.available_numa_nodes().size();
+	auto threads = info.available_cpu_threads().size();
+	auto at = b.size() - 4 - 13 * nodes - 8 * threads - 4;
+	assert(uint8_t(b[at]) == threads % 256);
+	auto corrupt = b;
+	std::fill_n(corrupt.begin() + at, 4, '\xFF');
+	expect_error(corrupt);
+	expect_error(b.substr(0, at + 4));
+
+	// The same for the node count.
+	corrupt = b;
+	std::fill_n(corrupt.begin() + (b.size() - 4 - 13 * nodes), 4, '\x7F');
+	expect_error(corrupt);
+}
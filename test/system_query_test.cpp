@@ -18,6 +18,9 @@ int main()
 	for (const auto& cache : info.cpu_info().caches()) {
 		cc::println(cache);
 	}
+	for (const auto& tlb : info.cpu_info().tlbs()) {
+		cc::println(tlb);
+	}
 
 	// Print information local to each NUMA node.
 	for (const auto& node : info.available_numa_nodes()) {
@@ -0,0 +1,77 @@
+/*
+** File Name: telemetry_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include <ccbase/format.hpp>
+#include <ctop/system_query.hpp>
+#include <ctop/telemetry.hpp>
+
+#include "fake_tree.hpp"
+
+int main()
+{
+	auto info = *ctop::system_query();
+
+	fake_tree dir{"telemetry"};
+	auto data = dir.path("/telemetry.dat");
+	auto prom = dir.path("/telemetry.prom");
+
+	{
+		ctop::telemetry_recorder r{info, data, prom,
+			std::chrono::milliseconds(10), std::chrono::milliseconds(50)};
+		r.start();
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	}
+
+	ctop::telemetry_file f{data};
+	assert(f.topology().available_cpu_threads().size() ==
+		info.available_cpu_threads().size());
+
+	auto rows = size_t{};
+	for (const auto& b : f.blocks()) {
+		assert(b.begin_ns <= b.end_ns);
+		for (auto i = 0u; i != b.rows; ++i) {
+			assert(b.timestamp_ns[i] >= b.begin_ns);
+			assert(b.timestamp_ns[i] <= b.end_ns);
+			assert(b.utilization[i] >= 0 && b.utilization[i] <= 1);
+		}
+		rows += b.rows;
+	}
+	assert(rows % info.available_cpu_threads().size() == 0);
+	cc::println("Recorded $ rows in $ blocks.", rows, f.blocks().size());
+	std::cout << std::ifstream{prom}.rdbuf();
+
+	// The directory of the textfile is removed while the recorder runs. The
+	// failed flushes are recorded instead of terminating the process.
+	auto sub = dir.path("/textfile");
+	dir.make_dirs("/textfile");
+	{
+		ctop::telemetry_recorder r{info, "", sub + "/telemetry.prom",
+			std::chrono::milliseconds(10), std::chrono::milliseconds(20)};
+		r.start();
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		std::remove((sub + "/telemetry.prom").c_str());
+		std::remove(sub.c_str());
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		r.stop();
+		assert(r.errors() != 0);
+		try {
+			std::rethrow_exception(r.last_error());
+		}
+		catch (const std::exception& e) {
+			cc::println("Recorded $ errors; last: $.", r.errors(),
+				e.what());
+		}
+	}
+}
@@ -0,0 +1,132 @@
+/*
+** File Name: thermal_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <ccbase/format.hpp>
+#include <ctop/system_query.hpp>
+#include <ctop/thermal.hpp>
+
+#include "fake_tree.hpp"
+
+using ctop::throttle_scope;
+using regs = std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>;
+
+/*
+** Fills in a sysfs tree in which every CPU thread is in package 0, and the
+** kernel numbers the cores from zero in the order of their IDs. The coretemp
+** device reports 60 degrees for the package and 70 for core 0 only.
+*/
+static void
+make_fake_sysfs(const fake_tree& root, const ctop::system_info& info)
+{
+	auto core = 0u;
+	for (const auto& p : domain_cpus(ctop::topology_domain::core, info)) {
+		for (auto cpu : p.second) {
+			auto dir = cc::format("/devices/system/cpu/cpu$", cpu);
+			root.write(dir + "/topology/physical_package_id", 0);
+			root.write(dir + "/topology/core_id", core);
+			root.write(dir + "/thermal_throttle/core_throttle_count",
+				0);
+			root.write(dir + "/thermal_throttle/"
+				"package_throttle_count", 0);
+		}
+		++core;
+	}
+
+	auto hwmon = std::string{"/class/hwmon/hwmon0"};
+	root.write(hwmon + "/name", "coretemp");
+	root.write(hwmon + "/temp1_label", "Package id 0");
+	root.write(hwmon + "/temp1_input", 60000);
+	root.write(hwmon + "/temp2_label", "Core 0");
+	root.write(hwmon + "/temp2_input", 70000);
+}
+
+static void write_count(const fake_tree& root, uint32_t cpu,
+	const char* counter, uint64_t n)
+{
+	root.write(cc::format("/devices/system/cpu/cpu$/thermal_throttle/$",
+		cpu, counter), n);
+}
+
+int main()
+{
+	// DTS, turbo, ARAT, PTM, and HWP, two thresholds, and APERF/MPERF.
+	auto leaves = std::map<uint32_t, regs>{
+		{0x0, regs{0x16, 0, 0, 0}},
+		{0x6, regs{0xC7, 2, 1, 0}},
+	};
+	auto f = ctop::detect_thermal_features([&](uint32_t leaf) {
+		return leaves.at(leaf);
+	});
+	assert(f.digital_thermal_sensor && f.turbo_boost && f.hwp);
+	assert(f.always_running_apic_timer && f.package_thermal_management);
+	assert(!f.power_limit_notification && !f.hwp_notification);
+	assert(f.effective_frequency && !f.energy_performance_bias);
+	assert(f.interrupt_thresholds == 2);
+	leaves[0x0] = regs{0x5, 0, 0, 0};
+	assert(!ctop::detect_thermal_features([&](uint32_t leaf) {
+		return leaves.at(leaf);
+	}).hwp);
+	cc::println("$.", ctop::detect_thermal_features());
+
+	auto info = *ctop::system_query();
+	fake_tree root{"thermal"};
+	make_fake_sysfs(root, info);
+	ctop::thermal_monitor m{info, root.root()};
+	auto events = std::vector<std::pair<throttle_scope, uint32_t>>{};
+	m.on_throttle([&](const ctop::throttle_event& e) {
+		events.emplace_back(e.scope, e.id);
+	});
+
+	auto cores = domain_cpus(ctop::topology_domain::core, info);
+	const auto& first = cores.begin()->second;
+	auto cpu = first.front();
+	assert(m.temperature(cpu) == 70);
+	if (cores.size() > 1) {
+		// The other cores fall back to the package temperature.
+		assert(m.temperature(std::next(cores.begin())->second.front())
+			== 60);
+	}
+
+	m.update();
+	assert(events.empty() && m.throttling_cpus().empty());
+
+	// The first core starts to throttle, and keeps throttling.
+	write_count(root, cpu, "core_throttle_count", 3);
+	m.update();
+	assert(events.size() == 1 && events[0].first == throttle_scope::core);
+	assert(events[0].second == cores.begin()->first);
+	assert(m.throttling(cpu) && m.throttling_cpus() == first);
+	assert(m.throttle_count(cpu, throttle_scope::core) == 3);
+	write_count(root, cpu, "core_throttle_count", 5);
+	m.update();
+	assert(events.size() == 1);
+
+	// The core stops, and then the package starts.
+	m.update();
+	assert(!m.throttling(cpu));
+	write_count(root, cpu, "package_throttle_count", 1);
+	m.update();
+	assert(events.size() == 2);
+	assert(events[1].first == throttle_scope::package);
+	assert(m.throttling_cpus().count() ==
+		info.available_cpu_threads().size());
+
+	// Print the state of this machine.
+	ctop::thermal_monitor live{info};
+	live.update();
+	for (auto c : live.cpus()) {
+		cc::println("CPU $: $ C, core throttled $ times.", c,
+			live.temperature(c), live.throttle_count(c,
+			throttle_scope::core));
+	}
+}
@@ -0,0 +1,68 @@
+/*
+** File Name: tlb_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <map>
+#include <tuple>
+#include <utility>
+
+#include <ctop/system_query.hpp>
+
+using ctop::cpu_vendor;
+using regs = std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>;
+using leaves = std::map<std::pair<uint32_t, uint32_t>, regs>;
+
+static ctop::global_cpu_info decode(cpu_vendor v, const leaves& l)
+{
+	auto info = ctop::global_cpu_info{};
+	info.version().vendor(v);
+	ctop::get_cpu_tlb_info(info, [&](uint32_t leaf, uint32_t subleaf) {
+		auto it = l.find({leaf, subleaf});
+		return it == l.end() ? regs{} : it->second;
+	});
+	return info;
+}
+
+int main()
+{
+	// Recorded from an AMD host: the maximum basic leaf is 0x10, and leaf 2
+	// is all zeros.
+	auto amd = leaves{{{0x0, 0}, regs{0x10, 0x68747541, 0x444D4163,
+		0x69746E65}}};
+	assert(decode(cpu_vendor::amd, amd).tlbs().empty());
+	// Leaf 2 is not consulted on AMD, even if it looks valid.
+	amd[{0x2, 0}] = regs{0x00B0B101, 0, 0, 0};
+	assert(decode(cpu_vendor::amd, amd).tlbs().empty());
+
+	// An Intel guest whose hypervisor leaves leaf 0x18 empty and reports a
+	// leaf 2 that is not in the expected form.
+	auto guest = leaves{
+		{{0x0, 0}, regs{0x1B, 0x756E6547, 0x6C65746E, 0x49656E69}},
+		{{0x2, 0}, regs{0x00FF0002, 0, 0, 0}},
+	};
+	assert(decode(cpu_vendor::intel, guest).tlbs().empty());
+
+	// With a usable leaf 2, the descriptors are decoded: 0xB0 is a 128-entry
+	// 4-way instruction TLB, and 0xB3 is a 128-entry 4-way data TLB. EDX is
+	// marked invalid.
+	guest[{0x2, 0}] = regs{0x00B0B301, 0, 0, 0x80000056};
+	auto info = decode(cpu_vendor::intel, guest);
+	assert(info.tlbs().size() == 2);
+	for (const auto& x : info.tlbs()) {
+		assert(x.entries() == 128 && x.associativity() == 4);
+		assert(x.has_4k_pages() && !x.has_2m_pages());
+	}
+
+	// Leaf 0x18 takes precedence: one subleaf with a 64-entry, 4-way L1
+	// data TLB for 4K pages.
+	guest[{0x18, 0}] = regs{0x1, 0x00040001, 16, 0x21};
+	info = decode(cpu_vendor::intel, guest);
+	assert(info.tlbs().size() == 1);
+	const auto& t = info.tlbs().front();
+	assert(t.type() == ctop::cache_type::data);
+	assert(t.level() == 1 && t.entries() == 64);
+}
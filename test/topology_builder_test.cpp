@@ -0,0 +1,127 @@
+/*
+** File Name: topology_builder_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <stdexcept>
+
+#include <ccbase/format.hpp>
+#include <ctop/cache_domain.hpp>
+#include <ctop/placement.hpp>
+#include <ctop/serialization.hpp>
+#include <ctop/sysfs.hpp>
+#include <ctop/topology_builder.hpp>
+#include <ctop/virtualization.hpp>
+
+#include "fake_tree.hpp"
+
+using ctop::server_preset;
+using ctop::topology_domain;
+
+template <class Function>
+static bool throws(const Function& f)
+{
+	try {
+		f();
+		return false;
+	}
+	catch (const std::invalid_argument&) {
+		return true;
+	}
+}
+
+int main()
+{
+	// 2 packages of 12 CCDs, each with 8 cores and an L3 cache.
+	auto genoa = ctop::server_topology(server_preset::epyc_9654).build();
+	assert(genoa.available_cpu_threads().size() == 384);
+	assert(genoa.available_numa_nodes().size() == 2);
+	assert(genoa.cpu_info().threads_per_core() == 2);
+	assert(genoa.cpu_info().version().vendor() == ctop::cpu_vendor::amd);
+	auto d = ctop::cache_domains{genoa};
+	assert(d.at_level(3).size() == 24);
+	for (const auto& l3 : d.at_level(3)) {
+		assert(l3->threads().size() == 16);
+	}
+	assert(d.at_level(2).size() == 192);
+	assert(ctop::domain_cpus(topology_domain::core, genoa).size() == 192);
+	assert(ctop::to_binary(ctop::from_binary(ctop::to_binary(genoa))) ==
+		ctop::to_binary(genoa));
+
+	// Sub-NUMA clustering splits each package into four nodes of one die.
+	auto b = ctop::server_topology(server_preset::xeon_platinum_8480);
+	b.nodes_per_package(4);
+	auto spr = b.build();
+	assert(spr.available_numa_nodes().size() == 8);
+	for (const auto& n : spr.available_numa_nodes()) {
+		assert(n.cpu_info().available_threads().size() == 28);
+		assert(n.cpu_info().uses_smt());
+	}
+	// Two bits of SMT and die ID, and four of core ID.
+	assert(b.x2apic_id(1, 0, 0) == 1 << 7);
+	assert(b.x2apic_id(0, 14, 1) == (1 << 5 | 1));
+	assert(b.os_id(0, 3, 1) == 115);
+	auto node5 = spr.available_numa_nodes()[5].cpu_info().cpus();
+	assert(node5.front() == 70 && node5.count() == 28);
+	assert(ctop::place_threads(spr, ctop::placement_policy::one_per_core,
+		112).size() == 112);
+
+	// Offline CPU threads leave holes, and a node without CPU threads is
+	// left out.
+	b.nodes_per_package(1).packages(1).dies_per_package(1).cores_per_die(4);
+	auto holes = b.offline_cpus({1, 5, 2, 6}).build();
+	assert(holes.available_cpus() == (ctop::cpu_set{0, 3, 4, 7}));
+	assert(holes.available_numa_nodes()[0].cpu_info().uses_smt());
+	b.offline_cpus({0, 5});
+	assert(!b.nodes_per_package(2).build().available_numa_nodes()[0].
+		cpu_info().uses_smt());
+	auto empty = b.offline_cpus({0, 1, 4, 5}).build();
+	assert(empty.available_numa_nodes().size() == 1);
+	assert(empty.available_numa_nodes()[0].id() == 1);
+
+	assert(throws([] { ctop::topology_builder{}.threads_per_core(3).
+		build(); }));
+	assert(throws([] { ctop::topology_builder{}.cores_per_die(6).
+		nodes_per_package(4).build(); }));
+	assert(throws([] { ctop::topology_builder{}.packages(2).
+		nodes_per_package(2).distances({{10, 21}, {21, 10}}).
+		build(); }));
+
+	// The kernel's view in the sysfs tree agrees with the `system_info`.
+	fake_tree tree{"topology"};
+	const auto& root = tree.root();
+	b = ctop::server_topology(server_preset::xeon_platinum_8480);
+	b.offline_cpus({3, 200});
+	b.write_sysfs(root);
+	auto spr_holes = b.build();
+	auto trust = ctop::assess_topology(spr_holes, {}, root);
+	assert(trust.smt == ctop::topology_trust::hardware);
+	assert(trust.packages == ctop::topology_trust::hardware);
+	auto cpu = root + "/devices/system/cpu";
+	assert((ctop::read_cpu_set(cpu + "/cpu0/topology/thread_siblings_list")
+		== ctop::cpu_set{0, 112}));
+	// The sibling of CPU 88 is offline.
+	assert((ctop::read_cpu_set(cpu + "/cpu88/topology/"
+		"thread_siblings_list") == ctop::cpu_set{88}));
+	assert(ctop::read_integer(cpu + "/cpu3/online") == 0);
+	assert(ctop::read_integer(cpu + "/cpu60/topology/physical_package_id")
+		== 1);
+	assert(ctop::read_integer(cpu + "/cpu60/topology/core_id") == 4);
+	assert(ctop::read_cpu_set(cpu + "/online").count() == 222);
+	assert(ctop::read_file(root + "/devices/system/node/node0/distance") ==
+		"10 21");
+	assert(ctop::read_cpu_set(root + "/devices/system/node/node1/cpulist")
+		== ctop::domain_cpus(topology_domain::package, 1, spr_holes));
+
+	for (auto p : {server_preset::xeon_platinum_8480,
+		server_preset::epyc_9654, server_preset::epyc_9754})
+	{
+		auto info = ctop::server_topology(p).build();
+		cc::println("$: $ CPU threads, $ L3 caches.", p,
+			info.available_cpu_threads().size(),
+			ctop::cache_domains{info}.at_level(3).size());
+	}
+}
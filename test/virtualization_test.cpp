@@ -0,0 +1,156 @@
+/*
+** File Name: virtualization_test.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+*/
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <tuple>
+
+#include <ccbase/format.hpp>
+#include <ctop/system_query.hpp>
+#include <ctop/virtualization.hpp>
+
+#include "fake_tree.hpp"
+
+using regs = std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>;
+
+/*
+** Returns recorded CPUID output with the hypervisor bit and signature given.
+*/
+static std::map<uint32_t, regs> record(bool hv_bit, const char* sig)
+{
+	uint32_t w[3] = {};
+	std::memcpy(w, sig, std::min(std::strlen(sig), sizeof(w)));
+	return {
+		{0x1, regs{0x806EC, 0, hv_bit ? 1u << 31 : 0, 0}},
+		{0x40000000, regs{0x40000001, w[0], w[1], w[2]}},
+	};
+}
+
+static ctop::hypervisor_info detect(const std::map<uint32_t, regs>& r)
+{
+	return ctop::detect_hypervisor([&](uint32_t leaf) {
+		return r.at(leaf);
+	});
+}
+
+/*
+** Four vCPUs in one package, which leaf 0xB claims are two cores with two SMT
+** threads each.
+*/
+static ctop::system_info make_info()
+{
+	auto info = ctop::system_info{};
+	auto& cpu = info.cpu_info();
+	cpu.smt_id_bits(1).core_id_bits(1).package_id_bits(30).
+		total_threads(4).total_cores(2).thread_ids_per_package(4).
+		core_ids_per_package(2);
+
+	auto c = ctop::cpu_cache{};
+	c.level(3).type(ctop::cache_type::unified).sharing_id_bits(2);
+	cpu.add(c);
+
+	info.total_numa_nodes(1);
+	for (auto i = 0u; i != 4; ++i) {
+		auto t = ctop::cpu_thread_info{};
+		t.os_id(i).x2apic_id(i);
+		info.add(t);
+	}
+	auto n = ctop::numa_node_info{};
+	n.id(0);
+	n.cpu_info().thread_data(&info.available_cpu_threads()[0]).
+		available_threads(4).uses_smt(true);
+	info.add(n);
+	return info;
+}
+
+/*
+** Writes counters in which every vCPU was idle for `2 * n` ticks more than at
+** the start, except vCPU 2, which lost half of them to steal time.
+*/
+static void write_stat(const fake_tree& root, uint64_t n)
+{
+	auto f = std::ofstream{root.path("/stat")};
+	f << "cpu  400 0 400 " << 400 + 7 * n << " 0 0 0 " << n << " 0 0\n";
+	for (auto i = 0u; i != 4; ++i) {
+		auto steal = i == 2 ? n : 0;
+		f << "cpu" << i << " 100 0 100 " << 100 + 2 * n - steal <<
+			" 0 0 0 " << steal << " 0 0\n";
+	}
+	f << "intr 0\n";
+}
+
+/*
+** Fills in a tree in which the kernel sees no SMT siblings, and all four vCPUs
+** in package 0.
+*/
+static void make_fake_root(const fake_tree& root)
+{
+	for (auto i = 0u; i != 4; ++i) {
+		auto dir = cc::format("/devices/system/cpu/cpu$/topology", i);
+		root.write(dir + "/thread_siblings_list", i);
+		root.write(dir + "/physical_package_id", 0);
+	}
+	write_stat(root, 0);
+}
+
+int main()
+{
+	assert(!detect(record(false, "KVMKVMKVM")).present());
+	auto kvm = detect(record(true, "KVMKVMKVM"));
+	assert(kvm.vendor == ctop::hypervisor_vendor::kvm);
+	assert(kvm.signature == "KVMKVMKVM" && kvm.max_leaf == 0x40000001);
+	assert(detect(record(true, "Microsoft Hv")).vendor ==
+		ctop::hypervisor_vendor::hyper_v);
+	assert(detect(record(true, "NotARealHv")).vendor ==
+		ctop::hypervisor_vendor::unknown);
+
+	auto live = *ctop::system_query();
+	auto hv = ctop::detect_hypervisor();
+	cc::println("$; $.", hv, ctop::assess_topology(live, hv));
+
+	// The kernel sees no SMT siblings, so the claim of leaf 0xB is
+	// contradicted, but the package and caches agree.
+	auto info = make_info();
+	fake_tree tree{"virtualization"};
+	const auto& root = tree.root();
+	make_fake_root(tree);
+	auto trust = ctop::assess_topology(info, kvm, root);
+	assert(trust.smt == ctop::topology_trust::inconsistent);
+	assert(trust.packages == ctop::topology_trust::hypervisor);
+	assert(trust.caches == ctop::topology_trust::hypervisor);
+	assert(ctop::assess_topology(info, {}, root).packages ==
+		ctop::topology_trust::hardware);
+
+	// Half of the last interval of vCPU 2 was stolen.
+	ctop::steal_monitor steal{info, root};
+	write_stat(tree, 150);
+	steal.update();
+	assert(steal.steal(2) == 0.5 && steal.steal(0) == 0);
+	assert((steal.overcommitted(0.1) == ctop::cpu_set{2}));
+
+	auto p = ctop::place_virtual_threads(info, trust, steal,
+		ctop::placement_policy::compact, 4);
+	assert((p == std::vector<uint32_t>{0, 1, 3, 2}));
+	// With SMT in doubt, one thread per core becomes one per vCPU.
+	p = ctop::place_virtual_threads(info, trust, steal,
+		ctop::placement_policy::one_per_core, 3);
+	assert((p == std::vector<uint32_t>{0, 1, 3}));
+
+	// vCPU 2 goes offline, and the idle counter of vCPU 1 goes backwards.
+	// Neither is mistaken for steal time.
+	tree.write("/stat",
+		"cpu  500 0 400 1000 0 0 0 150 0 0\n"
+		"cpu0 100 0 100 500 0 0 0 0 0 0\n"
+		"cpu1 110 0 100 390 0 0 0 0 0 0\n"
+		"cpu3 100 0 100 500 0 0 0 0 0 0\n"
+		"intr 0");
+	steal.update();
+	assert(steal.steal(1) == 0 && steal.steal(2) == 0);
+	assert(steal.overcommitted(0.1).empty());
+}
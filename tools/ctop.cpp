@@ -0,0 +1,137 @@
+/*
+** File Name: ctop.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** A top-like view of CPU utilization, grouped by NUMA node, package, and core.
+**
+** Usage: ctop [interval in ms [iterations]]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include <time.h>
+
+#include <ccbase/format.hpp>
+#include <ctop/cpu_stat.hpp>
+#include <ctop/system_query.hpp>
+
+using ctop::topology_domain;
+
+static double process_cpu_seconds()
+{
+	auto ts = timespec{};
+	::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_bar(double u)
+{
+	static constexpr auto width = 20u;
+	auto n = unsigned(u * width + 0.5);
+	cc::print("[");
+	for (auto i = 0u; i != width; ++i) {
+		cc::print(i < n ? "|" : " ");
+	}
+	cc::print("] ${num}%", unsigned(100 * u + 0.5));
+}
+
+int main(int argc, char** argv)
+{
+	auto interval_ms = 1000ul;
+	auto iterations = 0ul;
+	try {
+		if (argc > 3) {
+			throw std::invalid_argument{"too many arguments"};
+		}
+		if (argc > 1) {
+			interval_ms = std::stoul(argv[1]);
+		}
+		if (argc > 2) {
+			iterations = std::stoul(argv[2]);
+		}
+	}
+	catch (const std::exception&) {
+		cc::errln("Usage: $ [interval in ms [iterations]]", argv[0]);
+		return 1;
+	}
+
+	auto info = *ctop::system_query();
+	auto mon = ctop::utilization_monitor{info};
+
+	// Order the CPU threads so that each domain is contiguous.
+	auto cpus = mon.cpus();
+	auto key = [&](uint32_t cpu) {
+		return std::make_tuple(
+			mon.domain(cpu, topology_domain::numa_node).id,
+			mon.domain(cpu, topology_domain::package).id,
+			mon.domain(cpu, topology_domain::core).id, cpu);
+	};
+	std::sort(cpus.begin(), cpus.end(), [&](auto a, auto b) {
+		return key(a) < key(b);
+	});
+
+	auto interval = std::chrono::milliseconds(interval_ms);
+	auto next = std::chrono::steady_clock::now();
+	auto start_cpu = process_cpu_seconds();
+	auto start = next;
+
+	for (auto i = 1ul; iterations == 0 || i <= iterations; ++i) {
+		next += interval;
+		std::this_thread::sleep_until(next);
+		mon.update();
+
+		// Clear the screen and move the cursor home.
+		cc::print("\x1b[H\x1b[2J");
+		cc::println("ctop: $ CPU threads, $ packages, $ NUMA nodes; "
+			"interval $ ms.", cpus.size(),
+			mon.by(topology_domain::package).size(),
+			mon.by(topology_domain::numa_node).size(), interval_ms);
+
+		auto prev = std::make_tuple(~0u, ~0u, ~0u, ~0u);
+		for (auto cpu : cpus) {
+			auto cur = key(cpu);
+			const auto& node = mon.domain(cpu, topology_domain::numa_node);
+			const auto& pkg = mon.domain(cpu, topology_domain::package);
+			const auto& core = mon.domain(cpu, topology_domain::core);
+
+			if (std::get<0>(cur) != std::get<0>(prev)) {
+				cc::print("\nNUMA node ${num}          ", node.id);
+				print_bar(node.value);
+				cc::println("");
+			}
+			if (std::get<1>(cur) != std::get<1>(prev) ||
+				std::get<0>(cur) != std::get<0>(prev))
+			{
+				cc::print("  Package ${num}          ", pkg.id);
+				print_bar(pkg.value);
+				cc::println("");
+			}
+			if (std::get<2>(cur) != std::get<2>(prev) ||
+				std::get<1>(cur) != std::get<1>(prev))
+			{
+				cc::print("    Core ${num}           ", core.id);
+				print_bar(core.value);
+				cc::println("");
+			}
+			// List the SMT siblings only if there is more than one.
+			if (core.cpu_threads > 1) {
+				cc::print("      CPU ${num}          ", cpu);
+				print_bar(mon.utilization(cpu));
+				cc::println("");
+			}
+			prev = cur;
+		}
+
+		auto wall = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+		cc::println("\nMonitor overhead: $% of one CPU thread.",
+			100 * (process_cpu_seconds() - start_cpu) / wall);
+	}
+}
@@ -0,0 +1,69 @@
+/*
+** File Name: ctop_recorder.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Records per-CPU telemetry to a time-series file and a Prometheus textfile
+** until interrupted.
+**
+** Usage: ctop_recorder <data file> <prometheus file> [interval in ms [flush
+** interval in ms]]
+*/
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+#include <signal.h>
+
+#include <ccbase/format.hpp>
+#include <ctop/system_query.hpp>
+#include <ctop/telemetry.hpp>
+
+int main(int argc, char** argv)
+{
+	auto interval_ms = 100ul;
+	auto flush_ms = 10000ul;
+	try {
+		if (argc < 3 || argc > 5) {
+			throw std::invalid_argument{"wrong number of arguments"};
+		}
+		if (argc > 3) {
+			interval_ms = std::stoul(argv[3]);
+		}
+		if (argc > 4) {
+			flush_ms = std::stoul(argv[4]);
+		}
+	}
+	catch (const std::exception&) {
+		cc::errln("Usage: $ <data file> <prometheus file> [interval in ms "
+			"[flush interval in ms]]", argv[0]);
+		return 1;
+	}
+
+	// Block the termination signals before starting any threads, so that
+	// only the main thread receives them.
+	auto signals = sigset_t{};
+	::sigemptyset(&signals);
+	::sigaddset(&signals, SIGINT);
+	::sigaddset(&signals, SIGTERM);
+	::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+	auto info = *ctop::system_query();
+	ctop::telemetry_recorder rec{info, argv[1], argv[2],
+		std::chrono::milliseconds(interval_ms),
+		std::chrono::milliseconds(flush_ms)};
+	if (!rec.records_frequency()) {
+		cc::errln("Frequency is not available; recording zero.");
+	}
+	if (!rec.records_context_switches()) {
+		cc::errln("/proc/schedstat is not available; recording zero "
+			"context switches.");
+	}
+
+	rec.start();
+	auto sig = 0;
+	::sigwait(&signals, &sig);
+	rec.stop();
+}
@@ -0,0 +1,36 @@
+/*
+** File Name: native_topology.cpp
+** Author:    Aditya Ramesh
+** Date:      10/19/2026
+** Contact:   _@adityaramesh.com
+**
+** Probes the build machine and writes the header read by
+** `ctop/native_topology.hpp`. Invoked by `rake native_topology`.
+*/
+
+#include <fstream>
+
+#include <ccbase/format.hpp>
+#include <ctop/native_topology.hpp>
+#include <ctop/system_query.hpp>
+
+int main(int argc, char** argv)
+{
+	if (argc != 2) {
+		cc::errln("Usage: $ <output header>", argv[0]);
+		return 1;
+	}
+
+	auto info = *ctop::system_query();
+	auto os = std::ofstream{argv[1]};
+	if (!os) {
+		cc::errln("Failed to open ${quote} for writing.", argv[1]);
+		return 1;
+	}
+	ctop::write_native_topology(os, info);
+	os.close();
+	if (!os) {
+		cc::errln("Failed to write ${quote}.", argv[1]);
+		return 1;
+	}
+}